@@ -178,23 +178,26 @@ int
 	list.Add (staticRouting, 0);	
 	list.Add (nixRouting, 10);	
 	internet.SetRoutingHelper(list);
+	// The switches only forward, they do without the transport protocols
+	InternetStackHelper switchStack = internet;
+	switchStack.SetForwardingOnly (true);
 
 //=========== Creation of Node Containers ===========//
 //
 	NodeContainer core[num_group];				// NodeContainer for core switches
 	for (i=0; i<num_group;i++){  	
 		core[i].Create (num_core);
-		internet.Install (core[i]);		
+		switchStack.Install (core[i]);		
 	}
 	NodeContainer agg[num_pod];				// NodeContainer for aggregation switches
 	for (i=0; i<num_pod;i++){  	
 		agg[i].Create (num_agg);
-		internet.Install (agg[i]);
+		switchStack.Install (agg[i]);
 	}
 	NodeContainer edge[num_pod];				// NodeContainer for edge switches
   	for (i=0; i<num_pod;i++){  	
 		edge[i].Create (num_bridge);
-		internet.Install (edge[i]);
+		switchStack.Install (edge[i]);
 	}
 	NodeContainer bridge[num_pod];				// NodeContainer for edge bridges
   	for (i=0; i<num_pod;i++){  	
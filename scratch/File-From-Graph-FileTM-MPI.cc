@@ -32,6 +32,7 @@
 #include <stdlib.h>
 
 #include "ns3/mpi-interface.h"
+#include "ns3/graph-partition-helper.h"
 #include "ns3/flow-monitor-module.h"
 #include "ns3/bridge-helper.h"
 #include "ns3/bridge-net-device.h"
@@ -124,15 +125,8 @@ char * toString(int a,int b, int c, int d){
 	return address;
 }
 
-inline int getRackRank(int rack, int systemCount){
-  return rack % systemCount;
-}
-inline int getRackIdInRank(int rack, int systemCount){
-  return rack / systemCount;
-}
-Ptr<Node> getPointerToRack(int rack, NodeContainer* cons, int systemCount){
-   int x = getRackRank(rack, systemCount), y = getRackIdInRank(rack, systemCount);
-   return cons[x].Get(y);
+inline int getRackRank(int rack, const GraphPartitionHelper &partitioner){
+  return partitioner.GetPartition(rack);
 }
 
 
@@ -141,6 +135,86 @@ inline int truncateBytes(int bytes){
    return (bytes < 10? 0 : bytes);
 }
 
+// Streams the flows of a traffic matrix file, those of one row of a
+// dense matrix or one line of a sparse one at a time, so that the
+// matrix is never held in memory.
+// dense: one row of comma separated bytes per source host, the bytes
+//        are weighted by traffic_wt and small flows dropped
+// sparse: one "source destination bytes start" line per flow, see
+//         TrafficMatrixReader, the bytes are sent as given
+class trafficMatrixStream{
+   public:
+      trafficMatrixStream(bool sparse, int total_host, double traffic_wt)
+         : sparse(sparse), total_host(total_host), traffic_wt(traffic_wt),
+           row(0), max_traffic(0.0), nskipped(0){
+      }
+      bool open(string filename){
+         row = 0;
+         nskipped = 0;
+         if(sparse){
+            reader.Close();
+            return reader.Open(filename);
+         }
+         tmfile.close();
+         tmfile.clear();
+         tmfile.open(filename.c_str());
+         return tmfile.is_open();
+      }
+      // Fills flows with the next flows to send, false at the end of the file
+      bool next(vector<TrafficMatrixReader::Flow> &flows){
+         flows.clear();
+         TrafficMatrixReader::Flow f;
+         if(sparse){
+            while(reader.Read(f)){
+               if(f.source >= (uint32_t)total_host || f.destination >= (uint32_t)total_host){
+                  nskipped++;
+                  continue;
+               }
+               max_traffic = max(max_traffic, (double)f.bytes);
+               if(f.bytes > 0){
+                  flows.push_back(f);
+                  return true;
+               }
+            }
+            return false;
+         }
+         string line;
+         if(row >= total_host || !getline(tmfile, line)) return false;
+         std::replace(line.begin(), line.end(), ',', ' ');  // replace ',' by ' '
+         stringstream ss(line);
+         double temp;
+         f.source = row++;
+         f.destination = 0;
+         f.start = Seconds (0.0);
+         while (ss >> temp){
+            max_traffic = max(max_traffic, temp);
+            int bytes = truncateBytes((int)(temp * traffic_wt));
+            if(f.destination < (uint32_t)total_host && bytes >= 1){
+               f.bytes = bytes;
+               flows.push_back(f);
+            }
+            f.destination++;
+         }
+         return true;
+      }
+      double getMaxTraffic() const{
+         return max_traffic;
+      }
+      // number of flows whose hosts are out of range
+      int getNSkipped() const{
+         return nskipped;
+      }
+   private:
+      bool sparse;
+      int total_host;
+      double traffic_wt;
+      TrafficMatrixReader reader;
+      ifstream tmfile;
+      int row;
+      double max_traffic;
+      int nskipped;
+};
+
 // Main function
 //
 int 
@@ -158,7 +232,7 @@ int
    int nreqarg = 5;
    if(argc <= nreqarg){
       cout<<nreqarg-1<<" arguments required, "<<argc-1<<" given."<<endl;
-      cout<<"Usage> <exec> <topology_file> <tm_file> <result_file> <drop queue limit(e.g. 100 for a limit of 100 packets)> <background data rate (e.g. 10 for 10 Mbps) >"<<endl;
+      cout<<"Usage> <exec> <topology_file> <tm_file> <result_file> <drop queue limit(e.g. 100 for a limit of 100 packets)> <background data rate (e.g. 10 for 10 Mbps) > [tm format: dense (default) or sparse]"<<endl;
       exit(0);
    }
    string topology_filename = argv[1];
@@ -166,6 +240,10 @@ int
    string result_filename = argv[3];
    int drop_queue_limit = atoi(argv[4]);
    string background_datarate = argv[5];
+   // dense: one row of comma separated bytes per source host, all flows
+   //        start within the first 10 ms
+   // sparse: one "source destination bytes start" line per flow
+   bool sparse_tm = (argc > 6 && string(argv[6]) == "sparse");
 
 
    cout<<"Setting resolution to "<<Time::NS<<endl;
@@ -179,7 +257,6 @@ int
 
 //==== Simulation Parameters ====//
    double simTimeInSec = 10.0;
-	bool onOffApplication = false;	
 
 
 //=========== Define topology  ===========//
@@ -188,7 +265,6 @@ int
    static int total_host = 0;	// number of hosts in the entire network	
    static vector<vector<int> > networkLinks;
    static vector<vector<int> > hostsInTor;
-   static vector<vector<double> > serverTM;
    static map<int, int> hostToTor;
 	//char filename [] = "statistics/File-From-Graph.xml";// filename for Flow Monitor xml output file
    //string topology_filename = "topology/ns3_deg4_sw8_svr8_os1_i1.edgelist";
@@ -199,28 +275,6 @@ int
    
    class topologyUtility{
       public:
-         static void readServerTmFromFile(string tmfile){
-            //< read TM from the TM File
-            ifstream myfile(tmfile.c_str());
-            string line;
-            if (myfile.is_open()){
-               string delimiter = ",";
-               while(myfile.good()){
-                  getline(myfile, line);
-                  std::replace(line.begin(), line.end(), ',', ' ');  // replace ',' by ' '
-                  vector<double> array;
-                  stringstream ss(line);
-                  double temp;
-                  while (ss >> temp){
-                      array.push_back(temp); 
-                      //cout<<temp<<",";
-                  }
-                  serverTM.push_back(array);
-                  //cout<<endl;
-               }
-               myfile.close();
-            }
-         }
          static void readTopologyFromFile(string topofile){
             //< read graph from the graphFile
             ifstream myfile(topofile.c_str());
@@ -335,7 +389,6 @@ int
    };
 
    topologyUtility::readTopologyFromFile(topology_filename);
-   topologyUtility::readServerTmFromFile(tm_filename);
 
 // Define variables for On/Off Application
 // These values will be used to serve the purpose that addresses of server and client are selected randomly
@@ -350,14 +403,12 @@ int
 //
 	int port = 9; //port for background app
    int fg_port = 10; //port for foreground app
-	int packetSize = 1024;		// 1024 bytes
 	string dataRate_OnOff = background_datarate + "Mbps"; //"1Mbps";
-	char maxBytes [] = "0" ; //"50000"; // "0";		// unlimited
 
 // Initialize parameters for Csma and PointToPoint protocol
 //
 	char dataRate [] = "1000Mbps";	// 1Gbps
-	float delay = 0.001;		// 0.001 ms
+	uint64_t delay = 1;		// 0.001 ms, in microseconds
 
 
 	
@@ -378,15 +429,54 @@ int
 	//list.Add (nixRouting, 10);	
 	list.Add (globalRouting, 20);	
 	internet.SetRoutingHelper(list);
+	// The switches only forward, they do without the transport protocols
+	InternetStackHelper switchStack = internet;
+	switchStack.SetForwardingOnly (true);
+
+//=========== Assignment of racks to MPI ranks ===========//
+//
+// One vertex per rack, weighted by the bytes its hosts send and receive,
+// and one edge per switch link, so that few links go through MPI.
+// Every rank computes the same assignment, in a first pass over the
+// traffic matrix.
+//
+   double traffic_wt = 0.001;
+   trafficMatrixStream tm(sparse_tm, total_host, traffic_wt);
+   vector<TrafficMatrixReader::Flow> flows;
+   GraphPartitionHelper partitioner;
+   for(int i=0; i<num_tor; i++){
+      partitioner.AddVertex(0);
+   }
+   if(!tm.open(tm_filename)){
+      cout<<"Cannot open "<<tm_filename<<endl;
+      exit(0);
+   }
+   while(tm.next(flows)){
+      for(uint32_t k=0; k<flows.size(); k++){
+         int src = topologyUtility::getHostRack(flows[k].source);
+         int dst = topologyUtility::getHostRack(flows[k].destination);
+         partitioner.SetVertexWeight(src, partitioner.GetVertexWeight(src) + flows[k].bytes);
+         partitioner.SetVertexWeight(dst, partitioner.GetVertexWeight(dst) + flows[k].bytes);
+      }
+   }
+   if(tm.getNSkipped() > 0 && systemId == 0){
+      cout<<"Skipped flows, host out of range (total_host "<<total_host<<"): "<<tm.getNSkipped()<<endl;
+   }
+   for(int i=0; i<num_tor; i++){
+      for(int h=0; h<networkLinks[i].size(); h++){
+         partitioner.AddEdge(i, networkLinks[i][h]);
+      }
+   }
+   partitioner.Partition(systemCount);
+   if(systemId == 0){
+      cout<<"Rack assignment: ";
+      partitioner.Print(cout);
+   }
 
 //=========== Creation of Node Containers ===========//
 
-	NodeContainer tors[systemCount];				// NodeContainer of ToR switches, one for all MPI ranks
-   for(int i=0; i<systemCount; i++){
-      int ntorsInRank = num_tor/systemCount + (i<(num_tor%systemCount)? 1 : 0); 
-      tors[i].Create(ntorsInRank, i);  //Assign tors to MPI ranks in a round robin way
-      internet.Install(tors[i]);
-   }
+	NodeContainer tors = partitioner.Create();				// NodeContainer of ToR switches, with the system id of their rank
+   switchStack.Install(tors);
 
 /*
 	NodeContainer bridges;				// NodeContainer for all ToR bridges
@@ -395,91 +485,53 @@ int
 */
    NodeContainer rackhosts[num_tor];
 	for (int i=0; i<num_tor;i++){  	
-		rackhosts[i].Create (hostsInTor[i].size(), i%systemCount); //all hosts go on the same rank as the tor switch
+		rackhosts[i].Create (hostsInTor[i].size(), getRackRank(i, partitioner)); //all hosts go on the same rank as the tor switch
 		internet.Install (rackhosts[i]);		
 	}
 
-//=========== Initialize settings for On/Off Application ===========//
+//=========== Initialize settings for the flows ===========//
 //
-// Generate traffics for the simulation
+// Generate traffics for the simulation, in a second pass over the
+// traffic matrix. Every flow of a host is sent by a single application,
+// which opens the socket of a flow at its start time only; only the
+// hosts of this rank get one.
 //
 
    srand(7);
 
    cout<<"Creating background application .... "<<endl;
 
-   double max_traffic = 0.0;
-   for(int i=0; i<total_host; i++){
-      //cout<<"row.size(): "<<serverTM[i].size()<<endl;
-      max_traffic = max(max_traffic, *std::max_element(serverTM[i].begin(),serverTM[i].end()));
-   }
-   double traffic_wt = 0.001;
-   cout<<"Max Traffic: "<<max_traffic<<", Weighted: "<<max_traffic * traffic_wt<<endl;
+   if(sparse_tm) cout<<"Max Traffic: "<<tm.getMaxTraffic()<<endl;
+   else cout<<"Max Traffic: "<<tm.getMaxTraffic()<<", Weighted: "<<tm.getMaxTraffic() * traffic_wt<<endl;
 
-	ApplicationContainer** background_app = new ApplicationContainer*[total_host];
-   for(int i=0; i<total_host; i++)
-      background_app[i] = new ApplicationContainer[total_host];
+   TrafficMatrixHelper source ("ns3::TcpSocketFactory");
+   vector<Ptr<TrafficMatrixApplication> > background_app(total_host);
    int nflows = 0, total_bytes=0;
-   for(int i=0; i<total_host; i++){
-      int rack = topologyUtility::getHostRack(i);
-      if(getRackRank(rack, systemCount) == systemId){
-         for(int j=0; j<total_host; j++){
-            int bytes = truncateBytes((int)(serverTM[i][j] * traffic_wt));
-            //cout<<"bytes: "<<bytes<<endl;
-            if(bytes < 1) continue;
-            nflows++;
-            total_bytes += bytes;
-            char* bytes_c = new char[50];
-            sprintf(bytes_c,"%d",bytes);
-            string bytes_s = bytes_c;
-            if(i%100 == 0 && j%100 == 0)
-               cout<<"Bytes = "<<bytes_c<<endl;
-
-            char *add = topologyUtility::getHostIpAddress(j);
-
-            OnOffHelper oo = OnOffHelper("ns3::TcpSocketFactory",Address(InetSocketAddress(Ipv4Address(add), port))); // ip address of remote server
-            //OnOffHelper oo = OnOffHelper("ns3::UdpSocketFactory",Address(InetSocketAddress(Ipv4Address(add), port))); // ip address of server
-            BulkSendHelper source ("ns3::TcpSocketFactory", Address(InetSocketAddress(Ipv4Address(add), port)));
-            // Initialize On/Off Application with addresss of server
-            if(onOffApplication){
-               double onTime = 0.010, offTime = 0.010;
-               oo.SetAttribute("OnTime",RandomVariableValue(ExponentialVariable(onTime)));  
-               oo.SetAttribute("OffTime",RandomVariableValue(ExponentialVariable(offTime))); 
-               oo.SetAttribute("PacketSize",UintegerValue (packetSize));
-               oo.SetAttribute("DataRate",StringValue (dataRate_OnOff));      
-               oo.SetAttribute("MaxBytes",StringValue (bytes_c));
-            }
-            //Initialize BulkSend background_application
-            else{
-               // Set the amount of data to send in bytes.  Zero is unlimited.
-               //cout<<"Max Bytes: "<<bytes_c<<endl;
-               source.SetAttribute("MaxBytes",StringValue (bytes_c));
-            }
-            //cout<<i<<"-->"<<j<<std::endl;
-            // Install On/Off Application to the client
-            if(onOffApplication){
-               NodeContainer onoff;
-               onoff.Add(rackhosts[rack].Get(topologyUtility::getHostIndexInRack(i)));
-               background_app[i][j] = oo.Install (onoff);
-               //std::cout << "Finished creating On/Off traffic"<<"\n";
-            }
-            //For bulk send
-            else{
-               NodeContainer bulksend;
-               bulksend.Add(rackhosts[rack].Get(topologyUtility::getHostIndexInRack(i)));
-               background_app[i][j] = source.Install (bulksend);
-               //background_app[i][j].Start (Seconds (1.0));
-               //background_app[i][j].Stop (Seconds (simTimeInSec));
-               //std::cout << "Finished creating Bulk send and Packet Sink Applications"<<"\n";
-            }
+   tm.open(tm_filename);
+   while(tm.next(flows)){
+      for(uint32_t k=0; k<flows.size(); k++){
+         TrafficMatrixReader::Flow &f = flows[k];
+         int i = f.source, j = f.destination;
+         int rack = topologyUtility::getHostRack(i);
+         if(getRackRank(rack, partitioner) != systemId) continue;
+         nflows++;
+         total_bytes += f.bytes;
+         if(i%100 == 0 && j%100 == 0)
+            cout<<"Bytes = "<<f.bytes<<endl;
+         if(background_app[i] == 0){
+            Ptr<Node> host = rackhosts[rack].Get(topologyUtility::getHostIndexInRack(i));
+            background_app[i] = source.Install(host).Get(0)->GetObject<TrafficMatrixApplication>();
          }
+         if(!sparse_tm) f.start = Seconds (rand() * 0.01/RAND_MAX);
+         char *add = topologyUtility::getHostIpAddress(j);
+         background_app[i]->AddFlow(InetSocketAddress(Ipv4Address(add), port), f.bytes, f.start);
       }
    }
    cout<<"Total Flows in the system: "<<nflows<<" carrying "<<total_bytes<<" bytes"<<endl;
 
    for(int i=0;i<total_host; i++){
       int rack = topologyUtility::getHostRack(i);
-      if(getRackRank(rack, systemCount) == systemId){
+      if(getRackRank(rack, partitioner) == systemId){
          //Create packet sink background_application on every server, if server belongs to my rank
          PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
          int irack = topologyUtility::getHostRack(i);
@@ -506,14 +558,14 @@ int
 //	
 	PointToPointHelper p2p;
   	p2p.SetDeviceAttribute ("DataRate", StringValue (dataRate));
-  	p2p.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (delay)));
+  	p2p.SetChannelAttribute ("Delay", TimeValue (MicroSeconds (delay)));
 
 
 // Initialize Csma helper
 //
   	CsmaHelper csma;
   	csma.SetChannelAttribute ("DataRate", StringValue (dataRate));
-  	csma.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (delay)));
+  	csma.SetChannelAttribute ("Delay", TimeValue (MicroSeconds (delay)));
 //=========== Connect switches to hosts ===========//
 
 	vector<NetDeviceContainer> sh[num_tor]; 	
@@ -524,7 +576,7 @@ int
 	}
    for (int i=0;i<num_tor;i++){
       for (int h=0; h<topologyUtility::getNumHostsInRack(i); h++){			
-         sh[i][h] = p2p.Install(getPointerToRack(i, tors, systemCount), rackhosts[i].Get(h));
+         sh[i][h] = p2p.Install(tors.Get(i), rackhosts[i].Get(h));
          //Assign subnet
          pair<char* , char*> subnet_base = topologyUtility::getHostBaseIpAddress(i, h);
          char *subnet = subnet_base.first;
@@ -546,7 +598,7 @@ int
 	for (int i=0;i<num_tor;i++){
 			for (int h=0;h<networkLinks[i].size();h++){
 				int nbr = networkLinks[i][h];
-				ss[i][h] = p2p.Install(getPointerToRack(i, tors, systemCount), getPointerToRack(nbr, tors, systemCount));
+				ss[i][h] = p2p.Install(tors.Get(i), tors.Get(nbr));
 				//Assign subnet
 				pair<char* , char*> subnet_base = topologyUtility::getLinkBaseIpAddress(i, h);
 				char *subnet = subnet_base.first;
@@ -574,16 +626,9 @@ int
 
    std::cout << "Start Simulation.. "<<"\n";
    for (int i=0;i<total_host;i++){
-      int rack = topologyUtility::getHostRack(i);
-      if(getRackRank(rack, systemCount) == systemId){
-         for (int j=0;j<total_host;j++){
-            int bytes = truncateBytes((int)(serverTM[i][j] * traffic_wt));
-            if(bytes < 1) continue;
-            //background_app[i][j].Start (Seconds (1.0));
-            background_app[i][j].Start (Seconds (rand() * 0.01/RAND_MAX));
-            background_app[i][j].Stop (Seconds (simTimeInSec));
-         }
-      }
+      if(background_app[i] == 0) continue;
+      background_app[i]->SetStartTime (Seconds (0.0));
+      background_app[i]->SetStopTime (Seconds (simTimeInSec));
 	}
 
 // Calculate Throughput using Flowmonitor
@@ -599,12 +644,13 @@ int
    sprintf(systemId_c,"%d",systemId);
    string systemId_s = systemId_c;
 
-   AsciiTraceHelper ascii;
-   Ptr<OutputStreamWrapper> ascii_fs = ascii.CreateFileStream (result_filename + systemId_s + ".tr");
+   // Binary traces, summarised per flow by utils/binary-trace-summary
+   BinaryTraceHelper binaryTrace;
+   Ptr<BinaryTraceFile> trace_fs = binaryTrace.CreateFile (result_filename + systemId_s + ".btr");
    //p2p.EnableAsciiAll (ascii.CreateFileStream ("/home/vipulharsh/jellyfish/ns3/ntu-nsi-dcn-forked/statistics/ascii_logs/distributedy" + systemId_s + ".tr"));
    for(int i=0; i<num_tor; i++){
-      //if(getRackRank(i, systemCount) == systemId){
-         p2p.EnableAscii(ascii_fs, rackhosts[i]);
+      //if(getRackRank(i, partitioner) == systemId){
+         p2p.EnableBinary(trace_fs, rackhosts[i]);
       //}
    }
    //p2p.EnablePcapAll("/home/vipulharsh/jellyfish/ns3/ntu-nsi-dcn-forked/statistics/pcap_logs/distributed");
@@ -76,37 +76,6 @@ using namespace ns3;
 using namespace std;
 NS_LOG_COMPONENT_DEFINE ("Fat-Tree-Architecture");
 
-// Function to create address string from numbers
-//
-char * ipOctectsToString(int a,int b, int c, int d){
-
-	int first = a;
-	int second = b;
-	int third = c;
-	int fourth = d;
-
-	char *address =  new char[30];
-	char firstOctet[30], secondOctet[30], thirdOctet[30], fourthOctet[30];	
-	//address = firstOctet.secondOctet.thirdOctet.fourthOctet;
-
-	bzero(address,30);
-
-	snprintf(firstOctet,10,"%d",first);
-	strcat(firstOctet,".");
-	snprintf(secondOctet,10,"%d",second);
-	strcat(secondOctet,".");
-	snprintf(thirdOctet,10,"%d",third);
-	strcat(thirdOctet,".");
-	snprintf(fourthOctet,10,"%d",fourth);
-
-	strcat(thirdOctet,fourthOctet);
-	strcat(secondOctet,thirdOctet);
-	strcat(firstOctet,secondOctet);
-	strcat(address,firstOctet);
-
-	return address;
-}
-
 inline int truncateBytes(int bytes){
    return (bytes < 10? 0 : bytes);
 }
@@ -120,7 +89,7 @@ int
    int nreqarg = 5;
    if(argc <= nreqarg){
       cout<<nreqarg-1<<" arguments required, "<<argc-1<<" given."<<endl;
-      cout<<"Usage> <exec> <topology_file> <tm_file> <result_file> <drop queue limit(e.g. 100 for a limit of 100 packets)> <data rate for on/off (e.g. 10 for 10 Mbps) >"<<endl;
+      cout<<"Usage> <exec> <topology_file> <tm_file> <result_file> <drop queue limit(e.g. 100 for a limit of 100 packets)> <data rate for on/off (e.g. 10 for 10 Mbps) > [tm format: dense (default) or sparse]"<<endl;
       exit(0);
    }
    string topology_filename = argv[1];
@@ -128,6 +97,11 @@ int
    string result_filename = argv[3];
    int drop_queue_limit = atoi(argv[4]);
    string on_off_datarate = argv[5];
+   // dense: one row of comma separated bytes per destination host, all flows start at 1 s,
+   //        the bytes are weighted by traffic_wt and small flows dropped
+   // sparse: one "source destination bytes start" line per flow, see TrafficMatrixReader,
+   //         the bytes are sent as given
+   bool sparse_tm = (argc > 6 && string(argv[6]) == "sparse");
 
 
    cout<<"Running topology: "<<topology_filename<<", output result to "<<result_filename<<endl;
@@ -137,159 +111,34 @@ int
 
 //==== Simulation Parameters ====//
    double simTimeInSec = 10000.0;
-	bool onOffApplication = false;	
 
 
 //=========== Define topology  ===========//
 //
-   static int num_tor = 0;
-   static int total_host = 0;	// number of hosts in the entire network	
-   static vector<vector<int> > networkLinks;
-   static vector<vector<int> > hostsInTor;
-   static vector<vector<double> > serverTM;
-   static map<int, int> hostToTor;
-	//char filename [] = "statistics/File-From-Graph.xml";// filename for Flow Monitor xml output file
-   //string topology_filename = "topology/ns3_deg4_sw8_svr8_os1_i1.edgelist";
-   
-   class topologyUtility{
-      public:
-         static void readServerTmFromFile(string tmfile){
-            //< read TM from the TM File
-            ifstream myfile(tmfile.c_str());
-            string line;
-            if (myfile.is_open()){
-               string delimiter = ",";
-               while(myfile.good()){
-                  getline(myfile, line);
-                  std::replace(line.begin(), line.end(), ',', ' ');  // replace ',' by ' '
-                  vector<double> array;
-                  stringstream ss(line);
-                  double temp;
-                  while (ss >> temp){
-                      array.push_back(temp); 
-                      //cout<<temp<<",";
-                  }
-                  serverTM.push_back(array);
-                  //cout<<endl;
-               }
-               myfile.close();
-            }
-         }
-         static void readTopologyFromFile(string topofile){
-            //< read graph from the graphFile
-            ifstream myfile(topofile.c_str());
-            string line;
-            vector<pair<int, int> > networkEdges, hostEdges;
-            if (myfile.is_open()){
-               while(myfile.good()){
-                  getline(myfile, line);
-                  if (line.find("->") == string::npos && line.find(" ") == string::npos) break;
-                  if(line.find(" ") != string::npos){ //host --> rack link
-                     assert(line.find("->") == string::npos);
-                     int sw1 = atoi(line.substr(0, line.find(" ")).c_str());
-                     int sw2 = atoi(line.substr(line.find(" ") + 1).c_str());
-                     num_tor = max(max(num_tor, sw1+1), sw2+1); 
-                     networkEdges.push_back(pair<int, int>(sw1, sw2));
-                     //cout<<"(sw1, sw2, num_tor): "<<sw1<<", "<<sw2<<", "<<num_tor<<endl;
-                  }
-                  if(line.find("->") != string::npos){ //host --> rack link
-                     assert(line.find(" ") == string::npos);
-                     int host = atoi(line.substr(0, line.find("->")).c_str());
-                     int rack = atoi(line.substr(line.find("->") + 2).c_str());
-                     if(rack >= num_tor){
-                        cout<<"Graph file has out of bounds nodes, "<<host<<"->"<<rack<<", NSW: "<<num_tor<<endl;
-                        exit(0);
-                     }
-                     hostEdges.push_back(pair<int, int>(host, rack));
-                     hostToTor[host] = rack;
-                     total_host++;
-                     //cout<<"(host, rack, num_tor): "<<host<<", "<<rack<<", "<<num_tor<<endl;
-                  }
-               }
-               myfile.close();
-            }
-            cout<<"num_tor: "<<num_tor<<endl;
-            cout<<"total_host: "<<total_host<<endl;
-            cout<<"num_network_edges: "<<networkEdges.size()<<endl;
-            cout<<"num_host_edges: "<<hostEdges.size()<<endl;
-            networkLinks.resize(num_tor);
-            hostsInTor.resize(num_tor);
-            for(int i=0; i<networkEdges.size(); i++){
-               pair<int, int> link = networkEdges[i];
-               networkLinks[link.first].push_back(link.second);
-            }
-            for(int i=0; i<hostEdges.size(); i++){
-               pair<int, int> hostlink = hostEdges[i];
-               hostsInTor[hostlink.second].push_back(hostlink.first);
-            }
-            //sanity check
-            for(int i=0; i<num_tor; i++){ 
-               sort(hostsInTor[i].begin(), hostsInTor[i].end());
-               for(int t=1; t<hostsInTor[i].size(); t++){
-                  if(hostsInTor[i][t] != hostsInTor[i][t-1]+1){
-                     cout<<"Hosts in Rack "<<i<<" are not contiguous"<<endl;
-                     exit(0);
-                  }
-               }
-            }
-         }
-         static pair<char*, char*> getLinkBaseIpAddress(int sw, int h){
-            char* subnet = ipOctectsToString(10, (getFirstOctetOfTor(sw) | 128), getSecondOctetOfTor(sw), 0);
-            char* base = ipOctectsToString(0, 0, 0, 2 + getNumHostsInRack(sw) + 2*h); 
-            return pair<char*, char*>(subnet, base);
-         }
-         static char* getHostIpAddress(int host){
-            int rack = getHostRack(host);
-            int ind = getHostIndexInRack(host);
-            return ipOctectsToString(10, getFirstOctetOfTor(rack), getSecondOctetOfTor(rack), ind*2 + 2);
-         }
-         static pair<char*, char*> getHostBaseIpAddress(int sw, int h){
-            char* subnet = ipOctectsToString(10, getFirstOctetOfTor(sw), getSecondOctetOfTor(sw), 0);
-            char* base = ipOctectsToString(0, 0, 0, (h*2) + 1); 
-            return pair<char*, char*>(subnet, base);
-         }
-         static pair<int, int> getRackHostsLimit(int rack){ //rack contains hosts from [l,r) ===> return (l, r)
-            pair<int, int> ret(0, 0);
-            if(hostsInTor[rack].size() > 0){
-              ret.first = hostsInTor[rack][0];
-              ret.second = hostsInTor[rack].back()+1;
-            }
-            return ret;
-         }
-         static int getHostRack(int host){
-            return hostToTor[host];
-         }
-         static int getNumHostsInRack(int rack){
-            return hostsInTor[rack].size();
-         }
-         static int getHostIndexInRack(int host){
-            return host - getRackHostsLimit(getHostRack(host)).first;
-         }
-         static int getFirstOctetOfTor(int tor){
-            return tor/256;
-         }
-         static int getSecondOctetOfTor(int tor){
-            return tor%256;
-         }
-   };
+	// Initialize PointtoPoint helper
+	//
+	char dataRate [] = "1000Mbps";	// 1Gbps
+	float delay = 0.001;		// 0.001 ms
+	PointToPointHelper p2p;
+	p2p.SetDeviceAttribute ("DataRate", StringValue (dataRate));
+	p2p.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (delay)));
 
-   topologyUtility::readTopologyFromFile(topology_filename);
-   topologyUtility::readServerTmFromFile(tm_filename);
+   PointToPointEdgeListHelper topology (p2p);
+   if(!topology.Read(topology_filename)){
+      cout<<"Cannot open "<<topology_filename<<endl;
+      exit(0);
+   }
+   int num_tor = topology.GetNSwitches();
+   int total_host = topology.GetNHosts();	// number of hosts in the entire network
+   cout<<"num_tor: "<<num_tor<<endl;
+   cout<<"total_host: "<<total_host<<endl;
 
 // Initialize parameters for On/Off application
 //
 	int port = 9; //port for background app
-	int packetSize = 1024;		// 1024 bytes
 	string dataRate_OnOff = on_off_datarate + "Mbps"; //"1Mbps";
-	char maxBytes [] = "0" ; //"50000"; // "0";		// unlimited
-
-// Initialize parameters for PointToPoint protocol
-//
-	char dataRate [] = "1000Mbps";	// 1Gbps
-	float delay = 0.001;		// 0.001 ms
 
 
-	
 // Output some useful information
 //	
 	std::cout << "Total number of hosts =  "<< total_host<<"\n";
@@ -307,18 +156,17 @@ int
 	//list.Add (nixRouting, 10);	
 	list.Add (globalRouting, 20);	
 	internet.SetRoutingHelper(list);
+	// The switches only forward, they do without the transport protocols
+	InternetStackHelper switchStack = internet;
+	switchStack.SetForwardingOnly (true);
 
-//=========== Creation of Node Containers ===========//
-
-	NodeContainer tors;				// NodeContainer for all ToR switches
-   tors.Create(num_tor);
-   internet.Install(tors);
-
-   NodeContainer rackhosts[num_tor];
-	for (int i=0; i<num_tor;i++){  	
-		rackhosts[i].Create (hostsInTor[i].size());
-		internet.Install (rackhosts[i]);		
-	}
+//=========== Creation of Nodes, Links and Addresses ===========//
+//
+   // Switches first, then the hosts of each switch; the addresses are
+   // derived from the switch and host indexes
+   topology.Install(internet, switchStack);
+	std::cout << "Finished connecting tors, hosts and switches  "<< "\n";
+	std::cout << "------------- "<<"\n";
 
 //=========== Initialize settings for On/Off Application ===========//
 //
@@ -328,137 +176,90 @@ int
 
    cout<<"Creating application flows .... "<<endl;
 
+   // Every flow of a host is sent by a single application, which opens
+   // the socket of a flow at its start time only
+   TrafficMatrixHelper source ("ns3::TcpSocketFactory");
+   vector<Ptr<TrafficMatrixApplication> > flow_app(total_host);
+   NodeContainer flow_hosts = topology.GetHosts();
+
    double max_traffic = 0.0;
-   for(int i=0; i<total_host; i++){
-      //cout<<"row.size(): "<<serverTM[i].size()<<endl;
-      max_traffic = max(max_traffic, *std::max_element(serverTM[i].begin(),serverTM[i].end()));
-   }
    double traffic_wt = 0.1;
-   cout<<"Max Traffic: "<<max_traffic<<", Weighted: "<<max_traffic * traffic_wt<<endl;
-
-	ApplicationContainer** flow_app = new ApplicationContainer*[total_host];
-   for(int i=0; i<total_host; i++)
-      flow_app[i] = new ApplicationContainer[total_host];
-   int nflows = 0, total_bytes=0;
-   for(int i=0; i<total_host; i++){
-      for(int j=0; j<total_host; j++){
-         int bytes = truncateBytes((int)(serverTM[i][j] * traffic_wt));
-         //cout<<"bytes: "<<bytes<<endl;
+   int nflows = 0, total_bytes=0, nskipped = 0;
+   vector<TrafficMatrixReader::Flow> flows;
+   TrafficMatrixReader reader;
+   ifstream tmfile;
+   int row = 0;
+   if(sparse_tm){
+      if(!reader.Open(tm_filename)){
+         cout<<"Cannot open "<<tm_filename<<endl;
+         exit(0);
+      }
+   }
+   else{
+      tmfile.open(tm_filename.c_str());
+   }
+   // The matrix is streamed, only the flows of a row are held at a time
+   while(true){
+      flows.clear();
+      if(sparse_tm){
+         TrafficMatrixReader::Flow f;
+         if(!reader.Read(f)) break;
+         if(f.source >= (uint32_t)total_host || f.destination >= (uint32_t)total_host){
+            cout<<tm_filename<<":"<<reader.GetLineNumber()<<": host out of range (total_host "<<total_host<<"), flow skipped"<<endl;
+            nskipped++;
+            continue;
+         }
+         flows.push_back(f);
+      }
+      else{
+         string line;
+         if(row >= total_host || !getline(tmfile, line)) break;
+         std::replace(line.begin(), line.end(), ',', ' ');  // replace ',' by ' '
+         stringstream ss(line);
+         double temp;
+         TrafficMatrixReader::Flow f;
+         f.source = 0;
+         f.destination = row++;
+         f.start = Seconds (1.0);
+         while (ss >> temp){
+            max_traffic = max(max_traffic, temp);
+            if(f.source < (uint32_t)total_host){
+               f.bytes = (uint32_t)temp;
+               flows.push_back(f);
+            }
+            f.source++;
+         }
+      }
+      for(uint32_t k=0; k<flows.size(); k++){
+         TrafficMatrixReader::Flow &f = flows[k];
+         int bytes = f.bytes;
+         if(sparse_tm) max_traffic = max(max_traffic, (double)f.bytes);
+         else bytes = truncateBytes((int)(f.bytes * traffic_wt));
          if(bytes < 1) continue;
          nflows++;
          total_bytes += bytes;
-         char* bytes_c = new char[50];
-         sprintf(bytes_c,"%d",bytes);
-         string bytes_s = bytes_c;
-         char *add = topologyUtility::getHostIpAddress(i);
-
-         OnOffHelper oo = OnOffHelper("ns3::TcpSocketFactory",Address(InetSocketAddress(Ipv4Address(add), port))); // ip address of server
-         BulkSendHelper source ("ns3::TcpSocketFactory", Address(InetSocketAddress(Ipv4Address(add), port)));
-         // Initialize On/Off Application with addresss of server
-         if(onOffApplication){
-            cout<<"Initializing On Off flow"<<endl;
-            double onTime = 0.010, offTime = 0.010;
-            oo.SetAttribute("OnTime",RandomVariableValue(ExponentialVariable(onTime)));  
-            oo.SetAttribute("OffTime",RandomVariableValue(ExponentialVariable(offTime))); 
-            oo.SetAttribute("PacketSize",UintegerValue (packetSize));
-            oo.SetAttribute("DataRate",StringValue (dataRate_OnOff));      
-            oo.SetAttribute("MaxBytes",StringValue (bytes_c));
-         }
-         //Initialize BulkSend application
-         else{
-            // Set the amount of data to send in bytes.  Zero is unlimited.
-            source.SetAttribute("MaxBytes",StringValue (bytes_c));
-         }
-         //cout<<i<<"-->"<<j<<std::endl;
-         int jrack = topologyUtility::getHostRack(j);
-         // Install On/Off Application to the client
-         if(onOffApplication){
-            NodeContainer onoff;
-            onoff.Add(rackhosts[jrack].Get(topologyUtility::getHostIndexInRack(j)));
-            flow_app[i][j] = oo.Install (onoff);
-            //std::cout << "Finished creating On/Off traffic"<<"\n";
-         }
-         //For bulk send
-         else{
-            NodeContainer bulksend;
-            bulksend.Add(rackhosts[jrack].Get(topologyUtility::getHostIndexInRack(j)));
-            flow_app[i][j] = source.Install (bulksend);
-            //flow_app[i][j].Start (Seconds (1.0));
-            //flow_app[i][j].Stop (Seconds (simTimeInSec));
-            //std::cout << "Finished creating Bulk send and Packet Sink Applications"<<"\n";
+         int i = f.destination, j = f.source;
+         if(flow_app[j] == 0){
+            flow_app[j] = source.Install(flow_hosts.Get(j)).Get(0)->GetObject<TrafficMatrixApplication>();
          }
+         flow_app[j]->AddFlow(InetSocketAddress(topology.GetHostIpv4Address(i), port), bytes, f.start);
       }
    }
+   if(sparse_tm) cout<<"Max Traffic: "<<max_traffic<<endl;
+   else cout<<"Max Traffic: "<<max_traffic<<", Weighted: "<<max_traffic * traffic_wt<<endl;
    cout<<"Total Flows in the system: "<<nflows<<" carrying "<<total_bytes<<" bytes"<<endl;
+   if(nskipped > 0) cout<<"Skipped flows: "<<nskipped<<endl;
 
    for(int i=0;i<total_host; i++){
       //Create packet sink application on every server
       PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
-      int irack = topologyUtility::getHostRack(i);
-      ApplicationContainer sinkApps = sink.Install (rackhosts[irack].Get(topologyUtility::getHostIndexInRack(i)));
+      ApplicationContainer sinkApps = sink.Install (flow_hosts.Get(i));
       sinkApps.Start (Seconds (0.0));
       sinkApps.Stop (Seconds (simTimeInSec));
    }
 
    cout<<"Finished creating applications"<<endl;
 
-   
-// Inintialize Address Helper
-//	
-  	Ipv4AddressHelper address;
-
-// Initialize PointtoPoint helper
-//	
-	PointToPointHelper p2p;
-  	p2p.SetDeviceAttribute ("DataRate", StringValue (dataRate));
-  	p2p.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (delay)));
-
-//=========== Connect switches to hosts ===========//
-//
-
-	vector<NetDeviceContainer> sh[num_tor]; 	
-	vector<Ipv4InterfaceContainer> ipShContainer[num_tor];
-	for(int i=0; i<num_tor; i++){
-		sh[i].resize(topologyUtility::getNumHostsInRack(i));
-		ipShContainer[i].resize(topologyUtility::getNumHostsInRack(i));
-	}
-   for (int i=0;i<num_tor;i++){
-      for (int h=0; h<topologyUtility::getNumHostsInRack(i); h++){			
-         sh[i][h] = p2p.Install(tors.Get(i), rackhosts[i].Get(h));
-         //Assign subnet
-         pair<char* , char*> subnet_base = topologyUtility::getHostBaseIpAddress(i, h);
-         char *subnet = subnet_base.first;
-         char *base =subnet_base.second;
-         address.SetBase (subnet, "255.255.255.0",base);
-         ipShContainer[i][h] = address.Assign(sh[i][h]);
-      }
-   }
-	std::cout << "Finished connecting tors and hosts  "<< "\n";
-
-//=========== Connect  switches to switches ===========//
-//
-	vector<NetDeviceContainer> ss[num_tor]; 	
-	vector<Ipv4InterfaceContainer> ipSsContainer[num_tor];
-	for(int i=0; i<num_tor; i++){
-		ss[i].resize(networkLinks[i].size());
-		ipSsContainer[i].resize(networkLinks[i].size());
-	}
-	for (int i=0;i<num_tor;i++){
-			for (int h=0;h<networkLinks[i].size();h++){
-				int nbr = networkLinks[i][h];
-				ss[i][h] = p2p.Install(tors.Get(i), tors.Get(nbr));
-				//Assign subnet
-				pair<char* , char*> subnet_base = topologyUtility::getLinkBaseIpAddress(i, h);
-				char *subnet = subnet_base.first;
-            char *base =subnet_base.second;
-            //cout<<"Network Link; "<<i<<" <--> "<<nbr<< " Nodecontainer.size: "<<ss[i][h].GetN() << endl;
-            //cout<<subnet<<" , "<<base<<endl;
-				address.SetBase (subnet, "255.255.255.0",base);
-				ipSsContainer[i][h] = address.Assign(ss[i][h]);
-			}			
-	}
-	std::cout << "Finished connecting switches and switches  "<< "\n";
-	std::cout << "------------- "<<"\n";
 
 //=========== Start the simulation ===========//
 //
@@ -475,15 +276,11 @@ int
    //   globalRouting.PrintRoutingTableAt (Seconds (10.0), tors.Get(i), routingStream);
 
    std::cout << "Start Simulation.. "<<"\n";
-   for (int i=0;i<total_host;i++){
-      for (int j=0;j<total_host;j++){
-         int bytes = truncateBytes((int)(serverTM[i][j] * traffic_wt));
-         if(bytes < 1) continue;
-		   flow_app[i][j].Start (Seconds (1.0));
-		   //flow_app[i][j].Start (Seconds (rand() * 100.0/RAND_MAX));
-  		   flow_app[i][j].Stop (Seconds (simTimeInSec));
-      }
-	}
+   for (int j=0;j<total_host;j++){
+      if(flow_app[j] == 0) continue;
+      flow_app[j]->SetStartTime (Seconds (0.0));
+      flow_app[j]->SetStopTime (Seconds (simTimeInSec));
+   }
 
 // Calculate Throughput using Flowmonitor
 //
@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "traffic-matrix-helper.h"
+#include "traffic-matrix-reader.h"
+#include "ns3/traffic-matrix-application.h"
+#include "ns3/fatal-error.h"
+#include "ns3/string.h"
+
+namespace ns3 {
+
+TrafficMatrixHelper::TrafficMatrixHelper (std::string protocol)
+{
+  m_factory.SetTypeId ("ns3::TrafficMatrixApplication");
+  m_factory.Set ("Protocol", StringValue (protocol));
+}
+
+void
+TrafficMatrixHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+ApplicationContainer
+TrafficMatrixHelper::Install (Ptr<Node> node) const
+{
+  return ApplicationContainer (InstallPriv (node));
+}
+
+ApplicationContainer
+TrafficMatrixHelper::Install (NodeContainer c) const
+{
+  ApplicationContainer apps;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      apps.Add (InstallPriv (*i));
+    }
+
+  return apps;
+}
+
+ApplicationContainer
+TrafficMatrixHelper::Install (TrafficMatrixReader &reader, NodeContainer hosts,
+                              const std::vector<Address> &peers) const
+{
+  std::vector<Ptr<TrafficMatrixApplication> > senders (hosts.GetN ());
+  TrafficMatrixReader::Flow flow;
+  while (reader.Read (flow))
+    {
+      if (flow.source >= hosts.GetN () || flow.destination >= peers.size ())
+        {
+          NS_FATAL_ERROR ("Flow on line " << reader.GetLineNumber () << " between unknown hosts "
+                          << flow.source << " and " << flow.destination);
+        }
+      if (senders[flow.source] == 0)
+        {
+          senders[flow.source] = InstallPriv (hosts.Get (flow.source))->GetObject<TrafficMatrixApplication> ();
+        }
+      senders[flow.source]->AddFlow (peers[flow.destination], flow.bytes, flow.start);
+    }
+
+  ApplicationContainer apps;
+  for (uint32_t i = 0; i < senders.size (); i++)
+    {
+      if (senders[i] != 0)
+        {
+          apps.Add (senders[i]);
+        }
+    }
+  return apps;
+}
+
+Ptr<Application>
+TrafficMatrixHelper::InstallPriv (Ptr<Node> node) const
+{
+  Ptr<Application> app = m_factory.Create<Application> ();
+  node->AddApplication (app);
+
+  return app;
+}
+
+} // namespace ns3
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_MATRIX_HELPER_H
+#define TRAFFIC_MATRIX_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ns3/object-factory.h"
+#include "ns3/address.h"
+#include "ns3/attribute.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+
+namespace ns3 {
+
+class TrafficMatrixReader;
+
+/**
+ * \brief A helper to make it easier to instantiate an
+ * ns3::TrafficMatrixApplication on a set of nodes.
+ */
+class TrafficMatrixHelper
+{
+public:
+  /**
+   * Create a TrafficMatrixHelper to make it easier to work with
+   * TrafficMatrixApplications
+   *
+   * \param protocol the name of the protocol to use to send traffic
+   *        by the applications. This string identifies the socket
+   *        factory type used to create sockets for the applications.
+   *        A typical value would be ns3::TcpSocketFactory.
+   */
+  TrafficMatrixHelper (std::string protocol);
+
+  /**
+   * Helper function used to set the underlying application attributes, 
+   * _not_ the socket attributes.
+   *
+   * \param name the name of the application attribute to set
+   * \param value the value of the application attribute to set
+   */
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Install an ns3::TrafficMatrixApplication without any flow on each
+   * node of the input container, configured with all the attributes
+   * set with SetAttribute.
+   *
+   * \param c NodeContainer of the set of nodes on which a
+   * TrafficMatrixApplication will be installed.
+   * \returns Container of Ptr to the applications installed.
+   */
+  ApplicationContainer Install (NodeContainer c) const;
+
+  /**
+   * Install an ns3::TrafficMatrixApplication without any flow on the
+   * node, configured with all the attributes set with SetAttribute.
+   *
+   * \param node The node on which a TrafficMatrixApplication will be installed.
+   * \returns Container of Ptr to the applications installed.
+   */
+  ApplicationContainer Install (Ptr<Node> node) const;
+
+  /**
+   * Read all the flows of a traffic matrix and install an
+   * ns3::TrafficMatrixApplication on each host which sends at least
+   * one of them.
+   *
+   * \param reader the open traffic matrix
+   * \param hosts the hosts, indexed as in the traffic matrix
+   * \param peers the address to which the flows to each host are
+   *        sent, indexed as in the traffic matrix
+   * \returns Container of Ptr to the applications installed, in the
+   * order of the hosts.
+   */
+  ApplicationContainer Install (TrafficMatrixReader &reader, NodeContainer hosts,
+                                const std::vector<Address> &peers) const;
+
+private:
+  /**
+   * \internal
+   * Install an ns3::TrafficMatrixApplication on the node configured with
+   * all the attributes set with SetAttribute.
+   *
+   * \param node The node on which a TrafficMatrixApplication will be installed.
+   * \returns Ptr to the application installed.
+   */
+  Ptr<Application> InstallPriv (Ptr<Node> node) const;
+  ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_MATRIX_HELPER_H */
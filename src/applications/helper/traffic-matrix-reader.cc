@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "traffic-matrix-reader.h"
+
+NS_LOG_COMPONENT_DEFINE ("TrafficMatrixReader");
+
+namespace ns3 {
+
+TrafficMatrixReader::TrafficMatrixReader ()
+  : m_line (0)
+{
+}
+
+TrafficMatrixReader::~TrafficMatrixReader ()
+{
+  Close ();
+}
+
+bool
+TrafficMatrixReader::Open (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  Close ();
+  m_file.clear ();
+  m_file.open (filename.c_str ());
+  m_filename = filename;
+  m_line = 0;
+  return m_file.is_open ();
+}
+
+void
+TrafficMatrixReader::Close (void)
+{
+  if (m_file.is_open ())
+    {
+      m_file.close ();
+    }
+}
+
+bool
+TrafficMatrixReader::Read (Flow &flow)
+{
+  std::string line;
+  while (m_file.is_open () && std::getline (m_file, line))
+    {
+      m_line++;
+      std::string::size_type comment = line.find ('#');
+      if (comment != std::string::npos)
+        {
+          line.erase (comment);
+        }
+      std::replace (line.begin (), line.end (), ',', ' ');
+      if (line.find_first_not_of (" \t\r") == std::string::npos)
+        {
+          continue;
+        }
+
+      const char *p = line.c_str ();
+      char *end;
+      double fields[4];
+      uint32_t n = 0;
+      for (; n < 4; n++)
+        {
+          fields[n] = strtod (p, &end);
+          if (end == p)
+            {
+              break;
+            }
+          p = end;
+        }
+      if (n < 4 || std::string (p).find_first_not_of (" \t\r") != std::string::npos
+          || fields[0] < 0 || fields[1] < 0 || fields[2] < 0 || fields[2] > 0xffffffffU
+          || fields[3] < 0)
+        {
+          NS_FATAL_ERROR (m_filename << ":" << m_line << ": expected \"source destination bytes start\"");
+        }
+      flow.source = (uint32_t)fields[0];
+      flow.destination = (uint32_t)fields[1];
+      flow.bytes = (uint32_t)fields[2];
+      flow.start = Seconds (fields[3]);
+      return true;
+    }
+  return false;
+}
+
+uint32_t
+TrafficMatrixReader::GetLineNumber (void) const
+{
+  return m_line;
+}
+
+} // namespace ns3
@@ -0,0 +1,84 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_MATRIX_READER_H
+#define TRAFFIC_MATRIX_READER_H
+
+#include <string>
+#include <fstream>
+#include <stdint.h>
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \brief Stream the flows of a sparse traffic matrix file.
+ *
+ * Each line holds one flow as "source destination bytes start", the
+ * fields separated by spaces or commas: the indexes of the source and
+ * destination hosts, the number of bytes to send and the start time in
+ * seconds. Blank lines and the text following a '#' are ignored.
+ *
+ * The flows are read one at a time, so that a large matrix is never
+ * held in memory; a malformed line is a fatal error.
+ */
+class TrafficMatrixReader
+{
+public:
+  /**
+   * One flow of the traffic matrix.
+   */
+  struct Flow
+  {
+    uint32_t source;      /**< index of the sending host */
+    uint32_t destination; /**< index of the receiving host */
+    uint32_t bytes;       /**< number of bytes to send */
+    Time start;           /**< start time of the flow */
+  };
+
+  TrafficMatrixReader ();
+  ~TrafficMatrixReader ();
+
+  /**
+   * \param filename the traffic matrix file
+   * \return false if the file could not be opened
+   */
+  bool Open (std::string filename);
+  /**
+   * Close the file, if open.
+   */
+  void Close (void);
+  /**
+   * \param flow filled with the next flow of the file
+   * \return false once all the flows have been read
+   */
+  bool Read (Flow &flow);
+  /**
+   * \return the number of the last line read
+   */
+  uint32_t GetLineNumber (void) const;
+
+private:
+  std::string m_filename;
+  std::ifstream m_file;
+  uint32_t m_line;
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_MATRIX_READER_H */
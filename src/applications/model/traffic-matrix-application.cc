@@ -0,0 +1,303 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/socket.h"
+#include "ns3/simulator.h"
+#include "ns3/socket-factory.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/tcp-socket-factory.h"
+#include "traffic-matrix-application.h"
+
+NS_LOG_COMPONENT_DEFINE ("TrafficMatrixApplication");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TrafficMatrixApplication);
+
+TypeId
+TrafficMatrixApplication::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TrafficMatrixApplication")
+    .SetParent<Application> ()
+    .AddConstructor<TrafficMatrixApplication> ()
+    .AddAttribute ("SendSize", "The amount of data to send each time.",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&TrafficMatrixApplication::m_sendSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Protocol", "The type of protocol to use.",
+                   TypeIdValue (TcpSocketFactory::GetTypeId ()),
+                   MakeTypeIdAccessor (&TrafficMatrixApplication::m_tid),
+                   MakeTypeIdChecker ())
+    .AddTraceSource ("Tx", "A new packet is created and is sent",
+                     MakeTraceSourceAccessor (&TrafficMatrixApplication::m_txTrace))
+  ;
+  return tid;
+}
+
+
+TrafficMatrixApplication::TrafficMatrixApplication ()
+  : m_nextPending (0),
+    m_nStarted (0),
+    m_running (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TrafficMatrixApplication::~TrafficMatrixApplication ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+TrafficMatrixApplication::AddFlow (const Address &peer, uint32_t maxBytes, Time start)
+{
+  NS_LOG_FUNCTION (this << peer << maxBytes << start);
+  PendingFlow flow;
+  flow.peer = peer;
+  flow.maxBytes = maxBytes;
+  flow.start = start;
+
+  // Flows are usually added in start time order, in which case this
+  // appends to the vector
+  std::vector<PendingFlow>::iterator i = m_pending.end ();
+  while (i != m_pending.begin () + m_nextPending && (i - 1)->start > start)
+    {
+      --i;
+    }
+  bool first = (i == m_pending.begin () + m_nextPending);
+  m_pending.insert (i, flow);
+  if (m_running && first)
+    {
+      ScheduleNextFlow ();
+    }
+}
+
+uint32_t
+TrafficMatrixApplication::GetNPendingFlows (void) const
+{
+  return m_pending.size () - m_nextPending;
+}
+
+uint32_t
+TrafficMatrixApplication::GetNActiveFlows (void) const
+{
+  return m_active.size ();
+}
+
+void
+TrafficMatrixApplication::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_startEvent.Cancel ();
+  m_pending.clear ();
+  m_active.clear ();
+  // chain up
+  Application::DoDispose ();
+}
+
+// Application Methods
+void TrafficMatrixApplication::StartApplication (void) // Called at time specified by Start
+{
+  NS_LOG_FUNCTION (this);
+  m_running = true;
+  StartFlows ();
+}
+
+void TrafficMatrixApplication::StopApplication (void) // Called at time specified by Stop
+{
+  NS_LOG_FUNCTION (this);
+  m_running = false;
+  m_startEvent.Cancel ();
+
+  // Close the sockets in the order the flows started
+  std::vector<std::pair<uint32_t, Ptr<Socket> > > sockets;
+  for (std::map<Ptr<Socket>, ActiveFlow>::const_iterator i = m_active.begin (); i != m_active.end (); ++i)
+    {
+      sockets.push_back (std::make_pair (i->second.id, i->first));
+    }
+  std::sort (sockets.begin (), sockets.end ());
+  m_active.clear ();
+  for (uint32_t i = 0; i < sockets.size (); i++)
+    {
+      sockets[i].second->Close ();
+    }
+}
+
+
+// Private helpers
+
+void TrafficMatrixApplication::ScheduleNextFlow (void)
+{
+  m_startEvent.Cancel ();
+  if (m_nextPending < m_pending.size ())
+    {
+      Time delay = std::max (m_pending[m_nextPending].start - Simulator::Now (), Seconds (0.0));
+      m_startEvent = Simulator::Schedule (delay, &TrafficMatrixApplication::StartFlows, this);
+    }
+}
+
+void TrafficMatrixApplication::StartFlows (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  while (m_running && m_nextPending < m_pending.size ()
+         && m_pending[m_nextPending].start <= Simulator::Now ())
+    {
+      StartFlow (m_pending[m_nextPending]);
+      m_nextPending++;
+    }
+  // Give back the records of the started flows
+  if (m_nextPending == m_pending.size ())
+    {
+      std::vector<PendingFlow> ().swap (m_pending);
+      m_nextPending = 0;
+    }
+  else if (2 * m_nextPending > m_pending.size ())
+    {
+      m_pending.erase (m_pending.begin (), m_pending.begin () + m_nextPending);
+      m_nextPending = 0;
+    }
+  if (m_running)
+    {
+      ScheduleNextFlow ();
+    }
+}
+
+void TrafficMatrixApplication::StartFlow (const PendingFlow &flow)
+{
+  NS_LOG_FUNCTION (this << flow.peer << flow.maxBytes);
+
+  Ptr<Socket> socket = Socket::CreateSocket (GetNode (), m_tid);
+
+  // Fatal error if socket type is not NS3_SOCK_STREAM or NS3_SOCK_SEQPACKET
+  if (socket->GetSocketType () != Socket::NS3_SOCK_STREAM &&
+      socket->GetSocketType () != Socket::NS3_SOCK_SEQPACKET)
+    {
+      NS_FATAL_ERROR ("Using TrafficMatrixApplication with an incompatible socket type. "
+                      "TrafficMatrixApplication requires SOCK_STREAM or SOCK_SEQPACKET. "
+                      "In other words, use TCP instead of UDP.");
+    }
+
+  socket->Bind ();
+  socket->Connect (flow.peer);
+  socket->ShutdownRecv ();
+  socket->SetConnectCallback (
+    MakeCallback (&TrafficMatrixApplication::ConnectionSucceeded, this),
+    MakeCallback (&TrafficMatrixApplication::ConnectionFailed, this));
+  socket->SetSendCallback (
+    MakeCallback (&TrafficMatrixApplication::DataSend, this));
+  // A refused connection is closed rather than failed
+  socket->SetCloseCallbacks (
+    MakeCallback (&TrafficMatrixApplication::ConnectionClosed, this),
+    MakeCallback (&TrafficMatrixApplication::ConnectionClosed, this));
+
+  ActiveFlow &active = m_active[socket];
+  active.id = m_nStarted++;
+  active.maxBytes = flow.maxBytes;
+  active.totBytes = 0;
+  active.connected = false;
+}
+
+void TrafficMatrixApplication::SendData (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  std::map<Ptr<Socket>, ActiveFlow>::iterator it = m_active.find (socket);
+  if (it == m_active.end ())
+    {
+      return;
+    }
+  ActiveFlow &flow = it->second;
+  while (flow.maxBytes == 0 || flow.totBytes < flow.maxBytes)
+    { // Time to send more
+      uint32_t toSend = m_sendSize;
+      // Make sure we don't send too many
+      if (flow.maxBytes > 0)
+        {
+          toSend = std::min (m_sendSize, flow.maxBytes - flow.totBytes);
+        }
+      NS_LOG_LOGIC ("sending packet at " << Simulator::Now ());
+      Ptr<Packet> packet = Create<Packet> (toSend);
+      m_txTrace (packet);
+      int actual = socket->Send (packet);
+      if (actual > 0)
+        {
+          flow.totBytes += actual;
+        }
+      // We exit this loop when actual < toSend as the send side
+      // buffer is full. The "DataSent" callback will pop when
+      // some buffer space has freed up.
+      if ((unsigned)actual != toSend)
+        {
+          break;
+        }
+    }
+  // Check if time to close (all sent). The socket finishes the
+  // connection on its own, the flow is done for the application.
+  if (flow.totBytes == flow.maxBytes && flow.connected)
+    {
+      socket->Close ();
+      m_active.erase (it);
+    }
+}
+
+void TrafficMatrixApplication::ConnectionSucceeded (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+  NS_LOG_LOGIC ("TrafficMatrixApplication Connection succeeded");
+  std::map<Ptr<Socket>, ActiveFlow>::iterator it = m_active.find (socket);
+  if (it != m_active.end ())
+    {
+      it->second.connected = true;
+      SendData (socket);
+    }
+}
+
+void TrafficMatrixApplication::ConnectionFailed (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+  NS_LOG_LOGIC ("TrafficMatrixApplication, Connection Failed");
+  m_active.erase (socket);
+}
+
+void TrafficMatrixApplication::ConnectionClosed (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+  m_active.erase (socket);
+}
+
+void TrafficMatrixApplication::DataSend (Ptr<Socket> socket, uint32_t)
+{
+  NS_LOG_FUNCTION (this);
+
+  std::map<Ptr<Socket>, ActiveFlow>::const_iterator it = m_active.find (socket);
+  if (it != m_active.end () && it->second.connected)
+    { // Only send new data if the connection has completed
+      Simulator::ScheduleNow (&TrafficMatrixApplication::SendData, this, socket);
+    }
+}
+
+} // Namespace ns3
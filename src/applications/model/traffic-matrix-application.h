@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_MATRIX_APPLICATION_H
+#define TRAFFIC_MATRIX_APPLICATION_H
+
+#include <map>
+#include <vector>
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class Socket;
+
+/**
+ * \ingroup applications
+ * \defgroup trafficmatrix TrafficMatrixApplication
+ *
+ * This traffic generator sends the flows of a traffic matrix which
+ * leave one node. Each flow behaves like a BulkSendApplication: at its
+ * start time a socket is connected to the peer, the data is sent as
+ * fast as the socket accepts it and the socket is closed once all the
+ * bytes are sent.
+ *
+ * Only a small record is kept for the flows which have not started
+ * yet, and a single event is pending for the next of them. The socket
+ * and the state of a flow exist from its start time to its completion,
+ * so that the memory used scales with the number of concurrent flows
+ * rather than with the number of flows of the matrix. Only SOCK_STREAM
+ * and SOCK_SEQPACKET sockets are supported.
+ */
+class TrafficMatrixApplication : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TrafficMatrixApplication ();
+  virtual ~TrafficMatrixApplication ();
+
+  /**
+   * \param peer the address of the receiver
+   * \param maxBytes the number of bytes to send, zero for no limit
+   * \param start the start time of the flow
+   *
+   * Flows with the same start time start in the order they were
+   * added. A flow whose start time has already passed when the
+   * application starts is started with the application.
+   */
+  void AddFlow (const Address &peer, uint32_t maxBytes, Time start);
+  /**
+   * \return the number of flows which have not started yet
+   */
+  uint32_t GetNPendingFlows (void) const;
+  /**
+   * \return the number of flows which are still sending
+   */
+  uint32_t GetNActiveFlows (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  // inherited from Application base class.
+  virtual void StartApplication (void);    // Called at time specified by Start
+  virtual void StopApplication (void);     // Called at time specified by Stop
+
+  struct PendingFlow
+  {
+    Address peer;
+    uint32_t maxBytes;
+    Time start;
+  };
+  struct ActiveFlow
+  {
+    uint32_t id;          // Order in which the flow started
+    uint32_t maxBytes;    // Limit total number of bytes sent
+    uint32_t totBytes;    // Total bytes sent so far
+    bool connected;       // True if connected
+  };
+
+  void ScheduleNextFlow (void);
+  void StartFlows (void);
+  void StartFlow (const PendingFlow &flow);
+  void SendData (Ptr<Socket> socket);
+
+  void ConnectionSucceeded (Ptr<Socket> socket);
+  void ConnectionFailed (Ptr<Socket> socket);
+  void ConnectionClosed (Ptr<Socket> socket);   // for socket's SetCloseCallbacks
+  void DataSend (Ptr<Socket> socket, uint32_t); // for socket's SetSendCallback
+
+  std::vector<PendingFlow> m_pending;  // Flows sorted by start time
+  uint32_t m_nextPending;              // First flow of m_pending not started
+  std::map<Ptr<Socket>, ActiveFlow> m_active;
+  uint32_t m_nStarted;
+  EventId m_startEvent;                // Start of the next pending flow
+  bool m_running;
+  uint32_t m_sendSize;                 // Size of data to send each time
+  TypeId m_tid;
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_MATRIX_APPLICATION_H */
@@ -0,0 +1,211 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fstream>
+#include <sstream>
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/packet-sink.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/traffic-matrix-application.h"
+#include "ns3/traffic-matrix-helper.h"
+#include "ns3/traffic-matrix-reader.h"
+
+namespace ns3 {
+
+class TrafficMatrixReaderTestCase : public TestCase
+{
+public:
+  TrafficMatrixReaderTestCase ();
+  virtual void DoRun (void);
+};
+
+TrafficMatrixReaderTestCase::TrafficMatrixReaderTestCase ()
+  : TestCase ("Check TrafficMatrixReader with comments and separators")
+{
+}
+
+void
+TrafficMatrixReaderTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("traffic-matrix.tm");
+  std::ofstream file (filename.c_str ());
+  file << "# source destination bytes start\n"
+       << "3 1 1000 1.5\n"
+       << "1,0,2000,0.25   # comma separated\n"
+       << "\n"
+       << "  0\t2 30.0 2\n";
+  file.close ();
+
+  TrafficMatrixReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (filename), true, "Could not open " << filename);
+  TrafficMatrixReader::Flow flow;
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (flow), true, "Could not read the first flow");
+  NS_TEST_ASSERT_MSG_EQ (flow.source, 3, "Unexpected source");
+  NS_TEST_ASSERT_MSG_EQ (flow.destination, 1, "Unexpected destination");
+  NS_TEST_ASSERT_MSG_EQ (flow.bytes, 1000, "Unexpected bytes");
+  NS_TEST_ASSERT_MSG_EQ (flow.start, Seconds (1.5), "Unexpected start");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetLineNumber (), 2, "Comment line not counted");
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (flow), true, "Could not read the second flow");
+  NS_TEST_ASSERT_MSG_EQ (flow.source, 1, "Unexpected source");
+  NS_TEST_ASSERT_MSG_EQ (flow.bytes, 2000, "Unexpected bytes");
+  NS_TEST_ASSERT_MSG_EQ (flow.start, Seconds (0.25), "Unexpected start");
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (flow), true, "Could not read the third flow");
+  NS_TEST_ASSERT_MSG_EQ (flow.destination, 2, "Unexpected destination");
+  NS_TEST_ASSERT_MSG_EQ (flow.bytes, 30, "Unexpected bytes");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetLineNumber (), 5, "Blank line not counted");
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (flow), false, "Read beyond the last flow");
+
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (filename + ".missing"), false, "Opened a missing file");
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (flow), false, "Read from a missing file");
+}
+
+class TrafficMatrixApplicationTestCase : public TestCase
+{
+public:
+  TrafficMatrixApplicationTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void Check (void);
+  void Tx (Ptr<const Packet> p);
+
+  Ptr<TrafficMatrixApplication> m_app;
+  Ptr<PacketSink> m_sink;
+  uint32_t m_pending;
+  uint32_t m_active;
+  uint32_t m_received;
+  uint32_t m_sent;
+};
+
+TrafficMatrixApplicationTestCase::TrafficMatrixApplicationTestCase ()
+  : TestCase ("Check that TrafficMatrixApplication starts and ends its flows"),
+    m_sent (0)
+{
+}
+
+void
+TrafficMatrixApplicationTestCase::Check (void)
+{
+  m_pending = m_app->GetNPendingFlows ();
+  m_active = m_app->GetNActiveFlows ();
+  m_received = m_sink->GetTotalRx ();
+}
+
+void
+TrafficMatrixApplicationTestCase::Tx (Ptr<const Packet> p)
+{
+  m_sent += p->GetSize ();
+}
+
+void
+TrafficMatrixApplicationTestCase::DoRun (void)
+{
+  NodeContainer n;
+  n.Create (3);
+
+  InternetStackHelper internet;
+  internet.Install (n);
+
+  // link node 0 to each of the two other nodes
+  Ipv4AddressHelper ipv4;
+  std::vector<Address> peers (n.GetN ());
+  uint16_t port = 9;
+  for (uint32_t i = 1; i < n.GetN (); i++)
+    {
+      Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+      Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+      n.Get (0)->AddDevice (txDev);
+      n.Get (i)->AddDevice (rxDev);
+      Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+      txDev->SetChannel (channel);
+      rxDev->SetChannel (channel);
+      NetDeviceContainer d;
+      d.Add (txDev);
+      d.Add (rxDev);
+      std::ostringstream subnet;
+      subnet << "10.1." << i << ".0";
+      ipv4.SetBase (subnet.str ().c_str (), "255.255.255.0");
+      Ipv4InterfaceContainer interfaces = ipv4.Assign (d);
+      peers[i] = InetSocketAddress (interfaces.GetAddress (1), port);
+    }
+
+  // Only node 1 listens, the flow to node 2 is refused
+  PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  ApplicationContainer sinkApps = sink.Install (n.Get (1));
+  m_sink = sinkApps.Get (0)->GetObject<PacketSink> ();
+
+  std::string filename = CreateTempDirFilename ("traffic-matrix.tm");
+  std::ofstream file (filename.c_str ());
+  file << "0 1 5000 2\n"
+       << "0 1 3000 1\n"
+       << "0 2 2000 1\n"
+       << "0 1 1000 1\n"
+       << "0 1 4000 4\n";
+  file.close ();
+
+  TrafficMatrixReader reader;
+  reader.Open (filename);
+  TrafficMatrixHelper helper ("ns3::TcpSocketFactory");
+  ApplicationContainer apps = helper.Install (reader, n, peers);
+  NS_TEST_ASSERT_MSG_EQ (apps.GetN (), 1, "Applications installed on hosts without flows");
+  m_app = apps.Get (0)->GetObject<TrafficMatrixApplication> ();
+  NS_TEST_ASSERT_MSG_EQ (m_app->GetNode (), n.Get (0), "Application installed on the wrong host");
+  NS_TEST_ASSERT_MSG_EQ (m_app->GetNPendingFlows (), 5, "Unexpected pending flows");
+  m_app->TraceConnectWithoutContext ("Tx", MakeCallback (&TrafficMatrixApplicationTestCase::Tx, this));
+  apps.Stop (Seconds (3.0));
+
+  Simulator::Schedule (Seconds (1.5), &TrafficMatrixApplicationTestCase::Check, this);
+  Simulator::Run ();
+
+  // The three flows at 1 s, the refused one included, are over
+  NS_TEST_ASSERT_MSG_EQ (m_pending, 2, "Unexpected pending flows at 1.5 s");
+  NS_TEST_ASSERT_MSG_EQ (m_active, 0, "Flows still active at 1.5 s");
+  NS_TEST_ASSERT_MSG_EQ (m_received, 4000, "Unexpected bytes received at 1.5 s");
+
+  // The flow at 4 s never starts as the application stops at 3 s
+  Check ();
+  NS_TEST_ASSERT_MSG_EQ (m_pending, 1, "Unexpected pending flows at the end");
+  NS_TEST_ASSERT_MSG_EQ (m_active, 0, "Flows still active at the end");
+  NS_TEST_ASSERT_MSG_EQ (m_received, 9000, "Unexpected bytes received at the end");
+  NS_TEST_ASSERT_MSG_EQ (m_sent, 9000, "Unexpected bytes sent");
+
+  Simulator::Destroy ();
+  m_app = 0;
+  m_sink = 0;
+}
+
+static class TrafficMatrixTestSuite : public TestSuite
+{
+public:
+  TrafficMatrixTestSuite ();
+} g_trafficMatrixTestSuite;
+
+TrafficMatrixTestSuite::TrafficMatrixTestSuite ()
+  : TestSuite ("traffic-matrix", UNIT)
+{
+  AddTestCase (new TrafficMatrixReaderTestCase ());
+  AddTestCase (new TrafficMatrixApplicationTestCase ());
+}
+
+} // namespace ns3
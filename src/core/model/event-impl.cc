@@ -19,9 +19,73 @@
  */
 
 #include "event-impl.h"
+#include <new>
 
 namespace ns3 {
 
+/* Events are allocated in size classes which are multiples of
+ * EVENT_GRANULARITY bytes. Blocks larger than the largest class go
+ * straight to the system allocator. Each thread keeps its own free
+ * lists (events can be scheduled from other threads with the realtime
+ * simulator), and at most EVENT_MAX_FREE blocks are kept per class so
+ * that the memory used by a burst of events is eventually returned.
+ */
+static const std::size_t EVENT_GRANULARITY = 16;
+static const std::size_t EVENT_N_CLASSES = 16;
+static const uint32_t EVENT_MAX_FREE = 16384;
+
+struct EventFreeBlock
+{
+  struct EventFreeBlock *next;
+};
+
+static __thread EventFreeBlock *g_eventFreeList[EVENT_N_CLASSES];
+static __thread uint32_t g_eventFreeCount[EVENT_N_CLASSES];
+
+static inline std::size_t
+EventSizeClass (std::size_t size)
+{
+  return (size - 1) / EVENT_GRANULARITY;
+}
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+  std::size_t sizeClass = EventSizeClass (size);
+  if (sizeClass >= EVENT_N_CLASSES)
+    {
+      return ::operator new (size);
+    }
+  EventFreeBlock *block = g_eventFreeList[sizeClass];
+  if (block == 0)
+    {
+      return ::operator new ((sizeClass + 1) * EVENT_GRANULARITY);
+    }
+  g_eventFreeList[sizeClass] = block->next;
+  g_eventFreeCount[sizeClass]--;
+  return block;
+}
+
+void
+EventImpl::operator delete (void *buffer, std::size_t size)
+{
+  if (buffer == 0)
+    {
+      return;
+    }
+  std::size_t sizeClass = EventSizeClass (size);
+  if (sizeClass >= EVENT_N_CLASSES
+      || g_eventFreeCount[sizeClass] >= EVENT_MAX_FREE)
+    {
+      ::operator delete (buffer);
+      return;
+    }
+  EventFreeBlock *block = static_cast<EventFreeBlock *> (buffer);
+  block->next = g_eventFreeList[sizeClass];
+  g_eventFreeList[sizeClass] = block;
+  g_eventFreeCount[sizeClass]++;
+}
+
 EventImpl::~EventImpl ()
 {
 }
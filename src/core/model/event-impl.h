@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 namespace ns3 {
@@ -35,6 +36,14 @@ namespace ns3 {
  * obviously (there are Ref and Unref methods) reference-counted and
  * most subclasses are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Event objects are allocated and released at a very high rate, so this
+ * class provides its own operator new and operator delete which are
+ * inherited by every subclass: small events are recycled through
+ * per-thread, size-classed free lists instead of going back to the
+ * system allocator each time. Since an event is only released when its
+ * last reference (including those held by EventId) goes away, this
+ * does not change the EventId::Cancel or EventId::IsExpired semantics.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -58,6 +67,17 @@ public:
    */
   bool IsCancelled (void);
 
+  /**
+   * \param size the size of the event object to allocate
+   * \returns a block of memory large enough to hold size bytes
+   */
+  static void *operator new (std::size_t size);
+  /**
+   * \param buffer a block previously returned by operator new
+   * \param size the size of the event object which was stored in it
+   */
+  static void operator delete (void *buffer, std::size_t size);
+
 protected:
   virtual void Notify (void) = 0;
 
@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lazy-timer.h"
+#include "simulator.h"
+
+namespace ns3 {
+
+LazyTimer::LazyTimer ()
+  : m_callback (),
+    m_event (),
+    m_deadline (),
+    m_running (false)
+{
+}
+
+LazyTimer::~LazyTimer ()
+{
+  m_event.Cancel ();
+}
+
+void
+LazyTimer::SetFunction (Callback<void> callback)
+{
+  m_callback = callback;
+}
+
+void
+LazyTimer::Schedule (Time delay)
+{
+  m_deadline = Simulator::Now () + delay;
+  m_running = true;
+  if (m_event.IsRunning () && m_event.GetTs () <= (uint64_t)m_deadline.GetTimeStep ())
+    {
+      // The pending event reschedules itself for the deadline
+      return;
+    }
+  m_event.Cancel ();
+  m_event = Simulator::Schedule (delay, &LazyTimer::Expire, this);
+}
+
+void
+LazyTimer::Cancel (void)
+{
+  m_running = false;
+}
+
+bool
+LazyTimer::IsRunning (void) const
+{
+  return m_running;
+}
+
+bool
+LazyTimer::IsExpired (void) const
+{
+  return !m_running;
+}
+
+Time
+LazyTimer::GetDelayLeft (void) const
+{
+  if (!m_running)
+    {
+      return Time ();
+    }
+  return m_deadline - Simulator::Now ();
+}
+
+void
+LazyTimer::Expire (void)
+{
+  if (!m_running)
+    {
+      return;
+    }
+  if (m_deadline > Simulator::Now ())
+    {
+      m_event = Simulator::Schedule (m_deadline - Simulator::Now (), &LazyTimer::Expire, this);
+      return;
+    }
+  m_running = false;
+  m_callback ();
+}
+
+} // namespace ns3
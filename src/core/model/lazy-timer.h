@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LAZY_TIMER_H
+#define LAZY_TIMER_H
+
+#include "nstime.h"
+#include "event-id.h"
+#include "callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ *
+ * \brief A timer which is restarted and cancelled without touching
+ * the scheduler.
+ *
+ * The timer keeps its deadline and at most one event in the
+ * scheduler. Cancelling the timer only forgets the deadline, and
+ * restarting it with a later deadline keeps the pending event: when
+ * that event expires before the deadline, it schedules itself again
+ * for the deadline. A timer restarted on every packet, such as a
+ * retransmission timer, thus costs about one event per timeout
+ * period instead of one scheduled and one cancelled event per packet.
+ *
+ * The pending event is cancelled when the timer is destroyed.
+ */
+class LazyTimer
+{
+public:
+  LazyTimer ();
+  ~LazyTimer ();
+
+  /**
+   * \param callback the function to invoke when the timer expires
+   */
+  void SetFunction (Callback<void> callback);
+
+  /**
+   * Start the timer, or restart it if it is running: it expires after
+   * delay unless it is cancelled or restarted in the meantime.
+   *
+   * \param delay the delay until the expiration
+   */
+  void Schedule (Time delay);
+  /**
+   * Stop the timer, which does not expire until it is started again.
+   */
+  void Cancel (void);
+
+  /**
+   * \returns true if the timer was started and neither expired nor
+   *          was cancelled since.
+   */
+  bool IsRunning (void) const;
+  /**
+   * \returns true if the timer is not running.
+   */
+  bool IsExpired (void) const;
+  /**
+   * \returns the time left until the expiration, or zero if the timer
+   *          is not running.
+   */
+  Time GetDelayLeft (void) const;
+
+private:
+  void Expire (void);
+
+  Callback<void> m_callback;
+  EventId m_event;  //!< The only event of this timer in the scheduler
+  Time m_deadline;  //!< The expiration time, when running
+  bool m_running;
+};
+
+} // namespace ns3
+
+#endif /* LAZY_TIMER_H */
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADING_H
+#define MULTITHREADING_H
+
+#include <sched.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ * \brief Whether several threads run simulation events at once
+ *
+ * A simulator implementation which runs the events of different
+ * nodes in different threads, such as MultithreadedSimulatorImpl,
+ * enables multithreading for the duration of its run. The state
+ * shared by all the nodes then has to be protected: the reference
+ * counts of SimpleRefCount and of the packet internals are updated
+ * with atomic instructions, and the objects shared by every node,
+ * like the FlowMonitor, take a SpinLock through a
+ * MultithreadedCriticalSection. Single threaded simulations keep
+ * the plain, cheaper, operations.
+ */
+class Multithreading
+{
+public:
+  /**
+   * Called by the simulator implementation before it starts its
+   * threads.
+   */
+  static void Enable (void);
+  /**
+   * Called by the simulator implementation once its threads are
+   * done.
+   */
+  static void Disable (void);
+  /**
+   * \returns true if several threads may be running events
+   */
+  static inline bool IsEnabled (void)
+  {
+    return m_enabled;
+  }
+
+  /**
+   * \param count a reference count to increment
+   */
+  template <typename T>
+  static inline void IncrementRefCount (T &count)
+  {
+    if (m_enabled)
+      {
+        __sync_fetch_and_add (&count, 1);
+      }
+    else
+      {
+        count++;
+      }
+  }
+  /**
+   * \param count a reference count to decrement
+   * \returns true if the count dropped to zero, i.e., the caller
+   * held the last reference
+   */
+  template <typename T>
+  static inline bool DecrementRefCount (T &count)
+  {
+    if (m_enabled)
+      {
+        return __sync_sub_and_fetch (&count, 1) == 0;
+      }
+    count--;
+    return count == 0;
+  }
+
+private:
+  static bool m_enabled;
+};
+
+/**
+ * \ingroup core
+ * \brief A lock for the short critical sections of multithreaded runs
+ *
+ * Unlike SystemMutex, it does not depend on the threading support of
+ * the platform, so that any module can use it. A thread which finds
+ * the lock held yields the processor until it is released.
+ */
+class SpinLock
+{
+public:
+  SpinLock ()
+    : m_locked (0)
+  {
+  }
+  void Lock (void)
+  {
+    while (__sync_lock_test_and_set (&m_locked, 1))
+      {
+        while (m_locked)
+          {
+            sched_yield ();
+          }
+      }
+  }
+  void Unlock (void)
+  {
+    __sync_lock_release (&m_locked);
+  }
+
+private:
+  SpinLock (const SpinLock &o);
+  SpinLock &operator = (const SpinLock &o);
+
+  volatile int m_locked;
+};
+
+/**
+ * \ingroup core
+ * \brief A critical section which only locks in multithreaded runs
+ *
+ * The lock is taken for the scope of the object if, and only if,
+ * Multithreading::IsEnabled () when it is created.
+ */
+class MultithreadedCriticalSection
+{
+public:
+  MultithreadedCriticalSection (SpinLock &lock)
+    : m_lock (Multithreading::IsEnabled () ? &lock : 0)
+  {
+    if (m_lock != 0)
+      {
+        m_lock->Lock ();
+      }
+  }
+  ~MultithreadedCriticalSection ()
+  {
+    if (m_lock != 0)
+      {
+        m_lock->Unlock ();
+      }
+  }
+
+private:
+  SpinLock *m_lock;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADING_H */
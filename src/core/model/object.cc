@@ -24,6 +24,7 @@
 #include "singleton.h"
 #include "attribute.h"
 #include "log.h"
+#include "multithreading.h"
 #include "string.h"
 #include <vector>
 #include <sstream>
@@ -151,12 +152,15 @@ Object::DoGetObject (TypeId tid) const
           // the idea is that if we perform a lookup for a TypeId on this object,
           // we are likely to perform the same lookup later so, we make sure
           // that the aggregate array is sorted by the number of accesses
-          // to each object.
-
-          // first, increment the access count
-          current->m_getObjectCount++;
-          // then, update the sort
-          UpdateSortedArray (m_aggregates, i);
+          // to each object. Not while several threads may be looking up
+          // the same array.
+          if (!Multithreading::IsEnabled ())
+            {
+              // first, increment the access count
+              current->m_getObjectCount++;
+              // then, update the sort
+              UpdateSortedArray (m_aggregates, i);
+            }
           // finally, return the match
           return const_cast<Object *> (current);
         }
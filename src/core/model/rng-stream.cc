@@ -23,6 +23,7 @@
 #include "rng-stream.h"
 #include "global-value.h"
 #include "integer.h"
+#include "multithreading.h"
 using namespace std;
 
 namespace
@@ -334,11 +335,15 @@ double RngStream::nextSeed[6] =
   12345.0, 12345.0, 12345.0, 12345.0, 12345.0, 12345.0
 };
 
+// Streams may be created from several threads in a multithreaded run
+static SpinLock g_nextSeedLock;
+
 //-------------------------------------------------------------------------
 // constructor
 //
 RngStream::RngStream ()
 {
+  MultithreadedCriticalSection cs (g_nextSeedLock);
   uint32_t run = EnsureGlobalInitialized ();
 
   anti = false;
@@ -25,6 +25,7 @@
 #include "empty.h"
 #include "default-deleter.h"
 #include "assert.h"
+#include "multithreading.h"
 #include <stdint.h>
 #include <limits>
 
@@ -58,6 +59,9 @@ namespace ns3 {
  *      it manages exist anymore.
  *
  * Interesting users of this class include ns3::Object as well as ns3::Packet.
+ *
+ * The reference count is updated atomically while
+ * Multithreading::IsEnabled ().
  */
 template <typename T, typename PARENT = empty, typename DELETER = DefaultDeleter<T> >
 class SimpleRefCount : public PARENT
@@ -82,7 +86,7 @@ public:
   inline void Ref (void) const
   {
     NS_ASSERT (m_count < std::numeric_limits<uint32_t>::max());
-    m_count++;
+    Multithreading::IncrementRefCount (m_count);
   }
   /**
    * Decrement the reference count. This method should not be called
@@ -92,8 +96,7 @@ public:
    */
   inline void Unref (void) const
   {
-    m_count--;
-    if (m_count == 0)
+    if (Multithreading::DecrementRefCount (m_count))
       {
         DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
       }
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ns3/lazy-timer.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+namespace ns3 {
+
+class LazyTimerTestCase : public TestCase
+{
+public:
+  LazyTimerTestCase ();
+  virtual void DoRun (void);
+  void Expire (void);
+  void Check (bool running, Time left);
+  uint32_t m_expired;
+  Time m_expiredTime;
+  LazyTimer m_timer;
+};
+
+LazyTimerTestCase::LazyTimerTestCase ()
+  : TestCase ("Check that a lazy timer expires at its last deadline")
+{
+}
+
+void
+LazyTimerTestCase::Expire (void)
+{
+  m_expired++;
+  m_expiredTime = Simulator::Now ();
+}
+
+void
+LazyTimerTestCase::Check (bool running, Time left)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_timer.IsRunning (), running, "Unexpected state at " << Simulator::Now ());
+  NS_TEST_EXPECT_MSG_EQ (m_timer.GetDelayLeft (), left, "Unexpected delay left at " << Simulator::Now ());
+}
+
+void
+LazyTimerTestCase::DoRun (void)
+{
+  m_expired = 0;
+  m_timer.SetFunction (MakeCallback (&LazyTimerTestCase::Expire, this));
+
+  // Restarted later and later, then sooner, then cancelled and restarted
+  m_timer.Schedule (MicroSeconds (10));
+  Simulator::Schedule (MicroSeconds (5), &LazyTimer::Schedule, &m_timer, MicroSeconds (20));
+  Simulator::Schedule (MicroSeconds (15), &LazyTimerTestCase::Check, this, true, MicroSeconds (10));
+  Simulator::Schedule (MicroSeconds (20), &LazyTimer::Schedule, &m_timer, MicroSeconds (2));
+  Simulator::Schedule (MicroSeconds (21), &LazyTimer::Cancel, &m_timer);
+  Simulator::Schedule (MicroSeconds (22), &LazyTimerTestCase::Check, this, false, Seconds (0));
+  Simulator::Schedule (MicroSeconds (23), &LazyTimer::Schedule, &m_timer, MicroSeconds (17));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_expired, 1, "The timer did not expire once");
+  NS_TEST_ASSERT_MSG_EQ (m_expiredTime, MicroSeconds (40), "The timer did not expire at its last deadline");
+  NS_TEST_ASSERT_MSG_EQ (m_timer.IsExpired (), true, "The timer still runs after expiring");
+
+  // Cancelled for good
+  m_timer.Schedule (MicroSeconds (10));
+  Simulator::Schedule (MicroSeconds (5), &LazyTimer::Cancel, &m_timer);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_expired, 1, "A cancelled timer expired");
+  Simulator::Destroy ();
+}
+
+static class LazyTimerTestSuite : public TestSuite
+{
+public:
+  LazyTimerTestSuite ()
+    : TestSuite ("lazy-timer", UNIT)
+  {
+    AddTestCase (new LazyTimerTestCase ());
+  }
+} g_lazyTimerTestSuite;
+
+} // namespace ns3
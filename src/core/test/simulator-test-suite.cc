@@ -21,9 +21,11 @@
 #include "ns3/simulator.h"
 #include "ns3/list-scheduler.h"
 #include "ns3/heap-scheduler.h"
+#include "ns3/dary-heap-scheduler.h"
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
 #include "ns3/ns2-calendar-scheduler.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -169,6 +171,129 @@ SimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_destroy, true, "Event should have run");
 }
 
+class SimulatorOrderTestCase : public TestCase
+{
+public:
+  SimulatorOrderTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+  void Record (uint32_t id, uint64_t expectedNs);
+  uint32_t m_lastId;
+  uint64_t m_lastNs;
+  uint32_t m_count;
+  bool m_inOrder;
+  ObjectFactory m_schedulerFactory;
+};
+
+SimulatorOrderTestCase::SimulatorOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that events run in timestamp and insertion order with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+void
+SimulatorOrderTestCase::Record (uint32_t id, uint64_t expectedNs)
+{
+  uint64_t now = Now ().GetNanoSeconds ();
+  if (now != expectedNs || now < m_lastNs
+      || (now == m_lastNs && m_count != 0 && id < m_lastId))
+    {
+      m_inOrder = false;
+    }
+  m_lastNs = now;
+  m_lastId = id;
+  m_count++;
+}
+
+void
+SimulatorOrderTestCase::DoRun (void)
+{
+  m_lastId = 0;
+  m_lastNs = 0;
+  m_count = 0;
+  m_inOrder = true;
+
+  Simulator::SetScheduler (m_schedulerFactory);
+
+  // a deterministic pseudo-random sequence with many equal timestamps
+  // to exercise both the deep levels of the scheduler and the tie
+  // breaking on insertion order.
+  std::vector<EventId> removed;
+  uint32_t seed = 12345;
+  uint32_t expected = 0;
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      uint64_t ns = (seed >> 16) % 200;
+      EventId id = Simulator::Schedule (NanoSeconds (ns), &SimulatorOrderTestCase::Record, this, i, ns);
+      if (i % 7 == 3)
+        {
+          removed.push_back (id);
+        }
+      else
+        {
+          expected++;
+        }
+    }
+  for (std::vector<EventId>::iterator i = removed.begin (); i != removed.end (); ++i)
+    {
+      Simulator::Remove (*i);
+    }
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_inOrder, true, "Events did not run in order");
+  NS_TEST_EXPECT_MSG_EQ (m_count, expected, "Unexpected number of events run");
+  Simulator::Destroy ();
+}
+
+class SimulatorEventRecycleTestCase : public TestCase
+{
+public:
+  SimulatorEventRecycleTestCase ();
+  virtual void DoRun (void);
+  void Count (void);
+  uint32_t m_count;
+};
+
+SimulatorEventRecycleTestCase::SimulatorEventRecycleTestCase ()
+  : TestCase ("Check that recycled events do not alias live EventIds")
+{
+}
+
+void
+SimulatorEventRecycleTestCase::Count (void)
+{
+  m_count++;
+}
+
+void
+SimulatorEventRecycleTestCase::DoRun (void)
+{
+  m_count = 0;
+  EventId expired = Simulator::Schedule (MicroSeconds (1), &SimulatorEventRecycleTestCase::Count, this);
+  EventId cancelled = Simulator::Schedule (MicroSeconds (2), &SimulatorEventRecycleTestCase::Count, this);
+  cancelled.Cancel ();
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      Simulator::Schedule (MicroSeconds (3), &SimulatorEventRecycleTestCase::Count, this);
+    }
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_count, 101, "Unexpected number of events run");
+
+  // the events which ran above have been released and can be reused
+  // by new events, but not those still referenced by an EventId.
+  EventId running = Simulator::Schedule (MicroSeconds (1), &SimulatorEventRecycleTestCase::Count, this);
+  NS_TEST_EXPECT_MSG_EQ ((running.PeekEventImpl () != expired.PeekEventImpl ()), true, "Live event was reused");
+  NS_TEST_EXPECT_MSG_EQ ((running.PeekEventImpl () != cancelled.PeekEventImpl ()), true, "Live event was reused");
+  NS_TEST_EXPECT_MSG_EQ (expired.IsExpired (), true, "Event should have expired");
+  NS_TEST_EXPECT_MSG_EQ (cancelled.IsExpired (), true, "Event was canceled: should have expired");
+  NS_TEST_EXPECT_MSG_EQ (running.IsRunning (), true, "Event should not have expired yet");
+  running.Cancel ();
+  NS_TEST_EXPECT_MSG_EQ (running.IsExpired (), true, "Event was canceled: should have expired");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_count, 101, "Canceled event was run");
+  Simulator::Destroy ();
+}
+
 class SimulatorTemplateTestCase : public TestCase
 {
 public:
@@ -474,10 +599,27 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (HeapScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (DaryHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+
+    factory.SetTypeId (ListScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory));
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory));
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory));
+    factory.SetTypeId (DaryHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory));
+    factory.SetTypeId (CalendarScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory));
+    factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory));
+
+    AddTestCase (new SimulatorEventRecycleTestCase ());
   }
 } g_simulatorTestSuite;
 
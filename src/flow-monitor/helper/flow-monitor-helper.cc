@@ -31,6 +31,7 @@
 namespace ns3 {
 
 FlowMonitorHelper::FlowMonitorHelper ()
+  : m_flowSampling (1)
 {
   m_monitorFactory.SetTypeId ("ns3::FlowMonitor");
 }
@@ -48,8 +49,7 @@ FlowMonitorHelper::GetMonitor ()
   if (!m_flowMonitor)
     {
       m_flowMonitor = m_monitorFactory.Create<FlowMonitor> ();
-      m_flowClassifier = Create<Ipv4FlowClassifier> ();
-      m_flowMonitor->SetFlowClassifier (m_flowClassifier);
+      m_flowMonitor->SetFlowClassifier (GetClassifier ());
     }
   return m_flowMonitor;
 }
@@ -60,23 +60,38 @@ FlowMonitorHelper::GetClassifier ()
 {
   if (!m_flowClassifier)
     {
-      m_flowClassifier = Create<Ipv4FlowClassifier> ();
+      Ptr<Ipv4FlowClassifier> classifier = Create<Ipv4FlowClassifier> ();
+      classifier->SetSampling (m_flowSampling);
+      m_flowClassifier = classifier;
     }
   return m_flowClassifier;
 }
 
+void
+FlowMonitorHelper::SetFlowSampling (uint32_t n)
+{
+  NS_ASSERT_MSG (!m_flowClassifier, "SetFlowSampling must be called before the Install* methods");
+  m_flowSampling = n;
+}
+
 
 Ptr<FlowMonitor>
-FlowMonitorHelper::Install (Ptr<Node> node)
+FlowMonitorHelper::Install (Ptr<Node> node, bool forwarding)
 {
   Ptr<FlowMonitor> monitor = GetMonitor ();
   Ptr<FlowClassifier> classifier = GetClassifier ();
   Ptr<Ipv4FlowProbe> probe = Create<Ipv4FlowProbe> (monitor,
                                                     DynamicCast<Ipv4FlowClassifier> (classifier),
-                                                    node);
+                                                    node, forwarding);
   return m_flowMonitor;
 }
 
+Ptr<FlowMonitor>
+FlowMonitorHelper::Install (Ptr<Node> node)
+{
+  return Install (node, true);
+}
+
 
 Ptr<FlowMonitor>
 FlowMonitorHelper::Install (NodeContainer nodes)
@@ -106,5 +121,34 @@ FlowMonitorHelper::InstallAll ()
   return m_flowMonitor;
 }
 
+Ptr<FlowMonitor>
+FlowMonitorHelper::InstallEndToEnd (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      if (node->GetObject<Ipv4L3Protocol> ())
+        {
+          Install (node, false);
+        }
+    }
+  return m_flowMonitor;
+}
+
+Ptr<FlowMonitor>
+FlowMonitorHelper::InstallEdges ()
+{
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+      if (ipv4 && ipv4->GetNInterfaces () == 2)
+        {
+          Install (node, false);
+        }
+    }
+  return m_flowMonitor;
+}
+
 
 } // namespace ns3
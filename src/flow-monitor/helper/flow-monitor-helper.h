@@ -51,6 +51,26 @@ public:
   /// \brief Enable flow monitoring on all nodes
   Ptr<FlowMonitor> InstallAll ();
 
+  /// \brief Enable end-to-end flow monitoring on a set of nodes
+  ///
+  /// Only the packets the nodes send and receive are reported, not
+  /// those they forward, which is enough for the first transmission
+  /// and last reception times of the flows. Note that the FlowMonitor
+  /// MaxPerHopDelay then applies to the end-to-end delay.
+  /// \param nodes A NodeContainer holding the end hosts
+  Ptr<FlowMonitor> InstallEndToEnd (NodeContainer nodes);
+  /// \brief Enable end-to-end flow monitoring on all the stub nodes,
+  /// that is the nodes with a single IPv4 interface besides the
+  /// loopback; the switches and routers get no probe at all. Hosts
+  /// with several interfaces, such as the servers of BCube, must be
+  /// given to InstallEndToEnd instead.
+  Ptr<FlowMonitor> InstallEdges ();
+
+  /// \brief Only monitor one flow in n, chosen by a hash of the
+  /// five-tuple. Must be called before the Install* methods.
+  /// \param n the sampling ratio, 1 to monitor all the flows
+  void SetFlowSampling (uint32_t n);
+
   /// \brief Retrieve the FlowMonitor object created by the Install* methods
   Ptr<FlowMonitor> GetMonitor ();
 
@@ -58,9 +78,12 @@ public:
   Ptr<FlowClassifier> GetClassifier ();
 
 private:
+  Ptr<FlowMonitor> Install (Ptr<Node> node, bool forwarding);
+
   ObjectFactory m_monitorFactory;
   Ptr<FlowMonitor> m_flowMonitor;
   Ptr<FlowClassifier> m_flowClassifier;
+  uint32_t m_flowSampling;
 };
 
 } // namespace ns3
@@ -32,6 +32,22 @@ FlowClassifier::~FlowClassifier ()
 {
 }
 
+std::string
+FlowClassifier::GetCsvColumns () const
+{
+  return "";
+}
+
+void
+FlowClassifier::SerializeFlowToCsv (std::ostream &os, FlowId flowId) const
+{
+}
+
+void
+FlowClassifier::ReleaseFlow (FlowId flowId)
+{
+}
+
 FlowId
 FlowClassifier::GetNewFlowId ()
 {
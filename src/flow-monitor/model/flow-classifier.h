@@ -23,12 +23,23 @@
 
 #include "ns3/simple-ref-count.h"
 #include <ostream>
+#include <string>
 
 namespace ns3 {
 
 typedef uint32_t FlowId;
 typedef uint32_t FlowPacketId;
 
+/// Hash of a FlowId for OpenHashMap; the flow ids are consecutive
+/// numbers, which the table spreads well enough by itself
+struct FlowIdHash
+{
+  uint32_t operator () (FlowId flowId) const
+  {
+    return flowId;
+  }
+};
+
 /// provides a method to translate raw packet data into abstract
 /// ``flow identifier'' and ``packet identifier'' parameters.  These
 /// identifiers are unsigned 32-bit integers that uniquely identify a
@@ -54,6 +65,17 @@ public:
 
   virtual void SerializeToXmlStream (std::ostream &os, int indent) const = 0;
 
+  /// \return the names of the columns written by SerializeFlowToCsv,
+  /// each preceded by a comma; none by default
+  virtual std::string GetCsvColumns () const;
+  /// Write the description of a flow, such as its five-tuple, as the
+  /// columns named by GetCsvColumns, each preceded by a comma
+  virtual void SerializeFlowToCsv (std::ostream &os, FlowId flowId) const;
+  /// Forget a flow which FlowMonitor exported, so that its memory is
+  /// freed; its packets seen afterwards get a new flow id.  Does
+  /// nothing by default.
+  virtual void ReleaseFlow (FlowId flowId);
+
 protected:
   FlowId GetNewFlowId ();
 
@@ -22,6 +22,9 @@
 #include "ns3/simulator.h"
 #include "ns3/log.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/abort.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -71,6 +74,15 @@ FlowMonitor::GetTypeId (void)
                    TimeValue (Seconds (0.5)),
                    MakeTimeAccessor (&FlowMonitor::m_flowInterruptionsMinTime),
                    MakeTimeChecker ())
+    .AddAttribute ("EnableHistograms", ("Whether to fill the delay, jitter, packetSize and flowInterruptions histograms."),
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FlowMonitor::m_enableHistograms),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FlowIdleTimeout", ("With EnableFlowExport, the time without any packet "
+                                       "after which a flow is considered complete and exported."),
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&FlowMonitor::m_flowIdleTimeout),
+                   MakeTimeChecker ())
   ;
   return tid;
 }
@@ -82,60 +94,99 @@ FlowMonitor::GetInstanceTypeId (void) const
 }
 
 FlowMonitor::FlowMonitor ()
-  : m_enabled (false)
+  : m_enabled (false),
+    m_enableHistograms (true)
 {
   // m_histogramBinWidth=DEFAULT_BIN_WIDTH;
 }
 
 
-inline FlowMonitor::FlowStats&
-FlowMonitor::GetStatsForFlow (FlowId flowId)
+/* The key of a packet in m_trackedPackets */
+static inline uint64_t
+TrackedPacketKey (FlowId flowId, FlowPacketId packetId)
 {
-  std::map<FlowId, FlowStats>::iterator iter;
-  iter = m_flowStats.find (flowId);
-  if (iter == m_flowStats.end ())
-    {
-      FlowMonitor::FlowStats &ref = m_flowStats[flowId];
-      ref.delaySum = Seconds (0);
-      ref.jitterSum = Seconds (0);
-      ref.lastDelay = Seconds (0);
-      ref.txBytes = 0;
-      ref.rxBytes = 0;
-      ref.txPackets = 0;
-      ref.rxPackets = 0;
-      ref.lostPackets = 0;
-      ref.timesForwarded = 0;
-      ref.delayHistogram.SetDefaultBinWidth (m_delayBinWidth);
-      ref.jitterHistogram.SetDefaultBinWidth (m_jitterBinWidth);
-      ref.packetSizeHistogram.SetDefaultBinWidth (m_packetSizeBinWidth);
-      ref.flowInterruptionsHistogram.SetDefaultBinWidth (m_flowInterruptionsBinWidth);
-      return ref;
-    }
-  else
-    {
-      return iter->second;
+  return ((uint64_t)flowId << 32) | packetId;
+}
+
+inline uint32_t
+FlowMonitor::GetFlowIndex (FlowId flowId)
+{
+  uint32_t nFlows = m_flowIndex.GetSize ();
+  uint32_t &index = m_flowIndex[flowId];
+  if (m_flowIndex.GetSize () != nFlows)
+    {
+      // first report of the flow; value-initialized, i.e. all zero
+      index = m_flowIds.size ();
+      m_flowIds.push_back (flowId);
+      m_flowCounters.push_back (FlowCounters ());
+      m_flowDetails.push_back (FlowDetails ());
+      FlowDetails &details = m_flowDetails.back ();
+      details.delayHistogram.SetDefaultBinWidth (m_delayBinWidth);
+      details.jitterHistogram.SetDefaultBinWidth (m_jitterBinWidth);
+      details.packetSizeHistogram.SetDefaultBinWidth (m_packetSizeBinWidth);
+      details.flowInterruptionsHistogram.SetDefaultBinWidth (m_flowInterruptionsBinWidth);
     }
+  return index;
+}
+
+FlowMonitor::FlowStats
+FlowMonitor::MakeFlowStats (uint32_t index) const
+{
+  const FlowCounters &counters = m_flowCounters[index];
+  const FlowDetails &details = m_flowDetails[index];
+  FlowStats stats;
+  stats.timeFirstTxPacket = counters.timeFirstTxPacket;
+  stats.timeFirstRxPacket = counters.timeFirstRxPacket;
+  stats.timeLastTxPacket = counters.timeLastTxPacket;
+  stats.timeLastRxPacket = counters.timeLastRxPacket;
+  stats.delaySum = counters.delaySum;
+  stats.jitterSum = counters.jitterSum;
+  stats.lastDelay = counters.lastDelay;
+  stats.txBytes = counters.txBytes;
+  stats.rxBytes = counters.rxBytes;
+  stats.txPackets = counters.txPackets;
+  stats.rxPackets = counters.rxPackets;
+  stats.lostPackets = counters.lostPackets;
+  stats.timesForwarded = counters.timesForwarded;
+  stats.delayHistogram = details.delayHistogram;
+  stats.jitterHistogram = details.jitterHistogram;
+  stats.packetSizeHistogram = details.packetSizeHistogram;
+  stats.packetsDropped = details.packetsDropped;
+  stats.bytesDropped = details.bytesDropped;
+  stats.flowInterruptionsHistogram = details.flowInterruptionsHistogram;
+  return stats;
 }
 
 
 void
 FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetId, uint32_t packetSize)
 {
+  MultithreadedCriticalSection cs (m_lock);
   if (!m_enabled)
     {
       return;
     }
   Time now = Simulator::Now ();
-  TrackedPacket &tracked = m_trackedPackets[std::make_pair (flowId, packetId)];
+  uint32_t nTracked = m_trackedPackets.GetSize ();
+  TrackedPacket &tracked = m_trackedPackets[TrackedPacketKey (flowId, packetId)];
+  bool isNew = m_trackedPackets.GetSize () != nTracked;
   tracked.firstSeenTime = now;
   tracked.lastSeenTime = tracked.firstSeenTime;
   tracked.timesForwarded = 0;
   NS_LOG_DEBUG ("ReportFirstTx: adding tracked packet (flowId=" << flowId << ", packetId=" << packetId
                                                                 << ").");
 
-  probe->AddPacketStats (flowId, packetSize, Seconds (0));
+  uint32_t index = GetFlowIndex (flowId);
+  if (probe->AddPacketStats (flowId, packetSize, Seconds (0)) && m_flowExport.is_open ())
+    {
+      m_flowDetails[index].probes.push_back (probe);
+    }
 
-  FlowStats &stats = GetStatsForFlow (flowId);
+  FlowCounters &stats = m_flowCounters[index];
+  if (isNew)
+    {
+      stats.packetsInFlight++;
+    }
   stats.txBytes += packetSize;
   stats.txPackets++;
   if (stats.txPackets == 1)
@@ -149,36 +200,42 @@ FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t pack
 void
 FlowMonitor::ReportForwarding (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetId, uint32_t packetSize)
 {
+  MultithreadedCriticalSection cs (m_lock);
   if (!m_enabled)
     {
       return;
     }
-  std::pair<FlowId, FlowPacketId> key (flowId, packetId);
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (key);
-  if (tracked == m_trackedPackets.end ())
+  TrackedPacket *tracked = m_trackedPackets.Find (TrackedPacketKey (flowId, packetId));
+  if (tracked == 0)
     {
       NS_LOG_WARN ("Received packet forward report (flowId=" << flowId << ", packetId=" << packetId
                                                              << ") but not known to be transmitted.");
       return;
     }
 
-  tracked->second.timesForwarded++;
-  tracked->second.lastSeenTime = Simulator::Now ();
+  tracked->timesForwarded++;
+  tracked->lastSeenTime = Simulator::Now ();
 
-  Time delay = (Simulator::Now () - tracked->second.firstSeenTime);
-  probe->AddPacketStats (flowId, packetSize, delay);
+  Time delay = (Simulator::Now () - tracked->firstSeenTime);
+  if (probe->AddPacketStats (flowId, packetSize, delay) && m_flowExport.is_open ())
+    {
+      // the flows of the tracked packets are not exported yet
+      m_flowDetails[*m_flowIndex.Find (flowId)].probes.push_back (probe);
+    }
 }
 
 
 void
 FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetId, uint32_t packetSize)
 {
+  MultithreadedCriticalSection cs (m_lock);
   if (!m_enabled)
     {
       return;
     }
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (std::make_pair (flowId, packetId));
-  if (tracked == m_trackedPackets.end ())
+  uint64_t key = TrackedPacketKey (flowId, packetId);
+  TrackedPacket *tracked = m_trackedPackets.Find (key);
+  if (tracked == 0)
     {
       NS_LOG_WARN ("Received packet last-tx report (flowId=" << flowId << ", packetId=" << packetId
                                                              << ") but not known to be transmitted.");
@@ -186,117 +243,135 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
     }
 
   Time now = Simulator::Now ();
-  Time delay = (now - tracked->second.firstSeenTime);
-  probe->AddPacketStats (flowId, packetSize, delay);
+  Time delay = (now - tracked->firstSeenTime);
+  uint32_t index = GetFlowIndex (flowId);
+  if (probe->AddPacketStats (flowId, packetSize, delay) && m_flowExport.is_open ())
+    {
+      m_flowDetails[index].probes.push_back (probe);
+    }
 
-  FlowStats &stats = GetStatsForFlow (flowId);
+  FlowCounters &stats = m_flowCounters[index];
   stats.delaySum += delay;
-  stats.delayHistogram.AddValue (delay.GetSeconds ());
+  Time jitter = stats.lastDelay - delay;
+  if (jitter < Seconds (0))
+    {
+      jitter = delay - stats.lastDelay;
+    }
   if (stats.rxPackets > 0 )
     {
-      Time jitter = stats.lastDelay - delay;
-      if (jitter > Seconds (0))
-        {
-          stats.jitterSum += jitter;
-          stats.jitterHistogram.AddValue (jitter.GetSeconds ());
-        }
-      else 
-        {
-          stats.jitterSum -= jitter;
-          stats.jitterHistogram.AddValue (-jitter.GetSeconds ());
-        }
+      stats.jitterSum += jitter;
     }
   stats.lastDelay = delay;
 
   stats.rxBytes += packetSize;
-  stats.packetSizeHistogram.AddValue ((double) packetSize);
   stats.rxPackets++;
+  Time interArrivalTime = now - stats.timeLastRxPacket;
   if (stats.rxPackets == 1)
     {
       stats.timeFirstRxPacket = now;
     }
-  else
+  stats.timeLastRxPacket = now;
+  stats.timesForwarded += tracked->timesForwarded;
+  stats.packetsInFlight--;
+
+  if (m_enableHistograms)
     {
-      // measure possible flow interruptions
-      Time interArrivalTime = now - stats.timeLastRxPacket;
-      if (interArrivalTime > m_flowInterruptionsMinTime)
+      FlowDetails &details = m_flowDetails[index];
+      details.delayHistogram.AddValue (delay.GetSeconds ());
+      details.packetSizeHistogram.AddValue ((double) packetSize);
+      if (stats.rxPackets > 1)
         {
-          stats.flowInterruptionsHistogram.AddValue (interArrivalTime.GetSeconds ());
+          details.jitterHistogram.AddValue (jitter.GetSeconds ());
+          // measure possible flow interruptions
+          if (interArrivalTime > m_flowInterruptionsMinTime)
+            {
+              details.flowInterruptionsHistogram.AddValue (interArrivalTime.GetSeconds ());
+            }
         }
     }
-  stats.timeLastRxPacket = now;
-  stats.timesForwarded += tracked->second.timesForwarded;
 
   NS_LOG_DEBUG ("ReportLastTx: removing tracked packet (flowId="
                 << flowId << ", packetId=" << packetId << ").");
 
-  m_trackedPackets.erase (tracked); // we don't need to track this packet anymore
+  m_trackedPackets.Erase (key); // we don't need to track this packet anymore
 }
 
 void
 FlowMonitor::ReportDrop (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetId, uint32_t packetSize,
                          uint32_t reasonCode)
 {
+  MultithreadedCriticalSection cs (m_lock);
   if (!m_enabled)
     {
       return;
     }
 
-  probe->AddPacketDropStats (flowId, packetSize, reasonCode);
+  uint32_t index = GetFlowIndex (flowId);
+  FlowDetails &details = m_flowDetails[index];
+  if (probe->AddPacketDropStats (flowId, packetSize, reasonCode) && m_flowExport.is_open ())
+    {
+      details.probes.push_back (probe);
+    }
 
-  FlowStats &stats = GetStatsForFlow (flowId);
+  FlowCounters &stats = m_flowCounters[index];
   stats.lostPackets++;
-  if (stats.packetsDropped.size () < reasonCode + 1)
+  if (details.packetsDropped.size () < reasonCode + 1)
     {
-      stats.packetsDropped.resize (reasonCode + 1, 0);
-      stats.bytesDropped.resize (reasonCode + 1, 0);
+      details.packetsDropped.resize (reasonCode + 1, 0);
+      details.bytesDropped.resize (reasonCode + 1, 0);
     }
-  ++stats.packetsDropped[reasonCode];
-  stats.bytesDropped[reasonCode] += packetSize;
-  NS_LOG_DEBUG ("++stats.packetsDropped[" << reasonCode<< "]; // becomes: " << stats.packetsDropped[reasonCode]);
+  ++details.packetsDropped[reasonCode];
+  details.bytesDropped[reasonCode] += packetSize;
+  NS_LOG_DEBUG ("++stats.packetsDropped[" << reasonCode<< "]; // becomes: " << details.packetsDropped[reasonCode]);
 
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (std::make_pair (flowId, packetId));
-  if (tracked != m_trackedPackets.end ())
+  if (m_trackedPackets.Erase (TrackedPacketKey (flowId, packetId)))
     {
+      stats.packetsInFlight--;
       // we don't need to track this packet anymore
       // FIXME: this will not necessarily be true with broadcast/multicast
-      NS_LOG_DEBUG ("ReportDrop: removing tracked packet (flowId="
+      NS_LOG_DEBUG ("ReportDrop: removed tracked packet (flowId="
                     << flowId << ", packetId=" << packetId << ").");
-      m_trackedPackets.erase (tracked);
     }
 }
 
 std::map<FlowId, FlowMonitor::FlowStats>
 FlowMonitor::GetFlowStats () const
 {
-  return m_flowStats;
+  std::map<FlowId, FlowStats> flowStats;
+  for (uint32_t index = 0; index < m_flowIds.size (); index++)
+    {
+      flowStats.insert (std::make_pair (m_flowIds[index], MakeFlowStats (index)));
+    }
+  return flowStats;
 }
 
 
 void
 FlowMonitor::CheckForLostPackets (Time maxDelay)
 {
+  MultithreadedCriticalSection cs (m_lock);
   Time now = Simulator::Now ();
 
-  for (TrackedPacketMap::iterator iter = m_trackedPackets.begin ();
-       iter != m_trackedPackets.end (); )
+  std::vector<uint64_t> lost;
+  for (uint32_t slot = 0; slot < m_trackedPackets.GetNSlots (); slot++)
     {
-      if (now - iter->second.lastSeenTime >= maxDelay)
+      if (m_trackedPackets.IsUsed (slot)
+          && now - m_trackedPackets.GetValue (slot).lastSeenTime >= maxDelay)
         {
-          // packet is considered lost, add it to the loss statistics
-          std::map<FlowId, FlowStats>::iterator
-            flow = m_flowStats.find (iter->first.first);
-          NS_ASSERT (flow != m_flowStats.end ());
-          flow->second.lostPackets++;
-
-          // we won't track it anymore
-          m_trackedPackets.erase (iter++);
-        }
-      else
-        {
-          iter++;
+          lost.push_back (m_trackedPackets.GetKey (slot));
         }
     }
+  for (std::vector<uint64_t>::const_iterator iter = lost.begin (); iter != lost.end (); iter++)
+    {
+      // packet is considered lost, add it to the loss statistics
+      uint32_t *index = m_flowIndex.Find (*iter >> 32);
+      NS_ASSERT (index != 0);
+      m_flowCounters[*index].lostPackets++;
+      m_flowCounters[*index].packetsInFlight--;
+
+      // we won't track it anymore
+      m_trackedPackets.Erase (*iter);
+    }
 }
 
 void
@@ -305,10 +380,26 @@ FlowMonitor::CheckForLostPackets ()
   CheckForLostPackets (m_maxPerHopDelay);
 }
 
+void
+FlowMonitor::ReportFlowEnd (Ptr<FlowProbe> probe, FlowId flowId)
+{
+  MultithreadedCriticalSection cs (m_lock);
+  uint32_t *index = m_flowIndex.Find (flowId);
+  if (!m_enabled || index == 0)
+    {
+      return;
+    }
+  m_flowCounters[*index].ended = true;
+}
+
 void
 FlowMonitor::PeriodicCheckForLostPackets ()
 {
   CheckForLostPackets ();
+  if (m_flowExport.is_open ())
+    {
+      ExportCompletedFlows ();
+    }
   Simulator::Schedule (PERIODIC_CHECK_INTERVAL, &FlowMonitor::PeriodicCheckForLostPackets, this);
 }
 
@@ -392,13 +483,22 @@ FlowMonitor::SerializeToXmlStream (std::ostream &os, int indent, bool enableHist
   indent += 2;
   INDENT (indent); os << "<FlowStats>\n";
   indent += 2;
-  for (std::map<FlowId, FlowStats>::const_iterator flowI = m_flowStats.begin ();
-       flowI != m_flowStats.end (); flowI++)
+  // in flow id order, which the vectors of the flows do not keep
+  std::vector<std::pair<FlowId, uint32_t> > flows;
+  for (uint32_t index = 0; index < m_flowIds.size (); index++)
+    {
+      flows.push_back (std::make_pair (m_flowIds[index], index));
+    }
+  std::sort (flows.begin (), flows.end ());
+  for (std::vector<std::pair<FlowId, uint32_t> >::const_iterator
+       iter = flows.begin (); iter != flows.end (); iter++)
     {
+      FlowId flowId = iter->first;
+      FlowStats flow = MakeFlowStats (iter->second);
 
       INDENT (indent);
-#define ATTRIB(name) << " " # name "=\"" << flowI->second.name << "\""
-      os << "<Flow flowId=\"" << flowI->first << "\""
+#define ATTRIB(name) << " " # name "=\"" << flow.name << "\""
+      os << "<Flow flowId=\"" << flowId << "\""
       ATTRIB (timeFirstTxPacket)
       ATTRIB (timeFirstRxPacket)
       ATTRIB (timeLastTxPacket)
@@ -417,26 +517,26 @@ FlowMonitor::SerializeToXmlStream (std::ostream &os, int indent, bool enableHist
 
 
       indent += 2;
-      for (uint32_t reasonCode = 0; reasonCode < flowI->second.packetsDropped.size (); reasonCode++)
+      for (uint32_t reasonCode = 0; reasonCode < flow.packetsDropped.size (); reasonCode++)
         {
           INDENT (indent);
           os << "<packetsDropped reasonCode=\"" << reasonCode << "\""
-          << " number=\"" << flowI->second.packetsDropped[reasonCode]
+          << " number=\"" << flow.packetsDropped[reasonCode]
           << "\" />\n";
         }
-      for (uint32_t reasonCode = 0; reasonCode < flowI->second.bytesDropped.size (); reasonCode++)
+      for (uint32_t reasonCode = 0; reasonCode < flow.bytesDropped.size (); reasonCode++)
         {
           INDENT (indent);
           os << "<bytesDropped reasonCode=\"" << reasonCode << "\""
-          << " bytes=\"" << flowI->second.bytesDropped[reasonCode]
+          << " bytes=\"" << flow.bytesDropped[reasonCode]
           << "\" />\n";
         }
       if (enableHistograms)
         {
-          flowI->second.delayHistogram.SerializeToXmlStream (os, indent, "delayHistogram");
-          flowI->second.jitterHistogram.SerializeToXmlStream (os, indent, "jitterHistogram");
-          flowI->second.packetSizeHistogram.SerializeToXmlStream (os, indent, "packetSizeHistogram");
-          flowI->second.flowInterruptionsHistogram.SerializeToXmlStream (os, indent, "flowInterruptionsHistogram");
+          flow.delayHistogram.SerializeToXmlStream (os, indent, "delayHistogram");
+          flow.jitterHistogram.SerializeToXmlStream (os, indent, "jitterHistogram");
+          flow.packetSizeHistogram.SerializeToXmlStream (os, indent, "packetSizeHistogram");
+          flow.flowInterruptionsHistogram.SerializeToXmlStream (os, indent, "flowInterruptionsHistogram");
         }
       indent -= 2;
 
@@ -482,6 +582,104 @@ FlowMonitor::SerializeToXmlFile (std::string fileName, bool enableHistograms, bo
   os.close ();
 }
 
+void
+FlowMonitor::EnableFlowExport (std::string fileName)
+{
+  NS_ASSERT_MSG (m_classifier, "FlowMonitor::EnableFlowExport(): no FlowClassifier set");
+  NS_ASSERT_MSG (!m_flowExport.is_open (), "FlowMonitor::EnableFlowExport(): already enabled");
+  m_flowExport.open (fileName.c_str (), std::ios::out);
+  NS_ABORT_MSG_IF (!m_flowExport, "Unable to open " << fileName << " for writing");
+  m_flowExport << "flowId,timeFirstTxPacket,timeFirstRxPacket,timeLastTxPacket,timeLastRxPacket,"
+               << "delaySum,jitterSum,txBytes,rxBytes,txPackets,rxPackets,lostPackets,timesForwarded,complete"
+               << m_classifier->GetCsvColumns () << '\n';
+  Simulator::ScheduleDestroy (&FlowMonitor::StopFlowExport, Ptr<FlowMonitor> (this));
+}
+
+bool
+FlowMonitor::IsFlowExportEnabled () const
+{
+  return m_flowExport.is_open ();
+}
+
+void
+FlowMonitor::ExportFlow (uint32_t index, bool complete)
+{
+  FlowId flowId = m_flowIds[index];
+  const FlowCounters &flow = m_flowCounters[index];
+  m_flowExport << flowId
+               << ',' << flow.timeFirstTxPacket.GetNanoSeconds ()
+               << ',' << flow.timeFirstRxPacket.GetNanoSeconds ()
+               << ',' << flow.timeLastTxPacket.GetNanoSeconds ()
+               << ',' << flow.timeLastRxPacket.GetNanoSeconds ()
+               << ',' << flow.delaySum.GetNanoSeconds ()
+               << ',' << flow.jitterSum.GetNanoSeconds ()
+               << ',' << flow.txBytes
+               << ',' << flow.rxBytes
+               << ',' << flow.txPackets
+               << ',' << flow.rxPackets
+               << ',' << flow.lostPackets
+               << ',' << flow.timesForwarded
+               << ',' << complete;
+  m_classifier->SerializeFlowToCsv (m_flowExport, flowId);
+  m_flowExport << '\n';
+
+  // free the flow everywhere, its packets seen again make a new flow
+  const std::vector< Ptr<FlowProbe> > &probes = m_flowDetails[index].probes;
+  for (std::vector< Ptr<FlowProbe> >::const_iterator iter = probes.begin (); iter != probes.end (); iter++)
+    {
+      (*iter)->ReleaseFlow (flowId);
+    }
+  m_classifier->ReleaseFlow (flowId);
+  m_flowIndex.Erase (flowId);
+  uint32_t last = m_flowIds.size () - 1;
+  if (index != last)
+    {
+      m_flowIds[index] = m_flowIds[last];
+      m_flowCounters[index] = m_flowCounters[last];
+      m_flowDetails[index] = m_flowDetails[last];
+      *m_flowIndex.Find (m_flowIds[index]) = index;
+    }
+  m_flowIds.pop_back ();
+  m_flowCounters.pop_back ();
+  m_flowDetails.pop_back ();
+}
+
+void
+FlowMonitor::ExportCompletedFlows ()
+{
+  MultithreadedCriticalSection cs (m_lock);
+  Time now = Simulator::Now ();
+  // backwards, as an exported flow is replaced by the last one
+  for (uint32_t index = m_flowIds.size (); index-- > 0; )
+    {
+      const FlowCounters &flow = m_flowCounters[index];
+      if (flow.packetsInFlight == 0
+          && (flow.ended
+              || now - Max (flow.timeLastTxPacket, flow.timeLastRxPacket) >= m_flowIdleTimeout))
+        {
+          ExportFlow (index, true);
+        }
+    }
+  m_flowExport.flush ();
+}
+
+void
+FlowMonitor::StopFlowExport ()
+{
+  if (!m_flowExport.is_open ())
+    {
+      return;
+    }
+  ExportCompletedFlows ();
+  while (!m_flowIds.empty ())
+    {
+      ExportFlow (m_flowIds.size () - 1, false);
+    }
+  // the packets still in flight belong to flows which are gone
+  m_trackedPackets.Clear ();
+  m_flowExport.close ();
+}
+
 
 } // namespace ns3
 
@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <map>
+#include <fstream>
 
 #include "ns3/ptr.h"
 #include "ns3/object.h"
@@ -31,6 +32,8 @@
 #include "ns3/histogram.h"
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
+#include "ns3/open-hash-map.h"
+#include "ns3/multithreading.h"
 
 namespace ns3 {
 
@@ -165,6 +168,11 @@ public:
   void ReportDrop (Ptr<FlowProbe> probe, FlowId flowId, FlowPacketId packetId,
                    uint32_t packetSize, uint32_t reasonCode);
 
+  /// FlowProbe implementations may call this method to report that
+  /// the sender ended a flow, e.g. when a TCP FIN is received, so that
+  /// the flow can be exported without waiting for FlowIdleTimeout.
+  void ReportFlowEnd (Ptr<FlowProbe> probe, FlowId flowId);
+
   /// Check right now for packets that appear to be lost
   void CheckForLostPackets ();
 
@@ -201,6 +209,30 @@ public:
   /// \param enableProbes if true, include also the per-probe/flow pair statistics in the output
   void SerializeToXmlFile (std::string fileName, bool enableHistograms, bool enableProbes);
 
+  /// \brief Stream the statistics of the flows to a file while the
+  /// simulation runs, instead of holding them until the end.
+  ///
+  /// A flow is exported, and its statistics freed, once none of its
+  /// packets are in flight and either a probe reported its end or no
+  /// packet of it was seen for FlowIdleTimeout. The flows are checked
+  /// once per simulated second, and the file is flushed every time.
+  /// At Simulator::Destroy, the flows not exported yet are written
+  /// with complete set to 0, and the file is closed.
+  ///
+  /// The file holds comma-separated values: a line with the column
+  /// names, then one line per exported flow with the FlowStats
+  /// counters, the times in nanoseconds, and the columns of the
+  /// FlowClassifier (the five-tuple for Ipv4FlowClassifier). A flow
+  /// which sends again after its export, such as a retransmitted FIN,
+  /// gets another line with a new flowId and the same five-tuple,
+  /// which readers are to merge. The exported flows are also freed
+  /// from the probes and the FlowClassifier, and no longer appear in
+  /// GetFlowStats and in the XML output.
+  /// \param fileName name or path of the output file that will be created
+  void EnableFlowExport (std::string fileName);
+  /// \return true if EnableFlowExport was called
+  bool IsFlowExportEnabled () const;
+
 
 protected:
 
@@ -215,11 +247,57 @@ private:
     uint32_t timesForwarded; // number of times the packet was reportedly forwarded
   };
 
-  // FlowId --> FlowStats
-  std::map<FlowId, FlowStats> m_flowStats;
+  // The part of FlowStats updated for every packet
+  struct FlowCounters
+  {
+    Time timeFirstTxPacket;
+    Time timeFirstRxPacket;
+    Time timeLastTxPacket;
+    Time timeLastRxPacket;
+    Time delaySum;
+    Time jitterSum;
+    Time lastDelay;
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t lostPackets;
+    uint32_t timesForwarded;
+    uint32_t packetsInFlight; // number of packets in m_trackedPackets
+    bool ended; // whether a probe reported the end of the flow
+  };
+
+  // The part of FlowStats only updated with histograms enabled or on drops
+  struct FlowDetails
+  {
+    Histogram delayHistogram;
+    Histogram jitterHistogram;
+    Histogram packetSizeHistogram;
+    Histogram flowInterruptionsHistogram;
+    std::vector<uint32_t> packetsDropped;
+    std::vector<uint64_t> bytesDropped;
+    // the probes which saw the flow, only kept for the flow export
+    std::vector< Ptr<FlowProbe> > probes;
+  };
+
+  struct TrackedPacketHash
+  {
+    uint32_t operator () (uint64_t key) const
+    {
+      return (uint32_t)(key >> 32) * 0x9e3779b1U ^ (uint32_t)key;
+    }
+  };
+
+  // FlowId --> index of the flow in the vectors below
+  OpenHashMap<FlowId, uint32_t, FlowIdHash> m_flowIndex;
+  // index --> FlowId, FlowCounters and FlowDetails of the flows seen
+  // and not exported; the last flow fills the place of an exported one
+  std::vector<FlowId> m_flowIds;
+  std::vector<FlowCounters> m_flowCounters;
+  std::vector<FlowDetails> m_flowDetails;
 
-  // (FlowId,PacketId) --> TrackedPacket
-  typedef std::map< std::pair<FlowId, FlowPacketId>, TrackedPacket> TrackedPacketMap;
+  // (FlowId << 32 | PacketId) --> TrackedPacket
+  typedef OpenHashMap<uint64_t, TrackedPacket, TrackedPacketHash> TrackedPacketMap;
   TrackedPacketMap m_trackedPackets;
   Time m_maxPerHopDelay;
   std::vector< Ptr<FlowProbe> > m_flowProbes;
@@ -230,14 +308,24 @@ private:
   EventId m_startEvent;
   EventId m_stopEvent;
   bool m_enabled;
+  // the probes of all the nodes report to the monitor, which may run
+  // in several threads at once
+  SpinLock m_lock;
   double m_delayBinWidth;
   double m_jitterBinWidth;
   double m_packetSizeBinWidth;
   double m_flowInterruptionsBinWidth;
   Time m_flowInterruptionsMinTime;
+  bool m_enableHistograms;
+  Time m_flowIdleTimeout;
+  std::ofstream m_flowExport;
 
-  FlowStats& GetStatsForFlow (FlowId flowId);
+  uint32_t GetFlowIndex (FlowId flowId);
+  FlowStats MakeFlowStats (uint32_t index) const;
   void PeriodicCheckForLostPackets ();
+  void ExportFlow (uint32_t index, bool complete);
+  void ExportCompletedFlows ();
+  void StopFlowExport ();
 };
 
 
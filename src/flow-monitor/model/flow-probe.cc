@@ -35,18 +35,21 @@ FlowProbe::FlowProbe (Ptr<FlowMonitor> flowMonitor)
   m_flowMonitor->AddProbe (this);
 }
 
-void
+bool
 FlowProbe::AddPacketStats (FlowId flowId, uint32_t packetSize, Time delayFromFirstProbe)
 {
+  uint32_t nFlows = m_stats.GetSize ();
   FlowStats &flow = m_stats[flowId];
   flow.delayFromFirstProbeSum += delayFromFirstProbe;
   flow.bytes += packetSize;
   ++flow.packets;
+  return m_stats.GetSize () != nFlows;
 }
 
-void
+bool
 FlowProbe::AddPacketDropStats (FlowId flowId, uint32_t packetSize, uint32_t reasonCode)
 {
+  uint32_t nFlows = m_stats.GetSize ();
   FlowStats &flow = m_stats[flowId];
 
   if (flow.packetsDropped.size () < reasonCode + 1)
@@ -56,12 +59,27 @@ FlowProbe::AddPacketDropStats (FlowId flowId, uint32_t packetSize, uint32_t reas
     }
   ++flow.packetsDropped[reasonCode];
   flow.bytesDropped[reasonCode] += packetSize;
+  return m_stats.GetSize () != nFlows;
+}
+
+void
+FlowProbe::ReleaseFlow (FlowId flowId)
+{
+  m_stats.Erase (flowId);
 }
- 
+
 FlowProbe::Stats
 FlowProbe::GetStats () const 
 {
-  return m_stats;
+  Stats stats;
+  for (uint32_t slot = 0; slot < m_stats.GetNSlots (); slot++)
+    {
+      if (m_stats.IsUsed (slot))
+        {
+          stats.insert (std::make_pair (m_stats.GetKey (slot), m_stats.GetValue (slot)));
+        }
+    }
+  return stats;
 }
 
 void
@@ -73,28 +91,31 @@ FlowProbe::SerializeToXmlStream (std::ostream &os, int indent, uint32_t index) c
 
   indent += 2;
 
-  for (Stats::const_iterator iter = m_stats.begin (); iter != m_stats.end (); iter++)
+  // in flow id order, as the hash table slots are not
+  Stats stats = GetStats ();
+  for (Stats::const_iterator iter = stats.begin (); iter != stats.end (); iter++)
     {
+      const FlowStats &flow = iter->second;
       INDENT (indent);
       os << "<FlowStats "
          << " flowId=\"" << iter->first << "\""
-         << " packets=\"" << iter->second.packets << "\""
-         << " bytes=\"" << iter->second.bytes << "\""
-         << " delayFromFirstProbeSum=\"" << iter->second.delayFromFirstProbeSum << "\""
+         << " packets=\"" << flow.packets << "\""
+         << " bytes=\"" << flow.bytes << "\""
+         << " delayFromFirstProbeSum=\"" << flow.delayFromFirstProbeSum << "\""
          << " >\n";
       indent += 2;
-      for (uint32_t reasonCode = 0; reasonCode < iter->second.packetsDropped.size (); reasonCode++)
+      for (uint32_t reasonCode = 0; reasonCode < flow.packetsDropped.size (); reasonCode++)
         {
           INDENT (indent);
           os << "<packetsDropped reasonCode=\"" << reasonCode << "\""
-             << " number=\"" << iter->second.packetsDropped[reasonCode]
+             << " number=\"" << flow.packetsDropped[reasonCode]
              << "\" />\n";
         }
-      for (uint32_t reasonCode = 0; reasonCode < iter->second.bytesDropped.size (); reasonCode++)
+      for (uint32_t reasonCode = 0; reasonCode < flow.bytesDropped.size (); reasonCode++)
         {
           INDENT (indent);
           os << "<bytesDropped reasonCode=\"" << reasonCode << "\""
-             << " bytes=\"" << iter->second.bytesDropped[reasonCode]
+             << " bytes=\"" << flow.bytesDropped[reasonCode]
              << "\" />\n";
         }
       indent -= 2;
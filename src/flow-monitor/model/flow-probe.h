@@ -27,6 +27,7 @@
 #include "ns3/simple-ref-count.h"
 #include "ns3/flow-classifier.h"
 #include "ns3/nstime.h"
+#include "ns3/open-hash-map.h"
 
 namespace ns3 {
 
@@ -68,8 +69,12 @@ public:
 
   typedef std::map<FlowId, FlowStats> Stats;
 
-  void AddPacketStats (FlowId flowId, uint32_t packetSize, Time delayFromFirstProbe);
-  void AddPacketDropStats (FlowId flowId, uint32_t packetSize, uint32_t reasonCode);
+  /// \return true if the flow was not seen by this probe before
+  bool AddPacketStats (FlowId flowId, uint32_t packetSize, Time delayFromFirstProbe);
+  /// \return true if the flow was not seen by this probe before
+  bool AddPacketDropStats (FlowId flowId, uint32_t packetSize, uint32_t reasonCode);
+  /// Free the statistics of a flow which FlowMonitor exported
+  void ReleaseFlow (FlowId flowId);
 
   /// Get the partial flow statistics stored in this probe.  With this
   /// information you can, for example, find out what is the delay
@@ -80,7 +85,9 @@ public:
 
 protected:
   Ptr<FlowMonitor> m_flowMonitor;
-  Stats m_stats;
+  /// FlowId --> FlowStats, only for the flows seen by this probe; a
+  /// probe sees a small part of the flows of a large network
+  OpenHashMap<FlowId, FlowStats, FlowIdHash> m_stats;
 
 };
 
@@ -24,6 +24,8 @@
 #include "ns3/udp-header.h"
 #include "ns3/tcp-header.h"
 
+#include <algorithm>
+
 namespace ns3 {
 
 /* see http://www.iana.org/assignments/protocol-numbers */
@@ -95,8 +97,25 @@ bool operator == (const Ipv4FlowClassifier::FiveTuple &t1,
 
 
 
+uint32_t
+Ipv4FlowClassifier::FiveTupleHash::operator () (const FiveTuple &tuple) const
+{
+  uint32_t hash = tuple.sourceAddress.Get ();
+  hash = hash * 31 + tuple.destinationAddress.Get ();
+  hash = hash * 31 + ((tuple.sourcePort << 16) | tuple.destinationPort);
+  return hash * 31 + tuple.protocol;
+}
+
 Ipv4FlowClassifier::Ipv4FlowClassifier ()
+  : m_sampling (1)
+{
+}
+
+void
+Ipv4FlowClassifier::SetSampling (uint32_t n)
 {
+  NS_ASSERT (n > 0);
+  m_sampling = n;
 }
 
 bool
@@ -138,17 +157,32 @@ Ipv4FlowClassifier::Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPa
       return false;
     }
 
-  // try to insert the tuple, but check if it already exists
-  std::pair<std::map<FiveTuple, FlowId>::iterator, bool> insert
-    = m_flowMap.insert (std::pair<FiveTuple, FlowId> (tuple, 0));
+  if (m_sampling > 1)
+    {
+      // a well mixed hash, the table hash need not be one
+      uint32_t hash = FiveTupleHash () (tuple);
+      hash ^= hash >> 16;
+      hash *= 0x85ebca6b;
+      hash ^= hash >> 13;
+      hash *= 0xc2b2ae35;
+      hash ^= hash >> 16;
+      if (hash % m_sampling != 0)
+        {
+          return false;
+        }
+    }
+
+  MultithreadedCriticalSection cs (m_lock);
+  FlowId &flowId = m_flowMap[tuple];
 
-  // if the insertion succeeded, we need to assign this tuple a new flow identifier
-  if (insert.second)
+  // if the tuple was not known yet, we need to assign it a new flow identifier
+  if (flowId == 0)
     {
-      insert.first->second = GetNewFlowId ();
+      flowId = GetNewFlowId ();
+      m_flows[flowId] = tuple;
     }
 
-  *out_flowId = insert.first->second;
+  *out_flowId = flowId;
   *out_packetId = ipHeader.GetIdentification ();
 
   return true;
@@ -158,19 +192,36 @@ Ipv4FlowClassifier::Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPa
 Ipv4FlowClassifier::FiveTuple
 Ipv4FlowClassifier::FindFlow (FlowId flowId) const
 {
-  for (std::map<FiveTuple, FlowId>::const_iterator
-       iter = m_flowMap.begin (); iter != m_flowMap.end (); iter++)
+  MultithreadedCriticalSection cs (m_lock);
+  const FiveTuple *tuple = m_flows.Find (flowId);
+  if (tuple != 0)
     {
-      if (iter->second == flowId)
-        {
-          return iter->first;
-        }
+      return *tuple;
     }
   NS_FATAL_ERROR ("Could not find the flow with ID " << flowId);
   FiveTuple retval = { Ipv4Address::GetZero (), Ipv4Address::GetZero (), 0, 0, 0 };
   return retval;
 }
 
+bool
+Ipv4FlowClassifier::HasFlow (FlowId flowId) const
+{
+  MultithreadedCriticalSection cs (m_lock);
+  return m_flows.Find (flowId) != 0;
+}
+
+void
+Ipv4FlowClassifier::ReleaseFlow (FlowId flowId)
+{
+  MultithreadedCriticalSection cs (m_lock);
+  const FiveTuple *tuple = m_flows.Find (flowId);
+  if (tuple != 0)
+    {
+      m_flowMap.Erase (*tuple);
+      m_flows.Erase (flowId);
+    }
+}
+
 void
 Ipv4FlowClassifier::SerializeToXmlStream (std::ostream &os, int indent) const
 {
@@ -178,9 +229,20 @@ Ipv4FlowClassifier::SerializeToXmlStream (std::ostream &os, int indent) const
 
   INDENT (indent); os << "<Ipv4FlowClassifier>\n";
 
+  // in five-tuple order, as when the flows were kept in a std::map
+  std::vector<std::pair<FiveTuple, FlowId> > flows;
+  for (uint32_t slot = 0; slot < m_flows.GetNSlots (); slot++)
+    {
+      if (m_flows.IsUsed (slot))
+        {
+          flows.push_back (std::make_pair (m_flows.GetValue (slot), m_flows.GetKey (slot)));
+        }
+    }
+  std::sort (flows.begin (), flows.end ());
+
   indent += 2;
-  for (std::map<FiveTuple, FlowId>::const_iterator
-       iter = m_flowMap.begin (); iter != m_flowMap.end (); iter++)
+  for (std::vector<std::pair<FiveTuple, FlowId> >::const_iterator
+       iter = flows.begin (); iter != flows.end (); iter++)
     {
       INDENT (indent);
       os << "<Flow flowId=\"" << iter->second << "\""
@@ -198,6 +260,23 @@ Ipv4FlowClassifier::SerializeToXmlStream (std::ostream &os, int indent) const
 #undef INDENT
 }
 
+std::string
+Ipv4FlowClassifier::GetCsvColumns () const
+{
+  return ",sourceAddress,destinationAddress,protocol,sourcePort,destinationPort";
+}
+
+void
+Ipv4FlowClassifier::SerializeFlowToCsv (std::ostream &os, FlowId flowId) const
+{
+  FiveTuple tuple = FindFlow (flowId);
+  os << ',' << tuple.sourceAddress
+     << ',' << tuple.destinationAddress
+     << ',' << int(tuple.protocol)
+     << ',' << tuple.sourcePort
+     << ',' << tuple.destinationPort;
+}
+
 
 } // namespace ns3
 
@@ -22,10 +22,12 @@
 #define IPV4_FLOW_CLASSIFIER_H
 
 #include <stdint.h>
-#include <map>
+#include <vector>
 
 #include "ns3/ipv4-header.h"
 #include "ns3/flow-classifier.h"
+#include "ns3/open-hash-map.h"
+#include "ns3/multithreading.h"
 
 namespace ns3 {
 
@@ -50,20 +52,44 @@ public:
 
   Ipv4FlowClassifier ();
 
+  /// \brief Only classify one flow in n, the others are not monitored
+  ///
+  /// The flows are chosen by a hash of their five-tuple, so that the
+  /// same flows are sampled from one run to the next and by every
+  /// probe. The default, 1, classifies all the flows.
+  /// \param n the sampling ratio
+  void SetSampling (uint32_t n);
+
   /// \brief try to classify the packet into flow-id and packet-id
   /// \return true if the packet was classified, false if not (i.e. it
-  /// does not appear to be part of a flow).
+  /// does not appear to be part of a flow, or its flow is not sampled).
   bool Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload,
                  uint32_t *out_flowId, uint32_t *out_packetId);
 
   /// Searches for the FiveTuple corresponding to the given flowId
   FiveTuple FindFlow (FlowId flowId) const;
+  /// \return true if flowId is a flow which was not released
+  bool HasFlow (FlowId flowId) const;
 
   virtual void SerializeToXmlStream (std::ostream &os, int indent) const;
+  virtual std::string GetCsvColumns () const;
+  virtual void SerializeFlowToCsv (std::ostream &os, FlowId flowId) const;
+  virtual void ReleaseFlow (FlowId flowId);
 
 private:
 
-  std::map<FiveTuple, FlowId> m_flowMap;
+  struct FiveTupleHash
+  {
+    uint32_t operator () (const FiveTuple &tuple) const;
+  };
+
+  // FiveTuple --> FlowId
+  OpenHashMap<FiveTuple, FlowId, FiveTupleHash> m_flowMap;
+  // FlowId --> FiveTuple
+  OpenHashMap<FlowId, FiveTuple, FlowIdHash> m_flows;
+  uint32_t m_sampling;
+  // the probes of all the nodes share the flows
+  mutable SpinLock m_lock;
 
 };
 
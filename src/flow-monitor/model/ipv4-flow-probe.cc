@@ -27,6 +27,8 @@
 #include "ns3/pointer.h"
 #include "ns3/config.h"
 #include "ns3/flow-id-tag.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-l4-protocol.h"
 
 namespace ns3 {
 
@@ -149,11 +151,12 @@ Ipv4FlowProbeTag::GetPacketSize (void) const
 
 Ipv4FlowProbe::Ipv4FlowProbe (Ptr<FlowMonitor> monitor,
                               Ptr<Ipv4FlowClassifier> classifier,
-                              Ptr<Node> node)
+                              Ptr<Node> node,
+                              bool forwarding)
   : FlowProbe (monitor),
     m_classifier (classifier)
 {
-  NS_LOG_FUNCTION (this << node->GetId ());
+  NS_LOG_FUNCTION (this << node->GetId () << forwarding);
 
   Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
 
@@ -162,8 +165,9 @@ Ipv4FlowProbe::Ipv4FlowProbe (Ptr<FlowMonitor> monitor,
     {
       NS_FATAL_ERROR ("trace fail");
     }
-  if (!ipv4->TraceConnectWithoutContext ("UnicastForward",
-                                         MakeCallback (&Ipv4FlowProbe::ForwardLogger, Ptr<Ipv4FlowProbe> (this))))
+  if (forwarding
+      && !ipv4->TraceConnectWithoutContext ("UnicastForward",
+                                            MakeCallback (&Ipv4FlowProbe::ForwardLogger, Ptr<Ipv4FlowProbe> (this))))
     {
       NS_FATAL_ERROR ("trace fail");
     }
@@ -241,6 +245,17 @@ Ipv4FlowProbe::ForwardUpLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ip
       uint32_t size = (ipPayload->GetSize () + ipHeader.GetSerializedSize ());
       NS_LOG_DEBUG ("ReportLastRx ("<<this<<", "<<flowId<<", "<<packetId<<", "<<size<<");");
       m_flowMonitor->ReportLastRx (this, flowId, packetId, size);
+
+      // a received FIN ends the flow, only the exported flows care
+      if (ipHeader.GetProtocol () == TcpL4Protocol::PROT_NUMBER && m_flowMonitor->IsFlowExportEnabled ())
+        {
+          TcpHeader tcpHeader;
+          ipPayload->PeekHeader (tcpHeader);
+          if (tcpHeader.GetFlags () & TcpHeader::FIN)
+            {
+              m_flowMonitor->ReportFlowEnd (this, flowId);
+            }
+        }
     }
 }
 
@@ -328,15 +343,19 @@ Ipv4FlowProbe::QueueDropLogger (Ptr<const Packet> ipPayload)
   Ipv4FlowProbeTag fTag;
 
   // ConstCast: see http://www.nsnam.org/bugzilla/show_bug.cgi?id=904
-  bool tagFound;
-  tagFound = ConstCast<Packet> (ipPayload)->RemovePacketTag (fTag);
-  NS_ASSERT_MSG (tagFound, "FlowProbeTag is missing");
-  // cast tagFound to void, to suppress 'tagFound' set but not used compiler 
-  // warning in optimized builds
-  (void) tagFound;
+  if (!ConstCast<Packet> (ipPayload)->RemovePacketTag (fTag))
+    {
+      // not part of a monitored flow, e.g. not sampled by the classifier
+      return;
+    }
   FlowId flowId = fTag.GetFlowId ();
   FlowPacketId packetId = fTag.GetPacketId ();
   uint32_t size = fTag.GetPacketSize ();
+  if (!m_classifier->HasFlow (flowId))
+    {
+      // the flow was exported, with this packet counted as lost
+      return;
+    }
 
   NS_LOG_DEBUG ("Drop ("<<this<<", "<<flowId<<", "<<packetId<<", "<<size<<", " << DROP_QUEUE 
                         << "); ");
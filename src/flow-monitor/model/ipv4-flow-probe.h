@@ -40,7 +40,13 @@ class Ipv4FlowProbe : public FlowProbe
 {
 
 public:
-  Ipv4FlowProbe (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Ptr<Node> node);
+  /// \param monitor the FlowMonitor the probe reports to
+  /// \param classifier the classifier of the packets
+  /// \param node the node to monitor
+  /// \param forwarding if false, the packets forwarded by the node
+  ///        are not reported, only those it sends and receives
+  Ipv4FlowProbe (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Ptr<Node> node,
+                 bool forwarding = true);
   virtual ~Ipv4FlowProbe ();
 
   /// \brief enumeration of possible reasons why a packet may be dropped
@@ -0,0 +1,305 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OPEN_HASH_MAP_H
+#define OPEN_HASH_MAP_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief A hash table with open addressing and linear probing.
+ *
+ * The keys and values live in a single array of slots, so that a
+ * lookup touches one or two cache lines and an insertion allocates
+ * nothing until the table grows. Erasing an element shifts the
+ * following elements of its probe sequence back, so there are no
+ * tombstones and lookups do not slow down as elements come and go.
+ *
+ * Hash must provide uint32_t operator () (const Key &) const; its
+ * result is mixed again before use, so it need not be well
+ * distributed. Pointers to values are invalidated by any insertion
+ * or erasure.
+ */
+template <typename Key, typename Value, typename Hash>
+class OpenHashMap
+{
+public:
+  OpenHashMap ();
+
+  /**
+   * \param key the key to look for
+   * \return the value of key, or 0 if key is not in the table
+   */
+  Value* Find (const Key &key);
+  /**
+   * \param key the key to look for
+   * \return the value of key, or 0 if key is not in the table
+   */
+  const Value* Find (const Key &key) const;
+  /**
+   * \param key the key to look for
+   * \return the value of key, default-constructed if key was not
+   * in the table
+   */
+  Value& operator [] (const Key &key);
+  /**
+   * \param key the key to remove
+   * \return true if key was in the table
+   */
+  bool Erase (const Key &key);
+  /**
+   * Remove all the elements, keeping the memory of the table.
+   */
+  void Clear (void);
+  /**
+   * \return the number of elements in the table
+   */
+  uint32_t GetSize (void) const;
+
+  /**
+   * The elements can be walked through with the slot indexes from 0
+   * to GetNSlots () - 1, skipping the slots which are not used.
+   *
+   * \return the number of slots of the table
+   */
+  uint32_t GetNSlots (void) const;
+  /**
+   * \param slot a slot index
+   * \return true if the slot holds an element
+   */
+  bool IsUsed (uint32_t slot) const;
+  /**
+   * \param slot the index of a used slot
+   * \return the key of the element in the slot
+   */
+  const Key& GetKey (uint32_t slot) const;
+  /**
+   * \param slot the index of a used slot
+   * \return the value of the element in the slot
+   */
+  Value& GetValue (uint32_t slot);
+  /**
+   * \param slot the index of a used slot
+   * \return the value of the element in the slot
+   */
+  const Value& GetValue (uint32_t slot) const;
+
+private:
+  struct Slot
+  {
+    Slot () : key (), value (), used (false) {}
+    Key key;
+    Value value;
+    bool used;
+  };
+
+  static const uint32_t INITIAL_SLOTS = 16;
+
+  uint32_t Home (const Key &key) const;
+  int64_t Lookup (const Key &key) const;
+  void Grow (void);
+
+  std::vector<Slot> m_slots;
+  uint32_t m_size;
+  Hash m_hash;
+};
+
+template <typename Key, typename Value, typename Hash>
+OpenHashMap<Key, Value, Hash>::OpenHashMap ()
+  : m_size (0)
+{
+}
+
+template <typename Key, typename Value, typename Hash>
+uint32_t
+OpenHashMap<Key, Value, Hash>::Home (const Key &key) const
+{
+  // Fibonacci hashing spreads the low quality hashes over the table
+  uint32_t hash = m_hash (key) * 2654435761U;
+  return (hash ^ (hash >> 16)) & (m_slots.size () - 1);
+}
+
+template <typename Key, typename Value, typename Hash>
+int64_t
+OpenHashMap<Key, Value, Hash>::Lookup (const Key &key) const
+{
+  if (m_size == 0)
+    {
+      return -1;
+    }
+  uint32_t mask = m_slots.size () - 1;
+  for (uint32_t i = Home (key); m_slots[i].used; i = (i + 1) & mask)
+    {
+      if (m_slots[i].key == key)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+template <typename Key, typename Value, typename Hash>
+Value*
+OpenHashMap<Key, Value, Hash>::Find (const Key &key)
+{
+  int64_t i = Lookup (key);
+  return i < 0 ? 0 : &m_slots[i].value;
+}
+
+template <typename Key, typename Value, typename Hash>
+const Value*
+OpenHashMap<Key, Value, Hash>::Find (const Key &key) const
+{
+  int64_t i = Lookup (key);
+  return i < 0 ? 0 : &m_slots[i].value;
+}
+
+template <typename Key, typename Value, typename Hash>
+Value&
+OpenHashMap<Key, Value, Hash>::operator [] (const Key &key)
+{
+  // Keep the load factor at most 1/2
+  if (2 * (m_size + 1) > m_slots.size ())
+    {
+      Grow ();
+    }
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t i = Home (key);
+  for (; m_slots[i].used; i = (i + 1) & mask)
+    {
+      if (m_slots[i].key == key)
+        {
+          return m_slots[i].value;
+        }
+    }
+  m_slots[i].key = key;
+  m_slots[i].value = Value ();
+  m_slots[i].used = true;
+  m_size++;
+  return m_slots[i].value;
+}
+
+template <typename Key, typename Value, typename Hash>
+bool
+OpenHashMap<Key, Value, Hash>::Erase (const Key &key)
+{
+  int64_t found = Lookup (key);
+  if (found < 0)
+    {
+      return false;
+    }
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t hole = found;
+  for (uint32_t i = (hole + 1) & mask; m_slots[i].used; i = (i + 1) & mask)
+    {
+      // Move the element back into the hole unless its home lies
+      // cyclically between the hole and its slot
+      uint32_t home = Home (m_slots[i].key);
+      if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+          m_slots[hole] = m_slots[i];
+          hole = i;
+        }
+    }
+  m_slots[hole] = Slot ();
+  m_size--;
+  return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+void
+OpenHashMap<Key, Value, Hash>::Clear (void)
+{
+  for (typename std::vector<Slot>::iterator i = m_slots.begin (); i != m_slots.end (); ++i)
+    {
+      *i = Slot ();
+    }
+  m_size = 0;
+}
+
+template <typename Key, typename Value, typename Hash>
+void
+OpenHashMap<Key, Value, Hash>::Grow (void)
+{
+  std::vector<Slot> old;
+  old.swap (m_slots);
+  m_slots.resize (old.empty () ? INITIAL_SLOTS : 2 * old.size ());
+  uint32_t mask = m_slots.size () - 1;
+  for (typename std::vector<Slot>::const_iterator j = old.begin (); j != old.end (); ++j)
+    {
+      if (!j->used)
+        {
+          continue;
+        }
+      uint32_t i = Home (j->key);
+      while (m_slots[i].used)
+        {
+          i = (i + 1) & mask;
+        }
+      m_slots[i] = *j;
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+uint32_t
+OpenHashMap<Key, Value, Hash>::GetSize (void) const
+{
+  return m_size;
+}
+
+template <typename Key, typename Value, typename Hash>
+uint32_t
+OpenHashMap<Key, Value, Hash>::GetNSlots (void) const
+{
+  return m_slots.size ();
+}
+
+template <typename Key, typename Value, typename Hash>
+bool
+OpenHashMap<Key, Value, Hash>::IsUsed (uint32_t slot) const
+{
+  return m_slots[slot].used;
+}
+
+template <typename Key, typename Value, typename Hash>
+const Key&
+OpenHashMap<Key, Value, Hash>::GetKey (uint32_t slot) const
+{
+  return m_slots[slot].key;
+}
+
+template <typename Key, typename Value, typename Hash>
+Value&
+OpenHashMap<Key, Value, Hash>::GetValue (uint32_t slot)
+{
+  return m_slots[slot].value;
+}
+
+template <typename Key, typename Value, typename Hash>
+const Value&
+OpenHashMap<Key, Value, Hash>::GetValue (uint32_t slot) const
+{
+  return m_slots[slot].value;
+}
+
+} // namespace ns3
+
+#endif /* OPEN_HASH_MAP_H */
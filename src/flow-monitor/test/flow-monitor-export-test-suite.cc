@@ -0,0 +1,254 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/flow-monitor.h"
+#include "ns3/flow-monitor-helper.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/simple-channel.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/test.h"
+
+namespace ns3 {
+
+class FlowMonitorExportTestCase : public TestCase
+{
+public:
+  FlowMonitorExportTestCase ();
+  virtual void DoRun (void);
+
+private:
+  // the exported lines, header excluded, split in columns
+  std::vector<std::vector<std::string> > ReadExport (void);
+  void CountRows (uint32_t stage);
+  void SendUdp (uint32_t packets);
+  void Accept (Ptr<Socket> socket, const Address &from);
+  void Receive (Ptr<Socket> socket);
+  void PeerClose (Ptr<Socket> socket);
+
+  std::string m_fileName;
+  Ptr<FlowMonitor> m_monitor;
+  Ptr<Socket> m_udpSocket;
+  uint32_t m_rows[4];
+  uint32_t m_flows[4];
+  uint32_t m_probeFlows[4];
+};
+
+FlowMonitorExportTestCase::FlowMonitorExportTestCase ()
+  : TestCase ("Check the streaming export of the completed flows")
+{
+}
+
+std::vector<std::vector<std::string> >
+FlowMonitorExportTestCase::ReadExport (void)
+{
+  std::vector<std::vector<std::string> > rows;
+  std::ifstream file (m_fileName.c_str ());
+  std::string line;
+  std::getline (file, line);
+  while (std::getline (file, line))
+    {
+      std::vector<std::string> columns;
+      std::istringstream iss (line);
+      std::string column;
+      while (std::getline (iss, column, ','))
+        {
+          columns.push_back (column);
+        }
+      rows.push_back (columns);
+    }
+  return rows;
+}
+
+void
+FlowMonitorExportTestCase::CountRows (uint32_t stage)
+{
+  m_rows[stage] = ReadExport ().size ();
+  m_flows[stage] = m_monitor->GetFlowStats ().size ();
+  m_probeFlows[stage] = 0;
+  std::vector< Ptr<FlowProbe> > probes = m_monitor->GetAllProbes ();
+  for (uint32_t i = 0; i < probes.size (); i++)
+    {
+      m_probeFlows[stage] += probes[i]->GetStats ().size ();
+    }
+}
+
+void
+FlowMonitorExportTestCase::SendUdp (uint32_t packets)
+{
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      m_udpSocket->Send (Create<Packet> (100));
+    }
+}
+
+void
+FlowMonitorExportTestCase::Accept (Ptr<Socket> socket, const Address &from)
+{
+  socket->SetRecvCallback (MakeCallback (&FlowMonitorExportTestCase::Receive, this));
+  socket->SetCloseCallbacks (MakeCallback (&FlowMonitorExportTestCase::PeerClose, this),
+                             MakeCallback (&FlowMonitorExportTestCase::PeerClose, this));
+}
+
+void
+FlowMonitorExportTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+    }
+}
+
+void
+FlowMonitorExportTestCase::PeerClose (Ptr<Socket> socket)
+{
+  socket->Close ();
+}
+
+void
+FlowMonitorExportTestCase::DoRun (void)
+{
+  NodeContainer n;
+  n.Create (2);
+  InternetStackHelper internet;
+  internet.Install (n);
+  Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+  n.Get (0)->AddDevice (txDev);
+  n.Get (1)->AddDevice (rxDev);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  txDev->SetChannel (channel);
+  rxDev->SetChannel (channel);
+  NetDeviceContainer d;
+  d.Add (txDev);
+  d.Add (rxDev);
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4Address server = ipv4.Assign (d).GetAddress (1);
+
+  FlowMonitorHelper helper;
+  helper.SetMonitorAttribute ("FlowIdleTimeout", TimeValue (Seconds (3)));
+  m_monitor = helper.Install (n);
+  m_fileName = CreateTempDirFilename ("flows.csv");
+  m_monitor->EnableFlowExport (m_fileName);
+
+  // A TCP connection ended by FIN in both directions at 1 s
+  Ptr<Socket> listener = Socket::CreateSocket (n.Get (1), TcpSocketFactory::GetTypeId ());
+  listener->Bind (InetSocketAddress (Ipv4Address::GetAny (), 20));
+  listener->Listen ();
+  listener->SetAcceptCallback (MakeNullCallback<bool, Ptr<Socket>, const Address &> (),
+                               MakeCallback (&FlowMonitorExportTestCase::Accept, this));
+  Ptr<Socket> client = Socket::CreateSocket (n.Get (0), TcpSocketFactory::GetTypeId ());
+  client->Bind ();
+  client->Connect (InetSocketAddress (server, 20));
+  client->Send (Create<Packet> (2000));
+  client->Close ();
+
+  // A UDP flow without end, which goes idle at 1 s, then sends again
+  // at 6 s with the same five-tuple
+  Ptr<Socket> sink = Socket::CreateSocket (n.Get (1), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 30));
+  sink->SetRecvCallback (MakeCallback (&FlowMonitorExportTestCase::Receive, this));
+  m_udpSocket = Socket::CreateSocket (n.Get (0), UdpSocketFactory::GetTypeId ());
+  m_udpSocket->Bind ();
+  m_udpSocket->Connect (InetSocketAddress (server, 30));
+  Simulator::Schedule (Seconds (1), &FlowMonitorExportTestCase::SendUdp, this, 3);
+  Simulator::Schedule (Seconds (6), &FlowMonitorExportTestCase::SendUdp, this, 2);
+
+  // The flows are checked every second
+  Simulator::Schedule (Seconds (2.5), &FlowMonitorExportTestCase::CountRows, this, 0);
+  Simulator::Schedule (Seconds (3.5), &FlowMonitorExportTestCase::CountRows, this, 1);
+  Simulator::Schedule (Seconds (4.5), &FlowMonitorExportTestCase::CountRows, this, 2);
+  Simulator::Schedule (Seconds (7.5), &FlowMonitorExportTestCase::CountRows, this, 3);
+  Simulator::Stop (Seconds (8));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_rows[0], 2, "Only the TCP flows, ended by FIN, expected at 2.5 s");
+  NS_TEST_ASSERT_MSG_EQ (m_flows[0], 1, "The exported flows are still reported");
+  NS_TEST_ASSERT_MSG_EQ (m_rows[1], 2, "The UDP flow exported before its idle timeout");
+  NS_TEST_ASSERT_MSG_EQ (m_rows[2], 3, "The UDP flow not exported on idle timeout");
+  NS_TEST_ASSERT_MSG_EQ (m_flows[2], 0, "The exported flows are still reported");
+  NS_TEST_ASSERT_MSG_EQ (m_probeFlows[2], 0, "The probes still hold the exported flows");
+  NS_TEST_ASSERT_MSG_EQ (m_rows[3], 3, "A flow exported twice");
+
+  // The flows not complete are written at Simulator::Destroy
+  Simulator::Destroy ();
+  std::vector<std::vector<std::string> > rows = ReadExport ();
+  NS_TEST_ASSERT_MSG_EQ (rows.size (), 4, "Unexpected number of exported flows");
+  for (uint32_t i = 0; i < rows.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (rows[i].size (), 19, "Unexpected number of columns in row " << i);
+    }
+  // flowId, ..., txPackets (9), rxPackets (10), ..., complete (13), ..., protocol (16)
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (rows[i][16], "6", "Unexpected protocol of the TCP flow");
+      NS_TEST_EXPECT_MSG_EQ (rows[i][13], "1", "The TCP flow not complete");
+      NS_TEST_EXPECT_MSG_EQ (rows[i][9], rows[i][10], "Packets of the TCP flow lost");
+    }
+  NS_TEST_EXPECT_MSG_NE (rows[0][0], rows[1][0], "The TCP flow exported twice");
+  NS_TEST_EXPECT_MSG_EQ (rows[2][16], "17", "Unexpected protocol of the UDP flow");
+  NS_TEST_EXPECT_MSG_EQ (rows[2][9], "3", "Unexpected txPackets of the idle UDP flow");
+  NS_TEST_EXPECT_MSG_EQ (rows[2][10], "3", "Unexpected rxPackets of the idle UDP flow");
+  NS_TEST_EXPECT_MSG_EQ (rows[2][13], "1", "The idle UDP flow not complete");
+  // The same five-tuple again, as a new flow
+  NS_TEST_EXPECT_MSG_NE (rows[3][0], rows[2][0], "The exported UDP flow kept its flowId");
+  for (uint32_t i = 14; i < 19; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (rows[3][i], rows[2][i], "The UDP flow changed its five-tuple");
+    }
+  NS_TEST_EXPECT_MSG_EQ (rows[3][9], "2", "The counters of the exported UDP flow not reset");
+  NS_TEST_EXPECT_MSG_EQ (rows[3][10], "2", "The counters of the exported UDP flow not reset");
+  NS_TEST_EXPECT_MSG_EQ (rows[3][13], "0", "The UDP flow still sending complete");
+
+  // The classifier forgot the exported flows
+  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (helper.GetClassifier ());
+  for (uint32_t i = 0; i < rows.size (); i++)
+    {
+      FlowId flowId;
+      std::istringstream (rows[i][0]) >> flowId;
+      NS_TEST_EXPECT_MSG_EQ (classifier->HasFlow (flowId), false, "The classifier still holds flow " << flowId);
+    }
+
+  m_monitor = 0;
+  m_udpSocket = 0;
+}
+
+static class FlowMonitorExportTestSuite : public TestSuite
+{
+public:
+  FlowMonitorExportTestSuite ();
+} g_flowMonitorExportTestSuite;
+
+FlowMonitorExportTestSuite::FlowMonitorExportTestSuite ()
+  : TestSuite ("flow-monitor-export", UNIT)
+{
+  AddTestCase (new FlowMonitorExportTestCase ());
+}
+
+} // namespace ns3
@@ -0,0 +1,99 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <set>
+
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/udp-header.h"
+#include "ns3/packet.h"
+#include "ns3/test.h"
+
+namespace ns3 {
+
+class Ipv4FlowClassifierSamplingTestCase : public TestCase
+{
+public:
+  Ipv4FlowClassifierSamplingTestCase ();
+  virtual void DoRun (void);
+
+private:
+  // classify one packet of each of nFlows UDP flows, and return the
+  // source ports of the classified ones
+  std::set<uint16_t> Sample (uint32_t sampling, uint32_t nFlows);
+};
+
+Ipv4FlowClassifierSamplingTestCase::Ipv4FlowClassifierSamplingTestCase ()
+  : TestCase ("Check the flow sampling of Ipv4FlowClassifier")
+{
+}
+
+std::set<uint16_t>
+Ipv4FlowClassifierSamplingTestCase::Sample (uint32_t sampling, uint32_t nFlows)
+{
+  Ptr<Ipv4FlowClassifier> classifier = Create<Ipv4FlowClassifier> ();
+  classifier->SetSampling (sampling);
+
+  Ipv4Header ipHeader;
+  ipHeader.SetSource (Ipv4Address ("10.0.0.1"));
+  ipHeader.SetDestination (Ipv4Address ("10.0.1.1"));
+  ipHeader.SetProtocol (17);
+
+  std::set<uint16_t> sampled;
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      UdpHeader udpHeader;
+      udpHeader.SetSourcePort (1024 + i);
+      udpHeader.SetDestinationPort (9);
+      Ptr<Packet> packet = Create<Packet> (100);
+      packet->AddHeader (udpHeader);
+
+      uint32_t flowId, packetId;
+      if (classifier->Classify (ipHeader, packet, &flowId, &packetId))
+        {
+          sampled.insert (1024 + i);
+        }
+    }
+  return sampled;
+}
+
+void
+Ipv4FlowClassifierSamplingTestCase::DoRun (void)
+{
+  const uint32_t nFlows = 4000;
+
+  NS_TEST_ASSERT_MSG_EQ (Sample (1, nFlows).size (), nFlows, "Not all the flows classified without sampling");
+
+  std::set<uint16_t> sampled = Sample (4, nFlows);
+  NS_TEST_ASSERT_MSG_EQ_TOL (sampled.size (), nFlows / 4, nFlows / 20, "Unexpected number of sampled flows");
+  NS_TEST_ASSERT_MSG_EQ ((Sample (4, nFlows) == sampled), true, "The sampled flows are not deterministic");
+}
+
+static class Ipv4FlowClassifierTestSuite : public TestSuite
+{
+public:
+  Ipv4FlowClassifierTestSuite ();
+} g_ipv4FlowClassifierTestSuite;
+
+Ipv4FlowClassifierTestSuite::Ipv4FlowClassifierTestSuite ()
+  : TestSuite ("ipv4-flow-classifier", UNIT)
+{
+  AddTestCase (new Ipv4FlowClassifierSamplingTestCase ());
+}
+
+} // namespace ns3
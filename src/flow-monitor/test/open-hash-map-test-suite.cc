@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <map>
+#include <stdlib.h>
+
+#include "ns3/open-hash-map.h"
+#include "ns3/test.h"
+
+namespace ns3 {
+
+// A poor hash, so that the probe sequences are long and wrap around
+struct PoorHash
+{
+  uint32_t operator () (uint32_t key) const
+  {
+    return key % 7;
+  }
+};
+
+class OpenHashMapTestCase : public TestCase
+{
+public:
+  OpenHashMapTestCase ();
+  virtual void DoRun (void);
+};
+
+OpenHashMapTestCase::OpenHashMapTestCase ()
+  : TestCase ("Check OpenHashMap against std::map")
+{
+}
+
+void
+OpenHashMapTestCase::DoRun (void)
+{
+  OpenHashMap<uint32_t, uint32_t, PoorHash> table;
+  std::map<uint32_t, uint32_t> reference;
+
+  srand (1);
+  for (uint32_t i = 0; i < 20000; i++)
+    {
+      uint32_t key = rand () % 500;
+      if (rand () % 3 == 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (table.Erase (key), (reference.erase (key) == 1),
+                                 "Erase (" << key << ") disagrees");
+        }
+      else
+        {
+          table[key] += i;
+          reference[key] += i;
+        }
+      NS_TEST_ASSERT_MSG_EQ (table.GetSize (), reference.size (), "Unexpected size");
+    }
+
+  for (uint32_t key = 0; key < 500; key++)
+    {
+      std::map<uint32_t, uint32_t>::const_iterator expected = reference.find (key);
+      uint32_t *value = table.Find (key);
+      NS_TEST_ASSERT_MSG_EQ ((value != 0), (expected != reference.end ()), "Find (" << key << ") disagrees");
+      if (value != 0 && expected != reference.end ())
+        {
+          NS_TEST_ASSERT_MSG_EQ (*value, expected->second, "Unexpected value for " << key);
+        }
+    }
+
+  uint32_t used = 0;
+  for (uint32_t slot = 0; slot < table.GetNSlots (); slot++)
+    {
+      if (table.IsUsed (slot))
+        {
+          used++;
+          NS_TEST_ASSERT_MSG_EQ (reference[table.GetKey (slot)], table.GetValue (slot),
+                                 "Unexpected value in slot " << slot);
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (used, reference.size (), "Unexpected number of used slots");
+
+  table.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 0, "Clear () left elements");
+  NS_TEST_ASSERT_MSG_EQ ((table.Find (reference.begin ()->first) == 0), true, "Find () after Clear ()");
+}
+
+static class OpenHashMapTestSuite : public TestSuite
+{
+public:
+  OpenHashMapTestSuite ();
+} g_openHashMapTestSuite;
+
+OpenHashMapTestSuite::OpenHashMapTestSuite ()
+  : TestSuite ("open-hash-map", UNIT)
+{
+  AddTestCase (new OpenHashMapTestCase ());
+}
+
+} // namespace ns3
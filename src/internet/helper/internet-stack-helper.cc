@@ -227,7 +227,9 @@ InternetStackHelper::InternetStackHelper ()
   : m_routing (0),
     m_routingv6 (0),
     m_ipv4Enabled (true),
-    m_ipv6Enabled (true)
+    m_ipv6Enabled (true),
+    m_forwardingOnly (false),
+    m_forwardingOnlyIcmp (true)
 {
   Initialize ();
 }
@@ -261,6 +263,8 @@ InternetStackHelper::InternetStackHelper (const InternetStackHelper &o)
   m_routingv6 = o.m_routingv6->Copy ();
   m_ipv4Enabled = o.m_ipv4Enabled;
   m_ipv6Enabled = o.m_ipv6Enabled;
+  m_forwardingOnly = o.m_forwardingOnly;
+  m_forwardingOnlyIcmp = o.m_forwardingOnlyIcmp;
   m_tcpFactory = o.m_tcpFactory;
 }
 
@@ -273,6 +277,8 @@ InternetStackHelper::operator = (const InternetStackHelper &o)
     }
   m_routing = o.m_routing->Copy ();
   m_routingv6 = o.m_routingv6->Copy ();
+  m_forwardingOnly = o.m_forwardingOnly;
+  m_forwardingOnlyIcmp = o.m_forwardingOnlyIcmp;
   return *this;
 }
 
@@ -285,6 +291,8 @@ InternetStackHelper::Reset (void)
   m_routingv6 = 0;
   m_ipv4Enabled = true;
   m_ipv6Enabled = true;
+  m_forwardingOnly = false;
+  m_forwardingOnlyIcmp = true;
   Initialize ();
 }
 
@@ -313,6 +321,18 @@ void InternetStackHelper::SetIpv6StackInstall (bool enable)
   m_ipv6Enabled = enable;
 }
 
+void
+InternetStackHelper::SetForwardingOnly (bool enable)
+{
+  m_forwardingOnly = enable;
+}
+
+void
+InternetStackHelper::SetForwardingOnlyIcmp (bool enable)
+{
+  m_forwardingOnlyIcmp = enable;
+}
+
 void
 InternetStackHelper::SetTcp (const std::string tid)
 {
@@ -362,13 +382,24 @@ InternetStackHelper::Install (Ptr<Node> node) const
           return;
         }
 
-      CreateAndAggregateObjectFromTypeId (node, "ns3::ArpL3Protocol");
-      CreateAndAggregateObjectFromTypeId (node, "ns3::Ipv4L3Protocol");
-      CreateAndAggregateObjectFromTypeId (node, "ns3::Icmpv4L4Protocol");
-      CreateAndAggregateObjectFromTypeId (node, "ns3::UdpL4Protocol");
-      node->AggregateObject (m_tcpFactory.Create<Object> ());
-      Ptr<PacketSocketFactory> factory = CreateObject<PacketSocketFactory> ();
-      node->AggregateObject (factory);
+      if (m_forwardingOnly)
+        {
+          CreateAndAggregateObjectFromTypeId (node, "ns3::Ipv4L3Protocol");
+          if (m_forwardingOnlyIcmp)
+            {
+              CreateAndAggregateObjectFromTypeId (node, "ns3::Icmpv4L4Protocol");
+            }
+        }
+      else
+        {
+          CreateAndAggregateObjectFromTypeId (node, "ns3::ArpL3Protocol");
+          CreateAndAggregateObjectFromTypeId (node, "ns3::Ipv4L3Protocol");
+          CreateAndAggregateObjectFromTypeId (node, "ns3::Icmpv4L4Protocol");
+          CreateAndAggregateObjectFromTypeId (node, "ns3::UdpL4Protocol");
+          node->AggregateObject (m_tcpFactory.Create<Object> ());
+          Ptr<PacketSocketFactory> factory = CreateObject<PacketSocketFactory> ();
+          node->AggregateObject (factory);
+        }
       // Set routing
       Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
       Ptr<Ipv4RoutingProtocol> ipv4Routing = m_routing->Create (node);
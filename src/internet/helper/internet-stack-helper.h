@@ -60,6 +60,9 @@ class Ipv6RoutingHelper;
  *  - a TCP based on the TCP factory provided
  *  - a PacketSocketFactory
  *  - Ipv4 routing (a list routing object and a static routing object)
+ *
+ * or only ns3::Ipv4L3Protocol, Ipv4 routing and ns3::Icmpv4L4Protocol in
+ * the forwarding-only mode, see SetForwardingOnly.
  */
 class InternetStackHelper : public PcapHelperForIpv4, public PcapHelperForIpv6, 
                             public AsciiTraceHelperForIpv4, public AsciiTraceHelperForIpv6
@@ -178,6 +181,31 @@ public:
    */
   void SetIpv6StackInstall (bool enable);
 
+  /**
+   * \brief Enable/disable the forwarding-only install of the IPv4 stack.
+   *
+   * A forwarding-only node gets ns3::Ipv4L3Protocol, its routing
+   * protocol and, unless disabled with SetForwardingOnlyIcmp,
+   * ns3::Icmpv4L4Protocol. It gets neither UDP, TCP, a
+   * PacketSocketFactory nor ns3::ArpL3Protocol, which ns3::Ipv4L3Protocol
+   * only adds once an interface on a device needing ARP is added. Such
+   * a node forwards packets but cannot run applications: this is
+   * meant for the switches of large topologies.
+   *
+   * \param enable enable state
+   */
+  void SetForwardingOnly (bool enable);
+
+  /**
+   * \brief Enable/disable ICMPv4 install on forwarding-only nodes.
+   *
+   * Without ICMPv4, a forwarding-only node silently drops the packets
+   * whose TTL expires.
+   *
+   * \param enable enable state
+   */
+  void SetForwardingOnlyIcmp (bool enable);
+
 private:
   /**
    * @brief Enable pcap output the indicated Ipv4 and interface pair.
@@ -286,6 +314,16 @@ private:
    * \brief IPv6 install state (enabled/disabled) ?
    */
   bool m_ipv6Enabled;
+
+  /**
+   * \brief Install a forwarding-only IPv4 stack ?
+   */
+  bool m_forwardingOnly;
+
+  /**
+   * \brief Install ICMPv4 on forwarding-only nodes ?
+   */
+  bool m_forwardingOnlyIcmp;
 };
 
 } // namespace ns3
@@ -0,0 +1,252 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/ipv4-interface-address.h"
+#include "point-to-point-edge-list-helper.h"
+
+NS_LOG_COMPONENT_DEFINE ("PointToPointEdgeListHelper");
+
+namespace ns3 {
+
+/* A host which has not been attached to a switch yet */
+const uint32_t NO_SWITCH = 0xffffffff;
+
+/* Every link is a /30 of 10.0.0.0/8 */
+const uint32_t NETWORK_BASE = 10 << 24;
+const uint32_t MAX_LINKS = 1 << 22;
+
+PointToPointEdgeListHelper::PointToPointEdgeListHelper (PointToPointHelper p2pHelper)
+  : m_p2p (p2pHelper)
+{
+}
+
+bool
+PointToPointEdgeListHelper::Read (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream file (filename.c_str ());
+  if (!file.is_open ())
+    {
+      return false;
+    }
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (file, line))
+    {
+      lineNumber++;
+      if (line.find_first_not_of (" \t\r") == std::string::npos)
+        {
+          continue;
+        }
+      std::string::size_type arrow = line.find ("->");
+      if (arrow != std::string::npos)
+        {
+          line.replace (arrow, 2, " ");
+        }
+      std::istringstream iss (line);
+      uint32_t a, b;
+      std::string rest;
+      if (!(iss >> a >> b) || (iss >> rest))
+        {
+          NS_FATAL_ERROR (filename << ":" << lineNumber << ": expected \"switch switch\" or \"host->switch\"");
+        }
+      if (arrow != std::string::npos)
+        {
+          AddHost (a, b);
+        }
+      else
+        {
+          AddSwitchLink (a, b);
+        }
+    }
+  return true;
+}
+
+void
+PointToPointEdgeListHelper::Resize (uint32_t nSwitches)
+{
+  if (nSwitches > m_switchLinks.size ())
+    {
+      m_switchLinks.resize (nSwitches);
+      m_switchHosts.resize (nSwitches);
+    }
+}
+
+void
+PointToPointEdgeListHelper::AddSwitchLink (uint32_t a, uint32_t b)
+{
+  Resize (std::max (a, b) + 1);
+  m_switchLinks[a].push_back (b);
+}
+
+void
+PointToPointEdgeListHelper::AddHost (uint32_t host, uint32_t sw)
+{
+  Resize (sw + 1);
+  if (host >= m_hostSwitch.size ())
+    {
+      m_hostSwitch.resize (host + 1, NO_SWITCH);
+    }
+  NS_ABORT_MSG_IF (m_hostSwitch[host] != NO_SWITCH, "Host " << host << " attached twice");
+  m_hostSwitch[host] = sw;
+  // Hosts are usually added in order, in which case this appends
+  std::vector<uint32_t> &hosts = m_switchHosts[sw];
+  hosts.insert (std::upper_bound (hosts.begin (), hosts.end (), host), host);
+}
+
+void
+PointToPointEdgeListHelper::Install (const InternetStackHelper &stack)
+{
+  Install (stack, stack);
+}
+
+void
+PointToPointEdgeListHelper::Install (const InternetStackHelper &hostStack, const InternetStackHelper &switchStack)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_UNLESS (m_switches.GetN () == 0, "Topology already installed");
+  for (uint32_t host = 0; host < m_hostSwitch.size (); host++)
+    {
+      NS_ABORT_MSG_IF (m_hostSwitch[host] == NO_SWITCH, "Host " << host << " not attached to a switch");
+    }
+  uint32_t nLinks = m_hostSwitch.size ();
+  for (uint32_t sw = 0; sw < m_switchLinks.size (); sw++)
+    {
+      nLinks += m_switchLinks[sw].size ();
+    }
+  NS_ABORT_MSG_IF (nLinks > MAX_LINKS, "Too many links for the addressing plan");
+
+  m_switches.Create (m_switchLinks.size ());
+  switchStack.Install (m_switches);
+  m_hosts.resize (m_hostSwitch.size ());
+  for (uint32_t sw = 0; sw < m_switchHosts.size (); sw++)
+    {
+      NodeContainer hosts;
+      hosts.Create (m_switchHosts[sw].size ());
+      hostStack.Install (hosts);
+      for (uint32_t k = 0; k < hosts.GetN (); k++)
+        {
+          m_hosts[m_switchHosts[sw][k]] = hosts.Get (k);
+        }
+    }
+
+  std::vector<Ptr<Ipv4> > switchIpv4 (m_switches.GetN ());
+  for (uint32_t sw = 0; sw < m_switches.GetN (); sw++)
+    {
+      switchIpv4[sw] = m_switches.Get (sw)->GetObject<Ipv4> ();
+    }
+  for (uint32_t sw = 0; sw < m_switchHosts.size (); sw++)
+    {
+      for (uint32_t k = 0; k < m_switchHosts[sw].size (); k++)
+        {
+          uint32_t host = m_switchHosts[sw][k];
+          uint32_t network = NETWORK_BASE | (host << 2);
+          NetDeviceContainer d = m_p2p.Install (m_switches.Get (sw), m_hosts[host]);
+          Assign (switchIpv4[sw], d.Get (0), Ipv4Address (network | 1));
+          Assign (m_hosts[host]->GetObject<Ipv4> (), d.Get (1), Ipv4Address (network | 2));
+        }
+    }
+  uint32_t link = m_hostSwitch.size ();
+  for (uint32_t sw = 0; sw < m_switchLinks.size (); sw++)
+    {
+      for (uint32_t j = 0; j < m_switchLinks[sw].size (); j++, link++)
+        {
+          uint32_t other = m_switchLinks[sw][j];
+          uint32_t network = NETWORK_BASE | (link << 2);
+          NetDeviceContainer d = m_p2p.Install (m_switches.Get (sw), m_switches.Get (other));
+          Assign (switchIpv4[sw], d.Get (0), Ipv4Address (network | 1));
+          Assign (switchIpv4[other], d.Get (1), Ipv4Address (network | 2));
+        }
+    }
+}
+
+void
+PointToPointEdgeListHelper::Assign (Ptr<Ipv4> ipv4, Ptr<NetDevice> device, Ipv4Address address)
+{
+  NS_ASSERT_MSG (ipv4, "PointToPointEdgeListHelper::Assign(): node without IPv4 stack");
+  int32_t interface = ipv4->AddInterface (device);
+  // Keep the allocated addresses known, as Ipv4AddressHelper does
+  Ipv4AddressGenerator::AddAllocated (address);
+  ipv4->AddAddress (interface, Ipv4InterfaceAddress (address, Ipv4Mask (0xfffffffc)));
+  ipv4->SetMetric (interface, 1);
+  ipv4->SetUp (interface);
+}
+
+uint32_t
+PointToPointEdgeListHelper::GetNSwitches (void) const
+{
+  return m_switchLinks.size ();
+}
+
+uint32_t
+PointToPointEdgeListHelper::GetNHosts (void) const
+{
+  return m_hostSwitch.size ();
+}
+
+Ptr<Node>
+PointToPointEdgeListHelper::GetSwitch (uint32_t sw) const
+{
+  return m_switches.Get (sw);
+}
+
+Ptr<Node>
+PointToPointEdgeListHelper::GetHost (uint32_t host) const
+{
+  return m_hosts[host];
+}
+
+NodeContainer
+PointToPointEdgeListHelper::GetSwitches (void) const
+{
+  return m_switches;
+}
+
+NodeContainer
+PointToPointEdgeListHelper::GetHosts (void) const
+{
+  NodeContainer hosts;
+  for (uint32_t host = 0; host < m_hosts.size (); host++)
+    {
+      hosts.Add (m_hosts[host]);
+    }
+  return hosts;
+}
+
+uint32_t
+PointToPointEdgeListHelper::GetHostSwitch (uint32_t host) const
+{
+  return m_hostSwitch[host];
+}
+
+Ipv4Address
+PointToPointEdgeListHelper::GetHostIpv4Address (uint32_t host) const
+{
+  return Ipv4Address (NETWORK_BASE | (host << 2) | 2);
+}
+
+} // namespace ns3
@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef POINT_TO_POINT_EDGE_LIST_HELPER_H
+#define POINT_TO_POINT_EDGE_LIST_HELPER_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/node-container.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/point-to-point-helper.h"
+
+namespace ns3 {
+
+class InternetStackHelper;
+class Ipv4;
+class NetDevice;
+
+/**
+ * \brief Build a data center network of point-to-point links from an
+ * edge list.
+ *
+ * The edge list names switches and hosts by index. A line "a b" links
+ * switch a to switch b, a line "h->s" attaches host h to switch s; the
+ * hosts are indexed from 0 without gaps. This is the format of the
+ * .edgelist files of the topology directory.
+ *
+ * Install () creates the switches, then the hosts of each switch, and
+ * installs the internet stack on them; it then links every host to
+ * its switch and the switches together with the PointToPointHelper,
+ * in the order of the edge list. The addresses are derived from the
+ * indexes instead of going through an Ipv4AddressHelper. Every link
+ * is a /30 of 10.0.0.0/8, so that each route of a switch leads to a
+ * single link whichever routing protocols are installed:
+ *
+ * - the link of host h is 10.0.0.0 + 4h, the switch gets .1 and the
+ *   host .2;
+ * - the switch links follow, in the order of the edge list grouped
+ *   by first switch; the first switch gets .1 and the other .2.
+ *
+ * so that the address of any host is known before the topology is
+ * built.
+ */
+class PointToPointEdgeListHelper
+{
+public:
+  /**
+   * \param p2pHelper the helper used to create the links
+   */
+  PointToPointEdgeListHelper (PointToPointHelper p2pHelper);
+
+  /**
+   * Add the links of an edge list file.
+   *
+   * \param filename the edge list file
+   * \return false if the file could not be opened
+   */
+  bool Read (std::string filename);
+  /**
+   * \param a a switch
+   * \param b another switch
+   */
+  void AddSwitchLink (uint32_t a, uint32_t b);
+  /**
+   * \param host a host
+   * \param sw the switch to which the host is attached
+   */
+  void AddHost (uint32_t host, uint32_t sw);
+
+  /**
+   * Create the nodes, the links and the addresses of the topology.
+   *
+   * \param stack the helper used to install the internet stack on
+   *        every node
+   */
+  void Install (const InternetStackHelper &stack);
+  /**
+   * Create the nodes, the links and the addresses of the topology,
+   * with a different internet stack on the switches, typically a
+   * forwarding-only one (see InternetStackHelper::SetForwardingOnly).
+   *
+   * \param hostStack the helper used to install the internet stack
+   *        on the hosts
+   * \param switchStack the helper used to install the internet stack
+   *        on the switches
+   */
+  void Install (const InternetStackHelper &hostStack, const InternetStackHelper &switchStack);
+
+  /**
+   * \return the number of switches
+   */
+  uint32_t GetNSwitches (void) const;
+  /**
+   * \return the number of hosts
+   */
+  uint32_t GetNHosts (void) const;
+  /**
+   * \param sw a switch index
+   * \return the node of the switch, once installed
+   */
+  Ptr<Node> GetSwitch (uint32_t sw) const;
+  /**
+   * \param host a host index
+   * \return the node of the host, once installed
+   */
+  Ptr<Node> GetHost (uint32_t host) const;
+  /**
+   * \return the nodes of the switches, by switch index
+   */
+  NodeContainer GetSwitches (void) const;
+  /**
+   * \return the nodes of the hosts, by host index
+   */
+  NodeContainer GetHosts (void) const;
+  /**
+   * \param host a host index
+   * \return the switch to which the host is attached
+   */
+  uint32_t GetHostSwitch (uint32_t host) const;
+  /**
+   * \param host a host index
+   * \return the address of the host, available before Install ()
+   */
+  Ipv4Address GetHostIpv4Address (uint32_t host) const;
+
+private:
+  void Assign (Ptr<Ipv4> ipv4, Ptr<NetDevice> device, Ipv4Address address);
+  void Resize (uint32_t nSwitches);
+
+  PointToPointHelper m_p2p;
+  std::vector<std::vector<uint32_t> > m_switchLinks;  // Switch links, by switch
+  std::vector<std::vector<uint32_t> > m_switchHosts;  // Sorted hosts, by switch
+  std::vector<uint32_t> m_hostSwitch;                 // Switch, by host
+  NodeContainer m_switches;
+  std::vector<Ptr<Node> > m_hosts;                    // Nodes, by host
+};
+
+} // namespace ns3
+
+#endif /* POINT_TO_POINT_EDGE_LIST_HELPER_H */
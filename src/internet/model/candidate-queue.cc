@@ -44,22 +44,26 @@ operator<< (std::ostream& os, const CandidateQueue& q)
 {
   typedef CandidateQueue::CandidateList_t List_t;
   typedef List_t::const_iterator CIter_t;
-  const CandidateQueue::CandidateList_t& list = q.m_candidates;
+  // print the candidates in the order they will be popped
+  List_t list = q.m_candidates;
+  std::sort (list.begin (), list.end (), &CandidateQueue::CompareCandidate);
 
   os << "*** CandidateQueue Begin (<id, distance, LSA-type>) ***" << std::endl;
   for (CIter_t iter = list.begin (); iter != list.end (); iter++)
     {
       os << "<" 
-      << (*iter)->GetVertexId () << ", "
-      << (*iter)->GetDistanceFromRoot () << ", "
-      << (*iter)->GetVertexType () << ">" << std::endl;
+      << iter->vertex->GetVertexId () << ", "
+      << iter->vertex->GetDistanceFromRoot () << ", "
+      << iter->vertex->GetVertexType () << ">" << std::endl;
     }
   os << "*** CandidateQueue End ***";
   return os;
 }
 
 CandidateQueue::CandidateQueue()
-  : m_candidates ()
+  : m_candidates (),
+    m_index (),
+    m_seq (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -74,12 +78,61 @@ void
 CandidateQueue::Clear (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  while (!m_candidates.empty ())
+  for (CandidateList_t::iterator i = m_candidates.begin (); i != m_candidates.end (); i++)
     {
-      SPFVertex *p = Pop ();
-      delete p;
-      p = 0;
+      delete i->vertex;
     }
+  m_candidates.clear ();
+  m_index.clear ();
+}
+
+void
+CandidateQueue::Place (uint32_t pos, const Candidate &c)
+{
+  m_candidates[pos] = c;
+  m_index[c.vertex->GetVertexId ()] = pos;
+}
+
+void
+CandidateQueue::SiftUp (uint32_t pos, Candidate c)
+{
+  while (pos > 0)
+    {
+      uint32_t parent = (pos - 1) / 2;
+      if (!CompareCandidate (c, m_candidates[parent]))
+        {
+          break;
+        }
+      Place (pos, m_candidates[parent]);
+      pos = parent;
+    }
+  Place (pos, c);
+}
+
+void
+CandidateQueue::SiftDown (uint32_t pos, Candidate c)
+{
+  uint32_t size = m_candidates.size ();
+  while (true)
+    {
+      uint32_t child = 2 * pos + 1;
+      if (child >= size)
+        {
+          break;
+        }
+      if (child + 1 < size
+          && CompareCandidate (m_candidates[child + 1], m_candidates[child]))
+        {
+          child++;
+        }
+      if (!CompareCandidate (m_candidates[child], c))
+        {
+          break;
+        }
+      Place (pos, m_candidates[child]);
+      pos = child;
+    }
+  Place (pos, c);
 }
 
 void
@@ -87,11 +140,11 @@ CandidateQueue::Push (SPFVertex *vNew)
 {
   NS_LOG_FUNCTION (this << vNew);
 
-  CandidateList_t::iterator i = std::upper_bound (
-      m_candidates.begin (), m_candidates.end (), vNew,
-      &CandidateQueue::CompareSPFVertex
-      );
-  m_candidates.insert (i, vNew);
+  Candidate c;
+  c.vertex = vNew;
+  c.seq = m_seq++;
+  m_candidates.push_back (c);
+  SiftUp (m_candidates.size () - 1, c);
 }
 
 SPFVertex *
@@ -103,8 +156,18 @@ CandidateQueue::Pop (void)
       return 0;
     }
 
-  SPFVertex *v = m_candidates.front ();
-  m_candidates.pop_front ();
+  SPFVertex *v = m_candidates.front ().vertex;
+  CandidateIndex_t::iterator i = m_index.find (v->GetVertexId ());
+  if (i != m_index.end () && i->second == 0)
+    {
+      m_index.erase (i);
+    }
+  Candidate last = m_candidates.back ();
+  m_candidates.pop_back ();
+  if (!m_candidates.empty ())
+    {
+      SiftDown (0, last);
+    }
   return v;
 }
 
@@ -117,7 +180,7 @@ CandidateQueue::Top (void) const
       return 0;
     }
 
-  return m_candidates.front ();
+  return m_candidates.front ().vertex;
 }
 
 bool
@@ -138,18 +201,22 @@ SPFVertex *
 CandidateQueue::Find (const Ipv4Address addr) const
 {
   NS_LOG_FUNCTION_NOARGS ();
-  CandidateList_t::const_iterator i = m_candidates.begin ();
-
-  for (; i != m_candidates.end (); i++)
+  CandidateIndex_t::const_iterator i = m_index.find (addr);
+  //
+  // The SPF calculation never queues two vertices with the same ID, but
+  // nothing prevents other users from doing so; the index then only knows
+  // about the most recently placed one, so check that it is still there.
+  //
+  if (i == m_index.end () || i->second >= m_candidates.size ())
     {
-      SPFVertex *v = *i;
-      if (v->GetVertexId () == addr)
-        {
-          return v;
-        }
+      return 0;
     }
-
-  return 0;
+  SPFVertex *v = m_candidates[i->second].vertex;
+  if (v->GetVertexId () != addr)
+    {
+      return 0;
+    }
+  return v;
 }
 
 void
@@ -157,11 +224,31 @@ CandidateQueue::Reorder (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  m_candidates.sort (&CandidateQueue::CompareSPFVertex);
+  for (uint32_t i = m_candidates.size () / 2; i > 0; i--)
+    {
+      SiftDown (i - 1, m_candidates[i - 1]);
+    }
   NS_LOG_LOGIC ("After reordering the CandidateQueue");
   NS_LOG_LOGIC (*this);
 }
 
+void
+CandidateQueue::DecreaseKey (SPFVertex *v)
+{
+  NS_LOG_FUNCTION (this << v);
+
+  CandidateIndex_t::iterator i = m_index.find (v->GetVertexId ());
+  NS_ASSERT_MSG (i != m_index.end () && i->second < m_candidates.size ()
+                 && m_candidates[i->second].vertex == v,
+                 "CandidateQueue::DecreaseKey (): vertex not in the queue");
+  Candidate c;
+  c.vertex = v;
+  c.seq = m_seq++;
+  SiftUp (i->second, c);
+  NS_LOG_LOGIC ("After decreasing the key of " << v->GetVertexId ());
+  NS_LOG_LOGIC (*this);
+}
+
 /*
  * In this implementation, SPFVertex follows the ordering where
  * a vertex is ranked first if its GetDistanceFromRoot () is smaller;
@@ -190,4 +277,18 @@ CandidateQueue::CompareSPFVertex (const SPFVertex* v1, const SPFVertex* v2)
   return result;
 }
 
+bool
+CandidateQueue::CompareCandidate (const Candidate &c1, const Candidate &c2)
+{
+  if (CompareSPFVertex (c1.vertex, c2.vertex))
+    {
+      return true;
+    }
+  if (CompareSPFVertex (c2.vertex, c1.vertex))
+    {
+      return false;
+    }
+  return c1.seq < c2.seq;
+}
+
 } // namespace ns3
@@ -22,8 +22,9 @@
 #define CANDIDATE_QUEUE_H
 
 #include <stdint.h>
-#include <list>
+#include <vector>
 #include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -45,6 +46,13 @@ class SPFVertex;
  * for a Find () operation, the dynamic nature of the data and the derived
  * requirement for a Reorder () operation led us to implement this simple 
  * enhanced priority queue.
+ *
+ * The queue is an indexed binary heap: Push, Pop and DecreaseKey are
+ * O(log n) and Find is O(1) through a hash table from vertex ID to heap
+ * position.  Vertices that compare equal are popped in the order they
+ * were pushed (or last had their key decreased), which is the order the
+ * previous sorted-list implementation produced and on which the ECMP
+ * next hop ordering depends.
  */
 class CandidateQueue
 {
@@ -162,6 +170,20 @@ public:
  */
   void Reorder (void);
 
+/**
+ * @brief Restore the priority order after the distance of a single vertex
+ * in the queue has been lowered.
+ * @internal
+ *
+ * This is the O(log n) equivalent of Reorder () for the only change the
+ * SPF calculation makes to queued vertices.  Among the vertices of equal
+ * priority, v is moved behind the ones already queued.
+ *
+ * @see SPFVertex
+ * @param v The Shortest Path First Vertex whose distance was decreased.
+ */
+  void DecreaseKey (SPFVertex *v);
+
 private:
 /**
  * Candidate Queue copy construction is disallowed (not implemented) to 
@@ -189,8 +211,34 @@ private:
  */
   static bool CompareSPFVertex (const SPFVertex* v1, const SPFVertex* v2);
 
-  typedef std::list<SPFVertex*> CandidateList_t;
+  /**
+   * \brief an entry of the heap
+   *
+   * The sequence number breaks ties between vertices that
+   * CompareSPFVertex considers equal.
+   */
+  struct Candidate
+  {
+    SPFVertex *vertex;
+    uint64_t seq;
+  };
+
+  /**
+   * \return True if c1 should be popped before c2; false otherwise
+   */
+  static bool CompareCandidate (const Candidate &c1, const Candidate &c2);
+  /**
+   * Store c at the given heap position and record that position.
+   */
+  void Place (uint32_t pos, const Candidate &c);
+  void SiftUp (uint32_t pos, Candidate c);
+  void SiftDown (uint32_t pos, Candidate c);
+
+  typedef std::vector<Candidate> CandidateList_t;
+  typedef sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash> CandidateIndex_t;
   CandidateList_t m_candidates;
+  CandidateIndex_t m_index;
+  uint64_t m_seq;
 
   friend std::ostream& operator<< (std::ostream& os, const CandidateQueue& q);
 };
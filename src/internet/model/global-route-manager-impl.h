@@ -757,7 +757,9 @@ private:
   GlobalRouteManagerImpl& operator= (GlobalRouteManagerImpl& srmi);
 
   SPFVertex* m_spfroot;
+  Ptr<Node> m_spfrootNode;
   GlobalRouteManagerLSDB* m_lsdb;
+  Ptr<Node> FindRootNode (Ipv4Address root) const;
   bool CheckForStubNode (Ipv4Address root);
   void SPFCalculate (Ipv4Address root);
   void SPFProcessStubs (SPFVertex* v);
@@ -659,6 +659,19 @@ public:
  */
   bool GetLSA (uint32_t n, GlobalRoutingLSA &lsa) const;
 
+/**
+ * @brief Release the Global Routing Link State Advertisements found by the
+ * last call to DiscoverLSAs.
+ *
+ * The route manager copies the advertisements into its link state database.
+ * In a distributed simulation, the routers simulated by other ranks have no
+ * further use for their own copy and release it with this method.
+ * GetNumLSAs () returns zero until DiscoverLSAs () is called again.
+ *
+ * @see GlobalRouting::DiscoverLSAs ()
+ */
+  void ClearLSAs (void);
+
 /**
  * @brief Inject a route to be circulated to other routers as an external
  * route
@@ -709,7 +722,6 @@ public:
 
 private:
   virtual ~GlobalRouter ();
-  void ClearLSAs (void);
 
   Ptr<NetDevice> GetAdjacent (Ptr<NetDevice> nd, Ptr<Channel> ch) const;
   bool FindInterfaceForDevice (Ptr<Node> node, Ptr<NetDevice> nd, uint32_t &index) const;
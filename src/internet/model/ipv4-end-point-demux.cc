@@ -26,6 +26,34 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("Ipv4EndPointDemux");
 
+bool
+Ipv4EndPointDemux::ConnectedKey::operator == (const ConnectedKey &o) const
+{
+  return localPort == o.localPort && peerPort == o.peerPort && peerAddress == o.peerAddress;
+}
+
+size_t
+Ipv4EndPointDemux::ConnectedKeyHash::operator () (const ConnectedKey &key) const
+{
+  uint32_t h = key.peerAddress.Get () * 2654435761U;
+  h ^= (key.localPort << 16) | key.peerPort;
+  return h ^ (h >> 16);
+}
+
+bool
+Ipv4EndPointDemux::LocalKey::operator == (const LocalKey &o) const
+{
+  return port == o.port && address == o.address;
+}
+
+size_t
+Ipv4EndPointDemux::LocalKeyHash::operator () (const LocalKey &key) const
+{
+  uint32_t h = key.address.Get () * 2654435761U;
+  h ^= key.port;
+  return h ^ (h >> 16);
+}
+
 Ipv4EndPointDemux::Ipv4EndPointDemux ()
   : m_ephemeral (49152), m_portLast (65535), m_portFirst (49152)
 {
@@ -41,35 +69,140 @@ Ipv4EndPointDemux::~Ipv4EndPointDemux ()
       delete endPoint;
     }
   m_endPoints.clear ();
+  m_connected.clear ();
+  m_unconnected.clear ();
+  m_portCounts.clear ();
+  m_localCounts.clear ();
 }
 
 bool
-Ipv4EndPointDemux::LookupPortLocal (uint16_t port)
+Ipv4EndPointDemux::IsConnected (Ipv4Address peerAddress, uint16_t peerPort)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  return peerPort != 0 && peerAddress != Ipv4Address::GetAny ();
+}
+
+Ipv4EndPointDemux::ConnectedKey
+Ipv4EndPointDemux::GetConnectedKey (uint16_t localPort, Ipv4Address peerAddress, uint16_t peerPort)
+{
+  ConnectedKey key;
+  key.localPort = localPort;
+  key.peerPort = peerPort;
+  key.peerAddress = peerAddress;
+  return key;
+}
+
+void
+Ipv4EndPointDemux::EraseFrom (EndPoints &endPoints, Ipv4EndPoint *endPoint)
+{
+  for (EndPointsI i = endPoints.begin (); i != endPoints.end (); i++)
     {
-      if ((*i)->GetLocalPort  () == port) 
+      if (*i == endPoint)
         {
-          return true;
+          endPoints.erase (i);
+          return;
         }
     }
-  return false;
+  NS_ASSERT_MSG (false, "Endpoint missing from the index");
 }
 
-bool
-Ipv4EndPointDemux::LookupLocal (Ipv4Address addr, uint16_t port)
+void
+Ipv4EndPointDemux::AddLocal (Ipv4Address address, uint16_t port)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  LocalKey key;
+  key.port = port;
+  key.address = address;
+  m_localCounts[key]++;
+  m_portCounts[port]++;
+}
+
+void
+Ipv4EndPointDemux::RemoveLocal (Ipv4Address address, uint16_t port)
+{
+  LocalKey key;
+  key.port = port;
+  key.address = address;
+  LocalCounts::iterator local = m_localCounts.find (key);
+  NS_ASSERT (local != m_localCounts.end ());
+  if (--local->second == 0)
+    {
+      m_localCounts.erase (local);
+    }
+  PortCounts::iterator count = m_portCounts.find (port);
+  NS_ASSERT (count != m_portCounts.end ());
+  if (--count->second == 0)
+    {
+      m_portCounts.erase (count);
+    }
+}
+
+void
+Ipv4EndPointDemux::AddToIndex (Ipv4EndPoint *endPoint)
+{
+  AddLocal (endPoint->GetLocalAddress (), endPoint->GetLocalPort ());
+  if (IsConnected (endPoint->GetPeerAddress (), endPoint->GetPeerPort ()))
     {
-      if ((*i)->GetLocalPort () == port &&
-          (*i)->GetLocalAddress () == addr) 
+      m_connected[GetConnectedKey (endPoint->GetLocalPort (), endPoint->GetPeerAddress (),
+                                   endPoint->GetPeerPort ())].push_back (endPoint);
+    }
+  else
+    {
+      m_unconnected[endPoint->GetLocalPort ()].push_back (endPoint);
+    }
+}
+
+void
+Ipv4EndPointDemux::RemoveFromIndex (Ipv4EndPoint *endPoint)
+{
+  RemoveLocal (endPoint->GetLocalAddress (), endPoint->GetLocalPort ());
+  if (IsConnected (endPoint->GetPeerAddress (), endPoint->GetPeerPort ()))
+    {
+      ConnectedEndPoints::iterator i =
+        m_connected.find (GetConnectedKey (endPoint->GetLocalPort (), endPoint->GetPeerAddress (),
+                                           endPoint->GetPeerPort ()));
+      NS_ASSERT (i != m_connected.end ());
+      EraseFrom (i->second, endPoint);
+      if (i->second.empty ())
+        {
+          m_connected.erase (i);
+        }
+    }
+  else
+    {
+      PortEndPoints::iterator i = m_unconnected.find (endPoint->GetLocalPort ());
+      NS_ASSERT (i != m_unconnected.end ());
+      EraseFrom (i->second, endPoint);
+      if (i->second.empty ())
         {
-          return true;
+          m_unconnected.erase (i);
         }
     }
-  return false;
+}
+
+Ipv4EndPoint *
+Ipv4EndPointDemux::Add (Ipv4EndPoint *endPoint)
+{
+  endPoint->m_demux = this;
+  endPoint->m_position = m_endPoints.insert (m_endPoints.end (), endPoint);
+  AddToIndex (endPoint);
+  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+  return endPoint;
+}
+
+bool
+Ipv4EndPointDemux::LookupPortLocal (uint16_t port)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return m_portCounts.find (port) != m_portCounts.end ();
+}
+
+bool
+Ipv4EndPointDemux::LookupLocal (Ipv4Address addr, uint16_t port)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  LocalKey key;
+  key.port = port;
+  key.address = addr;
+  return m_localCounts.find (key) != m_localCounts.end ();
 }
 
 Ipv4EndPoint *
@@ -82,10 +215,7 @@ Ipv4EndPointDemux::Allocate (void)
       NS_LOG_WARN ("Ephemeral port allocation failed.");
       return 0;
     }
-  Ipv4EndPoint *endPoint = new Ipv4EndPoint (Ipv4Address::GetAny (), port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Add (new Ipv4EndPoint (Ipv4Address::GetAny (), port));
 }
 
 Ipv4EndPoint *
@@ -98,10 +228,7 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address)
       NS_LOG_WARN ("Ephemeral port allocation failed.");
       return 0;
     }
-  Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Add (new Ipv4EndPoint (address, port));
 }
 
 Ipv4EndPoint *
@@ -121,10 +248,7 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address, uint16_t port)
       NS_LOG_WARN ("Duplicate address/port; failing.");
       return 0;
     }
-  Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Add (new Ipv4EndPoint (address, port));
 }
 
 Ipv4EndPoint *
@@ -132,40 +256,55 @@ Ipv4EndPointDemux::Allocate (Ipv4Address localAddress, uint16_t localPort,
                              Ipv4Address peerAddress, uint16_t peerPort)
 {
   NS_LOG_FUNCTION (this << localAddress << localPort << peerAddress << peerPort);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  // Only the endpoints indexed under the same key can be identical
+  EndPoints *candidates = 0;
+  if (IsConnected (peerAddress, peerPort))
     {
-      if ((*i)->GetLocalPort () == localPort &&
-          (*i)->GetLocalAddress () == localAddress &&
-          (*i)->GetPeerPort () == peerPort &&
-          (*i)->GetPeerAddress () == peerAddress) 
+      ConnectedEndPoints::iterator i = m_connected.find (GetConnectedKey (localPort, peerAddress, peerPort));
+      if (i != m_connected.end ())
         {
-          NS_LOG_WARN ("No way we can allocate this end-point.");
-          /* no way we can allocate this end-point. */
-          return 0;
+          candidates = &i->second;
+        }
+    }
+  else
+    {
+      PortEndPoints::iterator i = m_unconnected.find (localPort);
+      if (i != m_unconnected.end ())
+        {
+          candidates = &i->second;
+        }
+    }
+  if (candidates != 0)
+    {
+      for (EndPointsI i = candidates->begin (); i != candidates->end (); i++) 
+        {
+          if ((*i)->GetLocalPort () == localPort &&
+              (*i)->GetLocalAddress () == localAddress &&
+              (*i)->GetPeerPort () == peerPort &&
+              (*i)->GetPeerAddress () == peerAddress) 
+            {
+              NS_LOG_WARN ("No way we can allocate this end-point.");
+              /* no way we can allocate this end-point. */
+              return 0;
+            }
         }
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (localAddress, localPort);
   endPoint->SetPeer (peerAddress, peerPort);
-  m_endPoints.push_back (endPoint);
-
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-
-  return endPoint;
+  return Add (endPoint);
 }
 
 void 
 Ipv4EndPointDemux::DeAllocate (Ipv4EndPoint *endPoint)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  if (endPoint->m_demux != this)
     {
-      if (*i == endPoint)
-        {
-          delete endPoint;
-          m_endPoints.erase (i);
-          break;
-        }
+      return;
     }
+  RemoveFromIndex (endPoint);
+  m_endPoints.erase (endPoint->m_position);
+  delete endPoint;
 }
 
 /*
@@ -186,10 +325,95 @@ Ipv4EndPointDemux::GetAllEndPoints (void)
 }
 
 
+/*
+ * Sort endP into the matches of Lookup, from the least to the most
+ * exact. endP is known to match the local port.
+ */
+void
+Ipv4EndPointDemux::ClassifyEndPoint (Ipv4EndPoint *endP, Ipv4Address daddr,
+                                     Ipv4Address saddr, uint16_t sport,
+                                     Ptr<Ipv4Interface> incomingInterface,
+                                     bool isBroadcast, Ipv4Address incomingInterfaceAddr,
+                                     EndPoints retval[4])
+{
+  NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
+                                             << " daddr=" << endP->GetLocalAddress ()
+                                             << " sport=" << endP->GetPeerPort ()
+                                             << " saddr=" << endP->GetPeerAddress ());
+  if (endP->GetBoundNetDevice ())
+    {
+      if (endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
+        {
+          NS_LOG_LOGIC ("Skipping endpoint " << &endP
+                                             << " because endpoint is bound to specific device and"
+                                             << endP->GetBoundNetDevice ()
+                                             << " does not match packet device " << incomingInterface->GetDevice ());
+          return;
+        }
+    }
+  bool localAddressMatchesWildCard = 
+    endP->GetLocalAddress () == Ipv4Address::GetAny ();
+  bool localAddressMatchesExact = endP->GetLocalAddress () == daddr;
+
+  if (isBroadcast)
+    {
+      NS_LOG_DEBUG ("Found bcast, localaddr " << endP->GetLocalAddress ());
+    }
+
+  if (isBroadcast && (endP->GetLocalAddress () != Ipv4Address::GetAny ()))
+    {
+      localAddressMatchesExact = (endP->GetLocalAddress () ==
+                                  incomingInterfaceAddr);
+    }
+  // if no match here, keep looking
+  if (!(localAddressMatchesExact || localAddressMatchesWildCard))
+    return; 
+  bool remotePeerMatchesExact = endP->GetPeerPort () == sport;
+  bool remotePeerMatchesWildCard = endP->GetPeerPort () == 0;
+  bool remoteAddressMatchesExact = endP->GetPeerAddress () == saddr;
+  bool remoteAddressMatchesWildCard = endP->GetPeerAddress () ==
+    Ipv4Address::GetAny ();
+  // If remote does not match either with exact or wildcard,
+  // skip this one
+  if (!(remotePeerMatchesExact || remotePeerMatchesWildCard))
+    return;
+  if (!(remoteAddressMatchesExact || remoteAddressMatchesWildCard))
+    return;
+
+  // Now figure out which return list to add this one to
+  if (localAddressMatchesWildCard &&
+      remotePeerMatchesWildCard &&
+      remoteAddressMatchesWildCard)
+    { // Only local port matches exactly
+      retval[0].push_back (endP);
+    }
+  if ((localAddressMatchesExact || (isBroadcast && localAddressMatchesWildCard))&&
+      remotePeerMatchesWildCard &&
+      remoteAddressMatchesWildCard)
+    { // Only local port and local address matches exactly
+      retval[1].push_back (endP);
+    }
+  if (localAddressMatchesWildCard &&
+      remotePeerMatchesExact &&
+      remoteAddressMatchesExact)
+    { // All but local address
+      retval[2].push_back (endP);
+    }
+  if (localAddressMatchesExact &&
+      remotePeerMatchesExact &&
+      remoteAddressMatchesExact)
+    { // All 4 match
+      retval[3].push_back (endP);
+    }
+}
+
 /*
  * If we have an exact match, we return it.
  * Otherwise, if we find a generic match, we return it.
  * Otherwise, we return 0.
+ *
+ * Only the endpoints connected to (saddr, sport) and the endpoints
+ * without a peer can match, so only those are looked at.
  */
 Ipv4EndPointDemux::EndPoints
 Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport, 
@@ -197,114 +421,50 @@ Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport,
                            Ptr<Ipv4Interface> incomingInterface)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  EndPoints retval1; // Matches exact on local port, wildcards on others
-  EndPoints retval2; // Matches exact on local port/adder, wildcards on others
-  EndPoints retval3; // Matches all but local address
-  EndPoints retval4; // Exact match on all 4
+  EndPoints retval[4]; // From: matches exact on local port, wildcards on others
+                       // to: exact match on all 4
 
   NS_LOG_FUNCTION (this << daddr << dport << saddr << sport << incomingInterface);
   NS_LOG_DEBUG ("Looking up endpoint for destination address " << daddr);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  bool subnetDirected = false;
+  Ipv4Address incomingInterfaceAddr = daddr;  // may be a broadcast
+  for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
     {
-      Ipv4EndPoint* endP = *i;
-      NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
-                                                 << " daddr=" << endP->GetLocalAddress ()
-                                                 << " sport=" << endP->GetPeerPort ()
-                                                 << " saddr=" << endP->GetPeerAddress ());
-      if (endP->GetLocalPort () != dport) 
-        {
-          NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                                             << " because endpoint dport "
-                                             << endP->GetLocalPort ()
-                                             << " does not match packet dport " << dport);
-          continue;
-        }
-      if (endP->GetBoundNetDevice ())
+      Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
+      if (addr.GetLocal ().CombineMask (addr.GetMask ()) == daddr.CombineMask (addr.GetMask ()) &&
+          daddr.IsSubnetDirectedBroadcast (addr.GetMask ()))
         {
-          if (endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
-            {
-              NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                                                 << " because endpoint is bound to specific device and"
-                                                 << endP->GetBoundNetDevice ()
-                                                 << " does not match packet device " << incomingInterface->GetDevice ());
-              continue;
-            }
+          subnetDirected = true;
+          incomingInterfaceAddr = addr.GetLocal ();
         }
-      bool subnetDirected = false;
-      Ipv4Address incomingInterfaceAddr = daddr;  // may be a broadcast
-      for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
-        {
-          Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
-          if (addr.GetLocal ().CombineMask (addr.GetMask ()) == daddr.CombineMask (addr.GetMask ()) &&
-              daddr.IsSubnetDirectedBroadcast (addr.GetMask ()))
-            {
-              subnetDirected = true;
-              incomingInterfaceAddr = addr.GetLocal ();
-            }
-        }
-      bool isBroadcast = (daddr.IsBroadcast () || subnetDirected == true);
-      NS_LOG_DEBUG ("dest addr " << daddr << " broadcast? " << isBroadcast);
-      bool localAddressMatchesWildCard = 
-        endP->GetLocalAddress () == Ipv4Address::GetAny ();
-      bool localAddressMatchesExact = endP->GetLocalAddress () == daddr;
+    }
+  bool isBroadcast = (daddr.IsBroadcast () || subnetDirected == true);
+  NS_LOG_DEBUG ("dest addr " << daddr << " broadcast? " << isBroadcast);
 
-      if (isBroadcast)
+  ConnectedEndPoints::iterator connected = m_connected.find (GetConnectedKey (dport, saddr, sport));
+  if (connected != m_connected.end ())
+    {
+      for (EndPointsI i = connected->second.begin (); i != connected->second.end (); i++)
         {
-          NS_LOG_DEBUG ("Found bcast, localaddr " << endP->GetLocalAddress ());
+          ClassifyEndPoint (*i, daddr, saddr, sport, incomingInterface,
+                            isBroadcast, incomingInterfaceAddr, retval);
         }
-
-      if (isBroadcast && (endP->GetLocalAddress () != Ipv4Address::GetAny ()))
+    }
+  PortEndPoints::iterator unconnected = m_unconnected.find (dport);
+  if (unconnected != m_unconnected.end ())
+    {
+      for (EndPointsI i = unconnected->second.begin (); i != unconnected->second.end (); i++)
         {
-          localAddressMatchesExact = (endP->GetLocalAddress () ==
-                                      incomingInterfaceAddr);
-        }
-      // if no match here, keep looking
-      if (!(localAddressMatchesExact || localAddressMatchesWildCard))
-        continue; 
-      bool remotePeerMatchesExact = endP->GetPeerPort () == sport;
-      bool remotePeerMatchesWildCard = endP->GetPeerPort () == 0;
-      bool remoteAddressMatchesExact = endP->GetPeerAddress () == saddr;
-      bool remoteAddressMatchesWildCard = endP->GetPeerAddress () ==
-        Ipv4Address::GetAny ();
-      // If remote does not match either with exact or wildcard,
-      // skip this one
-      if (!(remotePeerMatchesExact || remotePeerMatchesWildCard))
-        continue;
-      if (!(remoteAddressMatchesExact || remoteAddressMatchesWildCard))
-        continue;
-
-      // Now figure out which return list to add this one to
-      if (localAddressMatchesWildCard &&
-          remotePeerMatchesWildCard &&
-          remoteAddressMatchesWildCard)
-        { // Only local port matches exactly
-          retval1.push_back (endP);
-        }
-      if ((localAddressMatchesExact || (isBroadcast && localAddressMatchesWildCard))&&
-          remotePeerMatchesWildCard &&
-          remoteAddressMatchesWildCard)
-        { // Only local port and local address matches exactly
-          retval2.push_back (endP);
-        }
-      if (localAddressMatchesWildCard &&
-          remotePeerMatchesExact &&
-          remoteAddressMatchesExact)
-        { // All but local address
-          retval3.push_back (endP);
-        }
-      if (localAddressMatchesExact &&
-          remotePeerMatchesExact &&
-          remoteAddressMatchesExact)
-        { // All 4 match
-          retval4.push_back (endP);
+          ClassifyEndPoint (*i, daddr, saddr, sport, incomingInterface,
+                            isBroadcast, incomingInterfaceAddr, retval);
         }
     }
 
   // Here we find the most exact match
-  if (!retval4.empty ()) return retval4;
-  if (!retval3.empty ()) return retval3;
-  if (!retval2.empty ()) return retval2;
-  return retval1;  // might be empty if no matches
+  if (!retval[3].empty ()) return retval[3];
+  if (!retval[2].empty ()) return retval[2];
+  if (!retval[1].empty ()) return retval[1];
+  return retval[0];  // might be empty if no matches
 }
 
 Ipv4EndPoint *
@@ -314,7 +474,8 @@ Ipv4EndPointDemux::SimpleLookup (Ipv4Address daddr,
                                  uint16_t sport)
 {
   // this code is a copy/paste version of an old BSD ip stack lookup
-  // function.
+  // function. It is only used for ICMP errors, and the generic match
+  // may be any endpoint on the port, so it still walks all of them.
   uint32_t genericity = 3;
   Ipv4EndPoint *generic = 0;
   for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <list>
 #include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
 #include "ipv4-interface.h"
 
 namespace ns3 {
@@ -38,6 +39,13 @@ class Ipv4EndPoint;
  * of endpoints, and has APIs to add and find endpoints in this demux.  This
  * code is shared in common to TCP and UDP protocols in ns3.  This demux
  * sits between ns3's layer four and the socket layer
+ *
+ * The endpoints are also indexed so that the cost of a lookup does not
+ * grow with their number: the endpoints connected to a peer are hashed
+ * on their local port and peer address and port, the others are kept
+ * in a list per local port, and the endpoints per local port and per
+ * local address and port are counted for the allocation checks. The
+ * endpoints tell their demux when their addresses change.
  */
 
 class Ipv4EndPointDemux {
@@ -74,12 +82,60 @@ public:
   void DeAllocate (Ipv4EndPoint *endPoint);
 
 private:
+  friend class Ipv4EndPoint;
+
+  /* The key of the endpoints connected to a peer */
+  struct ConnectedKey
+  {
+    uint16_t localPort;
+    uint16_t peerPort;
+    Ipv4Address peerAddress;
+    bool operator == (const ConnectedKey &o) const;
+  };
+  struct ConnectedKeyHash
+  {
+    size_t operator () (const ConnectedKey &key) const;
+  };
+  /* The key of the local address and port counts */
+  struct LocalKey
+  {
+    uint16_t port;
+    Ipv4Address address;
+    bool operator == (const LocalKey &o) const;
+  };
+  struct LocalKeyHash
+  {
+    size_t operator () (const LocalKey &key) const;
+  };
+  typedef sgi::hash_map<ConnectedKey, EndPoints, ConnectedKeyHash> ConnectedEndPoints;
+  typedef sgi::hash_map<uint16_t, EndPoints> PortEndPoints;
+  typedef sgi::hash_map<uint16_t, uint32_t> PortCounts;
+  typedef sgi::hash_map<LocalKey, uint32_t, LocalKeyHash> LocalCounts;
+
   uint16_t AllocateEphemeralPort (void);
+  Ipv4EndPoint *Add (Ipv4EndPoint *endPoint);
+  static bool IsConnected (Ipv4Address peerAddress, uint16_t peerPort);
+  static ConnectedKey GetConnectedKey (uint16_t localPort, Ipv4Address peerAddress, uint16_t peerPort);
+  static void EraseFrom (EndPoints &endPoints, Ipv4EndPoint *endPoint);
+  void AddLocal (Ipv4Address address, uint16_t port);
+  void RemoveLocal (Ipv4Address address, uint16_t port);
+  /* Also called by the endpoints, around the changes of their addresses */
+  void AddToIndex (Ipv4EndPoint *endPoint);
+  void RemoveFromIndex (Ipv4EndPoint *endPoint);
+  void ClassifyEndPoint (Ipv4EndPoint *endP, Ipv4Address daddr,
+                         Ipv4Address saddr, uint16_t sport,
+                         Ptr<Ipv4Interface> incomingInterface,
+                         bool isBroadcast, Ipv4Address incomingInterfaceAddr,
+                         EndPoints retval[4]);
 
   uint16_t m_ephemeral;
   uint16_t m_portLast;
   uint16_t m_portFirst;
   EndPoints m_endPoints;
+  ConnectedEndPoints m_connected;   //!< endpoints with a peer address and port
+  PortEndPoints m_unconnected;      //!< the other endpoints, per local port
+  PortCounts m_portCounts;          //!< number of endpoints per local port
+  LocalCounts m_localCounts;        //!< number of endpoints per local address and port
 };
 
 } // namespace ns3
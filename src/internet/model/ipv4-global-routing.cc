@@ -17,6 +17,7 @@
 //
 
 #include <vector>
+#include <algorithm>
 #include <iomanip>
 #include "ns3/names.h"
 #include "ns3/log.h"
@@ -70,7 +71,8 @@ Ipv4GlobalRouting::GetTypeId (void)
 Ipv4GlobalRouting::Ipv4GlobalRouting () 
   : m_randomEcmpRouting (false),
     m_flowEcmpRouting (false),
-    m_respondToInterfaceEvents (false)
+    m_respondToInterfaceEvents (false),
+    m_indexValid (false)
 {
   for(int i=0; i<256; i++)
     block_vals[i] = m_rand.GetInteger(0, 1000000007);
@@ -91,6 +93,7 @@ Ipv4GlobalRouting::AddHostRouteTo (Ipv4Address dest,
   Ipv4RoutingTableEntry *route = new Ipv4RoutingTableEntry ();
   *route = Ipv4RoutingTableEntry::CreateHostRouteTo (dest, nextHop, interface);
   m_hostRoutes.push_back (route);
+  InvalidateFib ();
 }
 
 void 
@@ -101,6 +104,7 @@ Ipv4GlobalRouting::AddHostRouteTo (Ipv4Address dest,
   Ipv4RoutingTableEntry *route = new Ipv4RoutingTableEntry ();
   *route = Ipv4RoutingTableEntry::CreateHostRouteTo (dest, interface);
   m_hostRoutes.push_back (route);
+  InvalidateFib ();
 }
 
 void 
@@ -116,6 +120,7 @@ Ipv4GlobalRouting::AddNetworkRouteTo (Ipv4Address network,
                                                         nextHop,
                                                         interface);
   m_networkRoutes.push_back (route);
+  InvalidateFib ();
 }
 
 void 
@@ -129,6 +134,7 @@ Ipv4GlobalRouting::AddNetworkRouteTo (Ipv4Address network,
                                                         networkMask,
                                                         interface);
   m_networkRoutes.push_back (route);
+  InvalidateFib ();
 }
 
 void 
@@ -144,6 +150,7 @@ Ipv4GlobalRouting::AddASExternalRouteTo (Ipv4Address network,
                                                         nextHop,
                                                         interface);
   m_ASexternalRoutes.push_back (route);
+  InvalidateFib ();
 }
 
 // This function is used to spread the routing of flows across equal
@@ -251,62 +258,114 @@ Ipv4GlobalRouting::GetTupleValue (const Ipv4Header &header, Ptr<const Packet> ip
 
 
 
-Ptr<Ipv4Route>
-Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipPayload, Ptr<NetDevice> oif)
+void
+Ipv4GlobalRouting::InvalidateFib (void)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  NS_ABORT_MSG_IF (m_randomEcmpRouting && m_flowEcmpRouting, "Ecmp mode selection");
-  NS_LOG_LOGIC ("Looking for route for destination " << header.GetDestination());
-  Ptr<Ipv4Route> rtentry = 0;
-  // store all available routes that bring packets to their destination
-  typedef std::vector<Ipv4RoutingTableEntry*> RouteVec_t;
-  RouteVec_t allRoutes;
+  m_indexValid = false;
+  m_fib.clear ();
+}
 
-  NS_LOG_LOGIC ("Number of m_hostRoutes = " << m_hostRoutes.size ());
+void
+Ipv4GlobalRouting::BuildIndex (void)
+{
+  if (m_indexValid)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+  m_hostIndex.clear ();
+  m_networkIndex.clear ();
+  m_fib.clear ();
+  uint32_t rank = 0;
   for (HostRoutesCI i = m_hostRoutes.begin (); 
        i != m_hostRoutes.end (); 
-       i++) 
+       i++, rank++) 
     {
       NS_ASSERT ((*i)->IsHost ());
-      if ((*i)->GetDest ().IsEqual (header.GetDestination ())) 
+      m_hostIndex[(*i)->GetDest ()].push_back (std::make_pair (rank, *i));
+    }
+  rank = 0;
+  for (NetworkRoutesCI j = m_networkRoutes.begin (); 
+       j != m_networkRoutes.end (); 
+       j++, rank++) 
+    {
+      Ipv4Mask mask = (*j)->GetDestNetworkMask ();
+      uint32_t k;
+      for (k = 0; k < m_networkIndex.size (); k++)
         {
-          if (oif != 0)
+          if (m_networkIndex[k].first == mask)
             {
-              if (oif != m_ipv4->GetNetDevice ((*i)->GetInterface ()))
-                {
-                  NS_LOG_LOGIC ("Not on requested interface, skipping");
-                  continue;
-                }
+              break;
             }
-          allRoutes.push_back (*i);
-          NS_LOG_LOGIC (allRoutes.size () << "Found global host route" << *i); 
         }
+      if (k == m_networkIndex.size ())
+        {
+          m_networkIndex.push_back (std::make_pair (mask, RouteIndex ()));
+        }
+      Ipv4Address network = (*j)->GetDestNetwork ().CombineMask (mask);
+      m_networkIndex[k].second[network].push_back (std::make_pair (rank, *j));
     }
-  if (allRoutes.size () == 0) // if no host route is found
+  m_indexValid = true;
+}
+
+void
+Ipv4GlobalRouting::CollectRoutes (Ipv4Address dest, Ptr<NetDevice> oif,
+                                  std::vector<Ipv4RoutingTableEntry *> &routes)
+{
+  BuildIndex ();
+
+  RouteIndex::const_iterator host = m_hostIndex.find (dest);
+  if (host != m_hostIndex.end ())
     {
-      NS_LOG_LOGIC ("Number of m_networkRoutes" << m_networkRoutes.size ());
-      for (NetworkRoutesI j = m_networkRoutes.begin (); 
-           j != m_networkRoutes.end (); 
-           j++) 
+      for (IndexedRoutes::const_iterator i = host->second.begin ();
+           i != host->second.end ();
+           i++)
         {
-          Ipv4Mask mask = (*j)->GetDestNetworkMask ();
-          Ipv4Address entry = (*j)->GetDestNetwork ();
-          if (mask.IsMatch (header.GetDestination (), entry)) 
+          if (oif != 0 && oif != m_ipv4->GetNetDevice (i->second->GetInterface ()))
             {
-              if (oif != 0)
+              NS_LOG_LOGIC ("Not on requested interface, skipping");
+              continue;
+            }
+          routes.push_back (i->second);
+          NS_LOG_LOGIC (routes.size () << "Found global host route" << i->second); 
+        }
+    }
+  if (routes.size () == 0) // if no host route is found
+    {
+      // a destination can match network routes of several masks: they
+      // are all candidates, in the order of the network routes table.
+      IndexedRoutes matches;
+      for (uint32_t k = 0; k < m_networkIndex.size (); k++)
+        {
+          Ipv4Address network = dest.CombineMask (m_networkIndex[k].first);
+          RouteIndex::const_iterator j = m_networkIndex[k].second.find (network);
+          if (j == m_networkIndex[k].second.end ())
+            {
+              continue;
+            }
+          for (IndexedRoutes::const_iterator i = j->second.begin ();
+               i != j->second.end ();
+               i++)
+            {
+              if (oif != 0 && oif != m_ipv4->GetNetDevice (i->second->GetInterface ()))
                 {
-                  if (oif != m_ipv4->GetNetDevice ((*j)->GetInterface ()))
-                    {
-                      NS_LOG_LOGIC ("Not on requested interface, skipping");
-                      continue;
-                    }
+                  NS_LOG_LOGIC ("Not on requested interface, skipping");
+                  continue;
                 }
-              allRoutes.push_back (*j);
-              NS_LOG_LOGIC (allRoutes.size () << "Found global network route" << *j);
+              matches.push_back (*i);
             }
         }
+      if (m_networkIndex.size () > 1)
+        {
+          std::sort (matches.begin (), matches.end ());
+        }
+      for (IndexedRoutes::const_iterator i = matches.begin (); i != matches.end (); i++)
+        {
+          routes.push_back (i->second);
+          NS_LOG_LOGIC (routes.size () << "Found global network route" << i->second);
+        }
     }
-  if (allRoutes.size () == 0)  // consider external if no host/network found
+  if (routes.size () == 0)  // consider external if no host/network found
     {
       for (ASExternalRoutesI k = m_ASexternalRoutes.begin ();
            k != m_ASexternalRoutes.end ();
@@ -314,7 +373,7 @@ Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipP
         {
           Ipv4Mask mask = (*k)->GetDestNetworkMask ();
           Ipv4Address entry = (*k)->GetDestNetwork ();
-          if (mask.IsMatch (header.GetDestination (), entry))
+          if (mask.IsMatch (dest, entry))
             {
               NS_LOG_LOGIC ("Found external route" << *k);
               if (oif != 0)
@@ -325,11 +384,56 @@ Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipP
                       continue;
                     }
                 }
-              allRoutes.push_back (*k);
+              routes.push_back (*k);
               break;
             }
         }
     }
+}
+
+Ptr<Ipv4Route>
+Ipv4GlobalRouting::CreateRoute (Ipv4RoutingTableEntry *route)
+{
+  // create a Ipv4Route object from the selected routing table entry
+  Ptr<Ipv4Route> rtentry = Create<Ipv4Route> ();
+  rtentry->SetDestination (route->GetDest ());
+  // XXX handle multi-address case
+  rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
+  rtentry->SetGateway (route->GetGateway ());
+  uint32_t interfaceIdx = route->GetInterface ();
+  rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
+  return rtentry;
+}
+
+Ptr<Ipv4Route>
+Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipPayload, Ptr<NetDevice> oif)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ABORT_MSG_IF (m_randomEcmpRouting && m_flowEcmpRouting, "Ecmp mode selection");
+  NS_LOG_LOGIC ("Looking for route for destination " << header.GetDestination());
+
+  // Packets bound to an output device are rare: they bypass the
+  // compiled forwarding table and get a route of their own.
+  std::vector<Ipv4RoutingTableEntry *> filtered;
+  FibEntry *entry = 0;
+  if (oif == 0)
+    {
+      BuildIndex ();
+      Fib::iterator i = m_fib.find (header.GetDestination ());
+      if (i == m_fib.end ())
+        {
+          i = m_fib.insert (std::make_pair (header.GetDestination (), FibEntry ())).first;
+          CollectRoutes (header.GetDestination (), 0, i->second.routes);
+          i->second.cache.resize (i->second.routes.size ());
+        }
+      entry = &i->second;
+    }
+  else
+    {
+      CollectRoutes (header.GetDestination (), oif, filtered);
+    }
+  const std::vector<Ipv4RoutingTableEntry *> &allRoutes = entry != 0 ? entry->routes : filtered;
+
   if (allRoutes.size () > 0 ) // if route(s) is found
     {
       // select one of the routes uniformly at random if random
@@ -355,14 +459,15 @@ Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipP
 
       //std::cout<<"allRoutes.size(): "<<allRoutes.size()<<std::endl;
       Ipv4RoutingTableEntry* route = allRoutes.at (selectIndex); 
-      // create a Ipv4Route object from the selected routing table entry
-      rtentry = Create<Ipv4Route> ();
-      rtentry->SetDestination (route->GetDest ());
-      // XXX handle multi-address case
-      rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
-      rtentry->SetGateway (route->GetGateway ());
-      uint32_t interfaceIdx = route->GetInterface ();
-      rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
+      if (entry == 0)
+        {
+          return CreateRoute (route);
+        }
+      Ptr<Ipv4Route> &rtentry = entry->cache[selectIndex];
+      if (rtentry == 0)
+        {
+          rtentry = CreateRoute (route);
+        }
       return rtentry;
     }
   else 
@@ -447,6 +552,7 @@ Ipv4GlobalRouting::RemoveRoute (uint32_t index)
               NS_LOG_LOGIC ("Removing route " << index << "; size = " << m_hostRoutes.size ());
               delete *i;
               m_hostRoutes.erase (i);
+              InvalidateFib ();
               NS_LOG_LOGIC ("Done removing host route " << index << "; host route remaining size = " << m_hostRoutes.size ());
               return;
             }
@@ -464,6 +570,7 @@ Ipv4GlobalRouting::RemoveRoute (uint32_t index)
           NS_LOG_LOGIC ("Removing route " << index << "; size = " << m_networkRoutes.size ());
           delete *j;
           m_networkRoutes.erase (j);
+          InvalidateFib ();
           NS_LOG_LOGIC ("Done removing network route " << index << "; network route remaining size = " << m_networkRoutes.size ());
           return;
         }
@@ -480,6 +587,7 @@ Ipv4GlobalRouting::RemoveRoute (uint32_t index)
           NS_LOG_LOGIC ("Removing route " << index << "; size = " << m_ASexternalRoutes.size ());
           delete *k;
           m_ASexternalRoutes.erase (k);
+          InvalidateFib ();
           NS_LOG_LOGIC ("Done removing network route " << index << "; network route remaining size = " << m_networkRoutes.size ());
           return;
         }
@@ -510,6 +618,9 @@ Ipv4GlobalRouting::DoDispose (void)
     {
       delete (*l);
     }
+  InvalidateFib ();
+  m_hostIndex.clear ();
+  m_networkIndex.clear ();
 
   Ipv4RoutingProtocol::DoDispose ();
 }
@@ -698,6 +809,8 @@ void
 Ipv4GlobalRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << interface << address);
+  // cached routes carry the source address of their interface
+  m_fib.clear ();
   if (m_respondToInterfaceEvents && Simulator::Now ().GetSeconds () > 0)  // avoid startup events
     {
       GlobalRouteManager::DeleteGlobalRoutes ();
@@ -710,6 +823,8 @@ void
 Ipv4GlobalRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << interface << address);
+  // cached routes carry the source address of their interface
+  m_fib.clear ();
   if (m_respondToInterfaceEvents && Simulator::Now ().GetSeconds () > 0)  // avoid startup events
     {
       GlobalRouteManager::DeleteGlobalRoutes ();
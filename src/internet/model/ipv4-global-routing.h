@@ -21,13 +21,16 @@
 #define IPV4_GLOBAL_ROUTING_H
 
 #include <list>
+#include <vector>
 #include <stdint.h>
+#include "ns3/sgi-hashmap.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/random-variable.h"
+#include "ns3/ipv4-route.h"
 
 namespace ns3 {
 
@@ -241,10 +244,48 @@ private:
 
   Ptr<Ipv4Route> LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipPayload, Ptr<NetDevice> oif = 0);
 
+  /**
+   * The forwarding state compiled for one destination address: the
+   * equal-cost routes which LookupGlobal would select from, in routing
+   * table order, and the Ipv4Route built for each of them on first use.
+   */
+  struct FibEntry
+  {
+    std::vector<Ipv4RoutingTableEntry *> routes;
+    std::vector<Ptr<Ipv4Route> > cache;
+  };
+  typedef std::vector<std::pair<uint32_t, Ipv4RoutingTableEntry *> > IndexedRoutes;
+  typedef sgi::hash_map<Ipv4Address, IndexedRoutes, Ipv4AddressHash> RouteIndex;
+  typedef sgi::hash_map<Ipv4Address, FibEntry, Ipv4AddressHash> Fib;
+
+  /**
+   * \brief Collect the routes to dest in the order the routing tables
+   * would have matched them: host routes, otherwise network routes,
+   * otherwise the first AS external route.
+   *
+   * Routes whose output device is not oif are skipped if oif is not 0.
+   */
+  void CollectRoutes (Ipv4Address dest, Ptr<NetDevice> oif,
+                      std::vector<Ipv4RoutingTableEntry *> &routes);
+  /// Rebuild the per-destination and per-prefix route indexes if needed.
+  void BuildIndex (void);
+  /// Drop the compiled forwarding state after a routing table change.
+  void InvalidateFib (void);
+  Ptr<Ipv4Route> CreateRoute (Ipv4RoutingTableEntry *route);
+
   HostRoutes m_hostRoutes;
   NetworkRoutes m_networkRoutes;
   ASExternalRoutes m_ASexternalRoutes; // External routes imported
 
+  /// true if m_hostIndex and m_networkIndex match the routing tables
+  bool m_indexValid;
+  /// host routes by destination address
+  RouteIndex m_hostIndex;
+  /// network routes by network address, one table per network mask
+  std::vector<std::pair<Ipv4Mask, RouteIndex> > m_networkIndex;
+  /// compiled ECMP groups, by destination address
+  Fib m_fib;
+
   Ptr<Ipv4> m_ipv4;
 };
 
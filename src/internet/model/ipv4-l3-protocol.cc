@@ -18,6 +18,7 @@
 // Author: George F. Riley<riley@ece.gatech.edu>
 //
 
+#include <algorithm>
 #include "ns3/packet.h"
 #include "ns3/log.h"
 #include "ns3/callback.h"
@@ -86,10 +87,22 @@ Ipv4L3Protocol::GetTypeId (void)
   return tid;
 }
 
+size_t
+Ipv4L3Protocol::DeviceHash::operator () (const NetDevice *device) const
+{
+  // The low bits of the address of an object are always zero
+  return (size_t)device >> 4;
+}
+
 Ipv4L3Protocol::Ipv4L3Protocol()
-  : m_identification (0)
+  : m_identification (0),
+    m_receivedPacket (0)
 {
   NS_LOG_FUNCTION (this);
+  m_ucb = MakeCallback (&Ipv4L3Protocol::IpForward, this);
+  m_mcb = MakeCallback (&Ipv4L3Protocol::IpMulticastForward, this);
+  m_lcb = MakeCallback (&Ipv4L3Protocol::LocalDeliver, this);
+  m_ecb = MakeCallback (&Ipv4L3Protocol::RouteInputError, this);
 }
 
 Ipv4L3Protocol::~Ipv4L3Protocol ()
@@ -201,6 +214,9 @@ Ipv4L3Protocol::DoDispose (void)
       *i = 0;
     }
   m_interfaces.clear ();
+  m_deviceInterfaces.clear ();
+  m_localInterfaces.clear ();
+  m_broadcastInterfaces.clear ();
   m_sockets.clear ();
   m_node = 0;
   m_routingProtocol = 0;
@@ -273,8 +289,19 @@ Ipv4L3Protocol::AddInterface (Ptr<NetDevice> device)
   Ptr<Node> node = GetObject<Node> ();
   node->RegisterProtocolHandler (MakeCallback (&Ipv4L3Protocol::Receive, this), 
                                  Ipv4L3Protocol::PROT_NUMBER, device);
-  node->RegisterProtocolHandler (MakeCallback (&ArpL3Protocol::Receive, PeekPointer (GetObject<ArpL3Protocol> ())),
-                                 ArpL3Protocol::PROT_NUMBER, device);
+  if (device->NeedsArp ())
+    {
+      // Forwarding-only stacks come without ARP, add it along with the
+      // first device which needs it
+      Ptr<ArpL3Protocol> arp = GetObject<ArpL3Protocol> ();
+      if (arp == 0)
+        {
+          arp = CreateObject<ArpL3Protocol> ();
+          node->AggregateObject (arp);
+        }
+      node->RegisterProtocolHandler (MakeCallback (&ArpL3Protocol::Receive, PeekPointer (arp)),
+                                     ArpL3Protocol::PROT_NUMBER, device);
+    }
 
   Ptr<Ipv4Interface> interface = CreateObject<Ipv4Interface> ();
   interface->SetNode (m_node);
@@ -289,9 +316,43 @@ Ipv4L3Protocol::AddIpv4Interface (Ptr<Ipv4Interface>interface)
   NS_LOG_FUNCTION (this << interface);
   uint32_t index = m_interfaces.size ();
   m_interfaces.push_back (interface);
+  // A device keeps its first interface
+  m_deviceInterfaces.insert (std::make_pair (PeekPointer (interface->GetDevice ()), index));
+  for (uint32_t i = 0; i < interface->GetNAddresses (); i++)
+    {
+      IndexAddress (index, interface->GetAddress (i));
+    }
   return index;
 }
 
+void
+Ipv4L3Protocol::IndexAddress (uint32_t interface, const Ipv4InterfaceAddress &address)
+{
+  std::vector<uint32_t> &local = m_localInterfaces[address.GetLocal ()];
+  local.insert (std::upper_bound (local.begin (), local.end (), interface), interface);
+  std::vector<uint32_t> &broadcast = m_broadcastInterfaces[address.GetBroadcast ()];
+  broadcast.insert (std::upper_bound (broadcast.begin (), broadcast.end (), interface), interface);
+}
+
+void
+Ipv4L3Protocol::UnindexAddress (uint32_t interface, const Ipv4InterfaceAddress &address)
+{
+  AddressInterfaces::iterator local = m_localInterfaces.find (address.GetLocal ());
+  NS_ASSERT (local != m_localInterfaces.end ());
+  local->second.erase (std::lower_bound (local->second.begin (), local->second.end (), interface));
+  if (local->second.empty ())
+    {
+      m_localInterfaces.erase (local);
+    }
+  AddressInterfaces::iterator broadcast = m_broadcastInterfaces.find (address.GetBroadcast ());
+  NS_ASSERT (broadcast != m_broadcastInterfaces.end ());
+  broadcast->second.erase (std::lower_bound (broadcast->second.begin (), broadcast->second.end (), interface));
+  if (broadcast->second.empty ())
+    {
+      m_broadcastInterfaces.erase (broadcast);
+    }
+}
+
 Ptr<Ipv4Interface>
 Ipv4L3Protocol::GetInterface (uint32_t index) const
 {
@@ -312,21 +373,12 @@ int32_t
 Ipv4L3Protocol::GetInterfaceForAddress (
   Ipv4Address address) const
 {
-  int32_t interface = 0;
-  for (Ipv4InterfaceList::const_iterator i = m_interfaces.begin (); 
-       i != m_interfaces.end (); 
-       i++, interface++)
+  AddressInterfaces::const_iterator found = m_localInterfaces.find (address);
+  if (found == m_localInterfaces.end ())
     {
-      for (uint32_t j = 0; j < (*i)->GetNAddresses (); j++)
-        {
-          if ((*i)->GetAddress (j).GetLocal () == address)
-            {
-              return interface;
-            }
-        }
+      return -1;
     }
-
-  return -1;
+  return found->second.front ();
 }
 
 int32_t 
@@ -355,37 +407,32 @@ int32_t
 Ipv4L3Protocol::GetInterfaceForDevice (
   Ptr<const NetDevice> device) const
 {
-  int32_t interface = 0;
-  for (Ipv4InterfaceList::const_iterator i = m_interfaces.begin (); 
-       i != m_interfaces.end (); 
-       i++, interface++)
+  DeviceInterfaces::const_iterator found = m_deviceInterfaces.find (PeekPointer (device));
+  if (found == m_deviceInterfaces.end ())
     {
-      if ((*i)->GetDevice () == device)
-        {
-          return interface;
-        }
+      return -1;
     }
-
-  return -1;
+  return found->second;
 }
 
 bool
 Ipv4L3Protocol::IsDestinationAddress (Ipv4Address address, uint32_t iif) const
 {
+  AddressInterfaces::const_iterator local = m_localInterfaces.find (address);
+  AddressInterfaces::const_iterator broadcast = m_broadcastInterfaces.find (address);
+
   // First check the incoming interface for a unicast address match
-  for (uint32_t i = 0; i < GetNAddresses (iif); i++)
+  if (local != m_localInterfaces.end ()
+      && std::binary_search (local->second.begin (), local->second.end (), iif))
     {
-      Ipv4InterfaceAddress iaddr = GetAddress (iif, i);
-      if (address == iaddr.GetLocal ())
-        {
-          NS_LOG_LOGIC ("For me (destination " << address << " match)");
-          return true;
-        }
-      if (address == iaddr.GetBroadcast ())
-        {
-          NS_LOG_LOGIC ("For me (interface broadcast address)");
-          return true;
-        }
+      NS_LOG_LOGIC ("For me (destination " << address << " match)");
+      return true;
+    }
+  if (broadcast != m_broadcastInterfaces.end ()
+      && std::binary_search (broadcast->second.begin (), broadcast->second.end (), iif))
+    {
+      NS_LOG_LOGIC ("For me (interface broadcast address)");
+      return true;
     }
 
   if (address.IsMulticast ())
@@ -406,26 +453,19 @@ Ipv4L3Protocol::IsDestinationAddress (Ipv4Address address, uint32_t iif) const
       return true;
     }
 
-  if (GetWeakEsModel ())  // Check other interfaces
+  // Check other interfaces; the address is not on the incoming one
+  if (GetWeakEsModel ())
     { 
-      for (uint32_t j = 0; j < GetNInterfaces (); j++)
+      if (local != m_localInterfaces.end ())
         {
-          if (j == uint32_t (iif)) continue;
-          for (uint32_t i = 0; i < GetNAddresses (j); i++)
-            {
-              Ipv4InterfaceAddress iaddr = GetAddress (j, i);
-              if (address == iaddr.GetLocal ())
-                {
-                  NS_LOG_LOGIC ("For me (destination " << address << " match) on another interface");
-                  return true;
-                }
-              //  This is a small corner case:  match another interface's broadcast address
-              if (address == iaddr.GetBroadcast ())
-                {
-                  NS_LOG_LOGIC ("For me (interface broadcast address on another interface)");
-                  return true;
-                }
-            }
+          NS_LOG_LOGIC ("For me (destination " << address << " match) on another interface");
+          return true;
+        }
+      //  This is a small corner case:  match another interface's broadcast address
+      if (broadcast != m_broadcastInterfaces.end ())
+        {
+          NS_LOG_LOGIC ("For me (interface broadcast address on another interface)");
+          return true;
         }
     }
   return false;
@@ -440,31 +480,23 @@ Ipv4L3Protocol::Receive ( Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t p
   NS_LOG_LOGIC ("Packet from " << from << " received on node " << 
                 m_node->GetId ());
 
-  uint32_t interface = 0;
   Ptr<Packet> packet = p->Copy ();
 
-  Ptr<Ipv4Interface> ipv4Interface;
-  for (Ipv4InterfaceList::const_iterator i = m_interfaces.begin (); 
-       i != m_interfaces.end (); 
-       i++, interface++)
+  DeviceInterfaces::const_iterator found = m_deviceInterfaces.find (PeekPointer (device));
+  NS_ASSERT_MSG (found != m_deviceInterfaces.end (), "Packet received on a device without interface");
+  uint32_t interface = found->second;
+  Ptr<Ipv4Interface> ipv4Interface = m_interfaces[interface];
+  if (ipv4Interface->IsUp ())
     {
-      ipv4Interface = *i;
-      if (ipv4Interface->GetDevice () == device)
-        {
-          if (ipv4Interface->IsUp ())
-            {
-              m_rxTrace (packet, m_node->GetObject<Ipv4> (), interface);
-              break;
-            }
-          else
-            {
-              NS_LOG_LOGIC ("Dropping received packet -- interface is down");
-              Ipv4Header ipHeader;
-              packet->RemoveHeader (ipHeader);
-              m_dropTrace (ipHeader, packet, DROP_INTERFACE_DOWN, m_node->GetObject<Ipv4> (), interface);
-              return;
-            }
-        }
+      m_rxTrace (packet, m_node->GetObject<Ipv4> (), interface);
+    }
+  else
+    {
+      NS_LOG_LOGIC ("Dropping received packet -- interface is down");
+      Ipv4Header ipHeader;
+      packet->RemoveHeader (ipHeader);
+      m_dropTrace (ipHeader, packet, DROP_INTERFACE_DOWN, m_node->GetObject<Ipv4> (), interface);
+      return;
     }
 
   Ipv4Header ipHeader;
@@ -495,12 +527,15 @@ Ipv4L3Protocol::Receive ( Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t p
     }
 
   NS_ASSERT_MSG (m_routingProtocol != 0, "Need a routing protocol object to process packets");
-  if (!m_routingProtocol->RouteInput (packet, ipHeader, device,
-                                      MakeCallback (&Ipv4L3Protocol::IpForward, this),
-                                      MakeCallback (&Ipv4L3Protocol::IpMulticastForward, this),
-                                      MakeCallback (&Ipv4L3Protocol::LocalDeliver, this),
-                                      MakeCallback (&Ipv4L3Protocol::RouteInputError, this)
-                                      ))
+  Packet *previous = m_receivedPacket;
+  // Only Receive may hold the packet for IpForward to change it: an rx
+  // trace sink may have kept a reference to it.  The count is checked
+  // here, as the routing protocol and the callbacks hold a varying
+  // number of references while it is routed.
+  m_receivedPacket = packet->GetReferenceCount () == 1 ? PeekPointer (packet) : 0;
+  bool routed = m_routingProtocol->RouteInput (packet, ipHeader, device, m_ucb, m_mcb, m_lcb, m_ecb);
+  m_receivedPacket = previous;
+  if (!routed)
     {
       NS_LOG_WARN ("No route found for forwarding packet.  Drop.");
       m_dropTrace (ipHeader, packet, DROP_NO_ROUTE, m_node->GetObject<Ipv4> (), interface);
@@ -821,7 +856,17 @@ Ipv4L3Protocol::IpForward (Ptr<Ipv4Route> rtentry, Ptr<const Packet> p, const Ip
   NS_LOG_LOGIC ("Forwarding logic for node: " << m_node->GetId ());
   // Forwarding
   Ipv4Header ipHeader = header;
-  Ptr<Packet> packet = p->Copy ();
+  Ptr<Packet> packet;
+  if (PeekPointer (p) == m_receivedPacket)
+    {
+      // Forwarding is the last use of the copy made by Receive, which
+      // no one else holds, so the header can be added back to it directly
+      packet = ConstCast<Packet> (p);
+    }
+  else
+    {
+      packet = p->Copy ();
+    }
   int32_t interface = GetInterfaceForDevice (rtentry->GetOutputDevice ());
   ipHeader.SetTtl (ipHeader.GetTtl () - 1);
   if (ipHeader.GetTtl () == 0)
@@ -832,7 +877,10 @@ Ipv4L3Protocol::IpForward (Ptr<Ipv4Route> rtentry, Ptr<const Packet> p, const Ip
           ipHeader.GetDestination ().IsMulticast () == false)
         {
           Ptr<Icmpv4L4Protocol> icmp = GetIcmp ();
-          icmp->SendTimeExceededTtl (ipHeader, packet);
+          if (icmp != 0)
+            {
+              icmp->SendTimeExceededTtl (ipHeader, packet);
+            }
         }
       NS_LOG_WARN ("TTL exceeded.  Drop.");
       m_dropTrace (header, packet, DROP_TTL_EXPIRED, m_node->GetObject<Ipv4> (), interface);
@@ -895,9 +943,10 @@ Ipv4L3Protocol::LocalDeliver (Ptr<const Packet> packet, Ipv4Header const&ip, uin
                   subnetDirected = true;
                 }
             }
-          if (subnetDirected == false)
+          Ptr<Icmpv4L4Protocol> icmp = GetIcmp ();
+          if (subnetDirected == false && icmp != 0)
             {
-              GetIcmp ()->SendDestUnreachPort (ip, copy);
+              icmp->SendDestUnreachPort (ip, copy);
             }
         }
     }
@@ -909,6 +958,10 @@ Ipv4L3Protocol::AddAddress (uint32_t i, Ipv4InterfaceAddress address)
   NS_LOG_FUNCTION (this << i << address);
   Ptr<Ipv4Interface> interface = GetInterface (i);
   bool retVal = interface->AddAddress (address);
+  if (retVal)
+    {
+      IndexAddress (i, address);
+    }
   if (m_routingProtocol != 0)
     {
       m_routingProtocol->NotifyAddAddress (i, address);
@@ -938,6 +991,7 @@ Ipv4L3Protocol::RemoveAddress (uint32_t i, uint32_t addressIndex)
   Ipv4InterfaceAddress address = interface->RemoveAddress (addressIndex);
   if (address != Ipv4InterfaceAddress ())
     {
+      UnindexAddress (i, address);
       if (m_routingProtocol != 0)
         {
           m_routingProtocol->NotifyRemoveAddress (i, address);
@@ -1400,9 +1454,9 @@ Ipv4L3Protocol::HandleFragmentsTimeout (std::pair<uint64_t, uint32_t> key, Ipv4H
   Ptr<Packet> packet = it->second->GetPartialPacket ();
 
   // if we have at least 8 bytes, we can send an ICMP.
-  if ( packet->GetSize () > 8 )
+  Ptr<Icmpv4L4Protocol> icmp = GetIcmp ();
+  if ( packet->GetSize () > 8 && icmp != 0)
     {
-      Ptr<Icmpv4L4Protocol> icmp = GetIcmp ();
       icmp->SendTimeExceededTtl (ipHeader, packet);
     }
   m_dropTrace (ipHeader, packet, DROP_FRAGMENT_TIMEOUT, m_node->GetObject<Ipv4> (), iif);
@@ -34,6 +34,7 @@
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/nstime.h"
 #include "ns3/simulator.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -257,6 +258,18 @@ private:
 
   uint32_t AddIpv4Interface (Ptr<Ipv4Interface> interface);
   void SetupLoopback (void);
+  /**
+   * \brief Add an address of an interface to the address indexes
+   * \param interface the interface index
+   * \param address the address
+   */
+  void IndexAddress (uint32_t interface, const Ipv4InterfaceAddress &address);
+  /**
+   * \brief Remove an address of an interface from the address indexes
+   * \param interface the interface index
+   * \param address the address
+   */
+  void UnindexAddress (uint32_t interface, const Ipv4InterfaceAddress &address);
 
   /**
    * \brief Get ICMPv4 protocol.
@@ -293,11 +306,24 @@ private:
   typedef std::vector<Ptr<Ipv4Interface> > Ipv4InterfaceList;
   typedef std::list<Ptr<Ipv4RawSocketImpl> > SocketList;
   typedef std::list<Ptr<Ipv4L4Protocol> > L4List_t;
+  struct DeviceHash
+  {
+    size_t operator () (const NetDevice *device) const;
+  };
+  typedef sgi::hash_map<const NetDevice *, uint32_t, DeviceHash> DeviceInterfaces;
+  // The sorted indexes of the interfaces holding an address, once per
+  // occurrence of the address
+  typedef sgi::hash_map<Ipv4Address, std::vector<uint32_t>, Ipv4AddressHash> AddressInterfaces;
 
   bool m_ipForward;
   bool m_weakEsModel;
   L4List_t m_protocols;
   Ipv4InterfaceList m_interfaces;
+  // Indexes of m_interfaces, so that the received packets find their
+  // interface and whether they are for this node at constant cost
+  DeviceInterfaces m_deviceInterfaces;      // First interface, by device
+  AddressInterfaces m_localInterfaces;      // By local address
+  AddressInterfaces m_broadcastInterfaces;  // By broadcast address
   uint8_t m_defaultTtl;
   uint16_t m_identification;
   Ptr<Node> m_node;
@@ -313,6 +339,15 @@ private:
   TracedCallback<const Ipv4Header &, Ptr<const Packet>, DropReason, Ptr<Ipv4>, uint32_t> m_dropTrace;
 
   Ptr<Ipv4RoutingProtocol> m_routingProtocol;
+  // Built once rather than for every received packet
+  Ipv4RoutingProtocol::UnicastForwardCallback m_ucb;
+  Ipv4RoutingProtocol::MulticastForwardCallback m_mcb;
+  Ipv4RoutingProtocol::LocalDeliverCallback m_lcb;
+  Ipv4RoutingProtocol::ErrorCallback m_ecb;
+  // The private copy made by Receive while it is being routed, if no one
+  // else holds it: IpForward sends this packet out as is instead of
+  // copying it again
+  Packet *m_receivedPacket;
 
   SocketList m_sockets;
 
@@ -48,7 +48,8 @@ TcpRxBuffer::GetTypeId (void)
  * initialized below is insignificant.
  */
 TcpRxBuffer::TcpRxBuffer (uint32_t n)
-  : m_nextRxSeq (n), m_gotFin (false), m_size (0), m_maxBuffer (32768), m_availBytes (0)
+  : m_nextRxSeq (n), m_gotFin (false), m_size (0), m_maxBuffer (32768), m_availBytes (0),
+    m_headChunk (0)
 {
 }
 
@@ -110,9 +111,9 @@ TcpRxBuffer::MaxRxSequence (void) const
     { // No data allowed beyond FIN
       return m_finSeq;
     }
-  else if (m_data.size ())
+  else if (m_headChunk < m_data.size ())
     { // No data allowed beyond Rx window allowed
-      return m_data.begin ()->first + SequenceNumber32 (m_maxBuffer);
+      return m_data[m_headChunk].seq + SequenceNumber32 (m_maxBuffer);
     }
   return m_nextRxSeq + SequenceNumber32 (m_maxBuffer);
 }
@@ -146,32 +147,32 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
 
   // Trim packet to fit Rx window specification
   if (headSeq < m_nextRxSeq) headSeq = m_nextRxSeq;
-  if (m_data.size ())
+  if (m_headChunk < m_data.size ())
     {
-      SequenceNumber32 maxSeq = m_data.begin ()->first + SequenceNumber32 (m_maxBuffer);
+      SequenceNumber32 maxSeq = m_data[m_headChunk].seq + SequenceNumber32 (m_maxBuffer);
       if (maxSeq < tailSeq) tailSeq = maxSeq;
       if (tailSeq < headSeq) headSeq = tailSeq;
     }
   // Remove overlapped bytes from packet
-  BufIterator i = m_data.begin ();
-  while (i != m_data.end () && i->first <= tailSeq)
+  BufIterator i = m_data.begin () + m_headChunk;
+  while (i != m_data.end () && i->seq <= tailSeq)
     {
-      SequenceNumber32 lastByteSeq = i->first + SequenceNumber32 (i->second->GetSize ());
+      SequenceNumber32 lastByteSeq = i->seq + SequenceNumber32 (i->size);
       if (lastByteSeq > headSeq)
         {
-          if (i->first > headSeq && lastByteSeq < tailSeq)
-            { // Rare case: Existing packet is embedded fully in the new packet
-              m_size -= i->second->GetSize ();
-              m_data.erase (i++);
+          if (i->seq > headSeq && lastByteSeq < tailSeq)
+            { // Rare case: Existing run is embedded fully in the new packet
+              m_size -= i->size;
+              i = m_data.erase (i);
               continue;
             }
-          if (i->first <= headSeq)
+          if (i->seq <= headSeq)
             { // Incoming head is overlapped
               headSeq = lastByteSeq;
             }
           if (lastByteSeq >= tailSeq)
             { // Incoming tail is overlapped
-              tailSeq = i->first;
+              tailSeq = i->seq;
             }
         }
       ++i;
@@ -182,31 +183,42 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
       NS_LOG_LOGIC ("Nothing to buffer");
       return false; // Nothing to buffer anyway
     }
+  uint32_t length = tailSeq - headSeq;
+  bool isVirtual = p->IsVirtual ();
+  // Insert the bytes into the buffer, after the runs before them
+  i = m_data.begin () + m_headChunk;
+  while (i != m_data.end () && i->seq < headSeq)
+    {
+      ++i;
+    }
+  NS_ASSERT (i == m_data.end () || i->seq != headSeq); // Shouldn't be there yet
+  if (isVirtual && i != m_data.begin () + m_headChunk && (i - 1)->packet == 0
+      && (i - 1)->seq + SequenceNumber32 ((i - 1)->size) == headSeq)
+    { // Extend the virtual run just before
+      (i - 1)->size += length;
+    }
   else
     {
-      uint32_t start = headSeq - tcph.GetSequenceNumber ();
-      uint32_t length = tailSeq - headSeq;
-      p = p->CreateFragment (start, length);
-      NS_ASSERT (length == p->GetSize ());
+      Chunk chunk;
+      chunk.seq = headSeq;
+      chunk.size = length;
+      if (!isVirtual)
+        {
+          chunk.packet = p->CreateFragment (headSeq - tcph.GetSequenceNumber (), length);
+        }
+      m_data.insert (i, chunk);
     }
-  // Insert packet into buffer
-  NS_ASSERT (m_data.find (headSeq) == m_data.end ()); // Shouldn't be there yet
-  m_data [ headSeq ] = p;
-  NS_LOG_LOGIC ("Buffered packet of seqno=" << headSeq << " len=" << p->GetSize ());
+  NS_LOG_LOGIC ("Buffered packet of seqno=" << headSeq << " len=" << length);
   // Update variables
-  m_size += p->GetSize ();      // Occupancy
-  for (BufIterator i = m_data.begin (); i != m_data.end (); ++i)
+  m_size += length;      // Occupancy
+  for (i = m_data.begin () + m_headChunk; i != m_data.end () && i->seq <= m_nextRxSeq; ++i)
     {
-      if (i->first < m_nextRxSeq)
+      SequenceNumber32 lastByteSeq = i->seq + SequenceNumber32 (i->size);
+      if (lastByteSeq > m_nextRxSeq.Get ())
         {
-          continue;
+          m_availBytes += lastByteSeq - m_nextRxSeq.Get ();
+          m_nextRxSeq = lastByteSeq;
         }
-      else if (i->first > m_nextRxSeq)
-        {
-          break;
-        };
-      m_nextRxSeq = i->first + SequenceNumber32 (i->second->GetSize ());
-      m_availBytes += i->second->GetSize ();
     }
   NS_LOG_LOGIC ("Updated buffer occupancy=" << m_size << " nextRxSeq=" << m_nextRxSeq);
   if (m_gotFin && m_nextRxSeq == m_finSeq)
@@ -224,40 +236,60 @@ TcpRxBuffer::Extract (uint32_t maxSize)
   uint32_t extractSize = std::min (maxSize, m_availBytes);
   NS_LOG_LOGIC ("Requested to extract " << extractSize << " bytes from TcpRxBuffer of size=" << m_size);
   if (extractSize == 0) return 0;  // No contiguous block to return
-  NS_ASSERT (m_data.size ()); // At least we have something to extract
+  NS_ASSERT (m_headChunk < m_data.size ()); // At least we have something to extract
   Ptr<Packet> outPkt = Create<Packet> (); // The packet that contains all the data to return
-  BufIterator i;
   while (extractSize)
     { // Check the buffered data for delivery
-      i = m_data.begin ();
-      NS_ASSERT (i->first <= m_nextRxSeq); // in-sequence data expected
-      // Check if we send the whole pkt or just a partial
-      uint32_t pktSize = i->second->GetSize ();
-      if (pktSize <= extractSize)
-        { // Whole packet is extracted
-          outPkt->AddAtEnd (i->second);
-          m_data.erase (i);
-          m_size -= pktSize;
-          m_availBytes -= pktSize;
-          extractSize -= pktSize;
+      Chunk &head = m_data[m_headChunk];
+      NS_ASSERT (head.seq <= m_nextRxSeq); // in-sequence data expected
+      // Check if we send the whole run or just a partial
+      uint32_t runSize = std::min (head.size, extractSize);
+      if (head.packet == 0)
+        { // Virtual bytes, create them now
+          outPkt->AddAtEnd (Create<Packet> (runSize));
+        }
+      else if (runSize == head.size)
+        {
+          outPkt->AddAtEnd (head.packet);
+        }
+      else
+        {
+          outPkt->AddAtEnd (head.packet->CreateFragment (0, runSize));
+          head.packet = head.packet->CreateFragment (runSize, head.size - runSize);
+        }
+      m_size -= runSize;
+      m_availBytes -= runSize;
+      extractSize -= runSize;
+      if (runSize == head.size)
+        { // Whole run is extracted, release its packet
+          head.packet = 0;
+          ++m_headChunk;
         }
       else
         { // Partial is extracted and done
-          outPkt->AddAtEnd (i->second->CreateFragment (0, extractSize));
-          m_data[i->first + SequenceNumber32 (extractSize)] = i->second->CreateFragment (extractSize, pktSize - extractSize);
-          m_data.erase (i);
-          m_size -= extractSize;
-          m_availBytes -= extractSize;
-          extractSize = 0;
+          head.seq += runSize;
+          head.size -= runSize;
         }
     }
+  // Drop the extracted runs once they make up half of the vector, so
+  // that the cost of moving the others is amortized
+  if (m_headChunk == m_data.size ())
+    {
+      m_data.clear ();
+      m_headChunk = 0;
+    }
+  else if (m_headChunk > m_data.size () / 2)
+    {
+      m_data.erase (m_data.begin (), m_data.begin () + m_headChunk);
+      m_headChunk = 0;
+    }
   if (outPkt->GetSize () == 0)
     {
       NS_LOG_LOGIC ("Nothing extracted.");
       return 0;
     }
   NS_LOG_LOGIC ("Extracted " << outPkt->GetSize ( ) << " bytes, bufsize=" << m_size
-                             << ", num pkts in buffer=" << m_data.size ());
+                             << ", num runs in buffer=" << m_data.size () - m_headChunk);
   return outPkt;
 }
 
@@ -21,7 +21,7 @@
 #ifndef TCP_RX_BUFFER_H
 #define TCP_RX_BUFFER_H
 
-#include <map>
+#include <vector>
 #include "ns3/traced-value.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/sequence-number.h"
@@ -36,6 +36,12 @@ class Packet;
  *
  * \brief class for the reordering buffer that keeps the data from lower layer, i.e.
  *        TcpL4Protocol, sent to the application
+ *
+ * The data is kept as runs of contiguous bytes sorted by sequence
+ * number. The bytes of virtual segments (see Packet::IsVirtual) are not
+ * stored, only counted: a virtual segment which follows a virtual run
+ * extends it, so that in-order bulk data occupies a single run and the
+ * packets given to the application are created when it reads them.
  */
 class TcpRxBuffer : public Object
 {
@@ -73,15 +79,25 @@ public:
    */
   Ptr<Packet> Extract (uint32_t maxSize);
 public:
-  typedef std::map<SequenceNumber32, Ptr<Packet> >::iterator BufIterator;
+  /**
+   * A run of contiguous bytes in the buffer
+   */
+  struct Chunk
+  {
+    SequenceNumber32 seq; //< Sequence number of the first byte of the run
+    uint32_t size;        //< Number of bytes of the run
+    Ptr<Packet> packet;   //< The bytes of the run, or 0 if they are virtual
+  };
+  typedef std::vector<Chunk>::iterator BufIterator;
+
   TracedValue<SequenceNumber32> m_nextRxSeq; //< Seqnum of the first missing byte in data (RCV.NXT)
   SequenceNumber32 m_finSeq;                 //< Seqnum of the FIN packet
   bool m_gotFin;                             //< Did I received FIN packet?
   uint32_t m_size;                           //< Number of total data bytes in the buffer, not necessarily contiguous
   uint32_t m_maxBuffer;                      //< Upper bound of the number of data bytes in buffer (RCV.WND)
   uint32_t m_availBytes;                     //< Number of bytes available to read, i.e. contiguous block at head
-  std::map<SequenceNumber32, Ptr<Packet> > m_data;
-  //< Corresponding data (may be null)
+  uint32_t m_headChunk;                      //< Index in m_data of the first run not extracted yet
+  std::vector<Chunk> m_data;                 //< Runs of received bytes, sorted by sequence number, the ones before m_headChunk are extracted
 };
 
 } //namepsace ns3
@@ -92,7 +92,8 @@ TcpSocketBase::GetTypeId (void)
 }
 
 TcpSocketBase::TcpSocketBase (void)
-  : m_dupAckCount (0),
+  : m_retxFlags (0),
+    m_dupAckCount (0),
     m_delAckCount (0),
     m_endPoint (0),
     m_node (0),
@@ -113,10 +114,13 @@ TcpSocketBase::TcpSocketBase (void)
     m_rWnd (0)
 {
   NS_LOG_FUNCTION (this);
+  m_retxTimer.SetFunction (MakeCallback (&TcpSocketBase::ReTxTimerExpired, this));
+  m_delAckTimer.SetFunction (MakeCallback (&TcpSocketBase::DelAckTimeout, this));
 }
 
 TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
   : TcpSocket (sock), //copy object::m_tid and socket::callbacks
+    m_retxFlags (0),
     m_dupAckCount (sock.m_dupAckCount),
     m_delAckCount (0),
     m_delAckMaxCount (sock.m_delAckMaxCount),
@@ -147,6 +151,8 @@ TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_LOGIC ("Invoked the copy constructor");
+  m_retxTimer.SetFunction (MakeCallback (&TcpSocketBase::ReTxTimerExpired, this));
+  m_delAckTimer.SetFunction (MakeCallback (&TcpSocketBase::DelAckTimeout, this));
   // Copy the rtt estimator if it is set
   if (sock.m_rtt)
     {
@@ -849,7 +855,7 @@ TcpSocketBase::ProcessSynSent (Ptr<Packet> packet, const TcpHeader& tcpHeader)
       NS_LOG_INFO ("SYN_SENT -> ESTABLISHED");
       m_state = ESTABLISHED;
       m_connected = true;
-      m_retxEvent.Cancel ();
+      m_retxTimer.Cancel ();
       m_delAckCount = m_delAckMaxCount;
       ReceivedData (packet, tcpHeader);
       Simulator::ScheduleNow (&TcpSocketBase::ConnectionSucceeded, this);
@@ -871,7 +877,7 @@ TcpSocketBase::ProcessSynSent (Ptr<Packet> packet, const TcpHeader& tcpHeader)
       NS_LOG_INFO ("SYN_SENT -> ESTABLISHED");
       m_state = ESTABLISHED;
       m_connected = true;
-      m_retxEvent.Cancel ();
+      m_retxTimer.Cancel ();
       m_rxBuffer.SetNextRxSequence (tcpHeader.GetSequenceNumber () + SequenceNumber32 (1));
       m_highTxMark = ++m_nextTxSequence;
       m_txBuffer.SetHeadSequence (m_nextTxSequence);
@@ -912,7 +918,7 @@ TcpSocketBase::ProcessSynRcvd (Ptr<Packet> packet, const TcpHeader& tcpHeader,
       NS_LOG_INFO ("SYN_RCVD -> ESTABLISHED");
       m_state = ESTABLISHED;
       m_connected = true;
-      m_retxEvent.Cancel ();
+      m_retxTimer.Cancel ();
       m_highTxMark = ++m_nextTxSequence;
       m_txBuffer.SetHeadSequence (m_nextTxSequence);
       m_endPoint->SetPeer (InetSocketAddress::ConvertFrom (fromAddress).GetIpv4 (),
@@ -938,7 +944,7 @@ TcpSocketBase::ProcessSynRcvd (Ptr<Packet> packet, const TcpHeader& tcpHeader,
       if (tcpHeader.GetSequenceNumber () == m_rxBuffer.NextRxSequence ())
         { // In-sequence FIN before connection complete. Set up connection and close.
           m_connected = true;
-          m_retxEvent.Cancel ();
+          m_retxTimer.Cancel ();
           m_highTxMark = ++m_nextTxSequence;
           m_txBuffer.SetHeadSequence (m_nextTxSequence);
           m_endPoint->SetPeer (InetSocketAddress::ConvertFrom (fromAddress).GetIpv4 (),
@@ -1186,7 +1192,7 @@ TcpSocketBase::Destroy (void)
     }
   m_tcp = 0;
   NS_LOG_LOGIC (this << " Cancelled ReTxTimeout event which was set to expire at " <<
-                (Simulator::Now () + Simulator::GetDelayLeft (m_retxEvent)).GetSeconds ());
+                (Simulator::Now () + m_retxTimer.GetDelayLeft ()).GetSeconds ());
   CancelAllTimers ();
 }
 
@@ -1242,15 +1248,16 @@ TcpSocketBase::SendEmptyPacket (uint8_t flags)
   m_tcp->SendPacket (p, header, m_endPoint->GetLocalAddress (), m_endPoint->GetPeerAddress (), m_boundnetdevice);
   if (flags & TcpHeader::ACK)
     { // If sending an ACK, cancel the delay ACK as well
-      m_delAckEvent.Cancel ();
+      m_delAckTimer.Cancel ();
       m_delAckCount = 0;
     }
-  if (m_retxEvent.IsExpired () && (hasSyn || hasFin) && !isAck )
+  if (m_retxTimer.IsExpired () && (hasSyn || hasFin) && !isAck )
     { // Retransmit SYN / SYN+ACK / FIN / FIN+ACK to guard against lost
       NS_LOG_LOGIC ("Schedule retransmission timeout at time "
                     << Simulator::Now ().GetSeconds () << " to expire at time "
                     << (Simulator::Now () + m_rto.Get ()).GetSeconds ());
-      m_retxEvent = Simulator::Schedule (m_rto, &TcpSocketBase::SendEmptyPacket, this, flags);
+      m_retxFlags = flags;
+      m_retxTimer.Schedule (m_rto);
     }
 }
 
@@ -1385,13 +1392,14 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
   header.SetDestinationPort (m_endPoint->GetPeerPort ());
   header.SetWindowSize (AdvertisedWindowSize ());
   AddOptions (header);
-  if (m_retxEvent.IsExpired () )
+  if (m_retxTimer.IsExpired () )
     { // Schedule retransmit
       m_rto = m_rtt->RetransmitTimeout ();
       NS_LOG_LOGIC (this << " SendDataPacket Schedule ReTxTimeout at time " <<
                     Simulator::Now ().GetSeconds () << " to expire at time " <<
                     (Simulator::Now () + m_rto.Get ()).GetSeconds () );
-      m_retxEvent = Simulator::Schedule (m_rto, &TcpSocketBase::ReTxTimeout, this);
+      m_retxFlags = 0;
+      m_retxTimer.Schedule (m_rto);
     }
   NS_LOG_LOGIC ("Send packet via TcpL4Protocol with flags 0x" << std::hex << static_cast<uint32_t> (flags) << std::dec);
   m_tcp->SendPacket (p, header, m_endPoint->GetLocalAddress (),
@@ -1522,15 +1530,14 @@ TcpSocketBase::ReceivedData (Ptr<Packet> p, const TcpHeader& tcpHeader)
     { // In-sequence packet: ACK if delayed ack count allows
       if (++m_delAckCount >= m_delAckMaxCount)
         {
-          m_delAckEvent.Cancel ();
+          m_delAckTimer.Cancel ();
           m_delAckCount = 0;
           SendEmptyPacket (TcpHeader::ACK);
         }
-      else if (m_delAckEvent.IsExpired ())
+      else if (m_delAckTimer.IsExpired ())
         {
-          m_delAckEvent = Simulator::Schedule (m_delAckTimeout,
-                                               &TcpSocketBase::DelAckTimeout, this);
-          NS_LOG_LOGIC (this << " scheduled delayed ACK at " << (Simulator::Now () + Simulator::GetDelayLeft (m_delAckEvent)).GetSeconds ());
+          m_delAckTimer.Schedule (m_delAckTimeout);
+          NS_LOG_LOGIC (this << " scheduled delayed ACK at " << (Simulator::Now () + m_delAckTimer.GetDelayLeft ()).GetSeconds ());
         }
     }
   // Notify app to receive if necessary
@@ -1571,22 +1578,20 @@ TcpSocketBase::NewAck (SequenceNumber32 const& ack)
 
   if (m_state != SYN_RCVD)
     { // Set RTO unless the ACK is received in SYN_RCVD state
-      NS_LOG_LOGIC (this << " Cancelled ReTxTimeout event which was set to expire at " <<
-                    (Simulator::Now () + Simulator::GetDelayLeft (m_retxEvent)).GetSeconds ());
-      m_retxEvent.Cancel ();
       // On recieving a "New" ack we restart retransmission timer .. RFC 2988
       m_rto = m_rtt->RetransmitTimeout ();
-      NS_LOG_LOGIC (this << " Schedule ReTxTimeout at time " <<
+      NS_LOG_LOGIC (this << " Restart ReTxTimeout at time " <<
                     Simulator::Now ().GetSeconds () << " to expire at time " <<
                     (Simulator::Now () + m_rto.Get ()).GetSeconds ());
-      m_retxEvent = Simulator::Schedule (m_rto, &TcpSocketBase::ReTxTimeout, this);
+      m_retxFlags = 0;
+      m_retxTimer.Schedule (m_rto);
     }
   if (m_rWnd.Get () == 0 && m_persistEvent.IsExpired ())
     { // Zero window: Enter persist state to send 1 byte to probe
       NS_LOG_LOGIC (this << "Enter zerowindow persist state");
       NS_LOG_LOGIC (this << "Cancelled ReTxTimeout event which was set to expire at " <<
-                    (Simulator::Now () + Simulator::GetDelayLeft (m_retxEvent)).GetSeconds ());
-      m_retxEvent.Cancel ();
+                    (Simulator::Now () + m_retxTimer.GetDelayLeft ()).GetSeconds ());
+      m_retxTimer.Cancel ();
       NS_LOG_LOGIC ("Schedule persist timeout at time " <<
                     Simulator::Now ().GetSeconds () << " to expire at time " <<
                     (Simulator::Now () + m_persistTimeout).GetSeconds ());
@@ -1608,13 +1613,27 @@ TcpSocketBase::NewAck (SequenceNumber32 const& ack)
   if (m_txBuffer.Size () == 0 && m_state != FIN_WAIT_1 && m_state != CLOSING)
     { // No retransmit timer if no data to retransmit
       NS_LOG_LOGIC (this << " Cancelled ReTxTimeout event which was set to expire at " <<
-                    (Simulator::Now () + Simulator::GetDelayLeft (m_retxEvent)).GetSeconds ());
-      m_retxEvent.Cancel ();
+                    (Simulator::Now () + m_retxTimer.GetDelayLeft ()).GetSeconds ());
+      m_retxTimer.Cancel ();
     }
   // Try to send more data
   SendPendingData (m_connected);
 }
 
+// Expiry of m_retxTimer: resend the SYN or FIN it guards, or go for the data
+void
+TcpSocketBase::ReTxTimerExpired (void)
+{
+  if (m_retxFlags != 0)
+    {
+      SendEmptyPacket (m_retxFlags);
+    }
+  else
+    {
+      ReTxTimeout ();
+    }
+}
+
 // Retransmit timeout
 void
 TcpSocketBase::ReTxTimeout ()
@@ -1723,9 +1742,9 @@ TcpSocketBase::DoRetransmit ()
 void
 TcpSocketBase::CancelAllTimers ()
 {
-  m_retxEvent.Cancel ();
+  m_retxTimer.Cancel ();
   m_persistEvent.Cancel ();
-  m_delAckEvent.Cancel ();
+  m_delAckTimer.Cancel ();
   m_lastAckEvent.Cancel ();
   m_timewaitEvent.Cancel ();
 }
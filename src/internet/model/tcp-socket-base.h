@@ -31,6 +31,7 @@
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4-interface.h"
 #include "ns3/event-id.h"
+#include "ns3/lazy-timer.h"
 #include "tcp-tx-buffer.h"
 #include "tcp-rx-buffer.h"
 #include "rtt-estimator.h"
@@ -172,6 +173,7 @@ protected:
   virtual void EstimateRtt (const TcpHeader&); // RTT accounting
   virtual void NewAck (SequenceNumber32 const& seq); // Update buffers w.r.t. ACK
   virtual void DupAck (const TcpHeader& t, uint32_t count) = 0; // Received dupack
+  void ReTxTimerExpired (void); // Resend SYN/FIN or call ReTxTimeout() upon RTO event
   virtual void ReTxTimeout (void); // Call Retransmit() upon RTO event
   virtual void Retransmit (void); // Halving cwnd and call DoRetransmit()
   virtual void DelAckTimeout (void);  // Action upon delay ACK timeout, i.e. send an ACK
@@ -183,9 +185,10 @@ protected:
 
 protected:
   // Counters and events
-  EventId           m_retxEvent;       //< Retransmission event
+  LazyTimer         m_retxTimer;       //< Retransmission timer, restarted by every new ACK
+  uint8_t           m_retxFlags;       //< Flags of the SYN or FIN guarded by m_retxTimer, 0 for data
   EventId           m_lastAckEvent;    //< Last ACK timeout event
-  EventId           m_delAckEvent;     //< Delayed ACK timeout event
+  LazyTimer         m_delAckTimer;     //< Delayed ACK timer
   EventId           m_persistEvent;    //< Persist event: Send 1 byte to probe for a non-zero Rx window
   EventId           m_timewaitEvent;   //< TIME_WAIT expiration event: Move this socket to CLOSED state
   uint32_t          m_dupAckCount;     //< Dupack counter
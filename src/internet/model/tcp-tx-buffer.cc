@@ -51,7 +51,7 @@ TcpTxBuffer::GetTypeId (void)
  * initialized below is insignificant.
  */
 TcpTxBuffer::TcpTxBuffer (uint32_t n)
-  : m_firstByteSeq (n), m_size (0), m_maxBuffer (32768), m_data (0)
+  : m_firstByteSeq (n), m_size (0), m_maxBuffer (32768), m_headOffset (0), m_headChunk (0)
 {
 }
 
@@ -105,8 +105,23 @@ TcpTxBuffer::Add (Ptr<Packet> p)
     {
       if (p->GetSize () > 0)
         {
-          m_data.push_back (p);
-          m_size += p->GetSize ();
+          Chunk chunk;
+          chunk.start = m_headOffset + m_size;
+          chunk.size = p->GetSize ();
+          if (!p->IsVirtual () || p->GetPacketTagIterator ().HasNext ())
+            {
+              chunk.packet = p;
+              m_data.push_back (chunk);
+            }
+          else if (m_headChunk < m_data.size () && m_data.back ().packet == 0)
+            { // Extend the virtual run at the tail
+              m_data.back ().size += chunk.size;
+            }
+          else
+            {
+              m_data.push_back (chunk);
+            }
+          m_size += chunk.size;
           NS_LOG_LOGIC ("Updated size=" << m_size << ", lastSeq=" << m_firstByteSeq + SequenceNumber32 (m_size));
         }
       return true;
@@ -127,6 +142,40 @@ TcpTxBuffer::SizeFromSequence (const SequenceNumber32& seq) const
   return lastSeq - seq;
 }
 
+uint32_t
+TcpTxBuffer::FindChunk (uint64_t offset) const
+{
+  // Binary search for the last run starting at or before offset
+  uint32_t low = m_headChunk;
+  uint32_t high = m_data.size ();
+  while (high - low > 1)
+    {
+      uint32_t middle = low + (high - low) / 2;
+      if (m_data[middle].start <= offset)
+        {
+          low = middle;
+        }
+      else
+        {
+          high = middle;
+        }
+    }
+  NS_ASSERT (m_data[low].start <= offset && offset < m_data[low].start + m_data[low].size);
+  return low;
+}
+
+Ptr<Packet>
+TcpTxBuffer::CopyFromChunk (const Chunk &chunk, uint64_t offset, uint32_t numBytes)
+{
+  uint32_t chunkOffset = offset - chunk.start;
+  uint32_t length = std::min (numBytes, chunk.size - chunkOffset);
+  if (chunk.packet == 0)
+    { // Virtual bytes, create them now
+      return Create<Packet> (length);
+    }
+  return chunk.packet->CreateFragment (chunkOffset, length);
+}
+
 Ptr<Packet>
 TcpTxBuffer::CopyFromSequence (uint32_t numBytes, const SequenceNumber32& seq)
 {
@@ -136,60 +185,19 @@ TcpTxBuffer::CopyFromSequence (uint32_t numBytes, const SequenceNumber32& seq)
     {
       return Create<Packet> (); // Empty packet returned
     }
-  if (m_data.size () == 0)
-    { // No actual data, just return dummy-data packet of correct size
-      return Create<Packet> (s);
-    }
 
   // Extract data from the buffer and return
-  uint32_t offset = seq - m_firstByteSeq.Get ();
-  uint32_t count = 0;      // Offset of the first byte of a packet in the buffer
-  uint32_t pktSize = 0;
-  bool beginFound = false;
-  int pktCount = 0;
-  Ptr<Packet> outPacket;
-  NS_LOG_LOGIC ("There are " << m_data.size () << " number of packets in buffer");
-  for (BufIterator i = m_data.begin (); i != m_data.end (); ++i)
-    {
-      pktCount++;
-      pktSize = (*i)->GetSize ();
-      if (!beginFound)
-        { // Look for first fragment
-          if (count + pktSize > offset)
-            {
-              NS_LOG_LOGIC ("First byte found in packet #" << pktCount << " at buffer offset " << count
-                                                           << ", packet len=" << pktSize);
-              beginFound = true;
-              uint32_t packetOffset = offset - count;
-              uint32_t fragmentLength = count + pktSize - offset;
-              if (fragmentLength >= s)
-                { // Data to be copied falls entirely in this packet
-                  return (*i)->CreateFragment (packetOffset, s);
-                }
-              else
-                { // This packet only fulfills part of the request
-                  outPacket = (*i)->CreateFragment (packetOffset, fragmentLength);
-                }
-              NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-            }
-        }
-      else if (count + pktSize >= offset + s)
-        { // Last packet fragment found
-          NS_LOG_LOGIC ("Last byte found in packet #" << pktCount << " at buffer offset " << count
-                                                      << ", packet len=" << pktSize);
-          uint32_t fragmentLength = offset + s - count;
-          Ptr<Packet> endFragment = (*i)->CreateFragment (0, fragmentLength);
-          outPacket->AddAtEnd (endFragment);
-          NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-          break;
-        }
-      else
-        {
-          NS_LOG_LOGIC ("Appending to output the packet #" << pktCount << " of offset " << count << " len=" << pktSize);
-          outPacket->AddAtEnd (*i);
-          NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-        }
-      count += pktSize;
+  uint64_t offset = m_headOffset + (seq - m_firstByteSeq.Get ());
+  uint32_t i = FindChunk (offset);
+  NS_LOG_LOGIC ("First byte found in run #" << i - m_headChunk << " at stream offset " << m_data[i].start
+                                            << ", run len=" << m_data[i].size);
+  Ptr<Packet> outPacket = CopyFromChunk (m_data[i], offset, s);
+  while (outPacket->GetSize () < s)
+    { // The data spans the next runs
+      ++i;
+      NS_LOG_LOGIC ("Appending to output the run #" << i - m_headChunk << " of len=" << m_data[i].size);
+      outPacket->AddAtEnd (CopyFromChunk (m_data[i], m_data[i].start, s - outPacket->GetSize ()));
+      NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
     }
   NS_ASSERT (outPacket->GetSize () == s);
   return outPacket;
@@ -207,44 +215,36 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq)
 {
   NS_LOG_FUNCTION (this << seq);
   NS_LOG_LOGIC ("current data size=" << m_size << ", headSeq=" << m_firstByteSeq << ", maxBuffer=" << m_maxBuffer
-                                     << ", numPkts=" << m_data.size ());
+                                     << ", numRuns=" << m_data.size () - m_headChunk);
   // Cases do not need to scan the buffer
   if (m_firstByteSeq >= seq) return;
 
-  // Scan the buffer and discard packets
-  uint32_t offset = seq - m_firstByteSeq.Get ();  // Number of bytes to remove
-  uint32_t pktSize;
+  // Number of bytes to remove, ACKing a FIN goes one beyond the data
+  uint32_t offset = std::min<uint32_t> (seq - m_firstByteSeq.Get (), m_size);
   NS_LOG_LOGIC ("Offset=" << offset);
-  BufIterator i = m_data.begin ();
-  while (i != m_data.end ())
+  m_size -= offset;
+  m_headOffset += offset;
+  while (m_headChunk < m_data.size ()
+         && m_data[m_headChunk].start + m_data[m_headChunk].size <= m_headOffset)
+    { // This run is behind the seqnum, release its packet
+      m_data[m_headChunk].packet = 0;
+      ++m_headChunk;
+    }
+  // Drop the discarded runs once they make up half of the vector, so
+  // that the cost of moving the others is amortized
+  if (m_headChunk == m_data.size ())
     {
-      if (offset > (*i)->GetSize ())
-        { // This packet is behind the seqnum. Remove this packet from the buffer
-          pktSize = (*i)->GetSize ();
-          m_size -= pktSize;
-          offset -= pktSize;
-          m_firstByteSeq += pktSize;
-          i = m_data.erase (i);
-          NS_LOG_LOGIC ("Removed one packet of size " << pktSize << ", offset=" << offset);
-        }
-      else if (offset > 0)
-        { // Part of the packet is behind the seqnum. Fragment
-          pktSize = (*i)->GetSize () - offset;
-          *i = (*i)->CreateFragment (offset, pktSize);
-          m_size -= offset;
-          m_firstByteSeq += offset;
-          NS_LOG_LOGIC ("Fragmented one packet by size " << offset << ", new size=" << pktSize);
-          break;
-        }
+      m_data.clear ();
+      m_headChunk = 0;
     }
-  // Catching the case of ACKing a FIN
-  if (m_size == 0)
+  else if (m_headChunk > m_data.size () / 2)
     {
-      m_firstByteSeq = seq;
+      m_data.erase (m_data.begin (), m_data.begin () + m_headChunk);
+      m_headChunk = 0;
     }
+  m_firstByteSeq = seq;
   NS_LOG_LOGIC ("size=" << m_size << " headSeq=" << m_firstByteSeq << " maxBuffer=" << m_maxBuffer
-                        <<" numPkts="<< m_data.size ());
-  NS_ASSERT (m_firstByteSeq == seq);
+                        <<" numRuns="<< m_data.size () - m_headChunk);
 }
 
 } // namepsace ns3
@@ -21,7 +21,7 @@
 #ifndef TCP_TX_BUFFER_H
 #define TCP_TX_BUFFER_H
 
-#include <list>
+#include <vector>
 #include "ns3/traced-value.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/object.h"
@@ -36,6 +36,15 @@ class Packet;
  *
  * \brief class for keeping the data sent by the application to the TCP socket, i.e.
  *        the sending buffer.
+ *
+ * The data is kept as runs of bytes located by their offset in the
+ * stream. The packets given by the application which are virtual (see
+ * Packet::IsVirtual), such as the ones of BulkSendApplication, are not
+ * stored: only their size is, merged with the virtual bytes just before
+ * them, and the segments are created with a new packet when they are
+ * sent. A bulk transfer thus keeps a single run whatever the size of
+ * the buffer, and sending, retransmitting or discarding data costs the
+ * same whatever the amount of data buffered.
  */
 class TcpTxBuffer : public Object
 {
@@ -108,12 +117,32 @@ public:
   void DiscardUpTo (const SequenceNumber32& seq);
 
 private:
-  typedef std::list<Ptr<Packet> >::iterator BufIterator;
+  /**
+   * A run of bytes added to the buffer
+   */
+  struct Chunk
+  {
+    uint64_t start;     //< Stream offset of the first byte of the run
+    uint32_t size;      //< Number of bytes of the run
+    Ptr<Packet> packet; //< The bytes of the run, or 0 if they are virtual
+  };
+
+  /**
+   * Returns the index in m_data of the run holding the byte at this stream offset
+   */
+  uint32_t FindChunk (uint64_t offset) const;
+
+  /**
+   * Copy at most numBytes of a run, starting from the byte at this stream offset
+   */
+  static Ptr<Packet> CopyFromChunk (const Chunk &chunk, uint64_t offset, uint32_t numBytes);
 
   TracedValue<SequenceNumber32> m_firstByteSeq; //< Sequence number of the first byte in data (SND.UNA)
   uint32_t m_size;                              //< Number of data bytes
   uint32_t m_maxBuffer;                         //< Max number of data bytes in buffer (SND.WND)
-  std::list<Ptr<Packet> > m_data;               //< Corresponding data (may be null)
+  uint64_t m_headOffset;                        //< Stream offset of the first byte in data
+  uint32_t m_headChunk;                         //< Index in m_data of the run holding the first byte
+  std::vector<Chunk> m_data;                    //< Runs of bytes, the ones before m_headChunk are discarded
 };
 
 } // namepsace ns3
@@ -53,13 +53,45 @@ GlobalRouteManagerImplTestCase::DoRun (void)
       candidate.Push (v);
     }
 
+  uint32_t lastDistance = 0;
   for (int i = 0; i < 100; ++i)
     {
       SPFVertex *v = candidate.Pop ();
+      NS_TEST_ASSERT_MSG_EQ ((v->GetDistanceFromRoot () >= lastDistance), true,
+                             "CandidateQueue out of order");
+      lastDistance = v->GetDistanceFromRoot ();
       delete v;
       v = 0;
     }
 
+  // Vertices of equal distance are popped in the order they were pushed,
+  // and a vertex whose distance was decreased goes behind the vertices
+  // already queued at its new distance.
+  SPFVertex *vertices[4];
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      vertices[i] = new SPFVertex;
+      vertices[i]->SetVertexId (Ipv4Address (i + 1));
+      vertices[i]->SetDistanceFromRoot (i < 3 ? 5 : 9);
+      candidate.Push (vertices[i]);
+    }
+  NS_TEST_ASSERT_MSG_EQ (candidate.Find (Ipv4Address (4)), vertices[3],
+                         "CandidateQueue::Find failed");
+  vertices[3]->SetDistanceFromRoot (5);
+  candidate.DecreaseKey (vertices[3]);
+  vertices[1]->SetDistanceFromRoot (2);
+  candidate.DecreaseKey (vertices[1]);
+  uint32_t expected[4] = { 1, 0, 2, 3};
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      SPFVertex *v = candidate.Pop ();
+      NS_TEST_ASSERT_MSG_EQ (v, vertices[expected[i]],
+                             "CandidateQueue tie order");
+      NS_TEST_ASSERT_MSG_EQ (candidate.Find (v->GetVertexId ()), 0,
+                             "Popped vertex still found");
+      delete v;
+    }
+
   // Build fake link state database; four routers (0-3), 3 point-to-point
   // links
   //
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/ipv4-end-point-demux.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv4-interface.h"
+
+namespace ns3 {
+
+class Ipv4EndPointDemuxTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxTestCase ();
+  virtual void DoRun (void);
+};
+
+Ipv4EndPointDemuxTestCase::Ipv4EndPointDemuxTestCase ()
+  : TestCase ("Check the lookups and allocations of Ipv4EndPointDemux")
+{
+}
+
+void
+Ipv4EndPointDemuxTestCase::DoRun (void)
+{
+  Ipv4EndPointDemux demux;
+  Ptr<Ipv4Interface> interface = CreateObject<Ipv4Interface> ();
+  Ipv4Address local ("10.0.0.1");
+  const uint32_t nPeers = 100;
+
+  // A listening socket and the connections it accepted
+  Ipv4EndPoint *listening = demux.Allocate (80);
+  NS_TEST_ASSERT_MSG_NE (listening, 0, "Could not allocate port 80");
+  NS_TEST_ASSERT_MSG_EQ (demux.Allocate (80), 0, "Port 80 allocated twice");
+  Ipv4EndPoint *accepted[nPeers];
+  for (uint32_t i = 0; i < nPeers; i++)
+    {
+      accepted[i] = demux.Allocate (local, 80, Ipv4Address (0x0a010000 + i), 1000 + i);
+      NS_TEST_ASSERT_MSG_NE (accepted[i], 0, "Could not allocate connection " << i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (demux.Allocate (local, 80, Ipv4Address (0x0a010005), 1005), 0,
+                         "Connection allocated twice");
+
+  for (uint32_t i = 0; i < nPeers; i++)
+    {
+      Ipv4EndPointDemux::EndPoints found =
+        demux.Lookup (local, 80, Ipv4Address (0x0a010000 + i), 1000 + i, interface);
+      NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Expected one match for connection " << i);
+      NS_TEST_ASSERT_MSG_EQ (found.front (), accepted[i], "Wrong match for connection " << i);
+    }
+  // A new peer, or a known peer on another port, reaches the listening socket
+  Ipv4EndPointDemux::EndPoints found =
+    demux.Lookup (local, 80, Ipv4Address (0x0a010005), 999, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Expected the listening endpoint");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), listening, "Expected the listening endpoint");
+  found = demux.Lookup (local, 81, Ipv4Address (0x0a010005), 1005, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.empty (), true, "Nothing listens on port 81");
+
+  // A connection closes: its segments go to the listening socket again
+  demux.DeAllocate (accepted[5]);
+  found = demux.Lookup (local, 80, Ipv4Address (0x0a010005), 1005, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.front (), listening, "Closed connection still matched");
+
+  // An active open: ephemeral port, then connected with SetPeer
+  NS_TEST_ASSERT_MSG_NE (demux.Allocate (49153), 0, "Could not allocate port 49153");
+  Ipv4EndPoint *client = demux.Allocate ();
+  NS_TEST_ASSERT_MSG_EQ (client->GetLocalPort (), 49154, "Ephemeral port in use was allocated");
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (49154), true, "Ephemeral port not recorded");
+  client->SetLocalAddress (local);
+  client->SetPeer (Ipv4Address ("10.2.0.1"), 5000);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (local, 49154), true, "Local address change lost");
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (Ipv4Address::GetAny (), 49154), false,
+                         "Old local address still recorded");
+  found = demux.Lookup (local, 49154, Ipv4Address ("10.2.0.1"), 5000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Expected the connected client");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), client, "Expected the connected client");
+  found = demux.Lookup (local, 49154, Ipv4Address ("10.2.0.2"), 5000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.empty (), true, "Connected client matched another peer");
+  demux.DeAllocate (client);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (49154), false, "Deallocated port still in use");
+  found = demux.Lookup (local, 49154, Ipv4Address ("10.2.0.1"), 5000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.empty (), true, "Deallocated client still matched");
+}
+
+static class Ipv4EndPointDemuxTestSuite : public TestSuite
+{
+public:
+  Ipv4EndPointDemuxTestSuite ();
+} g_ipv4EndPointDemuxTestSuite;
+
+Ipv4EndPointDemuxTestSuite::Ipv4EndPointDemuxTestSuite ()
+  : TestSuite ("ipv4-end-point-demux", UNIT)
+{
+  AddTestCase (new Ipv4EndPointDemuxTestCase ());
+}
+
+} // namespace ns3
@@ -29,6 +29,15 @@
 #include "ns3/arp-l3-protocol.h"
 #include "ns3/ipv4-interface.h"
 #include "ns3/loopback-net-device.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/boolean.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/udp-header.h"
+#include "ns3/socket.h"
 
 namespace ns3 {
 
@@ -97,6 +106,162 @@ Ipv4L3ProtocolTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class Ipv4L3ProtocolLookupTestCase : public TestCase
+{
+public:
+  Ipv4L3ProtocolLookupTestCase ();
+  virtual void DoRun (void);
+};
+
+Ipv4L3ProtocolLookupTestCase::Ipv4L3ProtocolLookupTestCase ()
+  : TestCase ("Check the interface lookups of the IPv4 layer 3 protocol")
+{
+}
+
+void
+Ipv4L3ProtocolLookupTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<Ipv4L3Protocol> ipv4 = CreateObject<Ipv4L3Protocol> ();
+  node->AggregateObject (ipv4);
+  Ptr<SimpleNetDevice> device1 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> device2 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> device3 = CreateObject<SimpleNetDevice> ();
+  node->AddDevice (device1);
+  node->AddDevice (device2);
+  node->AddDevice (device3);
+  // interface 0 is the loopback
+  uint32_t if1 = ipv4->AddInterface (device1);
+  uint32_t if2 = ipv4->AddInterface (device2);
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForDevice (device1), (int32_t)if1, "Unexpected interface of device 1");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForDevice (device2), (int32_t)if2, "Unexpected interface of device 2");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForDevice (device3), -1, "Interface of a device without interface");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress (Ipv4Address::GetLoopback ()), 0, "Loopback address not found");
+
+  ipv4->AddAddress (if1, Ipv4InterfaceAddress ("10.0.0.1", "255.255.255.0"));
+  ipv4->AddAddress (if2, Ipv4InterfaceAddress ("10.0.1.1", "255.255.255.0"));
+  ipv4->AddAddress (if2, Ipv4InterfaceAddress ("10.0.2.1", "255.255.255.0"));
+  // the same address on both interfaces
+  ipv4->AddAddress (if2, Ipv4InterfaceAddress ("10.0.3.1", "255.255.255.0"));
+  ipv4->AddAddress (if1, Ipv4InterfaceAddress ("10.0.3.1", "255.255.255.0"));
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress ("10.0.0.1"), (int32_t)if1, "Unexpected interface of 10.0.0.1");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress ("10.0.2.1"), (int32_t)if2, "Unexpected interface of 10.0.2.1");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress ("10.0.3.1"), (int32_t)if1, "Not the first interface of 10.0.3.1");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress ("10.0.0.2"), -1, "Interface of an address not on the node");
+
+  ipv4->SetAttribute ("WeakEsModel", BooleanValue (false));
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.0.1", if1), true, "Local address not for this node");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.0.255", if1), true, "Broadcast address not for this node");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.0.1", if2), false, "Address of another interface");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.1.255", if1), false, "Broadcast address of another interface");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.0.2", if1), false, "Address not on the node");
+  ipv4->SetAttribute ("WeakEsModel", BooleanValue (true));
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.0.1", if2), true, "Address of another interface");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.1.255", if1), true, "Broadcast address of another interface");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.0.2", if1), false, "Address not on the node");
+
+  // 10.0.3.1 is the second address of if1, then 10.0.2.1 the second of if2
+  ipv4->RemoveAddress (if1, 1);
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress ("10.0.3.1"), (int32_t)if2, "Address not left on the other interface");
+  ipv4->RemoveAddress (if2, 1);
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetInterfaceForAddress ("10.0.2.1"), -1, "Removed address still found");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.2.1", if2), false, "Removed address still for this node");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.2.255", if1), false, "Removed broadcast address still for this node");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->IsDestinationAddress ("10.0.3.1", if2), true, "Remaining address not for this node");
+
+  Simulator::Destroy ();
+}
+
+class Ipv4L3ProtocolForwardTestCase : public TestCase
+{
+public:
+  Ipv4L3ProtocolForwardTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void RxTrace (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+  void Receive (Ptr<Socket> socket);
+
+  std::vector<Ptr<const Packet> > m_rxPackets;
+  uint32_t m_received;
+};
+
+Ipv4L3ProtocolForwardTestCase::Ipv4L3ProtocolForwardTestCase ()
+  : TestCase ("Check that forwarding leaves alone the packets kept by an rx trace sink"),
+    m_received (0)
+{
+}
+
+void
+Ipv4L3ProtocolForwardTestCase::RxTrace (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  m_rxPackets.push_back (packet);
+}
+
+void
+Ipv4L3ProtocolForwardTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+Ipv4L3ProtocolForwardTestCase::DoRun (void)
+{
+  // source -- router -- destination
+  NodeContainer nodes;
+  nodes.Create (3);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.0");
+  Ipv4Address destination;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+      NetDeviceContainer devices;
+      for (uint32_t j = i; j < i + 2; j++)
+        {
+          Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+          device->SetAddress (Mac48Address::Allocate ());
+          device->SetChannel (channel);
+          nodes.Get (j)->AddDevice (device);
+          devices.Add (device);
+        }
+      destination = address.Assign (devices).GetAddress (1);
+      address.NewNetwork ();
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  Ptr<Ipv4L3Protocol> router = nodes.Get (1)->GetObject<Ipv4L3Protocol> ();
+  router->TraceConnectWithoutContext ("Rx", MakeCallback (&Ipv4L3ProtocolForwardTestCase::RxTrace, this));
+
+  Ptr<Socket> sink = Socket::CreateSocket (nodes.Get (2), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 1234));
+  sink->SetRecvCallback (MakeCallback (&Ipv4L3ProtocolForwardTestCase::Receive, this));
+  Ptr<Socket> source = Socket::CreateSocket (nodes.Get (0), UdpSocketFactory::GetTypeId ());
+  source->Connect (InetSocketAddress (destination, 1234));
+  source->Send (Create<Packet> (100));
+  source->Send (Create<Packet> (100));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_received, 2, "The packets were not forwarded");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets.size (), 2, "The router did not trace the packets");
+  UdpHeader udpHeader;
+  for (uint32_t i = 0; i < m_rxPackets.size (); i++)
+    {
+      // Receive removed the IPv4 header, the forwarding must not add
+      // its own back to the packet of the sink
+      NS_TEST_EXPECT_MSG_EQ (m_rxPackets[i]->GetSize (), 100 + udpHeader.GetSerializedSize (),
+                             "Packet " << i << " of the rx trace sink changed by the forwarding");
+    }
+
+  m_rxPackets.clear ();
+  Simulator::Destroy ();
+}
+
 static class IPv4L3ProtocolTestSuite : public TestSuite
 {
 public:
@@ -104,6 +269,8 @@ public:
     TestSuite ("ipv4-protocol", UNIT)
   {
     AddTestCase (new Ipv4L3ProtocolTestCase ());
+    AddTestCase (new Ipv4L3ProtocolLookupTestCase ());
+    AddTestCase (new Ipv4L3ProtocolForwardTestCase ());
   }
 } g_ipv4protocolTestSuite;
 
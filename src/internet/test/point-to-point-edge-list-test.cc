@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fstream>
+#include <vector>
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/socket.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/point-to-point-edge-list-helper.h"
+
+namespace ns3 {
+
+class PointToPointEdgeListTestCase : public TestCase
+{
+public:
+  PointToPointEdgeListTestCase ();
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+};
+
+PointToPointEdgeListTestCase::PointToPointEdgeListTestCase ()
+  : TestCase ("Check the nodes and addresses built from an edge list")
+{
+}
+
+void
+PointToPointEdgeListTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("topology.edgelist");
+  std::ofstream file (filename.c_str ());
+  file << "0 1\n"
+       << "1 0\n"
+       << "2->0\n"
+       << "0->1\n"
+       << "1->0\n"
+       << "\n";
+  file.close ();
+
+  PointToPointHelper p2p;
+  PointToPointEdgeListHelper topology (p2p);
+  NS_TEST_ASSERT_MSG_EQ (topology.Read (filename), true, "Could not read " << filename);
+  NS_TEST_ASSERT_MSG_EQ (topology.GetNSwitches (), 2, "Unexpected number of switches");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetNHosts (), 3, "Unexpected number of hosts");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetHostSwitch (2), 0, "Unexpected switch of host 2");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetHostIpv4Address (1), Ipv4Address ("10.0.0.6"), "Unexpected address of host 1");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetHostIpv4Address (2), Ipv4Address ("10.0.0.10"), "Unexpected address of host 2");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetHostIpv4Address (0), Ipv4Address ("10.0.0.2"), "Unexpected address of host 0");
+
+  InternetStackHelper stack;
+  topology.Install (stack);
+
+  // The switches first, then the hosts switch by switch
+  NS_TEST_ASSERT_MSG_EQ (topology.GetSwitch (1)->GetId (), 1, "Unexpected node of switch 1");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetHost (1)->GetId (), 2, "Unexpected node of host 1");
+  NS_TEST_ASSERT_MSG_EQ (topology.GetHost (0)->GetId (), 4, "Unexpected node of host 0");
+  NodeContainer hosts = topology.GetHosts ();
+  for (uint32_t host = 0; host < hosts.GetN (); host++)
+    {
+      Ptr<Ipv4> ipv4 = hosts.Get (host)->GetObject<Ipv4> ();
+      NS_TEST_ASSERT_MSG_EQ (ipv4->GetNInterfaces (), 2, "Unexpected interfaces on host " << host);
+      NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (1, 0).GetLocal (), topology.GetHostIpv4Address (host),
+                             "Unexpected address on host " << host);
+    }
+
+  // A /30 per link, the host links first, then the switch links
+  Ptr<Ipv4> ipv4 = topology.GetSwitch (0)->GetObject<Ipv4> ();
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetNInterfaces (), 5, "Unexpected interfaces on switch 0");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (1, 0).GetLocal (), Ipv4Address ("10.0.0.5"), "Unexpected host link address");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (1, 0).GetMask (), Ipv4Mask ("255.255.255.252"), "Unexpected host link mask");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (2, 0).GetLocal (), Ipv4Address ("10.0.0.9"), "Unexpected host link address");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (3, 0).GetLocal (), Ipv4Address ("10.0.0.13"), "Unexpected switch link address");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (4, 0).GetLocal (), Ipv4Address ("10.0.0.18"), "Unexpected switch link address");
+  ipv4 = topology.GetSwitch (1)->GetObject<Ipv4> ();
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (1, 0).GetLocal (), Ipv4Address ("10.0.0.1"), "Unexpected host link address");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (2, 0).GetLocal (), Ipv4Address ("10.0.0.14"), "Unexpected switch link address");
+  NS_TEST_ASSERT_MSG_EQ (ipv4->GetAddress (3, 0).GetLocal (), Ipv4Address ("10.0.0.17"), "Unexpected switch link address");
+}
+
+void
+PointToPointEdgeListTestCase::DoTeardown (void)
+{
+  Ipv4AddressGenerator::Reset ();
+  Simulator::Destroy ();
+}
+
+class PointToPointEdgeListDeliveryTestCase : public TestCase
+{
+public:
+  PointToPointEdgeListDeliveryTestCase ();
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+private:
+  void ReceivePkt (Ptr<Socket> socket);
+  std::vector<uint32_t> m_received;
+};
+
+PointToPointEdgeListDeliveryTestCase::PointToPointEdgeListDeliveryTestCase ()
+  : TestCase ("Check the delivery between hosts of the same and of different switches")
+{
+}
+
+void
+PointToPointEdgeListDeliveryTestCase::ReceivePkt (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      m_received[packet->GetSize ()]++;
+    }
+}
+
+void
+PointToPointEdgeListDeliveryTestCase::DoRun (void)
+{
+  // Three hosts on switch 0, which the static routing of the default
+  // stack must not send out of a single port, and one on switch 1
+  PointToPointHelper p2p;
+  PointToPointEdgeListHelper topology (p2p);
+  topology.AddSwitchLink (0, 1);
+  topology.AddHost (0, 0);
+  topology.AddHost (1, 0);
+  topology.AddHost (2, 0);
+  topology.AddHost (3, 1);
+  InternetStackHelper stack;
+  topology.Install (stack);
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  m_received.assign (topology.GetNHosts (), 0);
+  Ptr<Socket> txSocket = Socket::CreateSocket (topology.GetHost (0), UdpSocketFactory::GetTypeId ());
+  for (uint32_t host = 1; host < topology.GetNHosts (); host++)
+    {
+      Ptr<Socket> rxSocket = Socket::CreateSocket (topology.GetHost (host), UdpSocketFactory::GetTypeId ());
+      rxSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+      rxSocket->SetRecvCallback (MakeCallback (&PointToPointEdgeListDeliveryTestCase::ReceivePkt, this));
+      // The size of the packet tells its destination
+      txSocket->SendTo (Create<Packet> (host), 0, InetSocketAddress (topology.GetHostIpv4Address (host), 9));
+    }
+  Simulator::Run ();
+
+  for (uint32_t host = 1; host < topology.GetNHosts (); host++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_received[host], 1, "Packet to host " << host << " not delivered");
+    }
+}
+
+void
+PointToPointEdgeListDeliveryTestCase::DoTeardown (void)
+{
+  Ipv4AddressGenerator::Reset ();
+  Simulator::Destroy ();
+}
+
+static class PointToPointEdgeListTestSuite : public TestSuite
+{
+public:
+  PointToPointEdgeListTestSuite ();
+} g_pointToPointEdgeListTestSuite;
+
+PointToPointEdgeListTestSuite::PointToPointEdgeListTestSuite ()
+  : TestSuite ("point-to-point-edge-list", UNIT)
+{
+  AddTestCase (new PointToPointEdgeListTestCase ());
+  AddTestCase (new PointToPointEdgeListDeliveryTestCase ());
+}
+
+} // namespace ns3
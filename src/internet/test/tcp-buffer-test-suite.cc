@@ -0,0 +1,220 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/packet.h"
+#include "ns3/socket.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-tx-buffer.h"
+#include "ns3/tcp-rx-buffer.h"
+
+namespace ns3 {
+
+// Bytes 1, 2, 3... stored in a packet, to tell them from the virtual zeros
+static Ptr<Packet>
+CreateDataPacket (uint32_t size)
+{
+  uint8_t data[256];
+  for (uint32_t i = 0; i < size; i++)
+    {
+      data[i] = i + 1;
+    }
+  return Create<Packet> (data, size);
+}
+
+// Check that p holds zeros, then the bytes of CreateDataPacket from
+// dataStart to dataStart + dataSize, then zeros
+static bool
+CheckBytes (Ptr<const Packet> p, uint32_t zeros, uint32_t dataStart, uint32_t dataSize)
+{
+  uint8_t buffer[512];
+  p->CopyData (buffer, p->GetSize ());
+  for (uint32_t i = 0; i < p->GetSize (); i++)
+    {
+      uint8_t expected = 0;
+      if (i >= zeros && i < zeros + dataSize)
+        {
+          expected = dataStart + i - zeros + 1;
+        }
+      if (buffer[i] != expected)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+class TcpTxBufferTestCase : public TestCase
+{
+public:
+  TcpTxBufferTestCase ();
+  virtual void DoRun (void);
+};
+
+TcpTxBufferTestCase::TcpTxBufferTestCase ()
+  : TestCase ("Check TcpTxBuffer with virtual and real data")
+{
+}
+
+void
+TcpTxBufferTestCase::DoRun (void)
+{
+  TcpTxBuffer buffer (1000);
+  buffer.SetMaxBufferSize (1000);
+
+  // [1000, 1300) virtual, [1300, 1350) data, [1350, 1450) virtual
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (100)), true, "Could not add virtual data");
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (CreateDataPacket (50)), true, "Could not add real data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (100)), true, "Could not add virtual data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 450, "Unexpected size");
+  NS_TEST_ASSERT_MSG_EQ (buffer.TailSequence (), SequenceNumber32 (1450), "Unexpected tail");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (551)), false, "Added beyond the buffer size");
+
+  Ptr<Packet> p = buffer.CopyFromSequence (150, SequenceNumber32 (1050));
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 150, "Unexpected segment size");
+  NS_TEST_ASSERT_MSG_EQ (p->IsVirtual (), true, "Virtual data was materialized");
+  p = buffer.CopyFromSequence (100, SequenceNumber32 (1280));
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 100, "Unexpected segment size");
+  NS_TEST_ASSERT_MSG_EQ (CheckBytes (p, 20, 0, 50), true, "Unexpected segment spanning the data");
+  p = buffer.CopyFromSequence (100, SequenceNumber32 (1400));
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 50, "Segment beyond the tail");
+
+  // A virtual packet with a packet tag is kept as it is
+  SocketIpTtlTag tag;
+  tag.SetTtl (7);
+  p = Create<Packet> (10);
+  p->AddPacketTag (tag);
+  buffer.Add (p);
+  p = buffer.CopyFromSequence (10, SequenceNumber32 (1450));
+  NS_TEST_ASSERT_MSG_EQ (p->PeekPacketTag (tag), true, "Packet tag lost");
+
+  buffer.DiscardUpTo (SequenceNumber32 (1290));
+  NS_TEST_ASSERT_MSG_EQ (buffer.HeadSequence (), SequenceNumber32 (1290), "Unexpected head");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 170, "Unexpected size after discard");
+  p = buffer.CopyFromSequence (30, SequenceNumber32 (1290));
+  NS_TEST_ASSERT_MSG_EQ (CheckBytes (p, 10, 0, 20), true, "Unexpected segment after discard");
+  buffer.DiscardUpTo (SequenceNumber32 (1320));
+  p = buffer.CopyFromSequence (40, SequenceNumber32 (1320));
+  NS_TEST_ASSERT_MSG_EQ (CheckBytes (p, 0, 20, 30), true, "Unexpected segment in the data");
+
+  // Acknowledging the FIN goes one beyond the data
+  buffer.DiscardUpTo (SequenceNumber32 (1461));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 0, "Data left after discarding all");
+  NS_TEST_ASSERT_MSG_EQ (buffer.HeadSequence (), SequenceNumber32 (1461), "Unexpected head after FIN");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (100)), true, "Could not add after discarding all");
+  p = buffer.CopyFromSequence (100, SequenceNumber32 (1461));
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 100, "Unexpected segment size after discarding all");
+}
+
+class TcpRxBufferTestCase : public TestCase
+{
+public:
+  TcpRxBufferTestCase ();
+  virtual void DoRun (void);
+};
+
+TcpRxBufferTestCase::TcpRxBufferTestCase ()
+  : TestCase ("Check TcpRxBuffer with virtual and real data")
+{
+}
+
+void
+TcpRxBufferTestCase::DoRun (void)
+{
+  TcpRxBuffer buffer (1000);
+  buffer.SetMaxBufferSize (1000);
+  TcpHeader header;
+
+  // Out of order virtual data
+  header.SetSequenceNumber (SequenceNumber32 (1100));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (100), header), true, "Could not add out of order data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.NextRxSequence (), SequenceNumber32 (1000), "Moved beyond the hole");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Available (), 0, "Data available beyond the hole");
+
+  // Real data filling the hole
+  header.SetSequenceNumber (SequenceNumber32 (1000));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (CreateDataPacket (100), header), true, "Could not fill the hole");
+  NS_TEST_ASSERT_MSG_EQ (buffer.NextRxSequence (), SequenceNumber32 (1200), "Hole not filled");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Available (), 200, "Unexpected available data");
+
+  // Overlapping and duplicate data
+  header.SetSequenceNumber (SequenceNumber32 (1050));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (200), header), true, "Could not add overlapping data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.NextRxSequence (), SequenceNumber32 (1250), "Unexpected next sequence");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 250, "Overlapping bytes counted twice");
+  header.SetSequenceNumber (SequenceNumber32 (1000));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (100), header), false, "Duplicate data buffered");
+
+  // In order virtual data, beyond the window
+  header.SetSequenceNumber (SequenceNumber32 (1250));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (800), header), true, "Could not add in order data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.NextRxSequence (), SequenceNumber32 (2000), "Data accepted beyond the window");
+  NS_TEST_ASSERT_MSG_EQ (buffer.MaxRxSequence (), SequenceNumber32 (2000), "Unexpected window");
+
+  Ptr<Packet> p = buffer.Extract (150);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 150, "Unexpected extracted size");
+  NS_TEST_ASSERT_MSG_EQ (CheckBytes (p, 0, 0, 100), true, "Unexpected extracted bytes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.MaxRxSequence (), SequenceNumber32 (2150), "Window did not move");
+  p = buffer.Extract (2000);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 850, "Unexpected extracted size");
+  NS_TEST_ASSERT_MSG_EQ (p->IsVirtual (), true, "Virtual data was materialized");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 0, "Data left after extracting all");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Extract (100), 0, "Extracted from an empty buffer");
+
+  // Holes behind an extracted run, which is only dropped later
+  header.SetSequenceNumber (SequenceNumber32 (2000));
+  buffer.Add (CreateDataPacket (100), header);
+  header.SetSequenceNumber (SequenceNumber32 (2200));
+  buffer.Add (Create<Packet> (100), header);
+  header.SetSequenceNumber (SequenceNumber32 (2400));
+  buffer.Add (Create<Packet> (100), header);
+  p = buffer.Extract (1000);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 100, "Extracted beyond the hole");
+  NS_TEST_ASSERT_MSG_EQ (CheckBytes (p, 0, 0, 100), true, "Unexpected extracted bytes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.MaxRxSequence (), SequenceNumber32 (3200), "Window did not move");
+  header.SetSequenceNumber (SequenceNumber32 (2100));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (CreateDataPacket (100), header), true, "Could not fill the first hole");
+  NS_TEST_ASSERT_MSG_EQ (buffer.NextRxSequence (), SequenceNumber32 (2300), "Hole not filled");
+  p = buffer.Extract (1000);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 200, "Unexpected extracted size");
+  NS_TEST_ASSERT_MSG_EQ (CheckBytes (p, 0, 0, 100), true, "Unexpected extracted bytes");
+  header.SetSequenceNumber (SequenceNumber32 (2300));
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (100), header), true, "Could not fill the second hole");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Available (), 200, "Unexpected available data");
+  p = buffer.Extract (1000);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 200, "Unexpected extracted size");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 0, "Data left after extracting all");
+}
+
+static class TcpBufferTestSuite : public TestSuite
+{
+public:
+  TcpBufferTestSuite ();
+} g_tcpBufferTestSuite;
+
+TcpBufferTestSuite::TcpBufferTestSuite ()
+  : TestSuite ("tcp-buffer", UNIT)
+{
+  AddTestCase (new TcpTxBufferTestCase ());
+  AddTestCase (new TcpRxBufferTestCase ());
+}
+
+} // namespace ns3
@@ -42,6 +42,9 @@
 #include "ns3/tcp-l4-protocol.h"
 #include "ns3/ipv4-list-routing.h"
 #include "ns3/ipv4-static-routing.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/uinteger.h"
 
 #include <string>
 #include <limits>
@@ -320,6 +323,117 @@ UdpSocketImplTest::DoRun (void)
 
 }
 
+class UdpSocketForwardingOnlyTest : public TestCase
+{
+  Ptr<Packet> m_receivedPacket;
+  void AddInterface (Ptr<Node> node, Ptr<SimpleNetDevice> dev, std::string address);
+  void DoSendData (Ptr<Socket> socket, std::string to);
+  void SendData (Ptr<Socket> socket, std::string to);
+
+public:
+  virtual void DoRun (void);
+  UdpSocketForwardingOnlyTest ();
+
+  void ReceivePkt (Ptr<Socket> socket);
+};
+
+UdpSocketForwardingOnlyTest::UdpSocketForwardingOnlyTest ()
+  : TestCase ("UDP through a forwarding-only node")
+{
+}
+
+void
+UdpSocketForwardingOnlyTest::AddInterface (Ptr<Node> node, Ptr<SimpleNetDevice> dev, std::string address)
+{
+  dev->SetAddress (Mac48Address::ConvertFrom (Mac48Address::Allocate ()));
+  node->AddDevice (dev);
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  uint32_t netdev_idx = ipv4->AddInterface (dev);
+  ipv4->AddAddress (netdev_idx, Ipv4InterfaceAddress (Ipv4Address (address.c_str ()), Ipv4Mask (0xffffff00U)));
+  ipv4->SetUp (netdev_idx);
+}
+
+void
+UdpSocketForwardingOnlyTest::ReceivePkt (Ptr<Socket> socket)
+{
+  m_receivedPacket = socket->Recv (std::numeric_limits<uint32_t>::max (), 0);
+}
+
+void
+UdpSocketForwardingOnlyTest::DoSendData (Ptr<Socket> socket, std::string to)
+{
+  Address realTo = InetSocketAddress (Ipv4Address (to.c_str ()), 1234);
+  NS_TEST_EXPECT_MSG_EQ (socket->SendTo (Create<Packet> (123), 0, realTo),
+                         123, "XXX");
+}
+
+void
+UdpSocketForwardingOnlyTest::SendData (Ptr<Socket> socket, std::string to)
+{
+  m_receivedPacket = Create<Packet> ();
+  Simulator::ScheduleWithContext (socket->GetNode ()->GetId (), Seconds (0),
+                                  &UdpSocketForwardingOnlyTest::DoSendData, this, socket, to);
+  Simulator::Run ();
+}
+
+void
+UdpSocketForwardingOnlyTest::DoRun (void)
+{
+  // txNode -- router -- rxNode, the router being forwarding-only
+  // and without ICMP
+  Ptr<Node> txNode = CreateObject<Node> ();
+  Ptr<Node> router = CreateObject<Node> ();
+  Ptr<Node> rxNode = CreateObject<Node> ();
+  AddInternetStack (txNode);
+  AddInternetStack (rxNode);
+  InternetStackHelper stack;
+  stack.SetIpv6StackInstall (false);
+  stack.SetForwardingOnly (true);
+  stack.SetForwardingOnlyIcmp (false);
+  stack.Install (router);
+
+  NS_TEST_EXPECT_MSG_NE (router->GetObject<Ipv4> (), 0, "no IPv4 on the forwarding-only node");
+  NS_TEST_EXPECT_MSG_EQ (router->GetObject<UdpL4Protocol> (), 0, "UDP on the forwarding-only node");
+  NS_TEST_EXPECT_MSG_EQ (router->GetObject<Icmpv4L4Protocol> (), 0, "ICMP on the forwarding-only node");
+  NS_TEST_EXPECT_MSG_EQ (router->GetObject<ArpL3Protocol> (), 0, "ARP on the forwarding-only node");
+
+  Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> routerDev1 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> routerDev2 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+  AddInterface (txNode, txDev, "10.0.0.2");
+  AddInterface (router, routerDev1, "10.0.0.1");
+  AddInterface (router, routerDev2, "10.0.1.1");
+  AddInterface (rxNode, rxDev, "10.0.1.2");
+  NS_TEST_EXPECT_MSG_EQ (router->GetObject<ArpL3Protocol> (), 0, "ARP added without a device needing it");
+
+  Ptr<SimpleChannel> channel1 = CreateObject<SimpleChannel> ();
+  txDev->SetChannel (channel1);
+  routerDev1->SetChannel (channel1);
+  Ptr<SimpleChannel> channel2 = CreateObject<SimpleChannel> ();
+  routerDev2->SetChannel (channel2);
+  rxDev->SetChannel (channel2);
+
+  Ipv4StaticRoutingHelper routing;
+  routing.GetStaticRouting (txNode->GetObject<Ipv4> ())->SetDefaultRoute (Ipv4Address ("10.0.0.1"), 1);
+  routing.GetStaticRouting (rxNode->GetObject<Ipv4> ())->SetDefaultRoute (Ipv4Address ("10.0.1.1"), 1);
+
+  Ptr<Socket> rxSocket = rxNode->GetObject<UdpSocketFactory> ()->CreateSocket ();
+  NS_TEST_EXPECT_MSG_EQ (rxSocket->Bind (InetSocketAddress (Ipv4Address ("10.0.1.2"), 1234)), 0, "trivial");
+  rxSocket->SetRecvCallback (MakeCallback (&UdpSocketForwardingOnlyTest::ReceivePkt, this));
+  Ptr<Socket> txSocket = txNode->GetObject<UdpSocketFactory> ()->CreateSocket ();
+
+  SendData (txSocket, "10.0.1.2");
+  NS_TEST_EXPECT_MSG_EQ (m_receivedPacket->GetSize (), 123, "packet not forwarded");
+
+  // The TTL expires on the router, which has no ICMP to report it
+  txSocket->SetAttribute ("IpTtl", UintegerValue (1));
+  SendData (txSocket, "10.0.1.2");
+  NS_TEST_EXPECT_MSG_EQ (m_receivedPacket->GetSize (), 0, "packet forwarded beyond its TTL");
+
+  Simulator::Destroy ();
+}
+
 //-----------------------------------------------------------------------------
 class UdpTestSuite : public TestSuite
 {
@@ -328,6 +442,7 @@ public:
   {
     AddTestCase (new UdpSocketImplTest);
     AddTestCase (new UdpSocketLoopbackTest);
+    AddTestCase (new UdpSocketForwardingOnlyTest);
   }
 } g_udpTestSuite;
 
@@ -0,0 +1,646 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "graph-partition-helper.h"
+
+#include "ns3/node.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("GraphPartitionHelper");
+
+namespace ns3 {
+
+/* The coarsening stops at about this many vertices per part */
+const uint32_t COARSEST_VERTICES_PER_PART = 20;
+/* ... or when a level removes less than this fraction of the vertices */
+const double MIN_COARSENING = 0.05;
+/* Number of seeds tried to partition the coarsest graph */
+const uint32_t INITIAL_TRIALS = 8;
+/* Largest number of passes over the vertices of a level */
+const uint32_t MAX_REFINE_PASSES = 10;
+
+GraphPartitionHelper::GraphPartitionHelper ()
+  : m_tolerance (1.03),
+    m_nParts (1),
+    m_nCutEdges (0),
+    m_cut (0)
+{
+}
+
+uint32_t
+GraphPartitionHelper::AddVertex (double weight)
+{
+  NS_ASSERT (weight >= 0);
+  m_vertexWeights.push_back (weight);
+  return m_vertexWeights.size () - 1;
+}
+
+void
+GraphPartitionHelper::SetVertexWeight (uint32_t vertex, double weight)
+{
+  NS_ASSERT (vertex < m_vertexWeights.size () && weight >= 0);
+  m_vertexWeights[vertex] = weight;
+}
+
+double
+GraphPartitionHelper::GetVertexWeight (uint32_t vertex) const
+{
+  NS_ASSERT (vertex < m_vertexWeights.size ());
+  return m_vertexWeights[vertex];
+}
+
+void
+GraphPartitionHelper::AddEdge (uint32_t a, uint32_t b, double weight)
+{
+  NS_ASSERT (weight >= 0);
+  if (std::max (a, b) >= m_vertexWeights.size ())
+    {
+      m_vertexWeights.resize (std::max (a, b) + 1, 1.0);
+    }
+  Edge edge;
+  edge.a = a;
+  edge.b = b;
+  edge.weight = weight;
+  m_edges.push_back (edge);
+}
+
+uint32_t
+GraphPartitionHelper::GetNVertices (void) const
+{
+  return m_vertexWeights.size ();
+}
+
+void
+GraphPartitionHelper::SetImbalanceTolerance (double tolerance)
+{
+  NS_ASSERT (tolerance >= 1.0);
+  m_tolerance = tolerance;
+}
+
+void
+GraphPartitionHelper::Partition (uint32_t nParts)
+{
+  NS_LOG_FUNCTION (this << nParts);
+  NS_ASSERT (nParts > 0);
+  m_nParts = nParts;
+  uint32_t n = m_vertexWeights.size ();
+
+  // The graph of the vertices and edges, with the parallel edges
+  // merged and without loops
+  Graph graph;
+  graph.vertexWeight = m_vertexWeights;
+  double total = 0;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      total += graph.vertexWeight[v];
+    }
+  if (total <= 0)
+    {
+      // no load given, balance the number of vertices
+      graph.vertexWeight.assign (n, 1.0);
+      total = n;
+    }
+  std::vector<std::vector<std::pair<uint32_t, double> > > adjacency (n);
+  for (std::vector<Edge>::const_iterator i = m_edges.begin (); i != m_edges.end (); i++)
+    {
+      if (i->a != i->b)
+        {
+          adjacency[i->a].push_back (std::make_pair (i->b, i->weight));
+          adjacency[i->b].push_back (std::make_pair (i->a, i->weight));
+        }
+    }
+  graph.start.push_back (0);
+  for (uint32_t v = 0; v < n; v++)
+    {
+      std::sort (adjacency[v].begin (), adjacency[v].end ());
+      for (uint32_t j = 0; j < adjacency[v].size (); j++)
+        {
+          if (j > 0 && adjacency[v][j].first == adjacency[v][j - 1].first)
+            {
+              graph.edgeWeight.back () += adjacency[v][j].second;
+              continue;
+            }
+          graph.adjacent.push_back (adjacency[v][j].first);
+          graph.edgeWeight.push_back (adjacency[v][j].second);
+        }
+      graph.start.push_back (graph.adjacent.size ());
+      std::vector<std::pair<uint32_t, double> > ().swap (adjacency[v]);
+    }
+
+  std::vector<uint32_t> part (n, 0);
+  if (n <= nParts)
+    {
+      for (uint32_t v = 0; v < n; v++)
+        {
+          part[v] = v;
+        }
+    }
+  else if (nParts > 1)
+    {
+      // Coarsen
+      std::vector<Graph> levels (1, graph);
+      std::vector<std::vector<uint32_t> > coarseVertices;
+      uint32_t coarsest = COARSEST_VERTICES_PER_PART * nParts;
+      double maxVertexWeight = 1.5 * total / coarsest;
+      while (levels.back ().vertexWeight.size () > coarsest)
+        {
+          Graph coarse;
+          std::vector<uint32_t> coarseVertex;
+          Coarsen (levels.back (), maxVertexWeight, coarse, coarseVertex);
+          uint32_t fineSize = levels.back ().vertexWeight.size ();
+          uint32_t coarseSize = coarse.vertexWeight.size ();
+          if (coarseSize == fineSize)
+            {
+              break;
+            }
+          levels.push_back (coarse);
+          coarseVertices.push_back (coarseVertex);
+          if (coarseSize > (1 - MIN_COARSENING) * fineSize)
+            {
+              break;
+            }
+        }
+      NS_LOG_LOGIC (levels.size () << " levels, " << levels.back ().vertexWeight.size () << " coarsest vertices");
+
+      // Partition the coarsest graph, keeping the best of a few seeds:
+      // balanced first, then the smallest cut
+      const Graph &coarsestGraph = levels.back ();
+      uint32_t coarseSize = coarsestGraph.vertexWeight.size ();
+      double maxWeight = m_tolerance * total / nParts;
+      double bestCut = 0;
+      double bestHeaviest = 0;
+      uint32_t trials = std::min (coarseSize, INITIAL_TRIALS);
+      for (uint32_t t = 0; t < trials; t++)
+        {
+          std::vector<uint32_t> trial;
+          GrowPartition (coarsestGraph, (uint64_t)t * coarseSize / trials, trial);
+          Refine (coarsestGraph, trial);
+          double cut, heaviest;
+          Evaluate (coarsestGraph, trial, cut, heaviest);
+          bool balanced = heaviest <= maxWeight;
+          bool bestBalanced = bestHeaviest <= maxWeight;
+          if (t == 0
+              || (balanced && !bestBalanced)
+              || (balanced == bestBalanced
+                  && (cut < bestCut || (cut == bestCut && heaviest < bestHeaviest))))
+            {
+              part.swap (trial);
+              bestCut = cut;
+              bestHeaviest = heaviest;
+            }
+        }
+
+      // Project back to the finer graphs
+      for (uint32_t level = levels.size () - 1; level > 0; level--)
+        {
+          const std::vector<uint32_t> &coarseVertex = coarseVertices[level - 1];
+          std::vector<uint32_t> finePart (coarseVertex.size ());
+          for (uint32_t v = 0; v < coarseVertex.size (); v++)
+            {
+              finePart[v] = part[coarseVertex[v]];
+            }
+          part.swap (finePart);
+          Refine (levels[level - 1], part);
+        }
+    }
+  m_partition = part;
+
+  m_partWeights.assign (nParts, 0);
+  for (uint32_t v = 0; v < n; v++)
+    {
+      m_partWeights[part[v]] += graph.vertexWeight[v];
+    }
+  m_nCutEdges = 0;
+  m_cut = 0;
+  for (std::vector<Edge>::const_iterator i = m_edges.begin (); i != m_edges.end (); i++)
+    {
+      if (part[i->a] != part[i->b])
+        {
+          m_nCutEdges++;
+          m_cut += i->weight;
+        }
+    }
+}
+
+void
+GraphPartitionHelper::Coarsen (const Graph &fine, double maxVertexWeight,
+                               Graph &coarse, std::vector<uint32_t> &coarseVertex)
+{
+  uint32_t n = fine.vertexWeight.size ();
+  const uint32_t NONE = 0xffffffff;
+
+  // Match every vertex with the unmatched neighbor of the heaviest
+  // edge, the vertices with the fewest neighbors first
+  std::vector<std::pair<uint32_t, uint32_t> > order (n);
+  for (uint32_t v = 0; v < n; v++)
+    {
+      order[v] = std::make_pair (fine.start[v + 1] - fine.start[v], v);
+    }
+  std::sort (order.begin (), order.end ());
+  std::vector<uint32_t> match (n, NONE);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t v = order[i].second;
+      if (match[v] != NONE)
+        {
+          continue;
+        }
+      uint32_t best = v;
+      double bestWeight = -1;
+      for (uint32_t e = fine.start[v]; e < fine.start[v + 1]; e++)
+        {
+          uint32_t u = fine.adjacent[e];
+          if (match[u] != NONE
+              || fine.vertexWeight[v] + fine.vertexWeight[u] > maxVertexWeight)
+            {
+              continue;
+            }
+          if (fine.edgeWeight[e] > bestWeight
+              || (fine.edgeWeight[e] == bestWeight && fine.vertexWeight[u] < fine.vertexWeight[best]))
+            {
+              best = u;
+              bestWeight = fine.edgeWeight[e];
+            }
+        }
+      match[v] = best;
+      match[best] = v;
+    }
+
+  // Number the pairs and build their graph
+  coarseVertex.assign (n, NONE);
+  std::vector<uint32_t> members;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      if (coarseVertex[v] == NONE)
+        {
+          coarseVertex[v] = coarseVertex[match[v]] = coarse.vertexWeight.size ();
+          coarse.vertexWeight.push_back (fine.vertexWeight[v]);
+          members.push_back (v);
+          if (match[v] != v)
+            {
+              coarse.vertexWeight.back () += fine.vertexWeight[match[v]];
+            }
+        }
+    }
+  uint32_t coarseSize = coarse.vertexWeight.size ();
+  // position of each neighbor in the adjacency of the current vertex
+  std::vector<uint32_t> position (coarseSize, NONE);
+  coarse.start.push_back (0);
+  for (uint32_t c = 0; c < coarseSize; c++)
+    {
+      uint32_t first = coarse.adjacent.size ();
+      uint32_t pair[2] = { members[c], match[members[c]] };
+      for (uint32_t m = 0; m < (pair[0] == pair[1] ? 1U : 2U); m++)
+        {
+          for (uint32_t e = fine.start[pair[m]]; e < fine.start[pair[m] + 1]; e++)
+            {
+              uint32_t u = coarseVertex[fine.adjacent[e]];
+              if (u == c)
+                {
+                  continue;
+                }
+              if (position[u] == NONE)
+                {
+                  position[u] = coarse.adjacent.size ();
+                  coarse.adjacent.push_back (u);
+                  coarse.edgeWeight.push_back (0);
+                }
+              coarse.edgeWeight[position[u]] += fine.edgeWeight[e];
+            }
+        }
+      for (uint32_t e = first; e < coarse.adjacent.size (); e++)
+        {
+          position[coarse.adjacent[e]] = NONE;
+        }
+      coarse.start.push_back (coarse.adjacent.size ());
+    }
+}
+
+void
+GraphPartitionHelper::GrowPartition (const Graph &graph, uint32_t seed, std::vector<uint32_t> &part) const
+{
+  uint32_t n = graph.vertexWeight.size ();
+  uint32_t k = m_nParts;
+  double remaining = 0;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      remaining += graph.vertexWeight[v];
+    }
+  // part k is "not assigned yet"
+  part.assign (n, k);
+  // connection of the vertices of the frontier to the part being grown
+  std::vector<double> gain (n, 0);
+  std::vector<uint32_t> frontier;
+  uint32_t next = seed;
+  for (uint32_t p = 0; p < k; p++)
+    {
+      if (p == k - 1)
+        {
+          for (uint32_t v = 0; v < n; v++)
+            {
+              if (part[v] == k)
+                {
+                  part[v] = p;
+                }
+            }
+          break;
+        }
+      // Start next to the previous part, so that what is left stays
+      // in one piece
+      uint32_t start = n;
+      for (std::vector<uint32_t>::const_iterator i = frontier.begin (); i != frontier.end (); i++)
+        {
+          if (part[*i] == k && (start == n || gain[*i] > gain[start]))
+            {
+              start = *i;
+            }
+        }
+      for (std::vector<uint32_t>::const_iterator i = frontier.begin (); i != frontier.end (); i++)
+        {
+          gain[*i] = 0;
+        }
+      frontier.clear ();
+      if (start != n)
+        {
+          frontier.push_back (start);
+        }
+
+      double target = remaining / (k - p);
+      double weight = 0;
+      while (weight < target)
+        {
+          // the unassigned vertex the most connected to the part
+          uint32_t v = n;
+          uint32_t kept = 0;
+          for (uint32_t i = 0; i < frontier.size (); i++)
+            {
+              uint32_t u = frontier[i];
+              if (part[u] != k)
+                {
+                  continue;
+                }
+              frontier[kept++] = u;
+              if (v == n || gain[u] > gain[v])
+                {
+                  v = u;
+                }
+            }
+          frontier.resize (kept);
+          if (v == n)
+            {
+              // disconnected graph, jump to any vertex left
+              for (uint32_t i = 0; i < n && v == n; i++, next = (next + 1) % n)
+                {
+                  if (part[next] == k)
+                    {
+                      v = next;
+                    }
+                }
+              if (v == n)
+                {
+                  break;
+                }
+            }
+          if (weight > 0 && weight + graph.vertexWeight[v] - target > target - weight)
+            {
+              break;
+            }
+          part[v] = p;
+          weight += graph.vertexWeight[v];
+          for (uint32_t e = graph.start[v]; e < graph.start[v + 1]; e++)
+            {
+              uint32_t u = graph.adjacent[e];
+              if (part[u] == k)
+                {
+                  if (gain[u] == 0)
+                    {
+                      frontier.push_back (u);
+                    }
+                  gain[u] += graph.edgeWeight[e] > 0 ? graph.edgeWeight[e] : 1e-9;
+                }
+            }
+        }
+      remaining -= weight;
+    }
+}
+
+void
+GraphPartitionHelper::Refine (const Graph &graph, std::vector<uint32_t> &part) const
+{
+  uint32_t n = graph.vertexWeight.size ();
+  uint32_t k = m_nParts;
+  std::vector<double> partWeight (k, 0);
+  std::vector<uint32_t> partSize (k, 0);
+  double total = 0;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      partWeight[part[v]] += graph.vertexWeight[v];
+      partSize[part[v]]++;
+      total += graph.vertexWeight[v];
+    }
+  double maxWeight = m_tolerance * total / k;
+  // connection of the current vertex to each part
+  std::vector<double> connection (k, 0);
+  std::vector<uint32_t> touched;
+
+  // The first passes restore the balance if needed, as far as
+  // possible, the others reduce the cut
+  uint32_t balancingPasses = 0;
+  for (uint32_t refinePasses = 0; refinePasses < MAX_REFINE_PASSES; )
+    {
+      bool balancing = false;
+      for (uint32_t p = 0; p < k && !balancing && balancingPasses < MAX_REFINE_PASSES; p++)
+        {
+          balancing = partWeight[p] > maxWeight;
+        }
+      if (balancing)
+        {
+          balancingPasses++;
+        }
+      else
+        {
+          refinePasses++;
+        }
+      uint32_t moves = 0;
+      for (uint32_t v = 0; v < n; v++)
+        {
+          uint32_t from = part[v];
+          double weight = graph.vertexWeight[v];
+          if (partSize[from] == 1 || (balancing && partWeight[from] <= maxWeight))
+            {
+              continue;
+            }
+          touched.clear ();
+          for (uint32_t e = graph.start[v]; e < graph.start[v + 1]; e++)
+            {
+              uint32_t q = part[graph.adjacent[e]];
+              if (connection[q] == 0)
+                {
+                  touched.push_back (q);
+                }
+              connection[q] += graph.edgeWeight[e] > 0 ? graph.edgeWeight[e] : 1e-9;
+            }
+          uint32_t to = from;
+          double bestGain = 0;
+          for (std::vector<uint32_t>::const_iterator i = touched.begin (); i != touched.end (); i++)
+            {
+              uint32_t q = *i;
+              double gain = connection[q] - connection[from];
+              if (q == from || partWeight[q] + weight > maxWeight)
+                {
+                  continue;
+                }
+              bool better;
+              if (to == from)
+                {
+                  better = balancing || gain > 0 || (gain == 0 && partWeight[q] + weight < partWeight[from]);
+                }
+              else
+                {
+                  better = gain > bestGain || (gain == bestGain && partWeight[q] < partWeight[to]);
+                }
+              if (better)
+                {
+                  to = q;
+                  bestGain = gain;
+                }
+            }
+          if (balancing && to == from)
+            {
+              // no neighboring part can take it, try the lightest part
+              uint32_t lightest = std::min_element (partWeight.begin (), partWeight.end ()) - partWeight.begin ();
+              if (lightest != from && partWeight[lightest] + weight <= maxWeight)
+                {
+                  to = lightest;
+                }
+            }
+          for (std::vector<uint32_t>::const_iterator i = touched.begin (); i != touched.end (); i++)
+            {
+              connection[*i] = 0;
+            }
+          if (to != from)
+            {
+              part[v] = to;
+              partWeight[from] -= weight;
+              partWeight[to] += weight;
+              partSize[from]--;
+              partSize[to]++;
+              moves++;
+            }
+        }
+      if (moves == 0)
+        {
+          if (!balancing)
+            {
+              break;
+            }
+          // nothing more can move to a part which is not too heavy
+          balancingPasses = MAX_REFINE_PASSES;
+        }
+    }
+}
+
+void
+GraphPartitionHelper::Evaluate (const Graph &graph, const std::vector<uint32_t> &part,
+                                double &cut, double &heaviest) const
+{
+  std::vector<double> partWeight (m_nParts, 0);
+  cut = 0;
+  for (uint32_t v = 0; v < graph.vertexWeight.size (); v++)
+    {
+      partWeight[part[v]] += graph.vertexWeight[v];
+      for (uint32_t e = graph.start[v]; e < graph.start[v + 1]; e++)
+        {
+          if (part[graph.adjacent[e]] != part[v])
+            {
+              // each edge is seen from both ends
+              cut += graph.edgeWeight[e] / 2;
+            }
+        }
+    }
+  heaviest = *std::max_element (partWeight.begin (), partWeight.end ());
+}
+
+uint32_t
+GraphPartitionHelper::GetPartition (uint32_t vertex) const
+{
+  NS_ASSERT_MSG (vertex < m_partition.size (), "GraphPartitionHelper::GetPartition (): call Partition () first");
+  return m_partition[vertex];
+}
+
+uint32_t
+GraphPartitionHelper::GetNCutEdges (void) const
+{
+  return m_nCutEdges;
+}
+
+double
+GraphPartitionHelper::GetCutSize (void) const
+{
+  return m_cut;
+}
+
+double
+GraphPartitionHelper::GetImbalance (void) const
+{
+  double total = 0;
+  double heaviest = 0;
+  for (std::vector<double>::const_iterator i = m_partWeights.begin (); i != m_partWeights.end (); i++)
+    {
+      total += *i;
+      heaviest = std::max (heaviest, *i);
+    }
+  if (total <= 0)
+    {
+      return 1.0;
+    }
+  return heaviest * m_nParts / total;
+}
+
+void
+GraphPartitionHelper::Print (std::ostream &os) const
+{
+  std::vector<uint32_t> partSize (m_nParts, 0);
+  for (std::vector<uint32_t>::const_iterator i = m_partition.begin (); i != m_partition.end (); i++)
+    {
+      partSize[*i]++;
+    }
+  os << m_partition.size () << " vertices in " << m_nParts << " parts: "
+     << m_nCutEdges << " of " << m_edges.size () << " edges cut (weight " << m_cut
+     << "), imbalance " << GetImbalance () << std::endl;
+  for (uint32_t p = 0; p < m_partWeights.size (); p++)
+    {
+      os << "  part " << p << ": " << partSize[p] << " vertices, weight " << m_partWeights[p] << std::endl;
+    }
+}
+
+NodeContainer
+GraphPartitionHelper::Create (void) const
+{
+  NodeContainer nodes;
+  for (uint32_t v = 0; v < m_vertexWeights.size (); v++)
+    {
+      nodes.Add (CreateObject<Node> (GetPartition (v)));
+    }
+  return nodes;
+}
+
+} // namespace ns3
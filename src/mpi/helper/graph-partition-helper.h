@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GRAPH_PARTITION_HELPER_H
+#define GRAPH_PARTITION_HELPER_H
+
+#include <stdint.h>
+#include <ostream>
+#include <vector>
+
+#include "ns3/node-container.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Assign the nodes of a topology to the ranks of a distributed
+ * simulation so that few links cross ranks and the ranks are evenly
+ * loaded
+ *
+ * The topology is given as a graph before any node exists, since the
+ * system id of a node is fixed when it is created: one vertex per
+ * node, or per group of nodes which must stay together such as a
+ * switch and its hosts, weighted by the expected load (for instance
+ * the bytes a traffic matrix gives it), and one edge per
+ * point-to-point link. Partition () then computes the assignment with
+ * a multilevel scheme: the graph is coarsened by merging the
+ * vertices joined by the heaviest edges, the coarsest graph is
+ * partitioned by growing the parts from seed vertices, and the
+ * partition is projected back level by level, moving the vertices on
+ * the boundary of the parts whenever that reduces the cut without
+ * breaking the balance.
+ *
+ * \code
+ *   GraphPartitionHelper partitioner;
+ *   for (uint32_t i = 0; i < nSwitches; i++)
+ *     {
+ *       partitioner.AddVertex (load[i]);
+ *     }
+ *   partitioner.AddEdge (a, b);
+ *   ...
+ *   partitioner.Partition (MpiInterface::GetSize ());
+ *   partitioner.Print (std::cout);
+ *   NodeContainer switches = partitioner.Create ();
+ * \endcode
+ */
+class GraphPartitionHelper
+{
+public:
+  GraphPartitionHelper ();
+
+  /**
+   * \param weight the load of the vertex
+   * \return the index of the new vertex
+   */
+  uint32_t AddVertex (double weight = 1.0);
+  /**
+   * \param vertex a vertex index
+   * \param weight the load of the vertex
+   */
+  void SetVertexWeight (uint32_t vertex, double weight);
+  /**
+   * \param vertex a vertex index
+   * \return the load of the vertex
+   */
+  double GetVertexWeight (uint32_t vertex) const;
+  /**
+   * Add an edge between two vertices, such as a point-to-point link.
+   * The vertices which do not exist yet are added with a weight of 1.
+   * The edges between the same vertices add up.
+   *
+   * \param a a vertex index
+   * \param b another vertex index
+   * \param weight the cost of cutting the edge
+   */
+  void AddEdge (uint32_t a, uint32_t b, double weight = 1.0);
+  /**
+   * \return the number of vertices
+   */
+  uint32_t GetNVertices (void) const;
+  /**
+   * \param tolerance the largest accepted ratio of the weight of a
+   *        part to the average weight of the parts, 1.03 by default
+   */
+  void SetImbalanceTolerance (double tolerance);
+
+  /**
+   * Compute the partition of the vertices.
+   *
+   * \param nParts the number of parts, typically MpiInterface::GetSize ()
+   */
+  void Partition (uint32_t nParts);
+  /**
+   * \param vertex a vertex index
+   * \return the part of the vertex, from 0 to nParts - 1
+   */
+  uint32_t GetPartition (uint32_t vertex) const;
+  /**
+   * \return the number of edges between vertices of different parts
+   */
+  uint32_t GetNCutEdges (void) const;
+  /**
+   * \return the total weight of the edges between vertices of
+   *         different parts
+   */
+  double GetCutSize (void) const;
+  /**
+   * \return the weight of the heaviest part divided by the average
+   *         weight of the parts
+   */
+  double GetImbalance (void) const;
+  /**
+   * Report the cut and the weight of every part.
+   *
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+
+  /**
+   * \return one node per vertex, in the order of the vertices, with
+   *         the part of the vertex as system id
+   */
+  NodeContainer Create (void) const;
+
+private:
+  struct Edge
+  {
+    uint32_t a;
+    uint32_t b;
+    double weight;
+  };
+  // A graph in compressed sparse row form
+  struct Graph
+  {
+    std::vector<uint32_t> start;     // First adjacency of each vertex, and the end
+    std::vector<uint32_t> adjacent;
+    std::vector<double> edgeWeight;
+    std::vector<double> vertexWeight;
+  };
+
+  static void Coarsen (const Graph &fine, double maxVertexWeight,
+                       Graph &coarse, std::vector<uint32_t> &coarseVertex);
+  void GrowPartition (const Graph &graph, uint32_t seed, std::vector<uint32_t> &part) const;
+  void Refine (const Graph &graph, std::vector<uint32_t> &part) const;
+  void Evaluate (const Graph &graph, const std::vector<uint32_t> &part,
+                 double &cut, double &heaviest) const;
+
+  std::vector<double> m_vertexWeights;
+  std::vector<Edge> m_edges;
+  double m_tolerance;
+  uint32_t m_nParts;
+  std::vector<uint32_t> m_partition;
+  std::vector<double> m_partWeights;
+  uint32_t m_nCutEdges;
+  double m_cut;
+};
+
+} // namespace ns3
+
+#endif /* GRAPH_PARTITION_HELPER_H */
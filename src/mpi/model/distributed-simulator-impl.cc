@@ -24,9 +24,11 @@
 #include "ns3/event-impl.h"
 #include "ns3/channel.h"
 #include "ns3/node-container.h"
+#include "ns3/data-rate.h"
 #include "ns3/ptr.h"
 #include "ns3/pointer.h"
 #include "ns3/assert.h"
+#include "ns3/enum.h"
 #include "ns3/log.h"
 
 #include <math.h>
@@ -41,6 +43,13 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (DistributedSimulatorImpl);
 
+/* Number of events processed between two tests of the LBTS round in flight */
+const uint32_t ROUND_TEST_INTERVAL = 16;
+
+/* Size of the smallest frame sent through a point-to-point link: its
+   PPP header and an IPv4 header without options */
+const uint32_t MIN_FRAME_SIZE = 2 + 20;
+
 LbtsMessage::~LbtsMessage ()
 {
 }
@@ -68,6 +77,12 @@ LbtsMessage::GetMyId ()
   return m_myId;
 }
 
+bool
+LbtsMessage::IsFinished ()
+{
+  return m_isFinished;
+}
+
 Time DistributedSimulatorImpl::m_lookAhead = Seconds (0);
 
 TypeId
@@ -76,6 +91,12 @@ DistributedSimulatorImpl::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::DistributedSimulatorImpl")
     .SetParent<Object> ()
     .AddConstructor<DistributedSimulatorImpl> ()
+    .AddAttribute ("SynchronizationMode",
+                   "The conservative synchronization algorithm used between the ranks.",
+                   EnumValue (ALLGATHER),
+                   MakeEnumAccessor (&DistributedSimulatorImpl::m_mode),
+                   MakeEnumChecker (ALLGATHER, "Allgather",
+                                    NON_BLOCKING, "NonBlocking"))
   ;
   return tid;
 }
@@ -105,6 +126,7 @@ DistributedSimulatorImpl::DistributedSimulatorImpl ()
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
   m_events = 0;
+  m_mode = ALLGATHER;
 }
 
 DistributedSimulatorImpl::~DistributedSimulatorImpl ()
@@ -146,6 +168,7 @@ void
 DistributedSimulatorImpl::CalculateLookAhead (void)
 {
 #ifdef NS3_MPI
+  m_linkLookAhead.assign (MpiInterface::GetSize (), -1);
   if (MpiInterface::GetSize () <= 1)
     {
       DistributedSimulatorImpl::m_lookAhead = Seconds (0);
@@ -192,20 +215,36 @@ DistributedSimulatorImpl::CalculateLookAhead (void)
                   continue;
                 }
 
-              // compare delay on the channel with current value of
-              // m_lookAhead.  if delay on channel is smaller, make
-              // it the new lookAhead.
+              // A packet sent on the channel arrives after the delay
+              // of the channel and its transmission time, at least
+              // that of the smallest frame
               TimeValue delay;
               channel->GetAttribute ("Delay", delay);
+              Time lookAhead = delay.Get ();
+              DataRateValue rate;
+              if (localNetDevice->GetAttributeFailSafe ("DataRate", rate))
+                {
+                  lookAhead += Seconds (rate.Get ().CalculateTxTime (MIN_FRAME_SIZE));
+                }
+
+              // compare it with current value of m_lookAhead.  if it
+              // is smaller, make it the new lookAhead.
               if (DistributedSimulatorImpl::m_lookAhead.IsZero ())
                 {
-                  DistributedSimulatorImpl::m_lookAhead = delay.Get ();
-                  m_grantedTime = delay.Get ();
+                  DistributedSimulatorImpl::m_lookAhead = lookAhead;
+                  m_grantedTime = lookAhead;
+                }
+              if (lookAhead < DistributedSimulatorImpl::m_lookAhead)
+                {
+                  DistributedSimulatorImpl::m_lookAhead = lookAhead;
+                  m_grantedTime = lookAhead;
                 }
-              if (delay.Get ().GetSeconds () < DistributedSimulatorImpl::m_lookAhead.GetSeconds ())
+
+              // and the lookahead towards that particular rank
+              int64_t &linkLookAhead = m_linkLookAhead[remoteNode->GetSystemId ()];
+              if (linkLookAhead < 0 || lookAhead.GetTimeStep () < linkLookAhead)
                 {
-                  DistributedSimulatorImpl::m_lookAhead = delay.Get ();
-                  m_grantedTime = delay.Get ();
+                  linkLookAhead = lookAhead.GetTimeStep ();
                 }
             }
         }
@@ -215,6 +254,50 @@ DistributedSimulatorImpl::CalculateLookAhead (void)
 #endif
 }
 
+void
+DistributedSimulatorImpl::CalculateRankLookAhead (void)
+{
+#ifdef NS3_MPI
+  // Each rank only knows the links of its own nodes, gather all of
+  // them: distance[i * n + j] is the smallest lookahead of the links from
+  // rank i to rank j
+  uint32_t n = m_systemCount;
+  std::vector<int64_t> distance (n * n);
+  MPI_Allgather (&m_linkLookAhead[0], n * sizeof (int64_t), MPI_BYTE,
+                 &distance[0], n * sizeof (int64_t), MPI_BYTE, MPI_COMM_WORLD);
+
+  // Floyd-Warshall; as there are no links from a rank to itself, the
+  // diagonal ends up with the shortest cycles
+  for (uint32_t k = 0; k < n; ++k)
+    {
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          int64_t ik = distance[i * n + k];
+          if (ik < 0)
+            {
+              continue;
+            }
+          for (uint32_t j = 0; j < n; ++j)
+            {
+              int64_t kj = distance[k * n + j];
+              int64_t &ij = distance[i * n + j];
+              if (kj >= 0 && (ij < 0 || ik + kj < ij))
+                {
+                  ij = ik + kj;
+                }
+            }
+        }
+    }
+
+  m_rankLookAhead.resize (n);
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      m_rankLookAhead[i] = distance[i * n + m_myId];
+      NS_LOG_LOGIC ("lookahead from rank " << i << " to rank " << m_myId << ": " << m_rankLookAhead[i]);
+    }
+#endif
+}
+
 void
 DistributedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
 {
@@ -272,59 +355,161 @@ DistributedSimulatorImpl::Run (void)
 {
 #ifdef NS3_MPI
   CalculateLookAhead ();
+  CalculateRankLookAhead ();
   m_stop = false;
-  while (!m_events->IsEmpty () && !m_stop)
+  if (m_mode == NON_BLOCKING)
+    {
+      RunNonBlocking ();
+    }
+  else
+    {
+      RunAllgather ();
+    }
+  // Do not hold back the packets sent by the last events
+  MpiInterface::FlushSendBuffers ();
+
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  NS_ASSERT (!m_events->IsEmpty () || m_unscheduledEvents == 0);
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+DistributedSimulatorImpl::RunAllgather (void)
+{
+#ifdef NS3_MPI
+  while (true)
+    {
+      if (!IsFinished () && Next () <= m_grantedTime)
+        { // Safe to process
+          ProcessOneEvent ();
+          continue;
+        }
+      // Can't process, calculate a new LBTS
+      // First send the packets batched in this window and
+      // receive any pending messages
+      MpiInterface::FlushSendBuffers ();
+      MpiInterface::ReceiveMessages ();
+      // And check for send completes
+      MpiInterface::TestSendComplete ();
+      // Finally calculate the lbts. A rank which is out of events
+      // keeps taking part in the rounds until all of them are, as the
+      // others do not run in step with it.
+      bool finished = IsFinished ();
+      LbtsMessage lMsg (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId,
+                        finished, finished ? GetMaximumSimulationTime () : Next ());
+      m_pLBTS[m_myId] = lMsg;
+      MPI_Allgather (&lMsg, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
+                     sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD);
+      if (UpdateGrantedTime ())
+        {
+          break;
+        }
+    }
+#endif
+}
+
+void
+DistributedSimulatorImpl::RunNonBlocking (void)
+{
+#ifdef NS3_MPI
+#if MPI_VERSION >= 3
+  MPI_Request request;
+  bool inFlight = false;
+  uint32_t processed = 0;
+  while (true)
     {
-      Time nextTime = Next ();
-      if (nextTime > m_grantedTime)
-        { // Can't process, calculate a new LBTS
-          // First receive any pending messages
+      if (!inFlight)
+        { // Start the next round with the current state of this rank.
+          // From now on, the packets it sends belong to the next epoch
+          // and are not counted by the round.
+          MpiInterface::FlushSendBuffers ();
           MpiInterface::ReceiveMessages ();
-          // reset next time
-          nextTime = Next ();
-          // And check for send completes
           MpiInterface::TestSendComplete ();
-          // Finally calculate the lbts
-          LbtsMessage lMsg (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId, nextTime);
-          m_pLBTS[m_myId] = lMsg;
-          MPI_Allgather (&lMsg, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
-                         sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD);
-          Time smallestTime = m_pLBTS[0].GetSmallestTime ();
-          // The totRx and totTx counts insure there are no transient
-          // messages;  If totRx != totTx, there are transients,
-          // so we don't update the granted time.
-          uint32_t totRx = m_pLBTS[0].GetRxCount ();
-          uint32_t totTx = m_pLBTS[0].GetTxCount ();
-
-          for (uint32_t i = 1; i < m_systemCount; ++i)
-            {
-              if (m_pLBTS[i].GetSmallestTime () < smallestTime)
-                {
-                  smallestTime = m_pLBTS[i].GetSmallestTime ();
-                }
-              totRx += m_pLBTS[i].GetRxCount ();
-              totTx += m_pLBTS[i].GetTxCount ();
+          bool finished = IsFinished ();
+          m_lbtsSend = LbtsMessage (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId,
+                                    finished, finished ? GetMaximumSimulationTime () : Next ());
+          MpiInterface::NextEpoch ();
+          MPI_Iallgather (&m_lbtsSend, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
+                          sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD, &request);
+          inFlight = true;
+        }
 
-            }
-          if (totRx == totTx)
+      if (!IsFinished () && Next () <= m_grantedTime)
+        { // Safe to process
+          ProcessOneEvent ();
+          // MPI only makes progress on the round when it is tested
+          if (++processed % ROUND_TEST_INTERVAL != 0)
             {
-              m_grantedTime = smallestTime + DistributedSimulatorImpl::m_lookAhead;
+              continue;
             }
         }
-      if (nextTime <= m_grantedTime)
-        { // Save to process
-          ProcessOneEvent ();
+      else
+        { // Blocked, the packets received may be safe to process
+          MpiInterface::FlushSendBuffers ();
+          MpiInterface::ReceiveMessages ();
         }
-    }
 
-  // If the simulator stopped naturally by lack of events, make a
-  // consistency test to check that we didn't lose any events along the way.
-  NS_ASSERT (!m_events->IsEmpty () || m_unscheduledEvents == 0);
+      int flag = 0;
+      MPI_Test (&request, &flag, MPI_STATUS_IGNORE);
+      if (flag)
+        {
+          inFlight = false;
+          if (UpdateGrantedTime ())
+            {
+              break;
+            }
+        }
+    }
 #else
-  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+  NS_FATAL_ERROR ("The NonBlocking synchronization mode needs MPI_Iallgather (MPI 3)");
+#endif
 #endif
 }
 
+bool
+DistributedSimulatorImpl::UpdateGrantedTime (void)
+{
+  uint32_t totRx = 0;
+  uint32_t totTx = 0;
+  bool finished = true;
+  for (uint32_t i = 0; i < m_systemCount; ++i)
+    {
+      totRx += m_pLBTS[i].GetRxCount ();
+      totTx += m_pLBTS[i].GetTxCount ();
+      finished = finished && m_pLBTS[i].IsFinished ();
+    }
+  if (totRx != totTx)
+    { // Packets in flight, their receive events are not in the round
+      return false;
+    }
+  if (finished)
+    {
+      return true;
+    }
+
+  // A rank may only send this rank packets received after its smallest
+  // time plus the delay of the shortest path from it to this rank; for
+  // this rank itself, that is the shortest cycle back to it.
+  int64_t grantedTime = GetMaximumSimulationTime ().GetTimeStep ();
+  for (uint32_t i = 0; i < m_systemCount; ++i)
+    {
+      if (m_pLBTS[i].IsFinished () || m_rankLookAhead[i] < 0)
+        {
+          continue;
+        }
+      int64_t bound = m_pLBTS[i].GetSmallestTime ().GetTimeStep ();
+      if (bound < grantedTime - m_rankLookAhead[i])
+        {
+          grantedTime = bound + m_rankLookAhead[i];
+        }
+    }
+  m_grantedTime = Max (m_grantedTime, TimeStep (grantedTime));
+  return false;
+}
+
 uint32_t DistributedSimulatorImpl::GetSystemId () const
 {
   return m_myId;
@@ -25,6 +25,7 @@
 #include "ns3/ptr.h"
 
 #include <list>
+#include <vector>
 
 namespace ns3 {
 
@@ -39,7 +40,8 @@ public:
   LbtsMessage ()
     : m_txCount (0),
       m_rxCount (0),
-      m_myId (0)
+      m_myId (0),
+      m_isFinished (false)
   {
   }
 
@@ -47,12 +49,14 @@ public:
    * \param rxc received count
    * \param txc transmitted count
    * \param id mpi rank
+   * \param isFinished whether the rank has no more events to process
    * \param t smallest time
    */
-  LbtsMessage (uint32_t rxc, uint32_t txc, uint32_t id, const Time& t)
+  LbtsMessage (uint32_t rxc, uint32_t txc, uint32_t id, bool isFinished, const Time& t)
     : m_txCount (txc),
       m_rxCount (rxc),
       m_myId (id),
+      m_isFinished (isFinished),
       m_smallestTime (t)
   {
   }
@@ -75,11 +79,16 @@ public:
    * \return id which corresponds to mpi rank
    */
   uint32_t GetMyId ();
+  /**
+   * \return true if the rank has no more events to process
+   */
+  bool IsFinished ();
 
 private:
   uint32_t m_txCount;
   uint32_t m_rxCount;
   uint32_t m_myId;
+  bool     m_isFinished;
   Time     m_smallestTime;
 };
 
@@ -87,10 +96,41 @@ private:
  * \ingroup mpi
  *
  * \brief distributed simulator implementation using lookahead
+ *
+ * The lookahead between two ranks is the smallest time a packet sent
+ * by one of them takes to reach the other: the delay of the
+ * point-to-point links between them plus the transmission time of the
+ * smallest frame, along the shortest path of such links. Each rank
+ * computes its own bound from the next event times of the others and
+ * these lookaheads, rather than from the smallest lookahead of the
+ * whole simulation, so that ranks which are far apart, or not
+ * connected at all, do not hold each other back.
+ *
+ * Two conservative synchronization algorithms are available, see
+ * the SynchronizationMode attribute:
+ *  - Allgather: whenever a rank runs out of events it may safely
+ *    process, all the ranks exchange their next event time with a
+ *    blocking MPI_Allgather. Every time window is a global barrier.
+ *  - NonBlocking: the same exchange is made with MPI_Iallgather. A new
+ *    round is started as soon as the previous one completes and each
+ *    rank keeps processing the events it may safely process while the
+ *    round is in flight; it only waits when it runs out of them.
+ *
+ * In both modes, the simulation ends once every rank is out of events
+ * and no packet is in flight.
  */
 class DistributedSimulatorImpl : public SimulatorImpl
 {
 public:
+  /**
+   * The conservative synchronization algorithm used between the ranks
+   */
+  enum SynchronizationMode
+  {
+    ALLGATHER,
+    NON_BLOCKING
+  };
+
   static TypeId GetTypeId (void);
 
   DistributedSimulatorImpl ();
@@ -121,6 +161,19 @@ public:
 private:
   virtual void DoDispose (void);
   void CalculateLookAhead (void);
+  /**
+   * Compute m_rankLookAhead from the delays of the links between the
+   * ranks. This is a collective operation.
+   */
+  void CalculateRankLookAhead (void);
+  void RunAllgather (void);
+  void RunNonBlocking (void);
+  /**
+   * Raise m_grantedTime from the completed round in m_pLBTS.
+   *
+   * \return true if every rank is finished and no packet is in flight
+   */
+  bool UpdateGrantedTime (void);
 
   void ProcessOneEvent (void);
   uint64_t NextTs (void) const;
@@ -141,8 +194,15 @@ private:
   uint32_t     m_myId;        // MPI Rank
   uint32_t     m_systemCount; // MPI Size
   Time         m_grantedTime; // Last LBTS
-  static Time  m_lookAhead;   // Lookahead value
-
+  static Time  m_lookAhead;   // Smallest lookahead of the links
+
+  // Smallest lookahead of the links to each rank, or -1 without any link
+  std::vector<int64_t> m_linkLookAhead;
+  // Smallest lookahead of the paths from each rank to this one, this rank
+  // included (shortest cycle), or -1 without any path
+  std::vector<int64_t> m_rankLookAhead;
+  LbtsMessage  m_lbtsSend;    // Buffer of the non-blocking round in flight
+  enum SynchronizationMode m_mode;
 };
 
 } // namespace ns3
@@ -32,6 +32,8 @@
 #include "ns3/simulator.h"
 #include "ns3/simulator-impl.h"
 #include "ns3/nstime.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
 
 #ifdef NS3_MPI
 #include <mpi.h>
@@ -39,6 +41,27 @@
 
 namespace ns3 {
 
+/*
+ * A message holds a batch of packets for the same rank:
+ *
+ *   uint32_t epoch, uint32_t number of packets
+ *
+ * followed, for each packet, by
+ *
+ *   uint64_t rx time (ns), uint32_t node, uint32_t device,
+ *   uint32_t serialized size, the serialized packet
+ *
+ * each packet starting on an 8 byte boundary.
+ */
+const uint32_t BATCH_HEADER_SIZE = 8;
+const uint32_t PACKET_HEADER_SIZE = 20;
+
+static uint32_t
+PacketRecordSize (uint32_t serializedSize)
+{
+  return (PACKET_HEADER_SIZE + serializedSize + 7) & ~7U;
+}
+
 SentBuffer::SentBuffer ()
 {
   m_buffer = 0;
@@ -76,7 +99,12 @@ bool                  MpiInterface::m_initialized = false;
 bool                  MpiInterface::m_enabled = false;
 uint32_t              MpiInterface::m_rxCount = 0;
 uint32_t              MpiInterface::m_txCount = 0;
+uint32_t              MpiInterface::m_rxNextCount = 0;
+uint32_t              MpiInterface::m_epoch = 0;
 std::list<SentBuffer> MpiInterface::m_pendingTx;
+std::vector<uint8_t*> MpiInterface::m_bufferPool;
+uint8_t**             MpiInterface::m_pTxBatches = 0;
+uint32_t*             MpiInterface::m_txBatchSizes = 0;
 
 #ifdef NS3_MPI
 MPI_Request* MpiInterface::m_requests;
@@ -89,15 +117,44 @@ MpiInterface::Destroy ()
 #ifdef NS3_MPI
   for (uint32_t i = 0; i < GetSize (); ++i)
     {
+      // The receives posted by Enable () are still pending
+      MPI_Cancel (&m_requests[i]);
+      MPI_Request_free (&m_requests[i]);
       delete [] m_pRxBuffers[i];
     }
   delete [] m_pRxBuffers;
   delete [] m_requests;
 
+  for (uint32_t i = 0; i < GetSize (); ++i)
+    {
+      delete [] m_pTxBatches[i];
+    }
+  delete [] m_pTxBatches;
+  delete [] m_txBatchSizes;
+  m_pTxBatches = 0;
+  m_txBatchSizes = 0;
+
   m_pendingTx.clear ();
+  for (std::vector<uint8_t*>::iterator i = m_bufferPool.begin (); i != m_bufferPool.end (); ++i)
+    {
+      delete [] *i;
+    }
+  m_bufferPool.clear ();
 #endif
 }
 
+uint8_t*
+MpiInterface::AllocateBuffer ()
+{
+  if (m_bufferPool.empty ())
+    {
+      return new uint8_t[MAX_MPI_MSG_SIZE];
+    }
+  uint8_t* buffer = m_bufferPool.back ();
+  m_bufferPool.pop_back ();
+  return buffer;
+}
+
 uint32_t
 MpiInterface::GetRxCount ()
 {
@@ -110,6 +167,19 @@ MpiInterface::GetTxCount ()
   return m_txCount;
 }
 
+void
+MpiInterface::NextEpoch ()
+{
+  // The packets of a batch must all be sent in the same epoch
+  for (uint32_t i = 0; m_pTxBatches != 0 && i < m_size; ++i)
+    {
+      NS_ASSERT_MSG (m_pTxBatches[i] == 0, "Batch to rank " << i << " not flushed");
+    }
+  m_epoch++;
+  m_rxCount += m_rxNextCount;
+  m_rxNextCount = 0;
+}
+
 uint32_t
 MpiInterface::GetSystemId ()
 {
@@ -147,8 +217,13 @@ void
 MpiInterface::Enable (int* pargc, char*** pargv)
 {
 #ifdef NS3_MPI
-  // Initialize the MPI interface
-  MPI_Init (pargc, pargv);
+  // Initialize the MPI interface, unless a previous simulation did
+  int initialized = 0;
+  MPI_Initialized (&initialized);
+  if (!initialized)
+    {
+      MPI_Init (pargc, pargv);
+    }
   MPI_Barrier (MPI_COMM_WORLD);
   MPI_Comm_rank (MPI_COMM_WORLD, reinterpret_cast <int *> (&m_sid));
   MPI_Comm_size (MPI_COMM_WORLD, reinterpret_cast <int *> (&m_size));
@@ -163,6 +238,14 @@ MpiInterface::Enable (int* pargc, char*** pargv)
       MPI_Irecv (m_pRxBuffers[i], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
                  MPI_COMM_WORLD, &m_requests[i]);
     }
+  // No batch is being filled yet
+  m_pTxBatches = new uint8_t*[m_size];
+  m_txBatchSizes = new uint32_t[m_size];
+  for (uint32_t i = 0; i < GetSize (); ++i)
+    {
+      m_pTxBatches[i] = 0;
+      m_txBatchSizes[i] = 0;
+    }
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
@@ -172,30 +255,78 @@ void
 MpiInterface::SendPacket (Ptr<Packet> p, const Time& rxTime, uint32_t node, uint32_t dev)
 {
 #ifdef NS3_MPI
-  SentBuffer sendBuf;
-  m_pendingTx.push_back (sendBuf);
-  std::list<SentBuffer>::reverse_iterator i = m_pendingTx.rbegin (); // Points to the last element
+  // Find the system id for the destination node
+  Ptr<Node> destNode = NodeList::GetNode (node);
+  uint32_t nodeSysId = destNode->GetSystemId ();
 
   uint32_t serializedSize = p->GetSerializedSize ();
-  uint8_t* buffer =  new uint8_t[serializedSize + 16];
-  i->SetBuffer (buffer);
-  // Add the time, dest node and dest device
+  uint32_t recordSize = PacketRecordSize (serializedSize);
+  NS_ABORT_MSG_IF (BATCH_HEADER_SIZE + recordSize > MAX_MPI_MSG_SIZE,
+                   "Packet of " << serializedSize << " bytes too large for MAX_MPI_MSG_SIZE");
+  if (m_pTxBatches[nodeSysId] != 0 && m_txBatchSizes[nodeSysId] + recordSize > MAX_MPI_MSG_SIZE)
+    {
+      SendBatch (nodeSysId);
+    }
+  if (m_pTxBatches[nodeSysId] == 0)
+    {
+      m_pTxBatches[nodeSysId] = AllocateBuffer ();
+      m_txBatchSizes[nodeSysId] = BATCH_HEADER_SIZE;
+      reinterpret_cast<uint32_t *> (m_pTxBatches[nodeSysId])[1] = 0;
+    }
+
+  // Add the time, dest node, dest device and size, and serialize the
+  // packet right behind them
+  uint8_t* buffer = m_pTxBatches[nodeSysId] + m_txBatchSizes[nodeSysId];
   uint64_t t = rxTime.GetNanoSeconds ();
   uint64_t* pTime = reinterpret_cast <uint64_t *> (buffer);
   *pTime++ = t;
   uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
   *pData++ = node;
   *pData++ = dev;
-  // Serialize the packet
+  *pData++ = serializedSize;
   p->Serialize (reinterpret_cast<uint8_t *> (pData), serializedSize);
+  m_txBatchSizes[nodeSysId] += recordSize;
 
-  // Find the system id for the destination node
-  Ptr<Node> destNode = NodeList::GetNode (node);
-  uint32_t nodeSysId = destNode->GetSystemId ();
+  // Count the packets in the batch of this rank
+  uint32_t* pHeader = reinterpret_cast<uint32_t *> (m_pTxBatches[nodeSysId]);
+  pHeader[1]++;
+  m_txCount++;
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+MpiInterface::SendBatch (uint32_t rank)
+{
+#ifdef NS3_MPI
+  SentBuffer sendBuf;
+  m_pendingTx.push_back (sendBuf);
+  std::list<SentBuffer>::reverse_iterator i = m_pendingTx.rbegin (); // Points to the last element
+  i->SetBuffer (m_pTxBatches[rank]);
+  uint32_t* pHeader = reinterpret_cast<uint32_t *> (m_pTxBatches[rank]);
+  pHeader[0] = m_epoch;
 
-  MPI_Isend (reinterpret_cast<void *> (i->GetBuffer ()), serializedSize + 16, MPI_CHAR, nodeSysId,
+  MPI_Isend (reinterpret_cast<void *> (i->GetBuffer ()), m_txBatchSizes[rank], MPI_CHAR, rank,
              0, MPI_COMM_WORLD, (i->GetRequest ()));
-  m_txCount++;
+  m_pTxBatches[rank] = 0;
+  m_txBatchSizes[rank] = 0;
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+MpiInterface::FlushSendBuffers ()
+{
+#ifdef NS3_MPI
+  for (uint32_t i = 0; i < GetSize (); ++i)
+    {
+      if (m_pTxBatches[i] != 0)
+        {
+          SendBatch (i);
+        }
+    }
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
@@ -216,42 +347,59 @@ MpiInterface::ReceiveMessages ()
         {
           break;        // No more messages
         }
-      int count;
-      MPI_Get_count (&status, MPI_CHAR, &count);
-      m_rxCount++; // Count this receive
-
-      // Get the meta data first
-      uint64_t* pTime = reinterpret_cast<uint64_t *> (m_pRxBuffers[index]);
-      uint64_t nanoSeconds = *pTime++;
-      uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
-      uint32_t node = *pData++;
-      uint32_t dev  = *pData++;
 
-      Time rxTime = NanoSeconds (nanoSeconds);
+      uint32_t* pHeader = reinterpret_cast<uint32_t *> (m_pRxBuffers[index]);
+      uint32_t epoch = pHeader[0];
+      uint32_t nPackets = pHeader[1];
 
-      count -= sizeof (nanoSeconds) + sizeof (node) + sizeof (dev);
-
-      Ptr<Packet> p = Create<Packet> (reinterpret_cast<uint8_t *> (pData), count, true);
+      // Count these receives; the sender is at most one epoch ahead
+      if (epoch == m_epoch + 1)
+        {
+          m_rxNextCount += nPackets;
+        }
+      else
+        {
+          NS_ASSERT (epoch <= m_epoch);
+          m_rxCount += nPackets;
+        }
 
-      // Find the correct node/device to schedule receive event
-      Ptr<Node> pNode = NodeList::GetNode (node);
-      Ptr<MpiReceiver> pMpiRec = 0;
-      uint32_t nDevices = pNode->GetNDevices ();
-      for (uint32_t i = 0; i < nDevices; ++i)
+      uint8_t* buffer = reinterpret_cast<uint8_t *> (m_pRxBuffers[index]) + BATCH_HEADER_SIZE;
+      for (uint32_t j = 0; j < nPackets; ++j)
         {
-          Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
-          if (pThisDev->GetIfIndex () == dev)
+          // Get the meta data first
+          uint64_t* pTime = reinterpret_cast<uint64_t *> (buffer);
+          uint64_t nanoSeconds = *pTime++;
+          uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
+          uint32_t node = *pData++;
+          uint32_t dev  = *pData++;
+          uint32_t serializedSize = *pData++;
+
+          Time rxTime = NanoSeconds (nanoSeconds);
+
+          // Deserialize straight from the receive buffer
+          Ptr<Packet> p = Create<Packet> (reinterpret_cast<uint8_t *> (pData), serializedSize, true);
+          buffer += PacketRecordSize (serializedSize);
+
+          // Find the correct node/device to schedule receive event
+          Ptr<Node> pNode = NodeList::GetNode (node);
+          Ptr<MpiReceiver> pMpiRec = 0;
+          uint32_t nDevices = pNode->GetNDevices ();
+          for (uint32_t i = 0; i < nDevices; ++i)
             {
-              pMpiRec = pThisDev->GetObject<MpiReceiver> ();
-              break;
+              Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
+              if (pThisDev->GetIfIndex () == dev)
+                {
+                  pMpiRec = pThisDev->GetObject<MpiReceiver> ();
+                  break;
+                }
             }
-        }
 
-      NS_ASSERT (pNode && pMpiRec);
+          NS_ASSERT (pNode && pMpiRec);
 
-      // Schedule the rx event
-      Simulator::ScheduleWithContext (pNode->GetId (), rxTime - Simulator::Now (),
-                                      &MpiReceiver::Receive, pMpiRec, p);
+          // Schedule the rx event
+          Simulator::ScheduleWithContext (pNode->GetId (), rxTime - Simulator::Now (),
+                                          &MpiReceiver::Receive, pMpiRec, p);
+        }
 
       // Re-queue the next read
       MPI_Irecv (m_pRxBuffers[index], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
@@ -275,7 +423,9 @@ MpiInterface::TestSendComplete ()
       std::list<SentBuffer>::iterator current = i; // Save current for erasing
       i++;                                    // Advance to next
       if (flag)
-        { // This message is complete
+        { // This message is complete, recycle its buffer
+          m_bufferPool.push_back (current->GetBuffer ());
+          current->SetBuffer (0);
           m_pendingTx.erase (current);
         }
     }
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <list>
+#include <vector>
 
 #include "ns3/nstime.h"
 #include "ns3/buffer.h"
@@ -46,9 +47,10 @@ namespace ns3 {
 
 /**
  * maximum MPI message size for easy
- * buffer creation
+ * buffer creation. Packets to the same rank are batched into
+ * messages of up to this size.
  */
-const uint32_t MAX_MPI_MSG_SIZE = 2000;
+const uint32_t MAX_MPI_MSG_SIZE = 65536;
 
 /**
  * \ingroup mpi
@@ -90,7 +92,7 @@ class MpiInterface
 {
 public:
   /**
-   * Delete all buffers
+   * Cancel the pending receives and delete all buffers
    */
   static void Destroy ();
   /**
@@ -109,7 +111,8 @@ public:
    * \param pargc number of command line arguments
    * \param pargv command line arguments
    *
-   * Sets up MPI interface
+   * Sets up MPI interface. It may be called again after Destroy (),
+   * to run another distributed simulation before Disable ().
    */
   static void Enable (int* pargc, char*** pargv);
   /**
@@ -124,9 +127,16 @@ public:
    * \param node destination node
    * \param dev destination device
    *
-   * Serialize and send a packet to the specified node and net device
+   * Serialize a packet for the specified node and net device into
+   * the batch of its rank. The batch is sent when it is full or by
+   * FlushSendBuffers, the packet is counted as sent right away.
    */
   static void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+  /**
+   * Send the batches of packets which are not empty. This must be
+   * called before the sent and received counts are exchanged.
+   */
+  static void FlushSendBuffers ();
   /**
    * Check for received messages complete
    */
@@ -136,21 +146,47 @@ public:
    */
   static void TestSendComplete ();
   /**
-   * \return received count in packets
+   * \return received count in packets, not counting the packets sent
+   * in a later epoch than the current one
    */
   static uint32_t GetRxCount ();
   /**
    * \return transmitted count in packets
    */
   static uint32_t GetTxCount ();
+  /**
+   * Start the next epoch. Each batch carries the epoch in which it
+   * was sent, and a rank which starts epoch k once it has reported its
+   * counts for a LBTS round k can tell the packets sent before the
+   * round apart from the packets sent after it by ranks which already
+   * moved on to epoch k. See DistributedSimulatorImpl.
+   */
+  static void NextEpoch ();
 
 private:
+  /**
+   * \return a MAX_MPI_MSG_SIZE buffer from the pool
+   */
+  static uint8_t* AllocateBuffer ();
+  /**
+   * \param rank destination rank
+   *
+   * Send the batch of packets to rank
+   */
+  static void SendBatch (uint32_t rank);
+
   static uint32_t m_sid;
   static uint32_t m_size;
 
-  // Total packets received
+  // Total packets received, sent up to the current epoch
   static uint32_t m_rxCount;
 
+  // Packets received, sent in the epoch after the current one
+  static uint32_t m_rxNextCount;
+
+  // Epoch stamped on the packets sent
+  static uint32_t m_epoch;
+
   // Total packets sent
   static uint32_t m_txCount;
   static bool     m_initialized;
@@ -162,6 +198,15 @@ private:
   // Data buffers for non-blocking reads
   static char**   m_pRxBuffers;
 
+  // Batch of packets being filled for each rank, or 0
+  static uint8_t** m_pTxBatches;
+
+  // Bytes used in each batch, header included
+  static uint32_t* m_txBatchSizes;
+
+  // Free MAX_MPI_MSG_SIZE buffers, recycled once their send completes
+  static std::vector<uint8_t*> m_bufferPool;
+
   // List of pending non-blocking sends
   static std::list<SentBuffer> m_pendingTx;
 };
@@ -0,0 +1,765 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+#include "ns3/graph-partition-helper.h"
+
+#include "ns3/simulator.h"
+#include "ns3/channel.h"
+#include "ns3/channel-list.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+#include "ns3/data-rate.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <unistd.h>
+#include <sched.h>
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+/* Time stamp of the events which never run */
+const uint64_t NEVER = 0xffffffffffffffffULL;
+
+/* The smallest frame on a point-to-point link: a PPP header and an
+   IPv4 header without options */
+const uint32_t MIN_FRAME_SIZE = 2 + 20;
+
+/* Number of tests of the barrier before a waiting thread yields */
+const uint32_t BARRIER_SPINS = 1000;
+
+__thread MultithreadedSimulatorImpl::Partition *MultithreadedSimulatorImpl::m_currentPartition = 0;
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<Object> ()
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("ThreadCount",
+                   "The number of threads running the nodes, 0 for one per processor.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_threadCount),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_threadCount (0),
+    m_lookAhead (NEVER),
+    m_running (false),
+    m_stopTs (NEVER),
+    m_barrierCount (0),
+    m_barrierSense (false)
+{
+  Partition *main = new Partition ();
+  main->simulator = this;
+  main->id = 0;
+  // uids are allocated from 4.
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  main->uid = 4;
+  // before ::Run is entered, the m_currentUid will be zero
+  main->currentUid = 0;
+  main->currentTs = 0;
+  main->currentContext = 0xffffffff;
+  main->unscheduledEvents = 0;
+  main->grantedTs = NEVER;
+  main->nextTs = NEVER;
+  main->barrierSense = false;
+  m_partitions.push_back (main);
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  Partition *main = m_partitions[0];
+  while (!main->events->IsEmpty ())
+    {
+      Scheduler::Event next = main->events->RemoveNext ();
+      next.impl->Unref ();
+    }
+  main->events = 0;
+  delete main;
+  m_partitions.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_ASSERT (!m_running);
+  m_schedulerFactory = schedulerFactory;
+  Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+  Partition *main = m_partitions[0];
+  if (main->events != 0)
+    {
+      while (!main->events->IsEmpty ())
+        {
+          Scheduler::Event next = main->events->RemoveNext ();
+          scheduler->Insert (next);
+        }
+    }
+  main->events = scheduler;
+}
+
+MultithreadedSimulatorImpl::Partition*
+MultithreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  // out of Run (), m_nodePartition is empty and everything is in the
+  // main partition, as are the events of no node
+  if (context < m_nodePartition.size ())
+    {
+      return m_partitions[m_nodePartition[context]];
+    }
+  return m_partitions[0];
+}
+
+MultithreadedSimulatorImpl::Partition*
+MultithreadedSimulatorImpl::GetCurrentPartition (void) const
+{
+  // the main thread runs the main partition
+  return m_currentPartition != 0 ? m_currentPartition : m_partitions[0];
+}
+
+void
+MultithreadedSimulatorImpl::AssignPartitions (uint32_t n)
+{
+  uint32_t nNodes = NodeList::GetNNodes ();
+
+  // Union-find of the nodes which must stay together: those sharing
+  // a channel other than a point-to-point link
+  std::vector<uint32_t> group (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      group[i] = i;
+    }
+  struct Find
+  {
+    static uint32_t Root (std::vector<uint32_t> &group, uint32_t i)
+    {
+      while (group[i] != i)
+        {
+          group[i] = group[group[i]];
+          i = group[i];
+        }
+      return i;
+    }
+  };
+  // the point-to-point links
+  std::vector<std::pair<uint32_t, uint32_t> > links;
+  for (uint32_t c = 0; c < ChannelList::GetNChannels (); c++)
+    {
+      Ptr<Channel> channel = ChannelList::GetChannel (c);
+      uint32_t nDevices = channel->GetNDevices ();
+      if (nDevices == 0)
+        {
+          continue;
+        }
+      uint32_t first = channel->GetDevice (0)->GetNode ()->GetId ();
+      if (nDevices == 2 && channel->GetDevice (0)->IsPointToPoint ())
+        {
+          uint32_t second = channel->GetDevice (1)->GetNode ()->GetId ();
+          links.push_back (std::make_pair (first, second));
+          continue;
+        }
+      for (uint32_t d = 1; d < nDevices; d++)
+        {
+          uint32_t other = channel->GetDevice (d)->GetNode ()->GetId ();
+          group[Find::Root (group, other)] = Find::Root (group, first);
+        }
+    }
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      group[i] = Find::Root (group, i);
+    }
+
+  // the partition of a group is that of its root node
+  std::vector<uint32_t> groupPartition (nNodes, n);
+  bool systemIds = false;
+  for (uint32_t i = 0; i < nNodes && !systemIds; i++)
+    {
+      systemIds = NodeList::GetNode (i)->GetSystemId () != 0;
+    }
+  if (systemIds)
+    {
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          groupPartition[i] = NodeList::GetNode (i)->GetSystemId () % n;
+        }
+    }
+  else
+    {
+      // Partition the graph of the groups and the links between them,
+      // so that few links join two partitions
+      GraphPartitionHelper partitioner;
+      std::vector<uint32_t> vertex (nNodes);
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          if (group[i] == i)
+            {
+              vertex[i] = partitioner.AddVertex (0);
+            }
+        }
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          uint32_t v = vertex[group[i]];
+          partitioner.SetVertexWeight (v, partitioner.GetVertexWeight (v) + 1);
+        }
+      for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator i = links.begin (); i != links.end (); i++)
+        {
+          partitioner.AddEdge (vertex[group[i->first]], vertex[group[i->second]]);
+        }
+      partitioner.Partition (n);
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          if (group[i] == i)
+            {
+              groupPartition[i] = partitioner.GetPartition (vertex[i]);
+            }
+        }
+      NS_LOG_LOGIC (partitioner.GetNCutEdges () << " links between partitions, imbalance "
+                                                << partitioner.GetImbalance ());
+    }
+  m_nodePartition.resize (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      m_nodePartition[i] = groupPartition[group[i]];
+    }
+
+  // The lookahead is the smallest time a frame takes to cross a link
+  // between two partitions: its delay plus the transmission time of
+  // the smallest frame
+  m_lookAhead = NEVER;
+  for (uint32_t c = 0; c < ChannelList::GetNChannels (); c++)
+    {
+      Ptr<Channel> channel = ChannelList::GetChannel (c);
+      if (channel->GetNDevices () != 2
+          || (m_nodePartition[channel->GetDevice (0)->GetNode ()->GetId ()]
+              == m_nodePartition[channel->GetDevice (1)->GetNode ()->GetId ()]))
+        {
+          continue;
+        }
+      TimeValue delay;
+      channel->GetAttribute ("Delay", delay);
+      Time crossing = delay.Get ();
+      DataRateValue rate;
+      if (channel->GetDevice (0)->GetAttributeFailSafe ("DataRate", rate))
+        {
+          Time txTime = Seconds (rate.Get ().CalculateTxTime (MIN_FRAME_SIZE));
+          if (channel->GetDevice (1)->GetAttributeFailSafe ("DataRate", rate))
+            {
+              txTime = Min (txTime, Seconds (rate.Get ().CalculateTxTime (MIN_FRAME_SIZE)));
+            }
+          crossing += txTime;
+        }
+      if (!crossing.IsStrictlyPositive ())
+        {
+          NS_FATAL_ERROR ("MultithreadedSimulatorImpl: the link between nodes "
+                          << channel->GetDevice (0)->GetNode ()->GetId () << " and "
+                          << channel->GetDevice (1)->GetNode ()->GetId ()
+                          << " joins two partitions but has no delay");
+        }
+      m_lookAhead = std::min<uint64_t> (m_lookAhead, crossing.GetTimeStep ());
+    }
+  NS_LOG_LOGIC ("lookahead " << m_lookAhead);
+}
+
+void
+MultithreadedSimulatorImpl::Insert (Partition *partition, uint64_t ts, uint32_t context, EventImpl *event)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = partition->uid;
+  partition->uid += m_partitions.size ();
+  partition->unscheduledEvents++;
+  partition->events->Insert (ev);
+}
+
+void
+MultithreadedSimulatorImpl::ProcessOneEvent (Partition *partition)
+{
+  Scheduler::Event next = partition->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->currentTs);
+  partition->unscheduledEvents--;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  partition->currentTs = next.key.m_ts;
+  partition->currentContext = next.key.m_context;
+  partition->currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  return m_partitions[0]->events->IsEmpty () || m_stopTs <= m_partitions[0]->currentTs;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::NextTs (void) const
+{
+  NS_ASSERT (!m_partitions[0]->events->IsEmpty ());
+  Scheduler::Event ev = m_partitions[0]->events->PeekNext ();
+  return ev.key.m_ts;
+}
+
+Time
+MultithreadedSimulatorImpl::Next (void) const
+{
+  return TimeStep (NextTs ());
+}
+
+void
+MultithreadedSimulatorImpl::Barrier (Partition *partition)
+{
+  // sense reversing barrier
+  partition->barrierSense = !partition->barrierSense;
+  if (__sync_add_and_fetch (&m_barrierCount, 1) == m_partitions.size ())
+    {
+      m_barrierCount = 0;
+      __sync_synchronize ();
+      m_barrierSense = partition->barrierSense;
+    }
+  else
+    {
+      for (uint32_t spins = 0; m_barrierSense != partition->barrierSense; spins++)
+        {
+          if (spins >= BARRIER_SPINS)
+            {
+              sched_yield ();
+            }
+        }
+    }
+  __sync_synchronize ();
+}
+
+void
+MultithreadedSimulatorImpl::RunThread (Partition *partition)
+{
+  m_currentPartition = partition;
+  partition->simulator->RunPartition (partition);
+  m_currentPartition = 0;
+}
+
+void
+MultithreadedSimulatorImpl::RunPartition (Partition *partition)
+{
+  uint32_t n = m_partitions.size ();
+  while (true)
+    {
+      // Take the events the other partitions sent during the last
+      // window, in partition order so that runs are reproducible
+      for (uint32_t i = 0; i < n; i++)
+        {
+          std::vector<RemoteEvent> &inbox = m_partitions[i]->outbox[partition->id];
+          for (std::vector<RemoteEvent>::const_iterator ev = inbox.begin (); ev != inbox.end (); ev++)
+            {
+              Insert (partition, ev->ts, ev->context, ev->impl);
+            }
+          inbox.clear ();
+        }
+      partition->nextTs = partition->events->IsEmpty () ? NEVER : partition->events->PeekNext ().key.m_ts;
+      // nobody stops the simulation between the two barriers
+      uint64_t stopTs = m_stopTs;
+      Barrier (partition);
+
+      uint64_t nextTs = NEVER;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          nextTs = std::min (nextTs, m_partitions[i]->nextTs);
+        }
+      if (nextTs == NEVER || nextTs >= stopTs)
+        {
+          break;
+        }
+      // no event of another partition can reach this one before
+      // nextTs + m_lookAhead
+      partition->grantedTs = stopTs;
+      if (m_lookAhead < stopTs - nextTs)
+        {
+          partition->grantedTs = nextTs + m_lookAhead;
+        }
+      while (!partition->events->IsEmpty ()
+             && partition->events->PeekNext ().key.m_ts < std::min (partition->grantedTs, (uint64_t)m_stopTs))
+        {
+          ProcessOneEvent (partition);
+        }
+      Barrier (partition);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  uint32_t n = m_threadCount;
+  if (n == 0)
+    {
+      long processors = sysconf (_SC_NPROCESSORS_ONLN);
+      n = processors > 0 ? processors : 1;
+    }
+  n = std::max<uint32_t> (1, std::min (n, NodeList::GetNNodes ()));
+  NS_LOG_LOGIC ("running " << NodeList::GetNNodes () << " nodes in " << n << " threads");
+
+  // Spread the events over the partitions
+  Partition *main = m_partitions[0];
+  uint32_t uid = main->uid;
+  for (uint32_t i = 1; i < n; i++)
+    {
+      Partition *partition = new Partition ();
+      partition->simulator = this;
+      partition->id = i;
+      partition->events = m_schedulerFactory.Create<Scheduler> ();
+      partition->currentUid = 0;
+      partition->currentTs = main->currentTs;
+      partition->currentContext = 0xffffffff;
+      partition->unscheduledEvents = 0;
+      partition->grantedTs = main->currentTs;
+      partition->nextTs = NEVER;
+      partition->barrierSense = m_barrierSense;
+      m_partitions.push_back (partition);
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      m_partitions[i]->uid = uid + i;
+      m_partitions[i]->outbox.resize (n);
+    }
+  AssignPartitions (n);
+  if (n > 1)
+    {
+      std::vector<Scheduler::Event> events;
+      while (!main->events->IsEmpty ())
+        {
+          events.push_back (main->events->RemoveNext ());
+        }
+      for (std::vector<Scheduler::Event>::const_iterator ev = events.begin (); ev != events.end (); ev++)
+        {
+          Partition *partition = GetPartition (ev->key.m_context);
+          partition->events->Insert (*ev);
+          if (partition != main)
+            {
+              main->unscheduledEvents--;
+              partition->unscheduledEvents++;
+            }
+        }
+    }
+
+  m_running = true;
+  if (n > 1)
+    {
+      Multithreading::Enable ();
+      for (uint32_t i = 1; i < n; i++)
+        {
+          m_partitions[i]->thread = Create<SystemThread> (MakeBoundCallback (&MultithreadedSimulatorImpl::RunThread,
+                                                                             m_partitions[i]));
+          m_partitions[i]->thread->Start ();
+        }
+    }
+  RunPartition (main);
+  for (uint32_t i = 1; i < n; i++)
+    {
+      m_partitions[i]->thread->Join ();
+      m_partitions[i]->thread = 0;
+    }
+  Multithreading::Disable ();
+  m_running = false;
+
+  // Gather what is left in the main partition
+  uint64_t lastTs = main->currentTs;
+  uint32_t lastUid = main->currentUid;
+  for (uint32_t i = 1; i < n; i++)
+    {
+      Partition *partition = m_partitions[i];
+      while (!partition->events->IsEmpty ())
+        {
+          main->events->Insert (partition->events->RemoveNext ());
+        }
+      main->unscheduledEvents += partition->unscheduledEvents;
+      uid = std::max (uid, partition->uid);
+      if (partition->currentTs > lastTs)
+        {
+          lastTs = partition->currentTs;
+          lastUid = partition->currentUid;
+        }
+      partition->events = 0;
+      delete partition;
+    }
+  m_partitions.resize (1);
+  main->uid = std::max (uid, main->uid);
+  main->outbox.clear ();
+  m_nodePartition.clear ();
+  main->currentTs = lastTs;
+  main->currentUid = lastUid;
+  main->currentContext = 0xffffffff;
+  main->grantedTs = NEVER;
+  if (m_stopTs != NEVER && (main->events->IsEmpty () || NextTs () >= m_stopTs))
+    {
+      // stopped: the clock stops at the stop time
+      main->currentTs = std::max (main->currentTs, (uint64_t)m_stopTs);
+      main->currentUid = 0;
+      m_stopTs = NEVER;
+    }
+
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  NS_ASSERT (!main->events->IsEmpty () || main->unscheduledEvents == 0);
+}
+
+void
+MultithreadedSimulatorImpl::RunOneEvent (void)
+{
+  ProcessOneEvent (m_partitions[0]);
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  if (!m_running)
+    {
+      return;
+    }
+  MultithreadedCriticalSection cs (m_stopLock);
+  m_stopTs = std::min ((uint64_t)m_stopTs, GetCurrentPartition ()->currentTs);
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &time)
+{
+  MultithreadedCriticalSection cs (m_stopLock);
+  m_stopTs = std::min<uint64_t> ((uint64_t)m_stopTs, GetCurrentPartition ()->currentTs + time.GetTimeStep ());
+}
+
+//
+// Schedule an event for a _relative_ time in the future.
+//
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  Partition *partition = GetCurrentPartition ();
+  Time tAbsolute = time + TimeStep (partition->currentTs);
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= TimeStep (partition->currentTs));
+  uint64_t ts = static_cast<uint64_t> (tAbsolute.GetTimeStep ());
+  uint32_t uid = partition->uid;
+  Insert (partition, ts, partition->currentContext, event);
+  return EventId (event, ts, partition->currentContext, uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+
+  Partition *partition = GetCurrentPartition ();
+  Partition *target = GetPartition (context);
+  uint64_t ts = partition->currentTs + time.GetTimeStep ();
+  if (target == partition)
+    {
+      Insert (partition, ts, context, event);
+      return;
+    }
+  if (ts < partition->grantedTs)
+    {
+      NS_FATAL_ERROR ("MultithreadedSimulatorImpl: event for node " << context << " at " << ts
+                                                                    << " within the lookahead of its partition");
+    }
+  RemoteEvent ev;
+  ev.ts = ts;
+  ev.context = context;
+  ev.impl = event;
+  partition->outbox[target->id].push_back (ev);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  Partition *partition = GetCurrentPartition ();
+  uint32_t uid = partition->uid;
+  Insert (partition, partition->currentTs, partition->currentContext, event);
+  return EventId (event, partition->currentTs, partition->currentContext, uid);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), GetCurrentPartition ()->currentTs, 0xffffffff, 2);
+  MultithreadedCriticalSection cs (m_destroyLock);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  return TimeStep (GetCurrentPartition ()->currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - GetCurrentPartition ()->currentTs);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      MultithreadedCriticalSection cs (m_destroyLock);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Partition *partition = GetPartition (id.GetContext ());
+  if (partition != GetCurrentPartition ())
+    {
+      NS_FATAL_ERROR ("MultithreadedSimulatorImpl: cannot remove an event of node " << id.GetContext ()
+                                                                                  << " from another partition");
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  partition->events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+
+  partition->unscheduledEvents--;
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0
+          || ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      MultithreadedCriticalSection cs (const_cast<SpinLock &> (m_destroyLock));
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  // the events of a context are in the partition which runs it
+  const Partition *partition = GetPartition (ev.GetContext ());
+  if (ev.PeekEventImpl () == 0
+      || ev.GetTs () < partition->currentTs
+      || (ev.GetTs () == partition->currentTs
+          && ev.GetUid () <= partition->currentUid)
+      || ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  // XXX: I am fairly certain other compilers use other non-standard
+  // post-fixes to indicate 64 bit constants.
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  return GetCurrentPartition ()->currentContext;
+}
+
+} // namespace ns3
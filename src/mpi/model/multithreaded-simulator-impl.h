@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-thread.h"
+#include "ns3/multithreading.h"
+#include "ns3/ptr.h"
+
+#include <list>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Parallel simulator implementation running the nodes in
+ * several threads of one process
+ *
+ * The nodes are divided into partitions, one per thread, and each
+ * partition has its own event list. The threads use the same
+ * conservative synchronization as the Allgather mode of
+ * DistributedSimulatorImpl: they all process the events earlier than
+ * the smallest next event time of the simulation plus the lookahead,
+ * the shortest time a frame takes through a point-to-point link
+ * between two partitions (delay plus transmission time of the
+ * smallest frame), then meet at a barrier before the next window.
+ *
+ * An event scheduled with ScheduleWithContext for a node of another
+ * partition, such as the reception of a packet at the far end of a
+ * point-to-point link, goes to a queue which only the sending thread
+ * writes and which the target thread drains at the barrier, so no
+ * lock is taken. The packet itself is handed over as it is, without
+ * serialization; the topology, routing state and everything else
+ * exist once, shared by all the threads.
+ *
+ * The nodes with different system ids (see Node::GetSystemId) are
+ * placed in different partitions, system id modulo the number of
+ * threads. When all the nodes have the same system id, the nodes are
+ * split in partitions of the same size by GraphPartitionHelper, with
+ * as few point-to-point links as possible between them. In both
+ * cases, the nodes sharing any other kind of channel are kept in the
+ * same partition.
+ *
+ * The simulation must not make other cross-partition interactions
+ * than those of the point-to-point links, and those links must have
+ * a non-zero delay or a DataRate attribute on their devices. Packet printing and checking (see
+ * Packet::EnablePrinting) are not supported. With more than one
+ * thread, the events of a partition run in the same order from one
+ * run to the next, but the global packet uids are allocated in
+ * whatever order the threads reach them.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual Time Next (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual void RunOneEvent (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+private:
+  /* An event for another partition, waiting for the next barrier */
+  struct RemoteEvent
+  {
+    uint64_t ts;
+    uint32_t context;
+    EventImpl *impl;
+  };
+
+  struct Partition
+  {
+    MultithreadedSimulatorImpl *simulator;
+    uint32_t id;
+    Ptr<Scheduler> events;
+    // the uids of partition id are id, id + n, id + 2n... past the
+    // uids allocated before the run, so they never collide
+    uint32_t uid;
+    uint32_t currentUid;
+    uint64_t currentTs;
+    uint32_t currentContext;
+    // number of events that have been inserted but not yet scheduled,
+    // not counting the "destroy" events; this is used for validation
+    int unscheduledEvents;
+    // end of the current time window
+    uint64_t grantedTs;
+    // time of the next event, published at the barrier
+    uint64_t nextTs;
+    // the events for each partition, written by this partition only
+    std::vector<std::vector<RemoteEvent> > outbox;
+    bool barrierSense;
+    Ptr<SystemThread> thread;
+  };
+
+  virtual void DoDispose (void);
+
+  /**
+   * Fill m_nodePartition for n partitions and compute m_lookAhead.
+   */
+  void AssignPartitions (uint32_t n);
+  /**
+   * \param context an event context
+   * \return the partition which runs the events of that context
+   */
+  Partition* GetPartition (uint32_t context) const;
+  /**
+   * \return the partition of the calling thread
+   */
+  Partition* GetCurrentPartition (void) const;
+
+  static void RunThread (Partition *partition);
+  void RunPartition (Partition *partition);
+  void Barrier (Partition *partition);
+  void ProcessOneEvent (Partition *partition);
+  void Insert (Partition *partition, uint64_t ts, uint32_t context, EventImpl *event);
+  uint64_t NextTs (void) const;
+
+  typedef std::list<EventId> DestroyEvents;
+
+  DestroyEvents m_destroyEvents;
+  SpinLock m_destroyLock;
+  ObjectFactory m_schedulerFactory;
+  uint32_t m_threadCount;
+
+  // m_partitions[0] runs in the main thread and holds all the
+  // events out of Run ()
+  std::vector<Partition *> m_partitions;
+  // partition of each node while running, empty otherwise
+  std::vector<uint32_t> m_nodePartition;
+  uint64_t m_lookAhead;
+  bool m_running;
+
+  // the events from this time on are not run
+  volatile uint64_t m_stopTs;
+  SpinLock m_stopLock;
+
+  volatile uint32_t m_barrierCount;
+  volatile bool m_barrierSense;
+
+  static __thread Partition *m_currentPartition;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/nstime.h"
+#include "ns3/mpi-interface.h"
+
+#include <vector>
+
+namespace ns3 {
+
+class DistributedSimulatorImplTestCase : public TestCase
+{
+public:
+  DistributedSimulatorImplTestCase ();
+  virtual void DoRun (void);
+private:
+  /**
+   * Run a few chains of events, stopping once in the middle, and
+   * record when each event runs.
+   */
+  void RunChains (std::string implementation);
+  void Step (uint32_t chain, uint32_t left);
+
+  std::vector<uint64_t> m_trace;
+};
+
+DistributedSimulatorImplTestCase::DistributedSimulatorImplTestCase ()
+  : TestCase ("Check that the distributed simulator runs on a single rank like the default one")
+{
+}
+
+void
+DistributedSimulatorImplTestCase::Step (uint32_t chain, uint32_t left)
+{
+  m_trace.push_back (Simulator::Now ().GetTimeStep () * 4 + chain);
+  if (left > 0)
+    {
+      Simulator::Schedule (MicroSeconds (100 + 37 * ((chain + left) % 5)),
+                           &DistributedSimulatorImplTestCase::Step, this, chain, left - 1);
+    }
+}
+
+void
+DistributedSimulatorImplTestCase::RunChains (std::string implementation)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (implementation));
+  m_trace.clear ();
+  for (uint32_t chain = 0; chain < 4; chain++)
+    {
+      Simulator::Schedule (MicroSeconds (10 * chain), &DistributedSimulatorImplTestCase::Step,
+                           this, chain, 20);
+    }
+  Simulator::Stop (MilliSeconds (1));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (Simulator::Now (), MilliSeconds (1), "Run () did not stop at the stop time");
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+DistributedSimulatorImplTestCase::DoRun (void)
+{
+  RunChains ("ns3::DefaultSimulatorImpl");
+  std::vector<uint64_t> expected = m_trace;
+  NS_TEST_ASSERT_MSG_EQ (expected.size (), 4 * 21, "Unexpected number of events");
+
+  const char *modes[] = { "Allgather", "NonBlocking" };
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Config::SetDefault ("ns3::DistributedSimulatorImpl::SynchronizationMode", StringValue (modes[i]));
+      MpiInterface::Enable (0, 0);
+      RunChains ("ns3::DistributedSimulatorImpl");
+      NS_TEST_EXPECT_MSG_EQ ((m_trace == expected), true, "Events differ in the " << modes[i] << " mode");
+    }
+  MpiInterface::Disable ();
+
+  Config::SetDefault ("ns3::DistributedSimulatorImpl::SynchronizationMode", StringValue ("Allgather"));
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+static class DistributedSimulatorImplTestSuite : public TestSuite
+{
+public:
+  DistributedSimulatorImplTestSuite ();
+} g_distributedSimulatorImplTestSuite;
+
+DistributedSimulatorImplTestSuite::DistributedSimulatorImplTestSuite ()
+  : TestSuite ("distributed-simulator-impl", UNIT)
+{
+  AddTestCase (new DistributedSimulatorImplTestCase ());
+}
+
+} // namespace ns3
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/graph-partition-helper.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+class GraphPartitionCliquesTestCase : public TestCase
+{
+public:
+  GraphPartitionCliquesTestCase ();
+  virtual void DoRun (void);
+};
+
+GraphPartitionCliquesTestCase::GraphPartitionCliquesTestCase ()
+  : TestCase ("Check that two cliques joined by one edge are separated")
+{
+}
+
+void
+GraphPartitionCliquesTestCase::DoRun (void)
+{
+  // vertices 0 to 7 and 8 to 15, in interleaved order
+  GraphPartitionHelper partitioner;
+  for (uint32_t a = 0; a < 16; a++)
+    {
+      for (uint32_t b = a + 1; b < 16; b++)
+        {
+          if (a % 2 == b % 2)
+            {
+              partitioner.AddEdge (a, b);
+            }
+        }
+    }
+  partitioner.AddEdge (0, 1);
+  partitioner.Partition (2);
+  NS_TEST_ASSERT_MSG_EQ (partitioner.GetNCutEdges (), 1, "Unexpected cut");
+  NS_TEST_ASSERT_MSG_EQ (partitioner.GetImbalance (), 1.0, "Unexpected imbalance");
+  for (uint32_t v = 2; v < 16; v++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (partitioner.GetPartition (v), partitioner.GetPartition (v % 2),
+                             "Vertex " << v << " away from its clique");
+    }
+}
+
+class GraphPartitionGridTestCase : public TestCase
+{
+public:
+  GraphPartitionGridTestCase ();
+  virtual void DoRun (void);
+};
+
+GraphPartitionGridTestCase::GraphPartitionGridTestCase ()
+  : TestCase ("Check the partition of a weighted grid")
+{
+}
+
+void
+GraphPartitionGridTestCase::DoRun (void)
+{
+  // A 32x32 grid whose left half is twice as heavy
+  const uint32_t SIDE = 32;
+  GraphPartitionHelper partitioner;
+  for (uint32_t y = 0; y < SIDE; y++)
+    {
+      for (uint32_t x = 0; x < SIDE; x++)
+        {
+          partitioner.AddVertex (x < SIDE / 2 ? 2 : 1);
+        }
+    }
+  for (uint32_t y = 0; y < SIDE; y++)
+    {
+      for (uint32_t x = 0; x < SIDE; x++)
+        {
+          if (x + 1 < SIDE)
+            {
+              partitioner.AddEdge (y * SIDE + x, y * SIDE + x + 1);
+            }
+          if (y + 1 < SIDE)
+            {
+              partitioner.AddEdge (y * SIDE + x, (y + 1) * SIDE + x);
+            }
+        }
+    }
+  partitioner.Partition (4);
+  NS_TEST_ASSERT_MSG_EQ_TOL (partitioner.GetImbalance (), 1.0, 0.03, "Parts out of balance");
+  // 4 straight cuts take 96 edges, round-robin about 1984
+  NS_TEST_ASSERT_MSG_LT (partitioner.GetNCutEdges (), 160, "Cut too large");
+  NS_TEST_ASSERT_MSG_EQ (partitioner.GetCutSize (), partitioner.GetNCutEdges (), "Unexpected cut weight");
+
+  NodeContainer nodes = partitioner.Create ();
+  NS_TEST_ASSERT_MSG_EQ (nodes.GetN (), SIDE * SIDE, "Unexpected number of nodes");
+  for (uint32_t v = 0; v < nodes.GetN (); v++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (nodes.Get (v)->GetSystemId (), partitioner.GetPartition (v),
+                             "Node " << v << " with the wrong system id");
+    }
+  Simulator::Destroy ();
+}
+
+static class GraphPartitionHelperTestSuite : public TestSuite
+{
+public:
+  GraphPartitionHelperTestSuite ();
+} g_graphPartitionHelperTestSuite;
+
+GraphPartitionHelperTestSuite::GraphPartitionHelperTestSuite ()
+  : TestSuite ("graph-partition-helper", UNIT)
+{
+  AddTestCase (new GraphPartitionCliquesTestCase ());
+  AddTestCase (new GraphPartitionGridTestCase ());
+}
+
+} // namespace ns3
@@ -0,0 +1,237 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/node.h"
+#include "ns3/channel.h"
+#include "ns3/simple-channel.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/error-model.h"
+#include "ns3/multithreading.h"
+
+#include <vector>
+
+namespace ns3 {
+
+// A point-to-point link, as far as the partitioning can tell
+class TestLinkChannel : public Channel
+{
+public:
+  static TypeId GetTypeId (void);
+  void Attach (Ptr<NetDevice> a, Ptr<NetDevice> b);
+  virtual uint32_t GetNDevices (void) const;
+  virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
+private:
+  Ptr<NetDevice> m_devices[2];
+  Time m_delay;
+};
+
+TypeId
+TestLinkChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TestLinkChannel")
+    .SetParent<Channel> ()
+    .AddConstructor<TestLinkChannel> ()
+    .AddAttribute ("Delay", "Transmission delay through the channel",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&TestLinkChannel::m_delay),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+void
+TestLinkChannel::Attach (Ptr<NetDevice> a, Ptr<NetDevice> b)
+{
+  m_devices[0] = a;
+  m_devices[1] = b;
+}
+
+uint32_t
+TestLinkChannel::GetNDevices (void) const
+{
+  return 2;
+}
+
+Ptr<NetDevice>
+TestLinkChannel::GetDevice (uint32_t i) const
+{
+  return m_devices[i];
+}
+
+class TestLinkNetDevice : public SimpleNetDevice
+{
+public:
+  void SetLinkChannel (Ptr<Channel> channel)
+  {
+    m_channel = channel;
+  }
+  virtual Ptr<Channel> GetChannel (void) const
+  {
+    return m_channel;
+  }
+  virtual bool IsPointToPoint (void) const
+  {
+    return true;
+  }
+  virtual void DoDispose (void)
+  {
+    m_channel = 0;
+    SimpleNetDevice::DoDispose ();
+  }
+private:
+  Ptr<Channel> m_channel;
+};
+
+class MultithreadedSimulatorImplTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorImplTestCase ();
+  virtual void DoRun (void);
+private:
+  /**
+   * Pass tokens back and forth along a chain of nodes and record when
+   * each node sees them.
+   */
+  void RunChain (std::string implementation, bool systemIds);
+  void Hop (uint32_t node, bool forward);
+  void Tick (uint32_t node);
+
+  static const uint32_t NODES = 4;
+  std::vector<uint64_t> m_trace[NODES];
+  bool m_contextOk;
+  bool m_multithreaded;
+};
+
+MultithreadedSimulatorImplTestCase::MultithreadedSimulatorImplTestCase ()
+  : TestCase ("Check that the multithreaded simulator runs the events of each node like the default one")
+{
+}
+
+void
+MultithreadedSimulatorImplTestCase::Hop (uint32_t node, bool forward)
+{
+  m_trace[node].push_back (Simulator::Now ().GetTimeStep ());
+  m_contextOk = m_contextOk && Simulator::GetContext () == node;
+  m_multithreaded = m_multithreaded || Multithreading::IsEnabled ();
+  if ((forward && node == NODES - 1) || (!forward && node == 0))
+    {
+      forward = !forward;
+    }
+  uint32_t next = forward ? node + 1 : node - 1;
+  Simulator::ScheduleWithContext (next, MilliSeconds (1), &MultithreadedSimulatorImplTestCase::Hop,
+                                  this, next, forward);
+  Simulator::Schedule (MicroSeconds (300), &MultithreadedSimulatorImplTestCase::Tick, this, node);
+}
+
+void
+MultithreadedSimulatorImplTestCase::Tick (uint32_t node)
+{
+  m_trace[node].push_back (Simulator::Now ().GetTimeStep () + 1);
+  m_contextOk = m_contextOk && Simulator::GetContext () == node;
+}
+
+void
+MultithreadedSimulatorImplTestCase::RunChain (std::string implementation, bool systemIds)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (implementation));
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      m_trace[i].clear ();
+    }
+  m_contextOk = true;
+  m_multithreaded = false;
+
+  std::vector<Ptr<Node> > nodes;
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      nodes.push_back (CreateObject<Node> (systemIds ? i % 2 : 0));
+    }
+  for (uint32_t i = 0; i + 1 < NODES; i++)
+    {
+      Ptr<TestLinkChannel> channel = CreateObject<TestLinkChannel> ();
+      Ptr<TestLinkNetDevice> a = CreateObject<TestLinkNetDevice> ();
+      Ptr<TestLinkNetDevice> b = CreateObject<TestLinkNetDevice> ();
+      nodes[i]->AddDevice (a);
+      nodes[i + 1]->AddDevice (b);
+      a->SetLinkChannel (channel);
+      b->SetLinkChannel (channel);
+      channel->Attach (a, b);
+    }
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      Simulator::ScheduleWithContext (i, MicroSeconds (10 * i), &MultithreadedSimulatorImplTestCase::Hop,
+                                      this, i, i % 2 == 0);
+    }
+
+  Simulator::Stop (MilliSeconds (50));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (Simulator::Now (), MilliSeconds (50), "Run () did not stop at the stop time");
+  Simulator::Stop (MilliSeconds (25));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (Simulator::Now (), MilliSeconds (75), "The second Run () did not stop at the stop time");
+  Simulator::Destroy ();
+}
+
+void
+MultithreadedSimulatorImplTestCase::DoRun (void)
+{
+  RunChain ("ns3::DefaultSimulatorImpl", false);
+  std::vector<uint64_t> expected[NODES];
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      expected[i] = m_trace[i];
+    }
+  NS_TEST_ASSERT_MSG_EQ (expected[0].empty (), false, "No event run");
+
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::ThreadCount", UintegerValue (2));
+  for (uint32_t systemIds = 0; systemIds < 2; systemIds++)
+    {
+      RunChain ("ns3::MultithreadedSimulatorImpl", systemIds);
+      NS_TEST_EXPECT_MSG_EQ (m_multithreaded, true, "The events did not run in several threads");
+      NS_TEST_EXPECT_MSG_EQ (m_contextOk, true, "Event run with the wrong context");
+      for (uint32_t i = 0; i < NODES; i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ ((m_trace[i] == expected[i]), true, "Events of node " << i << " differ");
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (Multithreading::IsEnabled (), false, "Still multithreaded after Run ()");
+
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::ThreadCount", UintegerValue (0));
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+static class MultithreadedSimulatorImplTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorImplTestSuite ();
+} g_multithreadedSimulatorImplTestSuite;
+
+MultithreadedSimulatorImplTestSuite::MultithreadedSimulatorImplTestSuite ()
+  : TestSuite ("multithreaded-simulator-impl", UNIT)
+{
+  AddTestCase (new MultithreadedSimulatorImplTestCase ());
+}
+
+} // namespace ns3
@@ -17,6 +17,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <fstream>
 
@@ -28,6 +29,7 @@
 #include "ns3/names.h"
 #include "ns3/net-device.h"
 #include "ns3/pcap-file-wrapper.h"
+#include "ns3/queue.h"
 
 #include "trace-helper.h"
 
@@ -390,6 +392,130 @@ AsciiTraceHelper::DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> stream
   *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
 }
 
+/**
+ * The trace sinks of one device hooked by BinaryTraceHelper::HookDevice.
+ * Each sink is owned by the callbacks of the trace sources it is
+ * connected to, and owns the file it writes to.
+ */
+class BinaryTraceSink : public SimpleRefCount<BinaryTraceSink>
+{
+public:
+  BinaryTraceSink (Ptr<BinaryTraceFile> file, Ptr<NetDevice> device,
+                   Ptr<Queue> queue, uint32_t linkHeaderSize);
+
+  void Enqueue (Ptr<const Packet> p);
+  void Dequeue (Ptr<const Packet> p);
+  void Drop (Ptr<const Packet> p);
+  void Receive (Ptr<const Packet> p);
+
+private:
+  void Write (uint8_t type, Ptr<const Packet> p, uint32_t offset);
+
+  Ptr<BinaryTraceFile> m_file;
+  // a raw pointer: the queue owns the callbacks which own this sink
+  Queue *m_queue;
+  uint32_t m_node;
+  uint32_t m_device;
+  uint32_t m_linkHeaderSize;
+};
+
+BinaryTraceSink::BinaryTraceSink (Ptr<BinaryTraceFile> file, Ptr<NetDevice> device,
+                                  Ptr<Queue> queue, uint32_t linkHeaderSize)
+  : m_file (file),
+    m_queue (PeekPointer (queue)),
+    m_node (device->GetNode ()->GetId ()),
+    m_device (device->GetIfIndex ()),
+    m_linkHeaderSize (linkHeaderSize)
+{
+}
+
+void
+BinaryTraceSink::Write (uint8_t type, Ptr<const Packet> p, uint32_t offset)
+{
+  BinaryTraceRecord record;
+  memset (&record, 0, sizeof (record));
+  record.type = type;
+  record.time = Simulator::Now ().GetNanoSeconds ();
+  record.node = m_node;
+  record.device = m_device;
+  record.size = p->GetSize ();
+  record.queueLength = m_queue->GetNPackets ();
+  BinaryTraceFile::ParseIpv4 (p, offset, record);
+  m_file->Write (record);
+}
+
+void
+BinaryTraceSink::Enqueue (Ptr<const Packet> p)
+{
+  Write ('+', p, m_linkHeaderSize);
+}
+
+void
+BinaryTraceSink::Dequeue (Ptr<const Packet> p)
+{
+  Write ('-', p, m_linkHeaderSize);
+}
+
+void
+BinaryTraceSink::Drop (Ptr<const Packet> p)
+{
+  Write ('d', p, m_linkHeaderSize);
+}
+
+void
+BinaryTraceSink::Receive (Ptr<const Packet> p)
+{
+  Write ('r', p, 0);
+}
+
+BinaryTraceHelper::BinaryTraceHelper ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+BinaryTraceHelper::~BinaryTraceHelper ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+Ptr<BinaryTraceFile>
+BinaryTraceHelper::CreateFile (std::string filename, uint32_t bufferSize)
+{
+  NS_LOG_FUNCTION (filename << bufferSize);
+
+  Ptr<BinaryTraceFile> file = Create<BinaryTraceFile> ();
+  file->Open (filename, std::ios::out, bufferSize);
+  NS_ABORT_MSG_IF (file->Fail (), "Unable to Open " << filename << " for writing");
+  //
+  // Unlike the ascii traces, the records sit in the write buffer until it
+  // fills up. Do not count on the release of the last reference to write
+  // the tail of the trace: the devices may well outlive the simulation.
+  //
+  Simulator::ScheduleDestroy (&BinaryTraceFile::Close, file);
+  return file;
+}
+
+void
+BinaryTraceHelper::HookDevice (Ptr<BinaryTraceFile> file, Ptr<NetDevice> device, Ptr<Queue> queue,
+                               uint32_t linkHeaderSize, std::string rxTraceName)
+{
+  NS_LOG_FUNCTION (file << device << queue << linkHeaderSize << rxTraceName);
+
+  Ptr<BinaryTraceSink> sink = Create<BinaryTraceSink> (file, device, queue, linkHeaderSize);
+  bool __attribute__ ((unused)) result =
+    queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&BinaryTraceSink::Enqueue, sink));
+  NS_ASSERT_MSG (result == true, "BinaryTraceHelper::HookDevice():  Unable to hook \"Enqueue\"");
+  result = queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&BinaryTraceSink::Dequeue, sink));
+  NS_ASSERT_MSG (result == true, "BinaryTraceHelper::HookDevice():  Unable to hook \"Dequeue\"");
+  result = queue->TraceConnectWithoutContext ("Drop", MakeCallback (&BinaryTraceSink::Drop, sink));
+  NS_ASSERT_MSG (result == true, "BinaryTraceHelper::HookDevice():  Unable to hook \"Drop\"");
+  result = device->TraceConnectWithoutContext (rxTraceName, MakeCallback (&BinaryTraceSink::Receive, sink));
+  NS_ASSERT_MSG (result == true, "BinaryTraceHelper::HookDevice():  Unable to hook \""
+                 << rxTraceName << "\"");
+  // Not every device has a PhyRxDrop trace source
+  device->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&BinaryTraceSink::Drop, sink));
+}
+
 void 
 PcapHelperForDevice::EnablePcap (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
 {
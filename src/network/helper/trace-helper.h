@@ -25,9 +25,12 @@
 #include "ns3/simulator.h"
 #include "ns3/pcap-file-wrapper.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/binary-trace-file.h"
 
 namespace ns3 {
 
+class Queue;
+
 /**
  * \brief Manage pcap files for device models
  *
@@ -316,6 +319,60 @@ AsciiTraceHelper::HookDefaultReceiveSinkWithContext (
                  << tracename << "\"");
 }
 
+/**
+ * \brief Manage binary trace files for device models
+ *
+ * The binary traces record the same enqueue, dequeue, drop and receive
+ * events as the ascii traces, but as fixed-size BinaryTraceRecord
+ * written through a large buffer instead of a pretty-printed packet,
+ * which makes them much cheaper to write and to read back on the large
+ * simulations for which only the per-flow statistics are of interest.
+ */
+class BinaryTraceHelper
+{
+public:
+  /**
+   * @brief Create a binary trace helper.
+   */
+  BinaryTraceHelper ();
+
+  /**
+   * @brief Destroy a binary trace helper.
+   */
+  ~BinaryTraceHelper ();
+
+  /**
+   * @brief Create and open for writing a binary trace file.
+   *
+   * The file is flushed and closed by Simulator::Destroy, or earlier if
+   * the caller closes it explicitly.
+   *
+   * @param filename the name of the file
+   * @param bufferSize size of the write buffer, in bytes
+   */
+  Ptr<BinaryTraceFile> CreateFile (std::string filename,
+                                   uint32_t bufferSize = BinaryTraceFile::BUFFER_SIZE_DEFAULT);
+
+  /**
+   * @brief Hook the trace sources of a device and of its transmit queue
+   * to a binary trace file.
+   *
+   * The Enqueue, Dequeue and Drop traces of the queue and the PhyRxDrop
+   * trace of the device, if any, are recorded as the '+', '-' and 'd'
+   * events, and the receive trace of the device as the 'r' event.
+   *
+   * @param file the file to write to
+   * @param device the device to trace
+   * @param queue the transmit queue of the device
+   * @param linkHeaderSize size of the link-layer header found in front of
+   *        the IPv4 header of the packets in the queue
+   * @param rxTraceName the receive trace source of the device, which must
+   *        provide the packets without their link-layer header
+   */
+  void HookDevice (Ptr<BinaryTraceFile> file, Ptr<NetDevice> device, Ptr<Queue> queue,
+                   uint32_t linkHeaderSize, std::string rxTraceName = "MacRx");
+};
+
 /**
  * \brief Base class providing common user-level pcap operations for helpers
  * representing net devices.
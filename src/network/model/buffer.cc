@@ -45,8 +45,23 @@ static struct Zeroes
 
 namespace ns3 {
 
+/* Room left for trailers at the end of the pooled blocks */
+static const uint32_t TAIL_ROOM = 16;
+#ifdef BUFFER_FREE_LIST
+/* Maximum number of blocks in the free list */
+static const uint32_t FREE_LIST_SIZE = 4096;
+#endif
+
+/* How much of the free space of a new block to leave in front of the
+ * data, so that the next headers are added in place */
+static inline uint32_t
+GetHeadroom (uint32_t freeSpace)
+{
+  return freeSpace > TAIL_ROOM ? freeSpace - TAIL_ROOM : 0;
+}
+
 
-uint32_t Buffer::g_recommendedStart = 0;
+__thread uint32_t Buffer::g_recommendedStart = 0;
 #ifdef BUFFER_FREE_LIST
 /* The following macros are pretty evil but they are needed to allow us to
  * keep track of 3 possible states for the g_freeList variable:
@@ -64,6 +79,9 @@ uint32_t Buffer::g_recommendedStart = 0;
  * which the compiler assigns to zero-memory which is initialized to _zero_
  * before the constructors run so this ensures perfect handling of crazy 
  * constructor orderings.
+ * The static destructor releases the free list of the main thread; the
+ * other threads of a multithreaded run leave theirs, at most
+ * FREE_LIST_SIZE blocks each, behind when they exit.
  */
 #define MAGIC_DESTROYED (~(long) 0)
 #define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
@@ -71,8 +89,8 @@ uint32_t Buffer::g_recommendedStart = 0;
 #define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
 #define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
 #define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
+__thread uint32_t Buffer::g_pooledSize = 0;
+__thread Buffer::FreeList *Buffer::g_freeList = 0;
 struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
 
 Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
@@ -94,11 +112,11 @@ Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_ASSERT (data->m_count == 0);
   NS_ASSERT (!IS_UNINITIALIZED (g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
+  /* feed into free list, unless the block was made for an unusually
+   * large packet or before the pooled size grew */
+  if (data->m_size != g_pooledSize ||
       IS_DESTROYED (g_freeList) ||
-      g_freeList->size () > 1000)
+      g_freeList->size () >= FREE_LIST_SIZE)
     {
       Buffer::Deallocate (data);
     }
@@ -112,18 +130,24 @@ Buffer::Recycle (struct Buffer::Data *data)
 Buffer::Data *
 Buffer::Create (uint32_t dataSize)
 {
-  /* try to find a buffer correctly sized. */
   if (IS_UNINITIALIZED (g_freeList))
     {
       g_freeList = new Buffer::FreeList ();
     }
-  else if (IS_INITIALIZED (g_freeList))
+  /* g_recommendedStart only grows, and so does the pooled size */
+  g_pooledSize = std::max (g_pooledSize, (g_recommendedStart + TAIL_ROOM + 15) & ~15U);
+  if (dataSize > g_pooledSize)
+    {
+      return Buffer::Allocate (dataSize);
+    }
+  /* try to find a buffer correctly sized. */
+  if (IS_INITIALIZED (g_freeList))
     {
       while (!g_freeList->empty ()) 
         {
           struct Buffer::Data *data = g_freeList->back ();
           g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
+          if (data->m_size == g_pooledSize) 
             {
               data->m_count = 1;
               return data;
@@ -131,7 +155,7 @@ Buffer::Create (uint32_t dataSize)
           Buffer::Deallocate (data);
         }
     }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
+  struct Buffer::Data *data = Buffer::Allocate (g_pooledSize);
   NS_ASSERT (data->m_count == 1);
   return data;
 }
@@ -251,13 +275,12 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (Multithreading::DecrementRefCount (m_data->m_count))
         {
           Recycle (m_data);
         }
       m_data = o.m_data;
-      m_data->m_count++;
+      Multithreading::IncrementRefCount (m_data->m_count);
     }
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
   m_maxZeroAreaStart = o.m_maxZeroAreaStart;
@@ -274,8 +297,7 @@ Buffer::~Buffer ()
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (Multithreading::DecrementRefCount (m_data->m_count))
     {
       Recycle (m_data);
     }
@@ -316,15 +338,15 @@ Buffer::AddAtStart (uint32_t start)
     {
       uint32_t newSize = GetInternalSize () + start;
       struct Buffer::Data *newData = Buffer::Create (newSize);
-      memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
+      uint32_t headroom = GetHeadroom (newData->m_size - newSize);
+      memcpy (newData->m_data + headroom + start, m_data->m_data + m_start, GetInternalSize ());
+      if (Multithreading::DecrementRefCount (m_data->m_count))
         {
           Buffer::Recycle (m_data);
         }
       m_data = newData;
 
-      int32_t delta = start - m_start;
+      int32_t delta = headroom + start - m_start;
       m_start += delta;
       m_zeroAreaStart += delta;
       m_zeroAreaEnd += delta;
@@ -369,15 +391,15 @@ Buffer::AddAtEnd (uint32_t end)
     {
       uint32_t newSize = GetInternalSize () + end;
       struct Buffer::Data *newData = Buffer::Create (newSize);
-      memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      uint32_t headroom = GetHeadroom (newData->m_size - newSize);
+      memcpy (newData->m_data + headroom, m_data->m_data + m_start, GetInternalSize ());
+      if (Multithreading::DecrementRefCount (m_data->m_count))
         {
           Buffer::Recycle (m_data);
         }
       m_data = newData;
 
-      int32_t delta = -m_start;
+      int32_t delta = headroom - m_start;
       m_zeroAreaStart += delta;
       m_zeroAreaEnd += delta;
       m_end += delta;
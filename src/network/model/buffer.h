@@ -24,8 +24,9 @@
 #include <vector>
 #include <ostream>
 #include "ns3/assert.h"
+#include "ns3/multithreading.h"
 
-#define noBUFFER_FREE_LIST 1
+#define BUFFER_FREE_LIST 1
 
 namespace ns3 {
 
@@ -400,6 +401,13 @@ private:
    */
   inline uint32_t GetSize (void) const;
 
+  /**
+   * \return true if all the bytes of this buffer are "virtual zero
+   * data", that is, no header or data byte was ever written in them
+   * and no memory was allocated to store them.
+   */
+  inline bool IsVirtual (void) const;
+
   /**
    * \return a pointer to the start of the internal 
    * byte buffer.
@@ -590,9 +598,9 @@ private:
   /**
    * location in a newly-allocated buffer where you should start
    * writing data. i.e., m_start should be initialized to this 
-   * value.
+   * value. Each thread keeps its own.
    */
-  static uint32_t g_recommendedStart;
+  static __thread uint32_t g_recommendedStart;
 
   /* offset to the start of the virtual zero area from the start 
    * of m_data->m_data
@@ -617,8 +625,12 @@ private:
   {
     ~LocalStaticDestructor ();
   };
-  static uint32_t g_maxSize;
-  static FreeList *g_freeList;
+  /* size of the blocks kept in the free list: room for the
+   * headers of a typical packet and a few bytes of trailers.
+   * Each thread has its own free list, blocks released by a
+   * thread go to its list whichever thread allocated them */
+  static __thread uint32_t g_pooledSize;
+  static __thread FreeList *g_freeList;
   static struct LocalStaticDestructor g_localStaticDestructor;
 #endif
 };
@@ -859,7 +871,7 @@ Buffer::Buffer (Buffer const&o)
     m_start (o.m_start),
     m_end (o.m_end)
 {
-  m_data->m_count++;
+  Multithreading::IncrementRefCount (m_data->m_count);
   NS_ASSERT (CheckInternalState ());
 }
 
@@ -869,6 +881,12 @@ Buffer::GetSize (void) const
   return m_end - m_start;
 }
 
+bool
+Buffer::IsVirtual (void) const
+{
+  return m_start == m_zeroAreaStart && m_zeroAreaEnd == m_end;
+}
+
 Buffer::Iterator 
 Buffer::Begin (void) const
 {
@@ -19,6 +19,7 @@
  */
 #include "byte-tag-list.h"
 #include "ns3/log.h"
+#include "ns3/multithreading.h"
 #include <vector>
 #include <string.h>
 
@@ -38,22 +39,33 @@ struct ByteTagListData {
 };
 
 #ifdef USE_FREE_LIST
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
+typedef std::vector<struct ByteTagListData *> ByteTagListDataFreeList;
+/* Each thread has its own free list, created on first use. The static
+ * destructor releases the one of the main thread; the other threads of
+ * a multithreaded run leave theirs behind when they exit. */
+static __thread ByteTagListDataFreeList *g_freeList = 0;
+static __thread uint32_t g_maxSize = 0;
+static bool g_freeListDestroyed = false;
+
+static struct ByteTagListDataFreeListDestructor
 {
-public:
-  ~ByteTagListDataFreeList ();
-} g_freeList;
-static uint32_t g_maxSize = 0;
-
-ByteTagListDataFreeList::~ByteTagListDataFreeList ()
-{
-  for (ByteTagListDataFreeList::iterator i = begin ();
-       i != end (); i++)
-    {
-      uint8_t *buffer = (uint8_t *)(*i);
-      delete [] buffer;
-    }
-}
+  ~ByteTagListDataFreeListDestructor ()
+  {
+    if (g_freeList == 0)
+      {
+        return;
+      }
+    for (ByteTagListDataFreeList::iterator i = g_freeList->begin ();
+         i != g_freeList->end (); i++)
+      {
+        uint8_t *buffer = (uint8_t *)(*i);
+        delete [] buffer;
+      }
+    delete g_freeList;
+    g_freeList = 0;
+    g_freeListDestroyed = true;
+  }
+} g_freeListDestructor;
 #endif /* USE_FREE_LIST */
 
 ByteTagList::Iterator::Item::Item (TagBuffer buf_)
@@ -129,7 +141,7 @@ ByteTagList::ByteTagList (const ByteTagList &o)
   NS_LOG_FUNCTION (this << &o);
   if (m_data != 0)
     {
-      m_data->count++;
+      Multithreading::IncrementRefCount (m_data->count);
     }
 }
 ByteTagList &
@@ -146,7 +158,7 @@ ByteTagList::operator = (const ByteTagList &o)
   m_used = o.m_used;
   if (m_data != 0)
     {
-      m_data->count++;
+      Multithreading::IncrementRefCount (m_data->count);
     }
   return *this;
 }
@@ -339,10 +351,10 @@ struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
+  while (g_freeList != 0 && !g_freeList->empty ())
     {
-      struct ByteTagListData *data = g_freeList.back ();
-      g_freeList.pop_back ();
+      struct ByteTagListData *data = g_freeList->back ();
+      g_freeList->pop_back ();
       NS_ASSERT (data != 0);
       if (data->size >= size)
         {
@@ -370,10 +382,14 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
       return;
     }
   g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
+  if (Multithreading::DecrementRefCount (data->count))
     {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
+      if (g_freeList == 0 && !g_freeListDestroyed)
+        {
+          g_freeList = new ByteTagListDataFreeList ();
+        }
+      if (g_freeList == 0 ||
+          g_freeList->size () > FREE_LIST_SIZE ||
           data->size < g_maxSize)
         {
           uint8_t *buffer = (uint8_t *)data;
@@ -381,7 +397,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
         }
       else
         {
-          g_freeList.push_back (data);
+          g_freeList->push_back (data);
         }
     }
 }
@@ -408,8 +424,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (Multithreading::DecrementRefCount (data->count))
     {
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
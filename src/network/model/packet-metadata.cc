@@ -34,9 +34,14 @@ namespace ns3 {
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
-uint32_t PacketMetadata::m_maxSize = 0;
+__thread uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+__thread PacketMetadata::DataFreeList *PacketMetadata::m_freeList = 0;
+struct PacketMetadata::LocalStaticDestructor PacketMetadata::m_localStaticDestructor;
+/* Set once the free list of the main thread is destroyed, the packets
+ * destroyed later go straight back to the heap. The other threads of a
+ * multithreaded run leave their free lists behind when they exit. */
+static bool g_freeListDestroyed = false;
 
 PacketMetadata::DataFreeList::~DataFreeList ()
 {
@@ -44,7 +49,14 @@ PacketMetadata::DataFreeList::~DataFreeList ()
     {
       PacketMetadata::Deallocate (*i);
     }
+}
+
+PacketMetadata::LocalStaticDestructor::~LocalStaticDestructor ()
+{
+  delete PacketMetadata::m_freeList;
+  PacketMetadata::m_freeList = 0;
   PacketMetadata::m_enable = false;
+  g_freeListDestroyed = true;
 }
 
 void 
@@ -73,8 +85,7 @@ PacketMetadata::ReserveCopy (uint32_t size)
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (Multithreading::DecrementRefCount (m_data->m_count))
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -570,10 +581,10 @@ PacketMetadata::Create (uint32_t size)
     {
       m_maxSize = size;
     }
-  while (!m_freeList.empty ()) 
+  while (m_freeList != 0 && !m_freeList->empty ()) 
     {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
+      struct PacketMetadata::Data *data = m_freeList->back ();
+      m_freeList->pop_back ();
       if (data->m_size >= size) 
         {
           NS_LOG_LOGIC ("create found size="<<data->m_size);
@@ -590,21 +601,26 @@ PacketMetadata::Create (uint32_t size)
 void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
-  if (!m_enable)
+  // Even without metadata, every packet holds a small Data block
+  if (g_freeListDestroyed)
     {
       PacketMetadata::Deallocate (data);
       return;
     } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
+  if (m_freeList == 0)
+    {
+      m_freeList = new DataFreeList ();
+    }
+  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList->size ());
   NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
+  if (m_freeList->size () > 1000 ||
       data->m_size < m_maxSize) 
     {
       PacketMetadata::Deallocate (data);
     } 
   else 
     {
-      m_freeList.push_back (data);
+      m_freeList->push_back (data);
     }
 }
 
@@ -24,6 +24,7 @@
 #include <vector>
 #include "ns3/callback.h"
 #include "ns3/assert.h"
+#include "ns3/multithreading.h"
 #include "ns3/type-id.h"
 #include "buffer.h"
 
@@ -289,8 +290,13 @@ private:
 public:
     ~DataFreeList ();
   };
+  struct LocalStaticDestructor
+  {
+    ~LocalStaticDestructor ();
+  };
 
   friend DataFreeList::~DataFreeList ();
+  friend LocalStaticDestructor::~LocalStaticDestructor ();
   friend class ItemIterator;
 
   PacketMetadata ();
@@ -327,7 +333,9 @@ public:
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList;
+  // each thread has its own free list, created on first use
+  static __thread DataFreeList *m_freeList;
+  static struct LocalStaticDestructor m_localStaticDestructor;
   static bool m_enable;
   static bool m_enableChecking;
 
@@ -336,7 +344,7 @@ public:
   // middle of a simulation, which isn't allowed.
   static bool m_metadataSkipped;
 
-  static uint32_t m_maxSize;
+  static __thread uint32_t m_maxSize;
   static uint16_t m_chunkUid;
 
   struct Data *m_data;
@@ -376,7 +384,7 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_packetUid (o.m_packetUid)
 {
   NS_ASSERT (m_data != 0);
-  m_data->m_count++;
+  Multithreading::IncrementRefCount (m_data->m_count);
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -385,14 +393,13 @@ PacketMetadata::operator = (PacketMetadata const& o)
     {
       // not self assignment
       NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (Multithreading::DecrementRefCount (m_data->m_count))
         {
           PacketMetadata::Recycle (m_data);
         }
       m_data = o.m_data;
       NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      Multithreading::IncrementRefCount (m_data->m_count);
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
@@ -403,8 +410,7 @@ PacketMetadata::operator = (PacketMetadata const& o)
 PacketMetadata::~PacketMetadata ()
 {
   NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (Multithreading::DecrementRefCount (m_data->m_count))
     {
       PacketMetadata::Recycle (m_data);
     }
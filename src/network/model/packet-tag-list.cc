@@ -24,14 +24,17 @@
 #include "ns3/log.h"
 #include <string.h>
 
+#define USE_FREE_LIST 1
+#define FREE_LIST_SIZE 4096
+
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
 #ifdef USE_FREE_LIST
 
-struct PacketTagList::TagData *PacketTagList::g_free = 0;
-uint32_t PacketTagList::g_nfree = 0;
+__thread struct PacketTagList::TagData *PacketTagList::g_free = 0;
+__thread uint32_t PacketTagList::g_nfree = 0;
 
 struct PacketTagList::TagData *
 PacketTagList::AllocData (void) const
@@ -41,7 +44,7 @@ PacketTagList::AllocData (void) const
   if (g_free != 0) 
     {
       retval = g_free;
-      g_free = g_free->m_next;
+      g_free = g_free->next;
       g_nfree--;
     } 
   else 
@@ -55,7 +58,7 @@ void
 PacketTagList::FreeData (struct TagData *data) const
 {
   NS_LOG_FUNCTION (g_nfree << data);
-  if (g_nfree > 1000) 
+  if (g_nfree >= FREE_LIST_SIZE)
     {
       delete data;
       return;
@@ -23,6 +23,7 @@
 #include <stdint.h>
 #include <ostream>
 #include "ns3/type-id.h"
+#include "ns3/multithreading.h"
 
 namespace ns3 {
 
@@ -64,8 +65,9 @@ private:
   struct PacketTagList::TagData *AllocData (void) const;
   void FreeData (struct TagData *data) const;
 
-  static struct PacketTagList::TagData *g_free;
-  static uint32_t g_nfree;
+  // each thread has its own free list
+  static __thread struct PacketTagList::TagData *g_free;
+  static __thread uint32_t g_nfree;
 
   struct TagData *m_next;
 };
@@ -88,7 +90,7 @@ PacketTagList::PacketTagList (PacketTagList const &o)
 {
   if (m_next != 0)
     {
-      m_next->count++;
+      Multithreading::IncrementRefCount (m_next->count);
     }
 }
 
@@ -104,7 +106,7 @@ PacketTagList::operator = (PacketTagList const &o)
   m_next = o.m_next;
   if (m_next != 0) 
     {
-      m_next->count++;
+      Multithreading::IncrementRefCount (m_next->count);
     }
   return *this;
 }
@@ -120,8 +122,7 @@ PacketTagList::RemoveAll (void)
   struct TagData *prev = 0;
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
     {
-      cur->count--;
-      if (cur->count > 0) 
+      if (!Multithreading::DecrementRefCount (cur->count))
         {
           break;
         }
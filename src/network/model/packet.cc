@@ -21,6 +21,7 @@
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/multithreading.h"
 #include <string>
 #include <stdarg.h>
 
@@ -116,6 +117,68 @@ PacketTagIterator::Item::GetTag (Tag &tag) const
 }
 
 
+/* The memory of the destroyed packets is chained through its first
+ * word. Both variables are zero-initialized before any constructor
+ * runs, and packets destroyed after g_localStaticDestructor go
+ * straight back to the heap. Each thread has its own free list; the
+ * static destructor releases the one of the main thread, the other
+ * threads of a multithreaded run leave theirs behind when they exit.
+ */
+struct FreePacket
+{
+  struct FreePacket *next;
+};
+static __thread struct FreePacket *g_freePackets = 0;
+static __thread uint32_t g_nFreePackets = 0;
+static bool g_freePacketsDestroyed = false;
+static const uint32_t MAX_FREE_PACKETS = 4096;
+
+static struct FreePacketsDestructor
+{
+  ~FreePacketsDestructor ()
+  {
+    while (g_freePackets != 0)
+      {
+        struct FreePacket *packet = g_freePackets;
+        g_freePackets = packet->next;
+        ::operator delete (packet);
+      }
+    g_nFreePackets = 0;
+    g_freePacketsDestroyed = true;
+  }
+} g_localStaticDestructor;
+
+void *
+Packet::operator new (size_t size)
+{
+  if (size != sizeof (Packet) || g_freePackets == 0)
+    {
+      return ::operator new (size);
+    }
+  struct FreePacket *packet = g_freePackets;
+  g_freePackets = packet->next;
+  g_nFreePackets--;
+  return packet;
+}
+
+void
+Packet::operator delete (void *p, size_t size)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  if (size != sizeof (Packet) || g_nFreePackets >= MAX_FREE_PACKETS || g_freePacketsDestroyed)
+    {
+      ::operator delete (p);
+      return;
+    }
+  struct FreePacket *packet = static_cast<struct FreePacket *> (p);
+  packet->next = g_freePackets;
+  g_freePackets = packet;
+  g_nFreePackets++;
+}
+
 Ptr<Packet> 
 Packet::Copy (void) const
 {
@@ -129,16 +192,23 @@ Packet::Packet ()
   : m_buffer (),
     m_byteTagList (),
     m_packetTagList (),
-    /* The upper 32 bits of the packet id in 
-     * metadata is for the system id. For non-
-     * distributed simulations, this is simply 
-     * zero.  The lower 32 bits are for the 
-     * global UID
-     */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (GetNewUid (), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
+}
+
+uint64_t
+Packet::GetNewUid (void)
+{
+  /* The upper 32 bits of the packet id in 
+   * metadata is for the system id. For non-
+   * distributed simulations, this is simply 
+   * zero.  The lower 32 bits are for the 
+   * global UID, shared by all the threads
+   * of a multithreaded simulation.
+   */
+  uint32_t uid = Multithreading::IsEnabled () ? __sync_fetch_and_add (&m_globalUid, 1) : m_globalUid++;
+  return static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | uid;
 }
 
 Packet::Packet (const Packet &o)
@@ -171,16 +241,9 @@ Packet::Packet (uint32_t size)
   : m_buffer (size),
     m_byteTagList (),
     m_packetTagList (),
-    /* The upper 32 bits of the packet id in 
-     * metadata is for the system id. For non-
-     * distributed simulations, this is simply 
-     * zero.  The lower 32 bits are for the 
-     * global UID
-     */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (GetNewUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -197,16 +260,9 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
   : m_buffer (),
     m_byteTagList (),
     m_packetTagList (),
-    /* The upper 32 bits of the packet id in 
-     * metadata is for the system id. For non-
-     * distributed simulations, this is simply 
-     * zero.  The lower 32 bits are for the 
-     * global UID
-     */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (GetNewUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
@@ -818,6 +874,12 @@ Packet::GetByteTagIterator (void) const
   return ByteTagIterator (m_byteTagList.Begin (m_buffer.GetCurrentStartOffset (), m_buffer.GetCurrentEndOffset ()));
 }
 
+bool
+Packet::IsVirtual (void) const
+{
+  return m_buffer.IsVirtual () && !GetByteTagIterator ().HasNext ();
+}
+
 bool 
 Packet::FindFirstMatchingByteTag (Tag &tag) const
 {
@@ -256,6 +256,15 @@ public:
    *          initial payload)
    */
   inline uint32_t GetSize (void) const;
+  /**
+   * \returns true if the packet is made only of zero-filled payload
+   *          whose memory was never allocated, as created by
+   *          Packet (uint32_t size) or fragmented out of such a
+   *          packet, and if none of its bytes carries a byte tag.
+   *          Such a packet can be replaced by a new one of the same
+   *          size without losing anything but its uid and packet tags.
+   */
+  bool IsVirtual (void) const;
   /**
    * Add header to this packet. This method invokes the
    * Header::GetSerializedSize and Header::Serialize
@@ -553,11 +562,29 @@ public:
   void SetNixVector (Ptr<NixVector>);
   Ptr<NixVector> GetNixVector (void) const; 
 
+  /**
+   * Packets are allocated from a free list of the packets destroyed
+   * earlier, so that creating or copying a packet does not go to the
+   * heap in steady state.
+   *
+   * \param size the size of the object to allocate
+   * \returns the memory of the new packet
+   */
+  static void* operator new (size_t size);
+  /**
+   * Give the memory of a destroyed packet back to the free list.
+   *
+   * \param p the memory of the packet
+   * \param size the size of the object
+   */
+  static void operator delete (void *p, size_t size);
+
 private:
   Packet (const Buffer &buffer, const ByteTagList &byteTagList, 
           const PacketTagList &packetTagList, const PacketMetadata &metadata);
 
   uint32_t Deserialize (uint8_t const*buffer, uint32_t size);
+  static uint64_t GetNewUid (void);
 
   Buffer m_buffer;
   ByteTagList m_byteTagList;
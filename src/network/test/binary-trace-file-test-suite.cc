@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+#include <cstring>
+
+#include "ns3/test.h"
+#include "ns3/packet.h"
+#include "ns3/binary-trace-file.h"
+
+using namespace ns3;
+
+// ===========================================================================
+// Test case to make sure that records written through a buffer smaller
+// than the file are read back unchanged and in order.
+// ===========================================================================
+class BinaryTraceReadWriteTestCase : public TestCase
+{
+public:
+  BinaryTraceReadWriteTestCase ();
+  virtual ~BinaryTraceReadWriteTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  std::string m_testFilename;
+};
+
+BinaryTraceReadWriteTestCase::BinaryTraceReadWriteTestCase ()
+  : TestCase ("Check that BinaryTraceFile reads back the records it writes")
+{
+}
+
+BinaryTraceReadWriteTestCase::~BinaryTraceReadWriteTestCase ()
+{
+}
+
+void
+BinaryTraceReadWriteTestCase::DoSetup (void)
+{
+  std::stringstream filename;
+  uint32_t n = rand ();
+  filename << n;
+  m_testFilename = CreateTempDirFilename (filename.str () + ".btr");
+}
+
+void
+BinaryTraceReadWriteTestCase::DoTeardown (void)
+{
+  remove (m_testFilename.c_str ());
+}
+
+void
+BinaryTraceReadWriteTestCase::DoRun (void)
+{
+  const uint32_t nRecords = 1000;
+  // a buffer size which is not a multiple of the record size
+  const uint32_t bufferSize = 1000;
+
+  BinaryTraceFile f;
+  f.Open (m_testFilename, std::ios::out, bufferSize);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << m_testFilename << ", \"w\") returns error");
+  for (uint32_t i = 0; i < nRecords; ++i)
+    {
+      BinaryTraceRecord record;
+      memset (&record, 0, sizeof (record));
+      record.time = i * 1000000007LL;
+      record.node = i;
+      record.sequence = i * 3;
+      record.type = "+-dr"[i % 4];
+      f.Write (record);
+    }
+  f.Close ();
+
+  f.Open (m_testFilename, std::ios::in, bufferSize);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << m_testFilename << ", \"r\") returns error");
+  BinaryTraceRecord record;
+  uint32_t n = 0;
+  while (f.Read (record))
+    {
+      NS_TEST_ASSERT_MSG_EQ (record.time, n * 1000000007LL, "Unexpected time in record " << n);
+      NS_TEST_ASSERT_MSG_EQ (record.node, n, "Unexpected node in record " << n);
+      NS_TEST_ASSERT_MSG_EQ (record.sequence, n * 3, "Unexpected sequence in record " << n);
+      NS_TEST_ASSERT_MSG_EQ (record.type, "+-dr"[n % 4], "Unexpected type in record " << n);
+      n++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (n, nRecords, "Unexpected number of records");
+  NS_TEST_ASSERT_MSG_EQ (f.Eof (), true, "Read () failed before the end of the file");
+}
+
+// ===========================================================================
+// Test case to make sure that the 5-tuple is found behind a link header.
+// ===========================================================================
+class BinaryTraceParseTestCase : public TestCase
+{
+public:
+  BinaryTraceParseTestCase ();
+  virtual ~BinaryTraceParseTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BinaryTraceParseTestCase::BinaryTraceParseTestCase ()
+  : TestCase ("Check BinaryTraceFile::ParseIpv4")
+{
+}
+
+BinaryTraceParseTestCase::~BinaryTraceParseTestCase ()
+{
+}
+
+void
+BinaryTraceParseTestCase::DoRun (void)
+{
+  // PPP header, IPv4 header from 10.0.1.2 to 10.0.3.4 and TCP header from
+  // port 49153 to port 5000 with sequence number 0x01020304.
+  const uint8_t bytes[] = {
+    0x00, 0x21,
+    0x45, 0x00, 0x00, 0x28, 0x00, 0x00, 0x00, 0x00, 0x40, 0x06, 0x00, 0x00,
+    0x0a, 0x00, 0x01, 0x02, 0x0a, 0x00, 0x03, 0x04,
+    0xc0, 0x01, 0x13, 0x88, 0x01, 0x02, 0x03, 0x04,
+    0x00, 0x00, 0x00, 0x00, 0x50, 0x10, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00
+  };
+  Ptr<Packet> p = Create<Packet> (bytes, sizeof (bytes));
+
+  BinaryTraceRecord record;
+  memset (&record, 0, sizeof (record));
+  NS_TEST_ASSERT_MSG_EQ (BinaryTraceFile::ParseIpv4 (p, 2, record), true, "IPv4 header not found");
+  NS_TEST_ASSERT_MSG_EQ (record.protocol, 6, "Unexpected protocol");
+  NS_TEST_ASSERT_MSG_EQ (record.source, 0x0a000102, "Unexpected source address");
+  NS_TEST_ASSERT_MSG_EQ (record.destination, 0x0a000304, "Unexpected destination address");
+  NS_TEST_ASSERT_MSG_EQ (record.sourcePort, 49153, "Unexpected source port");
+  NS_TEST_ASSERT_MSG_EQ (record.destinationPort, 5000, "Unexpected destination port");
+  NS_TEST_ASSERT_MSG_EQ (record.sequence, 0x01020304, "Unexpected sequence number");
+
+  // Without skipping the PPP header, there is no IPv4 header to be found
+  NS_TEST_ASSERT_MSG_EQ (BinaryTraceFile::ParseIpv4 (p, 0, record), false, "Bogus IPv4 header found");
+  NS_TEST_ASSERT_MSG_EQ (record.source, 0, "Source address not cleared");
+}
+
+class BinaryTraceFileTestSuite : public TestSuite
+{
+public:
+  BinaryTraceFileTestSuite ();
+};
+
+BinaryTraceFileTestSuite::BinaryTraceFileTestSuite ()
+  : TestSuite ("binary-trace-file", UNIT)
+{
+  AddTestCase (new BinaryTraceReadWriteTestCase);
+  AddTestCase (new BinaryTraceParseTestCase);
+}
+
+static BinaryTraceFileTestSuite binaryTraceFileTestSuite;
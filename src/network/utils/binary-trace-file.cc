@@ -0,0 +1,241 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/fatal-impl.h"
+#include "ns3/packet.h"
+#include "binary-trace-file.h"
+
+NS_LOG_COMPONENT_DEFINE ("BinaryTraceFile");
+
+namespace ns3 {
+
+const uint32_t MAGIC = 0x6e734254;   /**< "nsBT", identifies a binary trace file */
+const uint32_t VERSION = 1;          /**< Version of the record layout */
+
+/* The IPv4 protocol numbers of the headers parsed by ParseIpv4 */
+const uint8_t TCP_PROTOCOL = 6;
+const uint8_t UDP_PROTOCOL = 17;
+
+/* The largest IPv4 header followed by the first 8 bytes of TCP or UDP */
+const uint32_t MAX_PARSED_BYTES = 60 + 8;
+/* The largest offset of the IPv4 header accepted by ParseIpv4 */
+const uint32_t MAX_LINK_HEADER = 32;
+
+struct BinaryTraceFileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t recordSize;
+  uint32_t reserved;
+};
+
+BinaryTraceFile::BinaryTraceFile ()
+  : m_file (),
+    m_position (0),
+    m_end (0),
+    m_eof (false),
+    m_writing (false)
+{
+  FatalImpl::RegisterStream (&m_file);
+}
+
+BinaryTraceFile::~BinaryTraceFile ()
+{
+  FatalImpl::UnregisterStream (&m_file);
+  Close ();
+}
+
+bool
+BinaryTraceFile::Fail (void) const
+{
+  return m_file.fail ();
+}
+
+bool
+BinaryTraceFile::Eof (void) const
+{
+  return m_eof;
+}
+
+void
+BinaryTraceFile::Open (std::string const &filename, std::ios::openmode mode,
+                       uint32_t bufferSize)
+{
+  NS_LOG_FUNCTION (this << filename << mode << bufferSize);
+  NS_ASSERT_MSG ((mode & (std::ios::in | std::ios::out)) == std::ios::in
+                 || (mode & (std::ios::in | std::ios::out)) == std::ios::out,
+                 "BinaryTraceFile::Open(): open either for reading or for writing");
+  NS_ASSERT (sizeof (BinaryTraceRecord) == 48);
+
+  Close ();
+  m_file.clear ();
+  m_file.open (filename.c_str (), mode | std::ios::binary);
+  // Leave room for at least one record in the buffer
+  m_buffer.resize (std::max<uint32_t> (bufferSize, sizeof (BinaryTraceRecord)));
+  m_position = 0;
+  m_end = 0;
+  m_eof = false;
+  m_writing = (mode & std::ios::out) != 0;
+  if (m_file.fail ())
+    {
+      return;
+    }
+
+  BinaryTraceFileHeader header;
+  if (m_writing)
+    {
+      header.magic = MAGIC;
+      header.version = VERSION;
+      header.recordSize = sizeof (BinaryTraceRecord);
+      header.reserved = 0;
+      m_file.write ((const char *)&header, sizeof (header));
+      return;
+    }
+
+  m_file.read ((char *)&header, sizeof (header));
+  if (m_file.fail ()
+      || header.magic != MAGIC
+      || header.version != VERSION
+      || header.recordSize != sizeof (BinaryTraceRecord))
+    {
+      NS_LOG_LOGIC ("not a binary trace file: " << filename);
+      m_file.setstate (std::ios::failbit);
+    }
+}
+
+void
+BinaryTraceFile::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_file.is_open ())
+    {
+      return;
+    }
+  Flush ();
+  m_file.close ();
+  m_writing = false;
+  // Release the buffer, a closed file may well live for the whole simulation
+  std::vector<uint8_t> ().swap (m_buffer);
+}
+
+void
+BinaryTraceFile::Flush (void)
+{
+  if (!m_writing || m_position == 0 || !m_file.is_open ())
+    {
+      return;
+    }
+  m_file.write ((const char *)&m_buffer[0], m_position);
+  m_file.flush ();
+  m_position = 0;
+}
+
+void
+BinaryTraceFile::Write (const BinaryTraceRecord &record)
+{
+  if (!m_writing)
+    {
+      // closed, the simulation is over
+      return;
+    }
+  if (m_position + sizeof (record) > m_buffer.size ())
+    {
+      Flush ();
+    }
+  memcpy (&m_buffer[m_position], &record, sizeof (record));
+  m_position += sizeof (record);
+}
+
+bool
+BinaryTraceFile::ReadBuffer (void)
+{
+  // Move the trailing partial record, if any, to the front of the buffer
+  uint32_t left = m_end - m_position;
+  memmove (&m_buffer[0], &m_buffer[m_position], left);
+  m_file.read ((char *)&m_buffer[left], m_buffer.size () - left);
+  m_position = 0;
+  m_end = left + m_file.gcount ();
+  return m_end >= sizeof (BinaryTraceRecord);
+}
+
+bool
+BinaryTraceFile::Read (BinaryTraceRecord &record)
+{
+  if (m_position + sizeof (record) > m_end)
+    {
+      if (m_eof || !m_file.is_open () || !ReadBuffer ())
+        {
+          m_eof = true;
+          return false;
+        }
+    }
+  memcpy (&record, &m_buffer[m_position], sizeof (record));
+  m_position += sizeof (record);
+  return true;
+}
+
+bool
+BinaryTraceFile::ParseIpv4 (Ptr<const Packet> p, uint32_t offset, BinaryTraceRecord &record)
+{
+  record.source = 0;
+  record.destination = 0;
+  record.sourcePort = 0;
+  record.destinationPort = 0;
+  record.sequence = 0;
+  record.protocol = 0;
+
+  uint8_t buffer[MAX_LINK_HEADER + MAX_PARSED_BYTES];
+  uint32_t size = std::min (p->GetSize (), offset + MAX_PARSED_BYTES);
+  if (offset > MAX_LINK_HEADER || size < offset + 20)
+    {
+      return false;
+    }
+  p->CopyData (buffer, size);
+  uint8_t *data = buffer + offset;
+  size -= offset;
+
+  uint32_t headerSize = (data[0] & 0x0f) * 4;
+  if ((data[0] >> 4) != 4 || headerSize < 20 || headerSize > size)
+    {
+      return false;
+    }
+  record.protocol = data[9];
+  record.source = (data[12] << 24) | (data[13] << 16) | (data[14] << 8) | data[15];
+  record.destination = (data[16] << 24) | (data[17] << 16) | (data[18] << 8) | data[19];
+
+  // only the first fragment carries the transport header
+  bool firstFragment = ((data[6] & 0x1f) | data[7]) == 0;
+  uint8_t *l4 = data + headerSize;
+  if (firstFragment && (record.protocol == TCP_PROTOCOL || record.protocol == UDP_PROTOCOL)
+      && headerSize + 4 <= size)
+    {
+      record.sourcePort = (l4[0] << 8) | l4[1];
+      record.destinationPort = (l4[2] << 8) | l4[3];
+      if (record.protocol == TCP_PROTOCOL && headerSize + 8 <= size)
+        {
+          record.sequence = (l4[4] << 24) | (l4[5] << 16) | (l4[6] << 8) | l4[7];
+        }
+    }
+  return true;
+}
+
+} // namespace ns3
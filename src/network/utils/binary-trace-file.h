@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BINARY_TRACE_FILE_H
+#define BINARY_TRACE_FILE_H
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \brief One fixed-size event of a binary trace file.
+ *
+ * The fields carry what the text traces of AsciiTraceHelper are
+ * usually parsed for: the event type ('+', '-', 'd' or 'r', as in the
+ * ascii traces), the time, the device on which the event happened, the
+ * IPv4 5-tuple, the TCP sequence number, the size of the packet and
+ * the number of packets in the device queue once the event happened.
+ * Packets which are not IPv4 have all the header fields set to zero.
+ *
+ * Records are stored in host byte order.
+ */
+struct BinaryTraceRecord
+{
+  int64_t time;         /**< time of the event, in nanoseconds */
+  uint32_t node;        /**< id of the node */
+  uint32_t device;      /**< index of the device on the node */
+  uint32_t source;      /**< IPv4 source address */
+  uint32_t destination; /**< IPv4 destination address */
+  uint16_t sourcePort;  /**< TCP or UDP source port */
+  uint16_t destinationPort; /**< TCP or UDP destination port */
+  uint32_t sequence;    /**< TCP sequence number */
+  uint32_t size;        /**< size of the packet, in bytes */
+  uint32_t queueLength; /**< packets in the device queue after the event */
+  uint8_t type;         /**< '+', '-', 'd' or 'r' */
+  uint8_t protocol;     /**< IPv4 protocol number */
+  uint8_t reserved[6]; /**< padding up to 48 bytes, always zero */
+};
+
+/**
+ * \brief A file of BinaryTraceRecord, read and written through a
+ * large user-space buffer.
+ *
+ * The file starts with a small header (magic number, version and
+ * record size) followed by the records, back to back. Writes are
+ * copied into the buffer and only reach the underlying stream when it
+ * is full, when Flush is called or when the file is closed, which
+ * includes the destruction of the last reference to it.
+ */
+class BinaryTraceFile : public SimpleRefCount<BinaryTraceFile>
+{
+public:
+  static const uint32_t BUFFER_SIZE_DEFAULT = 1 << 20; /**< Default buffer size, in bytes */
+
+  BinaryTraceFile ();
+  ~BinaryTraceFile ();
+
+  /**
+   * \return true if the 'fail' bit is set in the underlying iostream, false otherwise.
+   */
+  bool Fail (void) const;
+  /**
+   * \return true if the last Read hit the end of the file, false otherwise.
+   */
+  bool Eof (void) const;
+
+  /**
+   * Create a new trace file or open an existing one. With std::ios::out
+   * the header is written immediately; with std::ios::in it is read and
+   * checked, and the fail bit is set if it does not match.
+   *
+   * \param filename String containing the name of the file.
+   * \param mode std::ios::in or std::ios::out; std::ios::binary is added.
+   * \param bufferSize size of the read or write buffer, in bytes.
+   */
+  void Open (std::string const &filename, std::ios::openmode mode,
+             uint32_t bufferSize = BUFFER_SIZE_DEFAULT);
+
+  /**
+   * Write the buffered records and close the underlying file.
+   */
+  void Close (void);
+
+  /**
+   * Append a record to the write buffer. Records written once the file
+   * has been closed are discarded.
+   *
+   * \param record the record to write
+   */
+  void Write (const BinaryTraceRecord &record);
+
+  /**
+   * Write the buffered records to the underlying file.
+   */
+  void Flush (void);
+
+  /**
+   * Read the next record of the file.
+   *
+   * \param record the record to fill
+   * \return false at the end of the file or on a read error
+   */
+  bool Read (BinaryTraceRecord &record);
+
+  /**
+   * Fill the header fields of a record from the raw bytes of an IPv4
+   * packet: the addresses and the protocol, the ports of TCP and UDP
+   * packets and the sequence number of TCP packets. Only the first
+   * bytes of the packet are copied out and no Header is deserialized.
+   *
+   * \param p the packet
+   * \param offset number of bytes in front of the IPv4 header, such as
+   *        the link-layer header of a packet sitting in a device queue.
+   * \param record the record to fill
+   * \return false, leaving the header fields to zero, if p does not
+   *         hold an IPv4 header at offset
+   */
+  static bool ParseIpv4 (Ptr<const Packet> p, uint32_t offset, BinaryTraceRecord &record);
+
+private:
+  bool ReadBuffer (void);
+
+  std::fstream m_file;
+  std::vector<uint8_t> m_buffer;
+  uint32_t m_position; //!< next byte of m_buffer to read or write
+  uint32_t m_end;      //!< number of valid bytes in m_buffer, when reading
+  bool m_eof;
+  bool m_writing;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_TRACE_FILE_H */
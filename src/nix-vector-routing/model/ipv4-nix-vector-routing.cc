@@ -18,13 +18,18 @@
  * Authors: Josh Pelkey <jpelkey@gatech.edu>
  */
 
-#include <queue>
+#include <algorithm>
 #include <iomanip>
 
 #include "ns3/log.h"
 #include "ns3/abort.h"
 #include "ns3/names.h"
 #include "ns3/ipv4-list-routing.h"
+#include "ns3/sgi-hashmap.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/multithreading.h"
 
 #include "ipv4-nix-vector-routing.h"
 
@@ -34,18 +39,109 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (Ipv4NixVectorRouting);
 
+/*
+ * The node/device/channel graph, flattened into compressed sparse rows
+ * indexed by node id, so that a BFS does not have to touch a single
+ * Ptr<>, GetObject<Ipv4> () or channel while it runs.
+ *
+ * The device slots of node n are nodeDevices[n] to nodeDevices[n+1]-1,
+ * in device index order.  The neighbors reached through device slot d
+ * (as found by GetAdjacentNetDevices, so looking through bridges) are
+ * neighborNode/neighborDevice[deviceNeighbors[d]] to
+ * neighborNode/neighborDevice[deviceNeighbors[d+1]-1].
+ *
+ * The snapshot is shared by every node; it is rebuilt after
+ * FlushGlobalNixRoutingCache (), i.e., when an interface goes up or
+ * down or an address is added or removed, which is not supported
+ * while nodes run in several threads.  So are the BFS trees of the
+ * UseSharedTrees mode, which are computed from it.  When nodes run in
+ * several threads, g_topologyLock guards the building of the snapshot
+ * and of the trees; as neither changes once built, the searches run
+ * without it, each thread with its own BfsState.
+ */
+struct Ipv4NixVectorRouting::Topology
+{
+  enum
+  {
+    DEVICE_UP = 1,     // the device has a channel, its link and interface are up
+    DEVICE_BRIDGE = 2  // the device is a BridgeNetDevice
+  };
+
+  /* parent of the nodes not (yet) reached by a BFS */
+  static const uint32_t NO_NODE = 0xffffffff;
+
+  Topology ()
+    : valid (false),
+      destroyScheduled (false),
+      generation (0)
+  {
+  }
+
+  bool valid;
+  bool destroyScheduled;
+  /* tells the BfsStates sized for an older snapshot */
+  uint32_t generation;
+
+  std::vector<uint32_t> nodeDevices;
+  std::vector<uint32_t> deviceNeighbors;
+  std::vector<uint8_t> deviceFlags;
+  std::vector<uint32_t> neighborNode;
+  std::vector<uint32_t> neighborDevice;
+
+  /* node id of each local address, the first node wins */
+  sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash> addressToNode;
+
+  /* UseSharedTrees mode: parent vector of the complete BFS tree
+   * rooted at each node, empty until that node needs it */
+  std::vector<std::vector<uint32_t> > trees;
+
+  /* the BfsStates of all the threads, freed with the snapshot */
+  std::vector<BfsState *> bfsStates;
+};
+
+/*
+ * The state of a thread's searches, reused across them.  parent[n] is
+ * NO_NODE for every node that the last search did not reach; as those
+ * it did reach are all in the queue, only they have to be reset.
+ */
+struct Ipv4NixVectorRouting::BfsState
+{
+  /* the generation of the snapshot the vectors are sized for */
+  uint32_t generation;
+  std::vector<uint32_t> parent;
+  std::vector<uint32_t> queue;
+};
+
+static SpinLock g_topologyLock;
+/* incremented by every BuildTopology () */
+static uint32_t g_topologyGeneration = 0;
+/* incremented by every DestroyTopology (), which frees the BfsStates */
+static uint32_t g_bfsStateEpoch = 0;
+
 TypeId 
 Ipv4NixVectorRouting::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::Ipv4NixVectorRouting")
     .SetParent<Ipv4RoutingProtocol> ()
     .AddConstructor<Ipv4NixVectorRouting> ()
+    .AddAttribute ("UseSharedTrees",
+                   "Set to true to compute, the first time a node sends a packet, the BFS tree from that node to all the other nodes, and to build all its nix-vectors from that tree, which is shared by all the nodes; set to false for one BFS per destination",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Ipv4NixVectorRouting::m_useSharedTrees),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CacheSize",
+                   "Maximum number of nix-vectors, and of Ipv4Routes, cached by each node, the least recently used being evicted first; 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&Ipv4NixVectorRouting::m_cacheSize),
+                   MakeUintegerChecker<uint32_t> ())
   ;
   return tid;
 }
 
 Ipv4NixVectorRouting::Ipv4NixVectorRouting ()
-  : m_totalNeighbors (0)
+  : m_cacheSize (0),
+    m_useSharedTrees (false),
+    m_totalNeighbors (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -89,6 +185,11 @@ void
 Ipv4NixVectorRouting::FlushGlobalNixRoutingCache ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  // the caches of the nodes belong to the threads running them
+  NS_ABORT_MSG_IF (Multithreading::IsEnabled (),
+                   "Ipv4NixVectorRouting::FlushGlobalNixRoutingCache(): the interfaces and addresses "
+                   "cannot change while several threads run the simulation");
+  GetTopology ().valid = false;
   NodeList::Iterator listEnd = NodeList::End ();
   for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
     {
@@ -108,14 +209,157 @@ void
 Ipv4NixVectorRouting::FlushNixCache ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_nixCache.clear ();
+  m_nixCache.Clear ();
 }
 
 void
 Ipv4NixVectorRouting::FlushIpv4RouteCache ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_ipv4RouteCache.clear ();
+  m_ipv4RouteCache.Clear ();
+}
+
+Ipv4NixVectorRouting::Topology &
+Ipv4NixVectorRouting::GetTopology (void)
+{
+  static Topology topology;
+  return topology;
+}
+
+Ipv4NixVectorRouting::Topology &
+Ipv4NixVectorRouting::UpdateTopology (void)
+{
+  Topology &topology = GetTopology ();
+  if (!topology.valid || topology.nodeDevices.size () != NodeList::GetNNodes () + 1)
+    {
+      BuildTopology (topology);
+    }
+  return topology;
+}
+
+void
+Ipv4NixVectorRouting::DestroyTopology (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // swap with an empty snapshot to give the memory back
+  Topology empty;
+  std::swap (GetTopology (), empty);
+  for (std::vector<BfsState *>::iterator i = empty.bfsStates.begin (); i != empty.bfsStates.end (); i++)
+    {
+      delete *i;
+    }
+  g_bfsStateEpoch++;
+}
+
+Ipv4NixVectorRouting::BfsState &
+Ipv4NixVectorRouting::GetBfsState (Topology & topology)
+{
+  static __thread BfsState *state = 0;
+  static __thread uint32_t epoch = 0;
+  if (state == 0 || epoch != g_bfsStateEpoch)
+    {
+      state = new BfsState ();
+      state->generation = 0;
+      epoch = g_bfsStateEpoch;
+      MultithreadedCriticalSection cs (g_topologyLock);
+      topology.bfsStates.push_back (state);
+    }
+  if (state->generation != topology.generation)
+    {
+      uint32_t numberOfNodes = topology.nodeDevices.size () - 1;
+      state->parent.assign (numberOfNodes, Topology::NO_NODE);
+      state->queue.clear ();
+      state->queue.reserve (numberOfNodes);
+      state->generation = topology.generation;
+    }
+  return *state;
+}
+
+void
+Ipv4NixVectorRouting::BuildTopology (Topology & topology)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  uint32_t numberOfNodes = NodeList::GetNNodes ();
+  NS_LOG_LOGIC ("Building topology snapshot of " << numberOfNodes << " nodes");
+
+  topology.nodeDevices.clear ();
+  topology.deviceNeighbors.clear ();
+  topology.deviceFlags.clear ();
+  topology.neighborNode.clear ();
+  topology.neighborDevice.clear ();
+  topology.addressToNode.clear ();
+  topology.nodeDevices.reserve (numberOfNodes + 1);
+
+  for (uint32_t n = 0; n < numberOfNodes; n++)
+    {
+      Ptr<Node> node = NodeList::GetNode (n);
+      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+      topology.nodeDevices.push_back (topology.deviceFlags.size ());
+
+      for (uint32_t i = 0; i < node->GetNDevices (); i++)
+        {
+          Ptr<NetDevice> localNetDevice = node->GetDevice (i);
+          Ptr<Channel> channel = localNetDevice->GetChannel ();
+          topology.deviceNeighbors.push_back (topology.neighborNode.size ());
+
+          uint8_t flags = 0;
+          if (localNetDevice->IsBridge ())
+            {
+              flags |= Topology::DEVICE_BRIDGE;
+            }
+          // make sure that we can go this way
+          bool up = channel != 0 && localNetDevice->IsLinkUp ();
+          if (up && ipv4)
+            {
+              int32_t interfaceIndex = ipv4->GetInterfaceForDevice (localNetDevice);
+              up = interfaceIndex == -1 || ipv4->IsUp (interfaceIndex);
+            }
+          if (up)
+            {
+              flags |= Topology::DEVICE_UP;
+            }
+          topology.deviceFlags.push_back (flags);
+
+          if (channel == 0)
+            {
+              continue;
+            }
+          NetDeviceContainer netDeviceContainer;
+          GetAdjacentNetDevices (localNetDevice, channel, netDeviceContainer);
+          for (NetDeviceContainer::Iterator iter = netDeviceContainer.Begin (); iter != netDeviceContainer.End (); iter++)
+            {
+              topology.neighborNode.push_back ((*iter)->GetNode ()->GetId ());
+              topology.neighborDevice.push_back ((*iter)->GetIfIndex ());
+            }
+        }
+
+      if (!ipv4)
+        {
+          continue;
+        }
+      for (uint32_t j = 0; j < ipv4->GetNInterfaces (); j++)
+        {
+          for (uint32_t k = 0; k < ipv4->GetNAddresses (j); k++)
+            {
+              // insert () keeps the entry of the first node with this address
+              topology.addressToNode.insert (std::make_pair (ipv4->GetAddress (j, k).GetLocal (), n));
+            }
+        }
+    }
+  topology.nodeDevices.push_back (topology.deviceFlags.size ());
+  topology.deviceNeighbors.push_back (topology.neighborNode.size ());
+
+  topology.trees.clear ();
+  topology.trees.resize (numberOfNodes);
+  topology.generation = ++g_topologyGeneration;
+  topology.valid = true;
+
+  if (!topology.destroyScheduled)
+    {
+      Simulator::ScheduleDestroy (&Ipv4NixVectorRouting::DestroyTopology);
+      topology.destroyScheduled = true;
+    }
 }
 
 Ptr<NixVector>
@@ -124,11 +368,17 @@ Ipv4NixVectorRouting::GetNixVector (Ptr<Node> source, Ipv4Address dest, Ptr<NetD
   NS_LOG_FUNCTION_NOARGS ();
 
   Ptr<NixVector> nixVector = Create<NixVector> ();
+  Topology *snapshot;
+  {
+    MultithreadedCriticalSection cs (g_topologyLock);
+    snapshot = &UpdateTopology ();
+  }
+  Topology &topology = *snapshot;
 
   // not in cache, must build the nix vector
   // First, we have to figure out the nodes 
   // associated with these IPs
-  Ptr<Node> destNode = GetNodeByIp (dest);
+  Ptr<Node> destNode = GetNodeByIp (topology, dest);
   if (destNode == 0)
     {
       NS_LOG_ERROR ("No routing path exists");
@@ -147,11 +397,18 @@ Ipv4NixVectorRouting::GetNixVector (Ptr<Node> source, Ipv4Address dest, Ptr<NetD
     {
       // otherwise proceed as normal 
       // and build the nix vector
-      std::vector< Ptr<Node> > parentVector;
-
-      BFS (NodeList::GetNNodes (), source, destNode, parentVector, oif);
+      BfsState &state = GetBfsState (topology);
+      const std::vector<uint32_t> *parentVector = &state.parent;
+      if (m_useSharedTrees && !oif)
+        {
+          parentVector = &GetSourceTree (topology, state, source->GetId ());
+        }
+      else
+        {
+          BFS (topology, state, source->GetId (), destNode->GetId (), oif);
+        }
 
-      if (BuildNixVector (parentVector, source->GetId (), destNode->GetId (), nixVector))
+      if (BuildNixVector (topology, *parentVector, source->GetId (), destNode->GetId (), nixVector))
         {
           return nixVector;
         }
@@ -168,15 +425,12 @@ Ipv4NixVectorRouting::GetNixVectorInCache (Ipv4Address address)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  NixMap_t::iterator iter = m_nixCache.find (address);
-  if (iter != m_nixCache.end ())
+  Ptr<NixVector> nixVector = m_nixCache.Lookup (address);
+  if (nixVector)
     {
       NS_LOG_LOGIC ("Found Nix-vector in cache.");
-      return iter->second;
     }
-
-  // not in cache
-  return 0;
+  return nixVector;
 }
 
 Ptr<Ipv4Route>
@@ -184,15 +438,12 @@ Ipv4NixVectorRouting::GetIpv4RouteInCache (Ipv4Address address)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  Ipv4RouteMap_t::iterator iter = m_ipv4RouteCache.find (address);
-  if (iter != m_ipv4RouteCache.end ())
+  Ptr<Ipv4Route> rtentry = m_ipv4RouteCache.Lookup (address);
+  if (rtentry)
     {
       NS_LOG_LOGIC ("Found Ipv4Route in cache.");
-      return iter->second;
     }
-
-  // not in cache
-  return 0;
+  return rtentry;
 }
 
 bool
@@ -222,76 +473,76 @@ Ipv4NixVectorRouting::BuildNixVectorLocal (Ptr<NixVector> nixVector)
   return false;
 }
 
-bool
-Ipv4NixVectorRouting::BuildNixVector (const std::vector< Ptr<Node> > & parentVector, uint32_t source, uint32_t dest, Ptr<NixVector> nixVector)
+const std::vector<uint32_t> &
+Ipv4NixVectorRouting::GetSourceTree (Topology & topology, BfsState & state, uint32_t source)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-
-  if (source == dest)
-    {
-      return true;
-    }
-
-  if (parentVector.at (dest) == 0)
+  NS_LOG_FUNCTION (source);
+
+  std::vector<uint32_t> &tree = topology.trees[source];
+  {
+    MultithreadedCriticalSection cs (g_topologyLock);
+    if (!tree.empty ())
+      {
+        return tree;
+      }
+  }
+  NS_LOG_LOGIC ("Computing the BFS tree of Node " << source);
+  BFS (topology, state, source, Topology::NO_NODE, 0);
+  // another thread may have computed the same tree meanwhile
+  MultithreadedCriticalSection cs (g_topologyLock);
+  if (tree.empty ())
     {
-      return false;
+      tree = state.parent;
     }
+  return tree;
+}
 
-  Ptr<Node> parentNode = parentVector.at (dest);
-
-  uint32_t numberOfDevices = parentNode->GetNDevices ();
-  uint32_t destId = 0;
-  uint32_t totalNeighbors = 0;
+bool
+Ipv4NixVectorRouting::BuildNixVector (const Topology & topology, const std::vector<uint32_t> & parentVector,
+                                      uint32_t source, uint32_t dest, Ptr<NixVector> nixVector)
+{
+  NS_LOG_FUNCTION_NOARGS ();
 
-  // scan through the net devices on the parent node
-  // and then look at the nodes adjacent to them
-  for (uint32_t i = 0; i < numberOfDevices; i++)
+  // walk the parent vector back from dest to source, 
+  // grabbing the path and building the nix vector
+  while (dest != source)
     {
-      // Get a net device from the node
-      // as well as the channel, and figure
-      // out the adjacent net devices
-      Ptr<NetDevice> localNetDevice = parentNode->GetDevice (i);
-      if (localNetDevice->IsBridge ())
-        {
-          continue;
-        }
-      Ptr<Channel> channel = localNetDevice->GetChannel ();
-      if (channel == 0)
+      uint32_t parentNode = parentVector[dest];
+      if (parentNode == Topology::NO_NODE)
         {
-          continue;
+          return false;
         }
 
-      // this function takes in the local net dev, and channnel, and
-      // writes to the netDeviceContainer the adjacent net devs
-      NetDeviceContainer netDeviceContainer;
-      GetAdjacentNetDevices (localNetDevice, channel, netDeviceContainer);
-
-      // Finally we can get the adjacent nodes
-      // and scan through them.  If we find the 
-      // node that matches "dest" then we can add 
-      // the index  to the nix vector.
-      // the index corresponds to the neighbor index
-      uint32_t offset = 0;
-      for (NetDeviceContainer::Iterator iter = netDeviceContainer.Begin (); iter != netDeviceContainer.End (); iter++)
+      uint32_t destId = 0;
+      uint32_t totalNeighbors = 0;
+
+      // scan through the net devices on the parent node
+      // and then look at the nodes adjacent to them
+      for (uint32_t d = topology.nodeDevices[parentNode]; d < topology.nodeDevices[parentNode + 1]; d++)
         {
-          Ptr<Node> remoteNode = (*iter)->GetNode ();
+          if (topology.deviceFlags[d] & Topology::DEVICE_BRIDGE)
+            {
+              continue;
+            }
 
-          if (remoteNode->GetId () == dest)
+          // If we find the node that matches "dest" then we 
+          // can add the index to the nix vector.
+          // the index corresponds to the neighbor index
+          for (uint32_t j = topology.deviceNeighbors[d]; j < topology.deviceNeighbors[d + 1]; j++)
             {
-              destId = totalNeighbors + offset;
+              if (topology.neighborNode[j] == dest)
+                {
+                  destId = totalNeighbors + j - topology.deviceNeighbors[d];
+                }
             }
-          offset += 1;
+          totalNeighbors += topology.deviceNeighbors[d + 1] - topology.deviceNeighbors[d];
         }
+      NS_LOG_LOGIC ("Adding Nix: " << destId << " with " 
+                                   << nixVector->BitCount (totalNeighbors) << " bits, for node " << parentNode);
+      nixVector->AddNeighborIndex (destId, nixVector->BitCount (totalNeighbors));
 
-      totalNeighbors += netDeviceContainer.GetN ();
+      dest = parentNode;
     }
-  NS_LOG_LOGIC ("Adding Nix: " << destId << " with " 
-                               << nixVector->BitCount (totalNeighbors) << " bits, for node " << parentNode->GetId ());
-  nixVector->AddNeighborIndex (destId, nixVector->BitCount (totalNeighbors));
-
-  // recurse through parent vector, grabbing the path 
-  // and building the nix vector
-  BuildNixVector (parentVector, source, (parentVector.at (dest))->GetId (), nixVector);
   return true;
 }
 
@@ -336,62 +587,32 @@ Ipv4NixVectorRouting::GetAdjacentNetDevices (Ptr<NetDevice> netDevice, Ptr<Chann
 }
 
 Ptr<Node>
-Ipv4NixVectorRouting::GetNodeByIp (Ipv4Address dest)
+Ipv4NixVectorRouting::GetNodeByIp (const Topology & topology, Ipv4Address dest)
 { 
   NS_LOG_FUNCTION_NOARGS ();
 
-  NodeContainer allNodes = NodeContainer::GetGlobal ();
-  Ptr<Node> destNode;
-
-  for (NodeContainer::Iterator i = allNodes.Begin (); i != allNodes.End (); ++i)
-    {
-      Ptr<Node> node = *i;
-      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-      if (ipv4->GetInterfaceForAddress (dest) != -1)
-        {
-          destNode = node;
-          break;
-        }
-    }
-
-  if (!destNode)
+  sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash>::const_iterator i = topology.addressToNode.find (dest);
+  if (i == topology.addressToNode.end ())
     {
       NS_LOG_ERROR ("Couldn't find dest node given the IP" << dest);
       return 0;
     }
 
-  return destNode;
+  return NodeList::GetNode (i->second);
 }
 
 uint32_t
 Ipv4NixVectorRouting::FindTotalNeighbors ()
 {
-  uint32_t numberOfDevices = m_node->GetNDevices ();
-  uint32_t totalNeighbors = 0;
-
-  // scan through the net devices on the parent node
-  // and then look at the nodes adjacent to them
-  for (uint32_t i = 0; i < numberOfDevices; i++)
-    {
-      // Get a net device from the node
-      // as well as the channel, and figure
-      // out the adjacent net devices
-      Ptr<NetDevice> localNetDevice = m_node->GetDevice (i);
-      Ptr<Channel> channel = localNetDevice->GetChannel ();
-      if (channel == 0)
-        {
-          continue;
-        }
-
-      // this function takes in the local net dev, and channnel, and
-      // writes to the netDeviceContainer the adjacent net devs
-      NetDeviceContainer netDeviceContainer;
-      GetAdjacentNetDevices (localNetDevice, channel, netDeviceContainer);
-
-      totalNeighbors += netDeviceContainer.GetN ();
-    }
-
-  return totalNeighbors;
+  MultithreadedCriticalSection cs (g_topologyLock);
+  Topology &topology = UpdateTopology ();
+  uint32_t id = m_node->GetId ();
+
+  // the neighbors of all the net devices of this node
+  // are stored one after the other
+  uint32_t first = topology.nodeDevices[id];
+  uint32_t last = topology.nodeDevices[id + 1];
+  return topology.deviceNeighbors[last] - topology.deviceNeighbors[first];
 }
 
 Ptr<BridgeNetDevice>
@@ -437,36 +658,26 @@ Ipv4NixVectorRouting::NetDeviceIsBridged (Ptr<NetDevice> nd) const
 uint32_t
 Ipv4NixVectorRouting::FindNetDeviceForNixIndex (uint32_t nodeIndex, Ipv4Address & gatewayIp)
 {
-  uint32_t numberOfDevices = m_node->GetNDevices ();
+  MultithreadedCriticalSection cs (g_topologyLock);
+  Topology &topology = UpdateTopology ();
+  uint32_t id = m_node->GetId ();
   uint32_t index = 0;
   uint32_t totalNeighbors = 0;
 
   // scan through the net devices on the parent node
   // and then look at the nodes adjacent to them
-  for (uint32_t i = 0; i < numberOfDevices; i++)
+  for (uint32_t d = topology.nodeDevices[id]; d < topology.nodeDevices[id + 1]; d++)
     {
-      // Get a net device from the node
-      // as well as the channel, and figure
-      // out the adjacent net devices
-      Ptr<NetDevice> localNetDevice = m_node->GetDevice (i);
-      Ptr<Channel> channel = localNetDevice->GetChannel ();
-      if (channel == 0)
-        {
-          continue;
-        }
-
-      // this function takes in the local net dev, and channnel, and
-      // writes to the netDeviceContainer the adjacent net devs
-      NetDeviceContainer netDeviceContainer;
-      GetAdjacentNetDevices (localNetDevice, channel, netDeviceContainer);
+      uint32_t neighbors = topology.deviceNeighbors[d + 1] - topology.deviceNeighbors[d];
 
       // check how many neighbors we have
-      if (nodeIndex < (totalNeighbors + netDeviceContainer.GetN ()))
+      if (nodeIndex < (totalNeighbors + neighbors))
         {
           // found the proper net device
-          index = i;
-          Ptr<NetDevice> gatewayDevice = netDeviceContainer.Get (nodeIndex-totalNeighbors);
-          Ptr<Node> gatewayNode = gatewayDevice->GetNode ();
+          index = d - topology.nodeDevices[id];
+          uint32_t j = topology.deviceNeighbors[d] + nodeIndex - totalNeighbors;
+          Ptr<Node> gatewayNode = NodeList::GetNode (topology.neighborNode[j]);
+          Ptr<NetDevice> gatewayDevice = gatewayNode->GetDevice (topology.neighborDevice[j]);
           Ptr<Ipv4> ipv4 = gatewayNode->GetObject<Ipv4> ();
 
           uint32_t interfaceIndex = (ipv4)->GetInterfaceForDevice (gatewayDevice);
@@ -474,7 +685,7 @@ Ipv4NixVectorRouting::FindNetDeviceForNixIndex (uint32_t nodeIndex, Ipv4Address
           gatewayIp = ifAddr.GetLocal ();
           break;
         }
-      totalNeighbors += netDeviceContainer.GetN ();
+      totalNeighbors += neighbors;
     }
 
   return index;
@@ -501,7 +712,7 @@ Ipv4NixVectorRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<
       nixVectorInCache = GetNixVector (m_node, header.GetDestination (), oif);
 
       // cache it
-      m_nixCache.insert (NixMap_t::value_type (header.GetDestination (), nixVectorInCache));
+      m_nixCache.Insert (header.GetDestination (), nixVectorInCache, m_cacheSize);
     }
 
   // path exists
@@ -539,7 +750,7 @@ Ipv4NixVectorRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<
           // rtentry from the map
           if (rtentry)
             {
-              m_ipv4RouteCache.erase (header.GetDestination ());
+              m_ipv4RouteCache.Erase (header.GetDestination ());
             }
 
           NS_LOG_LOGIC ("Ipv4Route not in cache, build: ");
@@ -579,7 +790,7 @@ Ipv4NixVectorRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<
           sockerr = Socket::ERROR_NOTERROR;
 
           // add rtentry to cache
-          m_ipv4RouteCache.insert (Ipv4RouteMap_t::value_type (header.GetDestination (), rtentry));
+          m_ipv4RouteCache.Insert (header.GetDestination (), rtentry, m_cacheSize);
         }
 
       NS_LOG_LOGIC ("Nix-vector contents: " << *nixVectorInCache << " : Remaining bits: " << nixVectorForPacket->GetRemainingBits ());
@@ -644,7 +855,7 @@ Ipv4NixVectorRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
       rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIndex));
 
       // add rtentry to cache
-      m_ipv4RouteCache.insert (Ipv4RouteMap_t::value_type (header.GetDestination (), rtentry));
+      m_ipv4RouteCache.Insert (header.GetDestination (), rtentry, m_cacheSize);
     }
 
   NS_LOG_LOGIC ("At Node " << m_node->GetId () << ", Extracting " << numberOfBits <<
@@ -664,11 +875,14 @@ Ipv4NixVectorRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
 {
 
   std::ostream* os = stream->GetStream ();
+  // print the caches sorted by destination
+  NixMap_t nixCache (m_nixCache.GetEntries ().begin (), m_nixCache.GetEntries ().end ());
+  Ipv4RouteMap_t ipv4RouteCache (m_ipv4RouteCache.GetEntries ().begin (), m_ipv4RouteCache.GetEntries ().end ());
   *os << "NixCache:" << std::endl;
-  if (m_nixCache.size () > 0)
+  if (nixCache.size () > 0)
     {
       *os << "Destination     NixVector" << std::endl;
-      for (NixMap_t::const_iterator it = m_nixCache.begin (); it != m_nixCache.end (); it++)
+      for (NixMap_t::const_iterator it = nixCache.begin (); it != nixCache.end (); it++)
         {
           std::ostringstream dest;
           dest << it->first;
@@ -677,10 +891,10 @@ Ipv4NixVectorRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
         }
     }
   *os << "Ipv4RouteCache:" << std::endl;
-  if (m_ipv4RouteCache.size () > 0)
+  if (ipv4RouteCache.size () > 0)
     {
       *os << "Destination     Gateway         Source            OutputDevice" << std::endl;
-      for (Ipv4RouteMap_t::const_iterator it = m_ipv4RouteCache.begin (); it != m_ipv4RouteCache.end (); it++)
+      for (Ipv4RouteMap_t::const_iterator it = ipv4RouteCache.begin (); it != ipv4RouteCache.end (); it++)
         {
           std::ostringstream dest, gw, src;
           dest << it->second->GetDestination ();
@@ -726,147 +940,80 @@ Ipv4NixVectorRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddr
 }
 
 bool
-Ipv4NixVectorRouting::BFS (uint32_t numberOfNodes, Ptr<Node> source, 
-                           Ptr<Node> dest, std::vector< Ptr<Node> > & parentVector,
-                           Ptr<NetDevice> oif)
+Ipv4NixVectorRouting::BFS (const Topology & topology, BfsState & state, uint32_t source,
+                           uint32_t dest, Ptr<NetDevice> oif)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  NS_LOG_LOGIC ("Going from Node " << source->GetId () << " to Node " << dest->GetId ());
-  std::queue< Ptr<Node> > greyNodeList;  // discovered nodes with unexplored children
+  NS_LOG_LOGIC ("Going from Node " << source << " to Node " << dest);
 
-  // reset the parent vector
-  parentVector.clear ();
-  parentVector.reserve (sizeof (Ptr<Node>)*numberOfNodes);
-  parentVector.insert (parentVector.begin (), sizeof (Ptr<Node>)*numberOfNodes, 0); // initialize to 0
+  // reset the parent vector: the nodes discovered by the
+  // previous search are the ones it left in the queue
+  std::vector<uint32_t> &greyNodeList = state.queue;  // discovered nodes with unexplored children
+  for (std::vector<uint32_t>::const_iterator i = greyNodeList.begin (); i != greyNodeList.end (); i++)
+    {
+      state.parent[*i] = Topology::NO_NODE;
+    }
+  greyNodeList.clear ();
 
   // Add the source node to the queue, set its parent to itself 
-  greyNodeList.push (source);
-  parentVector.at (source->GetId ()) = source;
+  greyNodeList.push_back (source);
+  state.parent[source] = source;
+
+  if (source == dest)
+    {
+      return true;
+    }
 
   // BFS loop
-  while (greyNodeList.size () != 0)
+  for (uint32_t head = 0; head < greyNodeList.size (); head++)
     {
-      Ptr<Node> currNode = greyNodeList.front ();
-      Ptr<Ipv4> ipv4 = currNode->GetObject<Ipv4> ();
- 
-      if (currNode == dest) 
-        {
-          NS_LOG_LOGIC ("Made it to Node " << currNode->GetId ());
-          return true;
-        }
+      uint32_t currNode = greyNodeList[head];
+      uint32_t firstDevice = topology.nodeDevices[currNode];
+      uint32_t lastDevice = topology.nodeDevices[currNode + 1];
 
       // if this is the first iteration of the loop and a 
       // specific output interface was given, make sure 
       // we go this way
-      if (currNode == source && oif)
+      if (head == 0 && oif)
         {
-          // make sure that we can go this way
-          if (ipv4)
-            {
-              uint32_t interfaceIndex = (ipv4)->GetInterfaceForDevice (oif);
-              if (!(ipv4->IsUp (interfaceIndex)))
-                {
-                  NS_LOG_LOGIC ("Ipv4Interface is down");
-                  return false;
-                }
-            }
-          if (!(oif->IsLinkUp ()))
+          firstDevice += oif->GetIfIndex ();
+          lastDevice = firstDevice + 1;
+          if (!(topology.deviceFlags[firstDevice] & Topology::DEVICE_UP))
             {
-              NS_LOG_LOGIC ("Link is down.");
-              return false;
-            }
-          Ptr<Channel> channel = oif->GetChannel ();
-          if (channel == 0)
-            { 
+              NS_LOG_LOGIC ("Can't go out through " << oif);
               return false;
             }
+        }
 
-          // this function takes in the local net dev, and channnel, and
-          // writes to the netDeviceContainer the adjacent net devs
-          NetDeviceContainer netDeviceContainer;
-          GetAdjacentNetDevices (oif, channel, netDeviceContainer);
-
-          // Finally we can get the adjacent nodes
-          // and scan through them.  We push them
-          // to the greyNode queue, if they aren't 
-          // already there.
-          for (NetDeviceContainer::Iterator iter = netDeviceContainer.Begin (); iter != netDeviceContainer.End (); iter++)
+      // Iterate over the current node's adjacent vertices
+      // and push them into the queue
+      for (uint32_t d = firstDevice; d < lastDevice; d++)
+        {
+          if (!(topology.deviceFlags[d] & Topology::DEVICE_UP))
+            {
+              continue;
+            }
+          for (uint32_t j = topology.deviceNeighbors[d]; j < topology.deviceNeighbors[d + 1]; j++)
             {
-              Ptr<Node> remoteNode = (*iter)->GetNode ();
+              uint32_t remoteNode = topology.neighborNode[j];
 
               // check to see if this node has been pushed before
               // by checking to see if it has a parent
-              // if it doesn't (null or 0), then set its parent and 
+              // if it doesn't, then set its parent and 
               // push to the queue
-              if (parentVector.at (remoteNode->GetId ()) == 0)
-                {
-                  parentVector.at (remoteNode->GetId ()) = currNode;
-                  greyNodeList.push (remoteNode);
-                }
-            }
-        }
-      else
-        {
-          // Iterate over the current node's adjacent vertices
-          // and push them into the queue
-          for (uint32_t i = 0; i < (currNode->GetNDevices ()); i++)
-            {
-              // Get a net device from the node
-              // as well as the channel, and figure
-              // out the adjacent net device
-              Ptr<NetDevice> localNetDevice = currNode->GetDevice (i);
-
-              // make sure that we can go this way
-              if (ipv4)
+              if (state.parent[remoteNode] == Topology::NO_NODE)
                 {
-                  uint32_t interfaceIndex = (ipv4)->GetInterfaceForDevice (currNode->GetDevice (i));
-                  if (!(ipv4->IsUp (interfaceIndex)))
+                  state.parent[remoteNode] = currNode;
+                  greyNodeList.push_back (remoteNode);
+                  if (remoteNode == dest)
                     {
-                      NS_LOG_LOGIC ("Ipv4Interface is down");
-                      continue;
-                    }
-                }
-              if (!(localNetDevice->IsLinkUp ()))
-                {
-                  NS_LOG_LOGIC ("Link is down.");
-                  continue;
-                }
-              Ptr<Channel> channel = localNetDevice->GetChannel ();
-              if (channel == 0)
-                { 
-                  continue;
-                }
-
-              // this function takes in the local net dev, and channnel, and
-              // writes to the netDeviceContainer the adjacent net devs
-              NetDeviceContainer netDeviceContainer;
-              GetAdjacentNetDevices (localNetDevice, channel, netDeviceContainer);
-
-              // Finally we can get the adjacent nodes
-              // and scan through them.  We push them
-              // to the greyNode queue, if they aren't 
-              // already there.
-              for (NetDeviceContainer::Iterator iter = netDeviceContainer.Begin (); iter != netDeviceContainer.End (); iter++)
-                {
-                  Ptr<Node> remoteNode = (*iter)->GetNode ();
-
-                  // check to see if this node has been pushed before
-                  // by checking to see if it has a parent
-                  // if it doesn't (null or 0), then set its parent and 
-                  // push to the queue
-                  if (parentVector.at (remoteNode->GetId ()) == 0)
-                    {
-                      parentVector.at (remoteNode->GetId ()) = currNode;
-                      greyNodeList.push (remoteNode);
+                      NS_LOG_LOGIC ("Made it to Node " << remoteNode);
+                      return true;
                     }
                 }
             }
         }
-
-      // Pop off the head grey node.  We have all its children.
-      // It is now black.
-      greyNodeList.pop ();
     }
 
   // Didn't find the dest...
@@ -22,6 +22,8 @@
 #define IPV4_NIX_VECTOR_ROUTING_H
 
 #include <map>
+#include <list>
+#include <vector>
 
 #include "ns3/channel.h"
 #include "ns3/node-container.h"
@@ -31,6 +33,7 @@
 #include "ns3/ipv4-route.h"
 #include "ns3/nix-vector.h"
 #include "ns3/bridge-net-device.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -68,12 +71,71 @@ public:
   /**
    * @brief Called when run-time link topology change occurs
    * which iterates through the node list and flushes any
-   * nix vector caches
+   * nix vector caches.  Fatal while several threads run the
+   * simulation, see Multithreading::IsEnabled ()
    *
    */
   void FlushGlobalNixRoutingCache (void);
 
 private:
+  /* cache of nix-vectors or Ipv4Routes keyed by destination IP.
+   * Lookups are hashed; with a non-zero maximum size, inserting
+   * into a full cache evicts the least recently used entry */
+  template <typename T>
+  class DestinationCache
+  {
+public:
+    typedef std::list<std::pair<Ipv4Address, T> > List_t;
+
+    /* returns the cached value, or 0 if there is none */
+    T Lookup (Ipv4Address address)
+    {
+      typename Map_t::iterator i = m_map.find (address);
+      if (i == m_map.end ())
+        {
+          return 0;
+        }
+      // move to the front: the most recently used
+      m_list.splice (m_list.begin (), m_list, i->second);
+      return i->second->second;
+    }
+    void Insert (Ipv4Address address, T value, uint32_t maxSize)
+    {
+      Erase (address);
+      if (maxSize != 0 && m_list.size () >= maxSize)
+        {
+          m_map.erase (m_list.back ().first);
+          m_list.pop_back ();
+        }
+      m_list.push_front (std::make_pair (address, value));
+      m_map[address] = m_list.begin ();
+    }
+    void Erase (Ipv4Address address)
+    {
+      typename Map_t::iterator i = m_map.find (address);
+      if (i != m_map.end ())
+        {
+          m_list.erase (i->second);
+          m_map.erase (i);
+        }
+    }
+    void Clear (void)
+    {
+      m_list.clear ();
+      m_map.clear ();
+    }
+    /* entries, most recently used first */
+    const List_t & GetEntries (void) const
+    {
+      return m_list;
+    }
+
+private:
+    typedef sgi::hash_map<Ipv4Address, typename List_t::iterator, Ipv4AddressHash> Map_t;
+    List_t m_list;
+    Map_t m_map;
+  };
+
   /* flushes the cache which stores nix-vector based on
    * destination IP */
   void FlushNixCache (void);
@@ -102,12 +164,43 @@ private:
    * essentially getting the neighbors on that channel */
   void GetAdjacentNetDevices (Ptr<NetDevice>, Ptr<Channel>, NetDeviceContainer &);
 
-  /* iterates through the node list and finds the one
-   * corresponding to the given Ipv4Address */
-  Ptr<Node> GetNodeByIp (Ipv4Address);
+  /* snapshot of the node/device/channel graph shared by all
+   * the nix-vector routing instances; see the .cc file */
+  struct Topology;
+
+  /* the parent vector and queue of the searches of a thread */
+  struct BfsState;
+
+  /* finds the node corresponding to the given Ipv4Address */
+  Ptr<Node> GetNodeByIp (const Topology & topology, Ipv4Address);
+
+  /* returns the topology snapshot, valid or not */
+  static Topology & GetTopology (void);
 
-  /* Recurses the parent vector, created by BFS and actually builds the nixvector */
-  bool BuildNixVector (const std::vector< Ptr<Node> > & parentVector, uint32_t source, uint32_t dest, Ptr<NixVector> nixVector);
+  /* returns the topology snapshot, rebuilding it first if it was
+   * flushed or the node list has grown since it was built */
+  Topology & UpdateTopology (void);
+
+  /* walks every node, net-device and channel to fill in
+   * the topology snapshot */
+  void BuildTopology (Topology & topology);
+
+  /* releases the topology snapshot, and the BfsStates, at
+   * Simulator::Destroy () */
+  static void DestroyTopology (void);
+
+  /* returns the BfsState of the calling thread, sized for the
+   * given snapshot */
+  static BfsState & GetBfsState (Topology & topology);
+
+  /* returns the BFS tree rooted at the given node and covering all
+   * the destinations, computing it first if needed.  The trees are
+   * shared by all the nodes */
+  const std::vector<uint32_t> & GetSourceTree (Topology & topology, BfsState & state, uint32_t source);
+
+  /* Walks back the parent vector, created by BFS and actually builds the nixvector */
+  bool BuildNixVector (const Topology & topology, const std::vector<uint32_t> & parentVector,
+                       uint32_t source, uint32_t dest, Ptr<NixVector> nixVector);
 
   /* special variation of BuildNixVector for when a node is sending to itself */
   bool BuildNixVectorLocal (Ptr<NixVector> nixVector);
@@ -125,17 +218,18 @@ private:
   uint32_t FindNetDeviceForNixIndex (uint32_t nodeIndex, Ipv4Address & gatewayIp);
 
   /* Breadth first search algorithm
-   * Param1: total number of nodes
-   * Param2: Source Node
-   * Param3: Dest Node
-   * Param4: (returned) Parent vector for retracing routes
+   * Param1: topology snapshot
+   * Param2: state of the search; its parent vector is filled in
+   *         for retracing routes
+   * Param3: Source Node id
+   * Param4: Dest Node id, or an invalid id to reach all the nodes
    * Param5: specific output interface to use from source node, if not null
    * Returns: false if dest not found, true o.w.
    */
-  bool BFS (uint32_t numberOfNodes,
-            Ptr<Node> source,
-            Ptr<Node> dest,
-            std::vector< Ptr<Node> > & parentVector,
+  bool BFS (const Topology & topology,
+            BfsState & state,
+            uint32_t source,
+            uint32_t dest,
             Ptr<NetDevice> oif);
 
   void DoDispose (void);
@@ -154,10 +248,18 @@ private:
 
 
   /* cache stores nix-vectors based on destination ip */
-  NixMap_t m_nixCache;
+  DestinationCache<Ptr<NixVector> > m_nixCache;
 
   /* cache stores Ipv4Routes based on destination ip */
-  Ipv4RouteMap_t m_ipv4RouteCache;
+  DestinationCache<Ptr<Ipv4Route> > m_ipv4RouteCache;
+
+  /* maximum number of entries in each of the caches above,
+   * 0 for no limit */
+  uint32_t m_cacheSize;
+
+  /* build nix-vectors from the shared per-source BFS trees
+   * rather than with one BFS per destination */
+  bool m_useSharedTrees;
 
   Ptr<Ipv4> m_ipv4;
   Ptr<Node> m_node;
@@ -24,6 +24,7 @@
 #include "ns3/point-to-point-net-device.h"
 #include "ns3/point-to-point-channel.h"
 #include "ns3/point-to-point-remote-channel.h"
+#include "ns3/ppp-header.h"
 #include "ns3/queue.h"
 #include "ns3/config.h"
 #include "ns3/packet.h"
@@ -105,6 +106,47 @@ PointToPointHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, b
   pcapHelper.HookDefaultSink<PointToPointNetDevice> (device, "PromiscSniffer", file);
 }
 
+void
+PointToPointHelper::EnableBinary (Ptr<BinaryTraceFile> file, Ptr<NetDevice> nd)
+{
+  Ptr<PointToPointNetDevice> device = nd->GetObject<PointToPointNetDevice> ();
+  if (device == 0)
+    {
+      NS_LOG_INFO ("PointToPointHelper::EnableBinary(): Device " << nd <<
+                   " not of type ns3::PointToPointNetDevice");
+      return;
+    }
+
+  //
+  // The packets in the transmit queue already carry the PPP header, the
+  // MacRx trace source provides them once it has been removed.
+  //
+  BinaryTraceHelper binaryTraceHelper;
+  binaryTraceHelper.HookDevice (file, device, device->GetQueue (), PppHeader ().GetSerializedSize ());
+}
+
+void
+PointToPointHelper::EnableBinary (Ptr<BinaryTraceFile> file, NetDeviceContainer d)
+{
+  for (NetDeviceContainer::Iterator i = d.Begin (); i != d.End (); ++i)
+    {
+      EnableBinary (file, *i);
+    }
+}
+
+void
+PointToPointHelper::EnableBinary (Ptr<BinaryTraceFile> file, NodeContainer n)
+{
+  for (NodeContainer::Iterator i = n.Begin (); i != n.End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      for (uint32_t j = 0; j < node->GetNDevices (); ++j)
+        {
+          EnableBinary (file, node->GetDevice (j));
+        }
+    }
+}
+
 void 
 PointToPointHelper::EnableAsciiInternal (
   Ptr<OutputStreamWrapper> stream, 
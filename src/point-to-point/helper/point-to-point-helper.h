@@ -146,6 +146,32 @@ public:
    */
   NetDeviceContainer Install (std::string aNode, std::string bNode);
 
+  /**
+   * \brief Enable binary trace output on the indicated net device.
+   *
+   * \param file The binary trace file, see BinaryTraceHelper::CreateFile.
+   * \param nd Net device for which you want to enable tracing.
+   */
+  void EnableBinary (Ptr<BinaryTraceFile> file, Ptr<NetDevice> nd);
+
+  /**
+   * \brief Enable binary trace output on each device in the container
+   * which is of type ns3::PointToPointNetDevice.
+   *
+   * \param file The binary trace file, see BinaryTraceHelper::CreateFile.
+   * \param d container of devices
+   */
+  void EnableBinary (Ptr<BinaryTraceFile> file, NetDeviceContainer d);
+
+  /**
+   * \brief Enable binary trace output on each device of type
+   * ns3::PointToPointNetDevice of each node in the container.
+   *
+   * \param file The binary trace file, see BinaryTraceHelper::CreateFile.
+   * \param n container of nodes
+   */
+  void EnableBinary (Ptr<BinaryTraceFile> file, NodeContainer n);
+
 private:
   /**
    * \brief Enable pcap output the indicated net device.
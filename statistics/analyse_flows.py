@@ -0,0 +1,73 @@
+import csv
+import sys
+
+# Flow completion times from the file written by FlowMonitor::EnableFlowExport.
+# Same arguments and output as analyse.py, but the file is read one line
+# at a time and only the times of the selected flows are kept in memory.
+
+if(len(sys.argv) < 2):
+   print "Usage: python analyse_flows.py <csv file> <output cdf (optional)> <'bg_flows', optional, default='fg_flows')"
+   sys.exit()
+
+csvfile = sys.argv[1]
+
+outputcdf = False
+if(len(sys.argv) > 2 and sys.argv[2] == "cdf"):
+   outputcdf = True
+
+consider_bg_flows = False
+if(len(sys.argv) > 3 and sys.argv[3] == "bg_flows"):
+   consider_bg_flows = True
+
+bg_port = '9'
+fg_port = '10'
+
+port = fg_port
+if(consider_bg_flows == True):
+   port = bg_port
+
+# a flow which sent again after being exported has several lines,
+# its last reception is the latest of them
+bg_flows = 0
+fg_flows = 0
+seen = set()
+last_rx_times = {}
+incomplete = 0
+for flow in csv.DictReader(open(csvfile)):
+   flowid = int(flow['flowId'])
+   if(flow['complete'] == '0'):
+      incomplete += 1
+   if(flowid not in seen):
+      seen.add(flowid)
+      if(flow['sourcePort'] == fg_port):
+         fg_flows += 1
+      elif(flow['sourcePort'] == bg_port):
+         bg_flows += 1
+   if(flow['sourcePort'] != port):
+      continue
+   last_rx_time = int(flow['timeLastRxPacket'])
+   last_rx_times[flowid] = max(last_rx_times.get(flowid, 0), last_rx_time)
+
+print "|bg_flows|: ", bg_flows
+print "|fg_flows|: ", fg_flows
+if(incomplete > 0):
+   print "incomplete flows at the end of the run: ", incomplete
+
+flow_times = [x / 1000.0 for x in last_rx_times.itervalues()]
+
+flow_times.sort()
+if(outputcdf):
+   flow_times = [x/1000.0 - 1000.0 for x in flow_times]
+   for x in flow_times:
+      print x
+else:
+   app_completion_time = flow_times[-1]
+   ile_50 = (flow_times[(50 * len(flow_times) + 50)/100 - 1] - 1000000.0)/1000.0
+   ile_90 = (flow_times[(90 * len(flow_times) + 90)/100 - 1] - 1000000.0)/1000.0
+   ile_99 = (flow_times[(99 * len(flow_times) + 99)/100 - 1] - 1000000.0)/1000.0
+   avg_fct = (sum(flow_times)/len(flow_times) - 1000000.0)/1000.0
+   print "num flows: ", len(flow_times)
+   print "50%ile fct (us): ", ile_50
+   print "90%ile fct (us): ", ile_90
+   print "99%ile fct (us): ", ile_99
+   print "Avg fct (us): ", avg_fct
@@ -24,9 +24,43 @@
 #include <sstream>
 #include <string>
 #include <stdlib.h> // for exit ()
+#include <new>
 
 using namespace ns3;
 
+// Count the heap allocations made by the benchmarks
+static uint64_t g_nAllocations = 0;
+
+void *
+operator new (size_t size) throw (std::bad_alloc)
+{
+  g_nAllocations++;
+  void *p = malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new [] (size_t size) throw (std::bad_alloc)
+{
+  return operator new (size);
+}
+
+void
+operator delete (void *p) throw ()
+{
+  free (p);
+}
+
+void
+operator delete [] (void *p) throw ()
+{
+  free (p);
+}
+
 template <int N>
 class BenchHeader : public Header
 {
@@ -242,17 +276,77 @@ benchC (uint32_t n)
 }
 
 
+// A packet forwarded over four hops, as by Ipv4L3Protocol over
+// point-to-point links: each hop copies the packet on reception and
+// again on forwarding.
+static void
+benchE (uint32_t n)
+{
+  BenchHeader<20> tcp;
+  BenchHeader<20> ipv4;
+  BenchHeader<2> ppp;
+  BenchTag<12> tag;
+
+  for (uint32_t i = 0; i < n; i++) {
+    Ptr<Packet> p = Create<Packet> (1000);
+    p->AddHeader (tcp);
+    p->AddPacketTag (tag);
+    p->AddHeader (ipv4);
+    p->AddHeader (ppp);
+    for (uint32_t hop = 0; hop < 4; hop++) {
+      p->RemoveHeader (ppp);
+      Ptr<Packet> received = p->Copy ();
+      received->RemoveHeader (ipv4);
+      Ptr<Packet> forwarded = received->Copy ();
+      forwarded->AddHeader (ipv4);
+      forwarded->AddHeader (ppp);
+      p = forwarded;
+    }
+    p->RemoveHeader (ppp);
+    Ptr<Packet> received = p->Copy ();
+    received->RemoveHeader (ipv4);
+    received->RemovePacketTag (tag);
+    received->RemoveHeader (tcp);
+  }
+}
+
+// An empty packet, such as a TCP acknowledgment, sent over one hop
+static void
+benchF (uint32_t n)
+{
+  BenchHeader<20> tcp;
+  BenchHeader<20> ipv4;
+  BenchHeader<2> ppp;
+
+  for (uint32_t i = 0; i < n; i++) {
+    Ptr<Packet> p = Create<Packet> ();
+    p->AddHeader (tcp);
+    p->AddHeader (ipv4);
+    p->AddHeader (ppp);
+    p->RemoveHeader (ppp);
+    Ptr<Packet> received = p->Copy ();
+    received->RemoveHeader (ipv4);
+    received->RemoveHeader (tcp);
+  }
+}
+
+
 static void
 runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
 {
   SystemWallClockMs time;
+  // warm up, so that the free lists are filled
+  (*bench) (100);
+  uint64_t nAllocations = g_nAllocations;
   time.Start ();
   (*bench) (n);
   uint64_t deltaMs = time.End ();
+  nAllocations = g_nAllocations - nAllocations;
   double ps = n;
   ps *= 1000;
   ps /= deltaMs;
-  std::cout << name<<"=" << ps << " packets/s" << std::endl;
+  std::cout << name<<"=" << ps << " packets/s, "
+            << (double)nAllocations / n << " allocations/packet" << std::endl;
 }
 
 int main (int argc, char *argv[])
@@ -285,6 +379,8 @@ int main (int argc, char *argv[])
   runBench (&benchB, n, "b");
   runBench (&benchC, n, "c");
   runBench (&benchD, n, "d");
+  runBench (&benchE, n, "e");
+  runBench (&benchF, n, "f");
 
   return 0;
 }
@@ -135,6 +135,9 @@ PrintHelp (void)
   std::cout << "      --list: use std::list scheduler"<<std::endl;
   std::cout << "      --map: use std::map cheduler"<<std::endl;
   std::cout << "      --heap: use Binary Heap scheduler"<<std::endl;
+  std::cout << "      --dary: use 4-ary Heap scheduler"<<std::endl;
+  std::cout << "      --calendar: use Calendar Queue scheduler"<<std::endl;
+  std::cout << "      --ns2calendar: use ns-2 Calendar Queue scheduler"<<std::endl;
   std::cout << "      --debug: enable some debugging"<<std::endl;
 }
 
@@ -174,14 +177,24 @@ int main (int argc, char *argv[])
         } 
       else if (strcmp ("--map", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::HeapScheduler");
+          factory.SetTypeId ("ns3::MapScheduler");
           Simulator::SetScheduler (factory);
         } 
+      else if (strcmp ("--dary", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::DaryHeapScheduler");
+          Simulator::SetScheduler (factory);
+        }
       else if (strcmp ("--calendar", argv[0]) == 0)
         {
           factory.SetTypeId ("ns3::CalendarScheduler");
           Simulator::SetScheduler (factory);
         }
+      else if (strcmp ("--ns2calendar", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::Ns2CalendarScheduler");
+          Simulator::SetScheduler (factory);
+        }
       else if (strcmp ("--debug", argv[0]) == 0) 
         {
           g_debug = true;
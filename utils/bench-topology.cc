@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/system-wall-clock-ms.h"
+
+using namespace ns3;
+
+// Time the set up of a k-ary fat-tree, built link by link with the
+// PointToPointHelper and an Ipv4AddressHelper as the scratch programs
+// do, then in bulk with the PointToPointEdgeListHelper.
+//
+// The switches are numbered as in the topology files: the k * k / 2
+// edge switches, the k * k / 2 aggregation switches, then the
+// k * k / 4 core switches.
+
+static uint32_t
+EdgeSwitch (uint32_t k, uint32_t host)
+{
+  return host / (k / 2);
+}
+
+static uint32_t
+AggregationSwitch (uint32_t k, uint32_t edge, uint32_t a)
+{
+  return k * k / 2 + (edge / (k / 2)) * (k / 2) + a;
+}
+
+static uint32_t
+CoreSwitch (uint32_t k, uint32_t aggregation, uint32_t c)
+{
+  return k * k + ((aggregation - k * k / 2) % (k / 2)) * (k / 2) + c;
+}
+
+static PointToPointHelper
+CreatePointToPointHelper (void)
+{
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("1us"));
+  return p2p;
+}
+
+static void
+Report (char const *name, uint32_t k, uint32_t nLinks, uint64_t buildMs, uint64_t destroyMs)
+{
+  std::cout << name << " k=" << k << " links=" << nLinks
+            << " build=" << buildMs << "ms destroy=" << destroyMs << "ms "
+            << (double)buildMs * 1000 / nLinks << "us/link" << std::endl;
+}
+
+static void
+BenchLinks (uint32_t k)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  NodeContainer hosts;
+  NodeContainer switches;
+  hosts.Create (k * k * k / 4);
+  switches.Create (k * k * 5 / 4);
+  InternetStackHelper stack;
+  stack.Install (switches);
+  stack.Install (hosts);
+
+  PointToPointHelper p2p = CreatePointToPointHelper ();
+  Ipv4AddressHelper address;
+  uint32_t nLinks = 0;
+  for (uint32_t i = 0; i < k * k * k * 3 / 4; i++)
+    {
+      NodeContainer nodes;
+      if (i < hosts.GetN ())
+        {
+          nodes = NodeContainer (hosts.Get (i), switches.Get (EdgeSwitch (k, i)));
+        }
+      else if (i < 2 * hosts.GetN ())
+        {
+          uint32_t j = i - hosts.GetN ();
+          nodes = NodeContainer (switches.Get (j / (k / 2)),
+                                 switches.Get (AggregationSwitch (k, j / (k / 2), j % (k / 2))));
+        }
+      else
+        {
+          uint32_t j = i - 2 * hosts.GetN ();
+          uint32_t aggregation = k * k / 2 + j / (k / 2);
+          nodes = NodeContainer (switches.Get (aggregation),
+                                 switches.Get (CoreSwitch (k, aggregation, j % (k / 2))));
+        }
+      NetDeviceContainer devices = p2p.Install (nodes);
+      std::ostringstream base;
+      base << "10." << (i >> 14) << "." << ((i >> 6) & 255) << "." << ((i & 63) << 2);
+      address.SetBase (base.str ().c_str (), "255.255.255.252");
+      address.Assign (devices);
+      nLinks++;
+    }
+  uint64_t buildMs = time.End ();
+
+  time.Start ();
+  Simulator::Destroy ();
+  Ipv4AddressGenerator::Reset ();
+  Report ("links", k, nLinks, buildMs, time.End ());
+}
+
+static void
+BenchEdgeList (uint32_t k)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  PointToPointEdgeListHelper topology (CreatePointToPointHelper ());
+  for (uint32_t host = 0; host < k * k * k / 4; host++)
+    {
+      topology.AddHost (host, EdgeSwitch (k, host));
+    }
+  for (uint32_t edge = 0; edge < k * k / 2; edge++)
+    {
+      for (uint32_t a = 0; a < k / 2; a++)
+        {
+          topology.AddSwitchLink (edge, AggregationSwitch (k, edge, a));
+        }
+    }
+  for (uint32_t aggregation = k * k / 2; aggregation < k * k; aggregation++)
+    {
+      for (uint32_t c = 0; c < k / 2; c++)
+        {
+          topology.AddSwitchLink (aggregation, CoreSwitch (k, aggregation, c));
+        }
+    }
+  InternetStackHelper stack;
+  topology.Install (stack);
+  uint64_t buildMs = time.End ();
+
+  time.Start ();
+  Simulator::Destroy ();
+  Ipv4AddressGenerator::Reset ();
+  Report ("edge-list", k, k * k * k * 3 / 4, buildMs, time.End ());
+}
+
+int main (int argc, char *argv[])
+{
+  std::vector<uint32_t> ks;
+  for (int i = 1; i < argc; i++)
+    {
+      if (strncmp ("--k=", argv[i], strlen ("--k=")) == 0)
+        {
+          ks.push_back (atoi (argv[i] + strlen ("--k=")));
+        }
+    }
+  if (ks.empty ())
+    {
+      ks.push_back (8);
+      ks.push_back (16);
+      ks.push_back (24);
+    }
+
+  for (std::vector<uint32_t>::const_iterator k = ks.begin (); k != ks.end (); ++k)
+    {
+      if (*k < 2 || *k % 2 != 0)
+        {
+          std::cerr << "Error-- k must be even, got " << *k << std::endl;
+          exit (1);
+        }
+      BenchLinks (*k);
+      BenchEdgeList (*k);
+    }
+  return 0;
+}
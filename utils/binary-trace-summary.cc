@@ -0,0 +1,230 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Nanyang Technological University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+//
+// Per-flow summary of binary trace files, as written by BinaryTraceHelper.
+//
+// This is the binary counterpart of statistics/analyse_ascii/analyse_ascii.py
+// and writes the same output: for each flow seen in the traces, one line
+//
+//   proto srcip dstip srcport dstport minEnqueue maxReceive nEnqueue nReceive
+//
+// where the times are in seconds. The records are streamed through the
+// BinaryTraceFile read buffer, so the traces are never held in memory.
+//
+
+#include "ns3/binary-trace-file.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+struct FlowKey
+{
+  uint32_t source;
+  uint32_t destination;
+  uint16_t sourcePort;
+  uint16_t destinationPort;
+  uint8_t protocol;
+};
+
+bool operator == (const FlowKey &a, const FlowKey &b)
+{
+  return a.source == b.source && a.destination == b.destination
+         && a.sourcePort == b.sourcePort && a.destinationPort == b.destinationPort
+         && a.protocol == b.protocol;
+}
+
+bool operator < (const FlowKey &a, const FlowKey &b)
+{
+  if (a.protocol != b.protocol)
+    {
+      return a.protocol < b.protocol;
+    }
+  if (a.source != b.source)
+    {
+      return a.source < b.source;
+    }
+  if (a.destination != b.destination)
+    {
+      return a.destination < b.destination;
+    }
+  if (a.sourcePort != b.sourcePort)
+    {
+      return a.sourcePort < b.sourcePort;
+    }
+  return a.destinationPort < b.destinationPort;
+}
+
+struct FlowKeyHash
+{
+  size_t operator () (const FlowKey &key) const
+  {
+    uint32_t hash = key.source * 2654435761U;
+    hash ^= key.destination + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= ((key.sourcePort << 16) | key.destinationPort) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash ^ key.protocol;
+  }
+};
+
+struct FlowEntry
+{
+  FlowEntry ()
+    : minEnqueue (100000000000000000LL), // 1e8 seconds, as analyse_ascii.py
+      maxReceive (0),
+      nEnqueue (0),
+      nReceive (0)
+  {
+  }
+  int64_t minEnqueue;
+  int64_t maxReceive;
+  uint64_t nEnqueue;
+  uint64_t nReceive;
+};
+
+typedef sgi::hash_map<FlowKey, FlowEntry, FlowKeyHash> FlowMap;
+
+static bool
+CompareFlows (const std::pair<FlowKey, FlowEntry> &a, const std::pair<FlowKey, FlowEntry> &b)
+{
+  return a.first < b.first;
+}
+
+static void
+Summarize (BinaryTraceFile &file, FlowMap &flows)
+{
+  uint64_t enqueued = 0;
+  uint64_t dequeued = 0;
+  uint64_t dropped = 0;
+  uint64_t received = 0;
+  uint64_t other = 0;
+  BinaryTraceRecord record;
+  while (file.Read (record))
+    {
+      if (record.type == '-')
+        {
+          dequeued++;
+          continue;
+        }
+      if (record.type == 'd')
+        {
+          dropped++;
+          continue;
+        }
+      if (record.type != '+' && record.type != 'r')
+        {
+          other++;
+          continue;
+        }
+      FlowKey key;
+      key.source = record.source;
+      key.destination = record.destination;
+      key.sourcePort = record.sourcePort;
+      key.destinationPort = record.destinationPort;
+      key.protocol = record.protocol;
+      FlowEntry &flow = flows[key];
+      if (record.type == '+')
+        {
+          enqueued++;
+          flow.minEnqueue = std::min (flow.minEnqueue, record.time);
+          flow.nEnqueue++;
+        }
+      else
+        {
+          received++;
+          flow.maxReceive = std::max (flow.maxReceive, record.time);
+          flow.nReceive++;
+        }
+    }
+  std::cout << enqueued << " " << dequeued << " " << dropped << " " << received;
+  if (other != 0)
+    {
+      std::cout << " (" << other << " unknown records)";
+    }
+  std::cout << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  if (argc < 3)
+    {
+      std::cerr << "Arguments: <File containing list of all binary trace files> <output file>" << std::endl;
+      return 1;
+    }
+
+  std::ifstream list (argv[1]);
+  if (!list)
+    {
+      std::cerr << "Unable to open " << argv[1] << std::endl;
+      return 1;
+    }
+
+  FlowMap flows;
+  std::string filename;
+  while (std::getline (list, filename))
+    {
+      if (filename.empty ())
+        {
+          continue;
+        }
+      std::cout << "Opening binary trace file " << filename << std::endl;
+      BinaryTraceFile file;
+      file.Open (filename, std::ios::in);
+      if (file.Fail ())
+        {
+          std::cerr << "Unable to read " << filename << std::endl;
+          return 1;
+        }
+      Summarize (file, flows);
+    }
+  std::cout << flows.size () << std::endl;
+
+  std::vector<std::pair<FlowKey, FlowEntry> > sorted (flows.begin (), flows.end ());
+  std::sort (sorted.begin (), sorted.end (), CompareFlows);
+
+  FILE *out = fopen (argv[2], "w");
+  if (out == 0)
+    {
+      std::cerr << "Unable to open " << argv[2] << std::endl;
+      return 1;
+    }
+  for (std::vector<std::pair<FlowKey, FlowEntry> >::const_iterator i = sorted.begin ();
+       i != sorted.end (); ++i)
+    {
+      const FlowKey &key = i->first;
+      const FlowEntry &flow = i->second;
+      std::ostringstream source;
+      std::ostringstream destination;
+      Ipv4Address (key.source).Print (source);
+      Ipv4Address (key.destination).Print (destination);
+      fprintf (out, "%u %s %s %u %u %.9f %.9f %llu %llu\n",
+               key.protocol, source.str ().c_str (), destination.str ().c_str (),
+               key.sourcePort, key.destinationPort,
+               flow.minEnqueue / 1e9, flow.maxReceive / 1e9,
+               (unsigned long long)flow.nEnqueue, (unsigned long long)flow.nReceive);
+    }
+  fclose (out);
+  return 0;
+}